@@ -26,6 +26,7 @@
 #include "messages.h"
 #include "children.h"
 #include "dnscache.h"
+#include "dns-resolver.h"
 #include "alarms.h"
 #include "stats/stats-registry.h"
 #include "logmsg/logmsg.h"
@@ -168,6 +169,7 @@ app_startup(void)
   hostname_global_init();
   dns_caching_global_init();
   dns_caching_thread_init();
+  dns_resolver_global_init();
   afinter_global_init();
   child_manager_init();
   alarm_init();
@@ -224,6 +226,7 @@ app_shutdown(void)
   log_msg_global_deinit();
 
   afinter_global_deinit();
+  dns_resolver_global_deinit();
   stats_destroy();
   child_manager_deinit();
   g_list_foreach(application_hooks, (GFunc) g_free, NULL);
@@ -60,6 +60,12 @@ g_atomic_counter_exchange_and_add(GAtomicCounter *c, gint val)
 #endif
 }
 
+static inline gboolean
+g_atomic_counter_compare_and_exchange(GAtomicCounter *c, gint oldval, gint newval)
+{
+  return g_atomic_int_compare_and_exchange(&c->counter, oldval, newval);
+}
+
 static inline gint
 g_atomic_counter_racy_get(GAtomicCounter *c)
 {
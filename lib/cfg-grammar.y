@@ -182,6 +182,7 @@
 %token KW_TYPE                        10083
 %token KW_STATS_MAX_DYNAMIC           10084
 %token KW_MIN_IW_SIZE_PER_READER      10085
+%token KW_STATS_SHARDED_COUNTERS      10086
 %token KW_BATCH_LINES                 10087
 %token KW_BATCH_TIMEOUT               10088
 %token KW_TRIM_LARGE_MESSAGES         10089
@@ -204,6 +205,8 @@
 %token KW_DNS_CACHE_EXPIRE            10130
 %token KW_DNS_CACHE_EXPIRE_FAILED     10131
 %token KW_DNS_CACHE_HOSTS             10132
+%token KW_DNS_CACHE_ASYNC             10133
+%token KW_DNS_CACHE_RESOLVER_THREADS  10134
 
 %token KW_PERSIST_ONLY                10140
 %token KW_USE_RCPTID                  10141
@@ -335,6 +338,12 @@
 %token KW_RETRIES                     10512
 
 %token KW_FETCH_NO_DATA_DELAY         10513
+%token KW_WORKER_SELECTION            10514
+%token KW_WORKER_PARTITION_KEY        10515
+%token KW_WORKER_STEALING             10516
+%token KW_BATCH_ADAPTATION            10517
+%token KW_BATCH_LATENCY_TARGET        10518
+%token KW_STATS_SNAPSHOT_FREQ         10519
 /* END_DECLS */
 
 %type   <ptr> expr_stmt
@@ -963,6 +972,8 @@ stat_option
 	| KW_STATS_LEVEL '(' nonnegative_integer ')'         { last_stats_options->level = $3; }
 	| KW_STATS_LIFETIME '(' positive_integer ')'      { last_stats_options->lifetime = $3; }
   | KW_STATS_MAX_DYNAMIC '(' nonnegative_integer ')'   { last_stats_options->max_dynamic = $3; }
+	| KW_STATS_SHARDED_COUNTERS '(' yesno ')'          { last_stats_options->sharded_counters = $3; }
+	| KW_STATS_SNAPSHOT_FREQ '(' nonnegative_integer ')' { last_stats_options->snapshot_freq = $3; }
 	;
 
 dns_cache_option
@@ -971,6 +982,9 @@ dns_cache_option
 	| KW_DNS_CACHE_EXPIRE_FAILED '(' positive_integer ')'
 	                                        { last_dns_cache_options->expire_failed = $3; }
 	| KW_DNS_CACHE_HOSTS '(' string ')'     { last_dns_cache_options->hosts = g_strdup($3); free($3); }
+	| KW_DNS_CACHE_ASYNC '(' yesno ')'      { last_dns_cache_options->async = $3; }
+	| KW_DNS_CACHE_RESOLVER_THREADS '(' positive_integer ')'
+	                                        { last_dns_cache_options->resolver_threads = $3; }
         ;
 
 
@@ -1202,7 +1216,25 @@ threaded_dest_driver_option
         }
         | KW_BATCH_LINES '(' nonnegative_integer ')' { log_threaded_dest_driver_set_batch_lines(last_driver, $3); }
         | KW_BATCH_TIMEOUT '(' positive_integer ')' { log_threaded_dest_driver_set_batch_timeout(last_driver, $3); }
+        | KW_BATCH_ADAPTATION '(' string ')'
+          {
+            CHECK_ERROR(log_threaded_dest_driver_set_batch_adaptation(last_driver, $3), @3,
+                        "unknown batch-adaptation() argument \"%s\", expected none, throughput or latency", $3);
+            free($3);
+          }
+        | KW_BATCH_LATENCY_TARGET '(' positive_integer ')' { log_threaded_dest_driver_set_batch_latency_target(last_driver, $3); }
         | KW_TIME_REOPEN '(' positive_integer ')' { log_threaded_dest_driver_set_time_reopen(last_driver, $3); }
+        | KW_WORKER_SELECTION '(' string ')'
+          {
+            CHECK_ERROR(log_threaded_dest_driver_set_worker_selection(last_driver, $3), @3,
+                        "unknown worker-selection() argument \"%s\", expected round-robin or least-queue-depth", $3);
+            free($3);
+          }
+        | KW_WORKER_PARTITION_KEY '(' template_content ')'
+          {
+            log_threaded_dest_driver_set_worker_partition_key_ref(last_driver, $3);
+          }
+        | KW_WORKER_STEALING '(' yesno ')' { log_threaded_dest_driver_set_worker_stealing(last_driver, $3); }
         | dest_driver_option
         ;
 
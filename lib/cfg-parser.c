@@ -92,6 +92,8 @@ static CfgLexerKeyword main_keywords[] =
   { "stats_level",        KW_STATS_LEVEL },
   { "stats",              KW_STATS_FREQ, KWS_OBSOLETE, "stats_freq" },
   { "stats_max_dynamics", KW_STATS_MAX_DYNAMIC },
+  { "stats_sharded_counters", KW_STATS_SHARDED_COUNTERS },
+  { "stats_snapshot_freq", KW_STATS_SNAPSHOT_FREQ },
   { "min_iw_size_per_reader", KW_MIN_IW_SIZE_PER_READER },
   { "flush_lines",        KW_FLUSH_LINES },
   { "flush_timeout",      KW_FLUSH_TIMEOUT, KWS_OBSOLETE, "Some drivers support batch-timeout() instead that you can specify at the destination level." },
@@ -159,12 +161,19 @@ static CfgLexerKeyword main_keywords[] =
   { "dns_cache_size",     KW_DNS_CACHE_SIZE },
   { "dns_cache_expire",   KW_DNS_CACHE_EXPIRE },
   { "dns_cache_expire_failed", KW_DNS_CACHE_EXPIRE_FAILED },
+  { "dns_cache_async",    KW_DNS_CACHE_ASYNC },
+  { "dns_cache_resolver_threads", KW_DNS_CACHE_RESOLVER_THREADS },
   { "pass_unix_credentials",   KW_PASS_UNIX_CREDENTIALS },
   { "persist_name",            KW_PERSIST_NAME, VERSION_VALUE_3_8 },
 
   { "retries",            KW_RETRIES },
   { "batch_lines",        KW_BATCH_LINES },
   { "batch_timeout",      KW_BATCH_TIMEOUT },
+  { "batch_adaptation",   KW_BATCH_ADAPTATION },
+  { "batch_latency_target", KW_BATCH_LATENCY_TARGET },
+  { "worker_selection",   KW_WORKER_SELECTION },
+  { "worker_partition_key", KW_WORKER_PARTITION_KEY },
+  { "worker_stealing",    KW_WORKER_STEALING },
 
   { "read_old_records",   KW_READ_OLD_RECORDS},
   { "use_syslogng_pid",   KW_USE_SYSLOGNG_PID },
@@ -27,6 +27,7 @@
 #include "logpipe.h"
 
 #include <string.h>
+#include <unistd.h>
 
 static void _log_expr_node_free(LogExprNode *self);
 
@@ -1398,13 +1399,92 @@ _verify_unique_persist_names_among_pipes(const GPtrArray *initialized_pipes)
   return result;
 }
 
-gboolean
-cfg_tree_start(CfgTree *self)
+static gint
+_get_preload_thread_count(gint jobs)
+{
+  gint threads = 1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+  threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return CLAMP(threads, 1, jobs);
+}
+
+static void
+_preload_pipe(gpointer data, gpointer user_data)
 {
+  LogPipe *pipe = (LogPipe *) data;
+  gint *failures = (gint *) user_data;
+
+  if (!log_pipe_preload(pipe))
+    {
+      msg_error("Error preloading message pipeline",
+                evt_tag_str("plugin_name", pipe->plugin_name ? pipe->plugin_name : "not a plugin"),
+                log_pipe_location_tag(pipe));
+      g_atomic_int_inc(failures);
+    }
+}
+
+/*
+ * Run the preload() method of all pipes that have one. These jobs are
+ * independent of each other (anything that depends on another pipe
+ * belongs to init()), so the only ordering we need is that all of them
+ * finish before the init phase starts.  The global state they may touch
+ * (plugin lookup, the config parser, the NV and tag registries) is
+ * locked.
+ */
+static gboolean
+_preload_pipes(CfgTree *self)
+{
+  GPtrArray *jobs = g_ptr_array_new();
+  gint failures = 0;
   gint i;
 
-  if (!cfg_tree_compile(self))
-    return FALSE;
+  for (i = 0; i < self->initialized_pipes->len; i++)
+    {
+      LogPipe *pipe = g_ptr_array_index(self->initialized_pipes, i);
+
+      if (pipe->preload && !(pipe->flags & PIF_INITIALIZED))
+        g_ptr_array_add(jobs, pipe);
+    }
+
+  if (jobs->len == 1)
+    {
+      _preload_pipe(g_ptr_array_index(jobs, 0), &failures);
+    }
+  else if (jobs->len > 1)
+    {
+      GError *error = NULL;
+      GThreadPool *pool = g_thread_pool_new(_preload_pipe, &failures, _get_preload_thread_count(jobs->len),
+                                            TRUE, &error);
+
+      if (!pool)
+        {
+          msg_warning("Error starting preload threads, loading sequentially",
+                      evt_tag_str("error", error->message));
+          g_clear_error(&error);
+          for (i = 0; i < jobs->len; i++)
+            _preload_pipe(g_ptr_array_index(jobs, i), &failures);
+        }
+      else
+        {
+          for (i = 0; i < jobs->len; i++)
+            g_thread_pool_push(pool, g_ptr_array_index(jobs, i), NULL);
+          g_thread_pool_free(pool, FALSE, TRUE);
+        }
+    }
+
+  msg_verbose("Preloaded message pipeline",
+              evt_tag_int("jobs", jobs->len),
+              evt_tag_int("failures", g_atomic_int_get(&failures)));
+  g_ptr_array_free(jobs, TRUE);
+  return g_atomic_int_get(&failures) == 0;
+}
+
+static gboolean
+_init_pipes(CfgTree *self)
+{
+  gint i;
 
   /*
    *   As there are pipes that are dynamically created during init, these
@@ -1424,7 +1504,33 @@ cfg_tree_start(CfgTree *self)
           return FALSE;
         }
     }
+  return TRUE;
+}
 
+gboolean
+cfg_tree_start(CfgTree *self)
+{
+  gint64 compile_start, preload_start, init_start;
+  gboolean success;
+
+  compile_start = g_get_monotonic_time();
+  if (!cfg_tree_compile(self))
+    return FALSE;
+
+  preload_start = g_get_monotonic_time();
+  if (!_preload_pipes(self))
+    return FALSE;
+
+  init_start = g_get_monotonic_time();
+  success = _init_pipes(self);
+
+  msg_verbose("Message pipeline started",
+              evt_tag_long("compile_msec", (preload_start - compile_start) / 1000),
+              evt_tag_long("preload_msec", (init_start - preload_start) / 1000),
+              evt_tag_long("init_msec", (g_get_monotonic_time() - init_start) / 1000));
+
+  if (!success)
+    return FALSE;
   return _verify_unique_persist_names_among_pipes(self->initialized_pipes);
 }
 
@@ -32,6 +32,7 @@
 #include "userdb.h"
 #include "logmsg/logmsg.h"
 #include "dnscache.h"
+#include "dns-resolver.h"
 #include "serialize.h"
 #include "plugin.h"
 #include "cfg-parser.h"
@@ -360,6 +361,7 @@ cfg_init(GlobalConfig *cfg)
   stats_reinit(&cfg->stats_options);
 
   dns_caching_update_options(&cfg->dns_cache_options);
+  dns_resolver_update_options(&cfg->dns_cache_options);
   hostname_reinit(cfg->custom_domain);
   host_resolve_options_init_globals(&cfg->host_resolve_options);
   log_template_options_init(&cfg->template_options, cfg);
@@ -565,6 +567,15 @@ cfg_set_global_paths(GlobalConfig *self)
   g_free(include_path);
 }
 
+/*
+ * Parsing swaps the global configuration and the lexer of the config.
+ * Snippets (e.g. the conditions of patterndb actions or $(if) template
+ * functions) can be parsed from the preload threads of cfg_tree_start(),
+ * so parsing is serialized.  Nested parsers run in the same thread, hence
+ * the recursive mutex.
+ */
+static GStaticRecMutex cfg_parser_lock = G_STATIC_REC_MUTEX_INIT;
+
 gboolean
 cfg_run_parser(GlobalConfig *self, CfgLexer *lexer, CfgParser *parser, gpointer *result, gpointer arg)
 {
@@ -572,6 +583,7 @@ cfg_run_parser(GlobalConfig *self, CfgLexer *lexer, CfgParser *parser, gpointer
   GlobalConfig *old_cfg;
   CfgLexer *old_lexer;
 
+  g_static_rec_mutex_lock(&cfg_parser_lock);
   old_cfg = configuration;
   configuration = self;
   old_lexer = self->lexer;
@@ -585,6 +597,7 @@ cfg_run_parser(GlobalConfig *self, CfgLexer *lexer, CfgParser *parser, gpointer
   self->lexer = NULL;
   self->lexer = old_lexer;
   configuration = old_cfg;
+  g_static_rec_mutex_unlock(&cfg_parser_lock);
   return res;
 }
 
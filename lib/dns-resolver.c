@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "dns-resolver.h"
+#include "host-resolve.h"
+#include "apphook.h"
+#include "messages.h"
+#include "timeutils/cache.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-single.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <string.h>
+
+#define DNS_RESOLVER_SHARDS 16
+
+typedef struct _DNSResolverKey
+{
+  gint family;
+  union
+  {
+    struct in_addr ip;
+#if SYSLOG_NG_ENABLE_IPV6
+    struct in6_addr ip6;
+#endif
+  } addr;
+} DNSResolverKey;
+
+typedef struct _DNSResolverEntry
+{
+  DNSResolverKey key;
+  gchar *hostname;
+  time_t resolved;
+  gboolean positive;
+  /* a resolver thread is working on this entry */
+  gboolean pending;
+  GList lru_link;
+} DNSResolverEntry;
+
+/* entries are evicted in least recently used order, the most recently
+ * used one is at the head of the lru queue */
+typedef struct _DNSResolverShard
+{
+  GStaticMutex lock;
+  GHashTable *entries;
+  GQueue lru;
+} DNSResolverShard;
+
+static struct
+{
+  DNSResolverShard shards[DNS_RESOLVER_SHARDS];
+  GThreadPool *pool;
+  DNSResolverFunc resolve;
+
+  gint enabled;
+  gint shutting_down;
+  gint cache_size;
+  gint expire;
+  gint expire_failed;
+
+  StatsCounterItem *queued;
+  StatsCounterItem *resolved;
+  StatsCounterItem *latency;
+} dns_resolver;
+
+static gboolean
+_key_equal(gconstpointer k1, gconstpointer k2)
+{
+  return memcmp(k1, k2, sizeof(DNSResolverKey)) == 0;
+}
+
+static guint
+_key_hash(gconstpointer k)
+{
+  const guint8 *p = (const guint8 *) k;
+  guint32 hash = 2166136261U;
+
+  /* FNV-1a, the key is zero-padded by _fill_key() */
+  for (gsize i = 0; i < sizeof(DNSResolverKey); i++)
+    {
+      hash ^= p[i];
+      hash *= 16777619U;
+    }
+  return hash;
+}
+
+static gboolean
+_fill_key(DNSResolverKey *key, GSockAddr *saddr)
+{
+  memset(key, 0, sizeof(*key));
+  key->family = saddr->sa.sa_family;
+  switch (key->family)
+    {
+    case AF_INET:
+      key->addr.ip = ((struct sockaddr_in *) &saddr->sa)->sin_addr;
+      return TRUE;
+#if SYSLOG_NG_ENABLE_IPV6
+    case AF_INET6:
+      key->addr.ip6 = ((struct sockaddr_in6 *) &saddr->sa)->sin6_addr;
+      return TRUE;
+#endif
+    default:
+      return FALSE;
+    }
+}
+
+static void
+_entry_free(DNSResolverEntry *entry)
+{
+  g_free(entry->hostname);
+  g_free(entry);
+}
+
+static gboolean
+_entry_is_expired(DNSResolverEntry *entry, time_t now)
+{
+  gint expire = entry->positive ? dns_resolver.expire : dns_resolver.expire_failed;
+
+  return entry->resolved < now - expire;
+}
+
+static DNSResolverShard *
+_get_shard(const DNSResolverKey *key)
+{
+  return &dns_resolver.shards[_key_hash(key) % DNS_RESOLVER_SHARDS];
+}
+
+/* NOTE: must be called with the shard lock held */
+static void
+_shard_touch(DNSResolverShard *shard, DNSResolverEntry *entry)
+{
+  g_queue_unlink(&shard->lru, &entry->lru_link);
+  g_queue_push_head_link(&shard->lru, &entry->lru_link);
+}
+
+/* NOTE: must be called with the shard lock held */
+static void
+_shard_evict_one(DNSResolverShard *shard)
+{
+  for (GList *l = shard->lru.tail; l; l = l->prev)
+    {
+      DNSResolverEntry *entry = (DNSResolverEntry *) l->data;
+
+      /* pending entries are referenced by queued requests */
+      if (!entry->pending)
+        {
+          g_queue_unlink(&shard->lru, &entry->lru_link);
+          g_hash_table_remove(shard->entries, &entry->key);
+          return;
+        }
+    }
+}
+
+static void
+_resolve_request(gpointer data, gpointer user_data)
+{
+  GSockAddr *saddr = (GSockAddr *) data;
+  gchar buf[256];
+  DNSResolverKey key;
+
+  /* the queue is being drained at shutdown, the cache is going away */
+  if (g_atomic_int_get(&dns_resolver.shutting_down))
+    {
+      g_sockaddr_unref(saddr);
+      return;
+    }
+
+  gint64 start = g_get_monotonic_time();
+  const gchar *hostname = dns_resolver.resolve(saddr, buf, sizeof(buf));
+  stats_counter_add(dns_resolver.latency, g_get_monotonic_time() - start);
+  stats_counter_inc(dns_resolver.resolved);
+
+  _fill_key(&key, saddr);
+  DNSResolverShard *shard = _get_shard(&key);
+
+  g_static_mutex_lock(&shard->lock);
+  DNSResolverEntry *entry = g_hash_table_lookup(shard->entries, &key);
+  if (entry)
+    {
+      g_free(entry->hostname);
+      entry->hostname = g_strdup(hostname);
+      entry->positive = (hostname != NULL);
+      entry->resolved = cached_g_current_time_sec();
+      entry->pending = FALSE;
+    }
+  g_static_mutex_unlock(&shard->lock);
+
+  g_sockaddr_unref(saddr);
+}
+
+gboolean
+dns_resolver_is_enabled(void)
+{
+  return g_atomic_int_get(&dns_resolver.enabled);
+}
+
+/*
+ * Returns TRUE if a (positive or negative) result is available for @saddr,
+ * @buf is filled with the hostname for positive results.  Otherwise the
+ * address is queued for resolution (unless it already is) and FALSE is
+ * returned, the caller should fall back to the IP address in this case.
+ *
+ * Expired positive results are still returned while they are being
+ * resolved again.
+ */
+gboolean
+dns_resolver_lookup(GSockAddr *saddr, gchar *buf, gsize buf_len, gboolean *positive)
+{
+  DNSResolverKey key;
+  gboolean result = FALSE;
+  gboolean queue_request = FALSE;
+  time_t now = cached_g_current_time_sec();
+
+  if (!_fill_key(&key, saddr))
+    return FALSE;
+
+  DNSResolverShard *shard = _get_shard(&key);
+
+  g_static_mutex_lock(&shard->lock);
+  DNSResolverEntry *entry = g_hash_table_lookup(shard->entries, &key);
+  if (!entry)
+    {
+      entry = g_new0(DNSResolverEntry, 1);
+      entry->key = key;
+      entry->pending = TRUE;
+      entry->lru_link.data = entry;
+      if (g_hash_table_size(shard->entries) >= MAX(dns_resolver.cache_size / DNS_RESOLVER_SHARDS, 1))
+        _shard_evict_one(shard);
+      g_hash_table_insert(shard->entries, &entry->key, entry);
+      g_queue_push_head_link(&shard->lru, &entry->lru_link);
+      queue_request = TRUE;
+    }
+  else
+    {
+      _shard_touch(shard, entry);
+      if (!entry->pending && _entry_is_expired(entry, now))
+        {
+          entry->pending = TRUE;
+          queue_request = TRUE;
+        }
+    }
+
+  /* a stale hostname is served until the refresh completes, there is
+   * nothing to serve for new or negative entries that are being resolved */
+  if (!entry->pending || entry->positive)
+    {
+      if (entry->positive)
+        g_strlcpy(buf, entry->hostname, buf_len);
+      *positive = entry->positive;
+      result = TRUE;
+    }
+  g_static_mutex_unlock(&shard->lock);
+
+  if (queue_request)
+    {
+      stats_counter_inc(dns_resolver.queued);
+      g_thread_pool_push(dns_resolver.pool, g_sockaddr_ref(saddr), NULL);
+    }
+  return result;
+}
+
+void
+dns_resolver_set_resolve_func(DNSResolverFunc resolve)
+{
+  dns_resolver.resolve = resolve;
+}
+
+void
+dns_resolver_update_options(const DNSCacheOptions *dns_cache_options)
+{
+  dns_resolver.cache_size = dns_cache_options->cache_size;
+  dns_resolver.expire = dns_cache_options->expire;
+  dns_resolver.expire_failed = dns_cache_options->expire_failed;
+
+  if (dns_cache_options->async)
+    {
+      if (!dns_resolver.pool)
+        {
+          GError *error = NULL;
+
+          dns_resolver.pool = g_thread_pool_new(_resolve_request, NULL, dns_cache_options->resolver_threads,
+                                                FALSE, &error);
+          if (!dns_resolver.pool)
+            {
+              msg_error("Error starting DNS resolver threads, falling back to synchronous name resolution",
+                        evt_tag_str("error", error->message));
+              g_clear_error(&error);
+              g_atomic_int_set(&dns_resolver.enabled, FALSE);
+              return;
+            }
+        }
+      else
+        {
+          g_thread_pool_set_max_threads(dns_resolver.pool, dns_cache_options->resolver_threads, NULL);
+        }
+    }
+  g_atomic_int_set(&dns_resolver.enabled, dns_cache_options->async);
+}
+
+static void
+_register_stats(gint type, gpointer user_data)
+{
+  StatsClusterKey sc_key;
+
+  stats_lock();
+  stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "dns_resolver_queued", NULL);
+  stats_register_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &dns_resolver.queued);
+  stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "dns_resolver_resolved", NULL);
+  stats_register_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &dns_resolver.resolved);
+
+  /* cumulative time spent in the resolver, in microseconds, divide by resolved for the average */
+  stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "dns_resolver_latency_usec", NULL);
+  stats_register_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &dns_resolver.latency);
+  stats_unlock();
+}
+
+static void
+_unregister_stats(void)
+{
+  StatsClusterKey sc_key;
+
+  stats_lock();
+  stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "dns_resolver_queued", NULL);
+  stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &dns_resolver.queued);
+  stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "dns_resolver_resolved", NULL);
+  stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &dns_resolver.resolved);
+  stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "dns_resolver_latency_usec", NULL);
+  stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &dns_resolver.latency);
+  stats_unlock();
+}
+
+void
+dns_resolver_global_init(void)
+{
+  for (gint i = 0; i < DNS_RESOLVER_SHARDS; i++)
+    {
+      g_static_mutex_init(&dns_resolver.shards[i].lock);
+      dns_resolver.shards[i].entries = g_hash_table_new_full(_key_hash, _key_equal, NULL,
+                                                             (GDestroyNotify) _entry_free);
+      g_queue_init(&dns_resolver.shards[i].lru);
+    }
+  dns_resolver.resolve = resolve_sockaddr_to_dns_hostname;
+
+  /* NOTE: the stats subsystem may not be operational yet */
+  register_application_hook(AH_RUNNING, _register_stats, NULL, AHM_RUN_ONCE);
+}
+
+void
+dns_resolver_global_deinit(void)
+{
+  if (dns_resolver.pool)
+    {
+      /* queued requests are not resolved anymore, but they are still
+       * processed to release the addresses they hold */
+      g_atomic_int_set(&dns_resolver.shutting_down, TRUE);
+      g_thread_pool_free(dns_resolver.pool, FALSE, TRUE);
+      dns_resolver.pool = NULL;
+      g_atomic_int_set(&dns_resolver.shutting_down, FALSE);
+    }
+  g_atomic_int_set(&dns_resolver.enabled, FALSE);
+  _unregister_stats();
+
+  for (gint i = 0; i < DNS_RESOLVER_SHARDS; i++)
+    {
+      g_hash_table_destroy(dns_resolver.shards[i].entries);
+      dns_resolver.shards[i].entries = NULL;
+      g_queue_init(&dns_resolver.shards[i].lru);
+      g_static_mutex_free(&dns_resolver.shards[i].lock);
+    }
+}
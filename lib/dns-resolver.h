@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef DNS_RESOLVER_H_INCLUDED
+#define DNS_RESOLVER_H_INCLUDED
+
+#include "syslog-ng.h"
+#include "gsockaddr.h"
+#include "dnscache.h"
+
+/*
+ * Shared, asynchronous reverse DNS resolver.  Lookups never block the
+ * caller: a miss is queued to a pool of resolver threads and the caller is
+ * expected to use the IP address until the result becomes available.
+ * Results (both positive and negative ones) are kept in a cache shared
+ * between all threads, honouring the dns-cache-expire() and
+ * dns-cache-expire-failed() options.  The cache is split into mutex
+ * protected shards, each holding its part of dns-cache-size() entries and
+ * evicting the least recently used one when it is full.
+ */
+
+typedef const gchar *(*DNSResolverFunc)(GSockAddr *saddr, gchar *buf, gsize buf_len);
+
+gboolean dns_resolver_is_enabled(void);
+gboolean dns_resolver_lookup(GSockAddr *saddr, gchar *buf, gsize buf_len, gboolean *positive);
+void dns_resolver_set_resolve_func(DNSResolverFunc resolve);
+
+void dns_resolver_update_options(const DNSCacheOptions *dns_cache_options);
+void dns_resolver_global_init(void);
+void dns_resolver_global_deinit(void);
+
+#endif
@@ -26,6 +26,9 @@
 #include "messages.h"
 #include "timeutils/cache.h"
 #include "tls-support.h"
+#include "apphook.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-single.h"
 
 #include <sys/types.h>
 #include <netinet/in.h>
@@ -357,6 +360,8 @@ dns_cache_options_defaults(DNSCacheOptions *options)
   options->expire = 3600;
   options->expire_failed = 60;
   options->hosts = NULL;
+  options->async = FALSE;
+  options->resolver_threads = 4;
 }
 
 void
@@ -419,11 +424,16 @@ TLS_BLOCK_END;
 static DNSCacheOptions effective_dns_cache_options;
 G_LOCK_DEFINE_STATIC(unused_dns_caches);
 static GList *unused_dns_caches;
+static StatsCounterItem *dns_cache_hits;
+static StatsCounterItem *dns_cache_misses;
 
 gboolean
 dns_caching_lookup(gint family, void *addr, const gchar **hostname, gsize *hostname_len, gboolean *positive)
 {
-  return dns_cache_lookup(dns_cache, family, addr, hostname, hostname_len, positive);
+  gboolean found = dns_cache_lookup(dns_cache, family, addr, hostname, hostname_len, positive);
+
+  stats_counter_inc(found ? dns_cache_hits : dns_cache_misses);
+  return found;
 }
 
 void
@@ -444,6 +454,8 @@ dns_caching_update_options(const DNSCacheOptions *new_options)
   options->expire = new_options->expire;
   options->expire_failed = new_options->expire_failed;
   options->hosts = g_strdup(new_options->hosts);
+  options->async = new_options->async;
+  options->resolver_threads = new_options->resolver_threads;
 }
 
 void
@@ -474,10 +486,26 @@ dns_caching_thread_deinit(void)
   dns_cache = NULL;
 }
 
+static void
+_register_stats(gint type, gpointer user_data)
+{
+  StatsClusterKey sc_key;
+
+  stats_lock();
+  stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "dns_cache_hits", NULL);
+  stats_register_contended_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &dns_cache_hits);
+  stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "dns_cache_misses", NULL);
+  stats_register_contended_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &dns_cache_misses);
+  stats_unlock();
+}
+
 void
 dns_caching_global_init(void)
 {
   dns_cache_options_defaults(&effective_dns_cache_options);
+
+  /* NOTE: the stats subsystem may not be operational yet */
+  register_application_hook(AH_RUNNING, _register_stats, NULL, AHM_RUN_ONCE);
 }
 
 void
@@ -489,4 +517,5 @@ dns_caching_global_deinit(void)
   unused_dns_caches = NULL;
   G_UNLOCK(unused_dns_caches);
   dns_cache_options_destroy(&effective_dns_cache_options);
+  dns_cache_hits = dns_cache_misses = NULL;
 }
@@ -34,6 +34,8 @@ typedef struct
   gint expire;
   gint expire_failed;
   gchar *hosts;
+  gboolean async;
+  gint resolver_threads;
 } DNSCacheOptions;
 
 typedef struct _DNSCache DNSCache;
@@ -177,10 +177,10 @@ log_src_driver_init_method(LogPipe *s)
   stats_lock();
   StatsClusterKey sc_key;
   stats_cluster_logpipe_key_set(&sc_key, SCS_SOURCE | SCS_GROUP, self->super.group, NULL );
-  stats_register_counter(0, &sc_key, SC_TYPE_PROCESSED,
-                         &self->super.processed_group_messages);
+  stats_register_contended_counter(0, &sc_key, SC_TYPE_PROCESSED,
+                                   &self->super.processed_group_messages);
   stats_cluster_logpipe_key_set(&sc_key,  SCS_CENTER, NULL, "received" );
-  stats_register_counter(0, &sc_key, SC_TYPE_PROCESSED, &self->received_global_messages);
+  stats_register_contended_counter(0, &sc_key, SC_TYPE_PROCESSED, &self->received_global_messages);
   stats_unlock();
 
   return TRUE;
@@ -338,10 +338,10 @@ log_dest_driver_init_method(LogPipe *s)
   stats_lock();
   StatsClusterKey sc_key;
   stats_cluster_logpipe_key_set(&sc_key, SCS_DESTINATION | SCS_GROUP, self->super.group, NULL );
-  stats_register_counter(0, &sc_key, SC_TYPE_PROCESSED,
-                         &self->super.processed_group_messages);
+  stats_register_contended_counter(0, &sc_key, SC_TYPE_PROCESSED,
+                                   &self->super.processed_group_messages);
   stats_cluster_logpipe_key_set(&sc_key, SCS_CENTER, NULL, "queued" );
-  stats_register_counter(0, &sc_key, SC_TYPE_PROCESSED, &self->queued_global_messages);
+  stats_register_contended_counter(0, &sc_key, SC_TYPE_PROCESSED, &self->queued_global_messages);
   stats_unlock();
 
   return TRUE;
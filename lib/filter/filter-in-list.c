@@ -24,20 +24,96 @@
 
 #include "filter-in-list.h"
 #include "logmsg/logmsg.h"
-#include "str-utils.h"
 
 #include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+/*
+ * The list is loaded once and never changes afterwards, so it is stored in
+ * a flat open addressing hash table (linear probing, at most half full)
+ * instead of a search tree: a lookup is a hash computation and usually a
+ * single memcmp().
+ */
+typedef struct _FilterInListEntry
+{
+  gchar *value;
+  guint32 hash;
+  guint32 len;
+} FilterInListEntry;
+
 typedef struct _FilterInList
 {
   FilterExprNode super;
   NVHandle value_handle;
-  GTree *tree;
+  FilterInListEntry *table;
+  guint32 table_mask;
 } FilterInList;
 
+/* FNV-1a, stops at the first NUL character to match the strcmp() based
+ * semantics of the original implementation, updates *len accordingly */
+static guint32
+_hash_value(const gchar *value, gssize *len)
+{
+  guint32 hash = 2166136261U;
+  gssize i;
+
+  for (i = 0; i < *len && value[i]; i++)
+    {
+      hash ^= (guint8) value[i];
+      hash *= 16777619U;
+    }
+  *len = i;
+  return hash;
+}
+
+static FilterInListEntry *
+_lookup_entry(FilterInList *self, const gchar *value, gssize len, guint32 hash)
+{
+  guint32 i = hash & self->table_mask;
+
+  for (;; i = (i + 1) & self->table_mask)
+    {
+      FilterInListEntry *entry = &self->table[i];
+
+      if (!entry->value)
+        return entry;
+      if (entry->hash == hash && (gssize) entry->len == len && memcmp(entry->value, value, len) == 0)
+        return entry;
+    }
+}
+
+static void
+_build_table(FilterInList *self, GPtrArray *values)
+{
+  guint32 table_size = 8;
+
+  while (table_size < values->len * 2)
+    table_size <<= 1;
+
+  self->table = g_new0(FilterInListEntry, table_size);
+  self->table_mask = table_size - 1;
+
+  for (guint i = 0; i < values->len; i++)
+    {
+      gchar *value = g_ptr_array_index(values, i);
+      gssize len = strlen(value);
+      guint32 hash = _hash_value(value, &len);
+      FilterInListEntry *entry = _lookup_entry(self, value, len, hash);
+
+      if (entry->value)
+        {
+          /* duplicate line */
+          g_free(value);
+          continue;
+        }
+      entry->value = value;
+      entry->hash = hash;
+      entry->len = len;
+    }
+}
+
 static gboolean
 filter_in_list_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTemplateEvalOptions *options)
 {
@@ -47,11 +123,11 @@ filter_in_list_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTempl
   gssize len = 0;
 
   value = log_msg_get_value(msg, self->value_handle, &len);
-  APPEND_ZERO(value, value, len);
+  guint32 hash = _hash_value(value, &len);
 
-  gboolean result = (g_tree_lookup(self->tree, value) != NULL);
+  gboolean result = (_lookup_entry(self, value, len, hash)->value != NULL);
   msg_trace("in-list() evaluation started",
-            evt_tag_str("value", value),
+            evt_tag_printf("value", "%.*s", (gint) len, value),
             evt_tag_printf("msg", "%p", msg));
 
   return result ^ s->comp;
@@ -62,7 +138,9 @@ filter_in_list_free(FilterExprNode *s)
 {
   FilterInList *self = (FilterInList *)s;
 
-  g_tree_destroy(self->tree);
+  for (guint32 i = 0; i <= self->table_mask; i++)
+    g_free(self->table[i].value);
+  g_free(self->table);
 }
 
 FilterExprNode *
@@ -84,16 +162,19 @@ filter_in_list_new(const gchar *list_file, const gchar *property)
   self = g_new0(FilterInList, 1);
   filter_expr_node_init_instance(&self->super);
   self->value_handle = log_msg_get_value_handle(property);
-  self->tree = g_tree_new_full((GCompareDataFunc)strcmp, NULL, g_free, NULL);
 
+  GPtrArray *values = g_ptr_array_new();
   while (fgets(line, sizeof(line), stream) != NULL)
     {
       line[strlen(line) - 1] = '\0';
       if (line[0])
-        g_tree_insert(self->tree, g_strdup(line), GINT_TO_POINTER(1));
+        g_ptr_array_add(values, g_strdup(line));
     }
   fclose(stream);
 
+  _build_table(self, values);
+  g_ptr_array_free(values, TRUE);
+
   self->super.eval = filter_in_list_eval;
   self->super.free_fn = filter_in_list_free;
   return &self->super;
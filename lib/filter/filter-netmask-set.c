@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "filter-netmask-set.h"
+#include "filter-netmask.h"
+#include "filter-netmask6.h"
+#include "gsocket.h"
+#include "logmsg/logmsg.h"
+
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+/*
+ * An OR-ed chain of netmask() and netmask6() filters, evaluated with a
+ * single lookup.
+ *
+ * The networks are stored in a multibit trie with 8-bit strides, one for
+ * IPv4 and one for IPv6.  A prefix that doesn't end on a byte boundary is
+ * expanded to all the byte values it covers on its last level, so a
+ * lookup is at most one step per address byte.  As we only need to know
+ * whether any of the networks contains the address, the lookup stops at
+ * the first match.
+ */
+
+typedef struct _NetmaskTrieNode NetmaskTrieNode;
+struct _NetmaskTrieNode
+{
+  guint8 match[256 / 8];
+  NetmaskTrieNode *children[256];
+};
+
+typedef struct _NetmaskTrie
+{
+  gboolean match_all;
+  NetmaskTrieNode *root;
+} NetmaskTrie;
+
+typedef struct _FilterNetmaskSet
+{
+  FilterExprNode super;
+  NetmaskTrie ipv4;
+  NetmaskTrie ipv6;
+} FilterNetmaskSet;
+
+static void
+_trie_insert(NetmaskTrie *self, const guint8 *network, gint prefix)
+{
+  NetmaskTrieNode **node = &self->root;
+  gint depth;
+
+  if (prefix == 0)
+    {
+      self->match_all = TRUE;
+      return;
+    }
+
+  for (depth = 0; prefix - depth * 8 > 8; depth++)
+    {
+      if (!*node)
+        *node = g_new0(NetmaskTrieNode, 1);
+      node = &(*node)->children[network[depth]];
+    }
+  if (!*node)
+    *node = g_new0(NetmaskTrieNode, 1);
+
+  gint host_bits = 8 - (prefix - depth * 8);
+  guint8 first = network[depth] & (0xFF << host_bits);
+
+  for (gint i = 0; i < (1 << host_bits); i++)
+    {
+      guint8 b = first | i;
+      (*node)->match[b >> 3] |= 1 << (b & 7);
+    }
+}
+
+static gboolean
+_trie_lookup(const NetmaskTrie *self, const guint8 *address, gsize address_len)
+{
+  const NetmaskTrieNode *node = self->root;
+
+  if (self->match_all)
+    return TRUE;
+
+  for (gsize i = 0; node && i < address_len; i++)
+    {
+      guint8 b = address[i];
+
+      if (node->match[b >> 3] & (1 << (b & 7)))
+        return TRUE;
+      node = node->children[b];
+    }
+  return FALSE;
+}
+
+static void
+_trie_node_free(NetmaskTrieNode *node)
+{
+  if (!node)
+    return;
+
+  for (gint i = 0; i < 256; i++)
+    _trie_node_free(node->children[i]);
+  g_free(node);
+}
+
+static gboolean
+_lookup_ipv4(FilterNetmaskSet *self, const struct in_addr *address)
+{
+  return _trie_lookup(&self->ipv4, (const guint8 *) &address->s_addr, sizeof(address->s_addr));
+}
+
+#if SYSLOG_NG_ENABLE_IPV6
+static gboolean
+_lookup_ipv6(FilterNetmaskSet *self, const struct in6_addr *address)
+{
+  return _trie_lookup(&self->ipv6, address->s6_addr, sizeof(address->s6_addr));
+}
+#endif
+
+static gboolean
+_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTemplateEvalOptions *options)
+{
+  FilterNetmaskSet *self = (FilterNetmaskSet *) s;
+  LogMessage *msg = msgs[num_msg - 1];
+  gboolean result;
+
+  /* same address selection as in netmask() and netmask6() */
+  if (msg->saddr && g_sockaddr_inet_check(msg->saddr))
+    {
+      result = _lookup_ipv4(self, &((struct sockaddr_in *) &msg->saddr->sa)->sin_addr);
+    }
+#if SYSLOG_NG_ENABLE_IPV6
+  else if (msg->saddr && g_sockaddr_inet6_check(msg->saddr))
+    {
+      result = _lookup_ipv6(self, &((struct sockaddr_in6 *) &msg->saddr->sa)->sin6_addr);
+    }
+#endif
+  else if (!msg->saddr || msg->saddr->sa.sa_family == AF_UNIX)
+    {
+      struct in_addr loopback = { .s_addr = htonl(INADDR_LOOPBACK) };
+
+      result = _lookup_ipv4(self, &loopback);
+#if SYSLOG_NG_ENABLE_IPV6
+      result = result || _lookup_ipv6(self, &in6addr_loopback);
+#endif
+    }
+  else
+    {
+      result = FALSE;
+    }
+
+  msg_trace("netmask() set evaluation started",
+            evt_tag_int("result", result),
+            evt_tag_printf("msg", "%p", msg));
+  return result ^ s->comp;
+}
+
+static void
+_free(FilterExprNode *s)
+{
+  FilterNetmaskSet *self = (FilterNetmaskSet *) s;
+
+  _trie_node_free(self->ipv4.root);
+  _trie_node_free(self->ipv6.root);
+}
+
+static FilterNetmaskSet *
+_new(void)
+{
+  FilterNetmaskSet *self = g_new0(FilterNetmaskSet, 1);
+
+  filter_expr_node_init_instance(&self->super);
+  self->super.eval = _eval;
+  self->super.free_fn = _free;
+  self->super.type = "netmask-set";
+  return self;
+}
+
+static gboolean
+_is_set(FilterExprNode *s)
+{
+  return s->eval == _eval;
+}
+
+static void
+_merge_trie(NetmaskTrie *self, const NetmaskTrieNode *node, guint8 *network, gint depth)
+{
+  for (gint b = 0; b < 256; b++)
+    {
+      network[depth] = b;
+      if (node->match[b >> 3] & (1 << (b & 7)))
+        _trie_insert(self, network, (depth + 1) * 8);
+      else if (node->children[b])
+        _merge_trie(self, node->children[b], network, depth + 1);
+    }
+}
+
+/* adds the networks of @s to @self, returns FALSE if @s is not something
+ * we can merge */
+static gboolean
+_add(FilterNetmaskSet *self, FilterExprNode *s)
+{
+  struct in_addr network;
+#if SYSLOG_NG_ENABLE_IPV6
+  struct in6_addr network6;
+#endif
+  gint prefix;
+
+  if (_is_set(s))
+    {
+      FilterNetmaskSet *other = (FilterNetmaskSet *) s;
+      guint8 network_bytes[16];
+
+      self->ipv4.match_all |= other->ipv4.match_all;
+      self->ipv6.match_all |= other->ipv6.match_all;
+      if (other->ipv4.root)
+        _merge_trie(&self->ipv4, other->ipv4.root, network_bytes, 0);
+      if (other->ipv6.root)
+        _merge_trie(&self->ipv6, other->ipv6.root, network_bytes, 0);
+      return TRUE;
+    }
+  if (filter_netmask_get_prefix(s, &network, &prefix))
+    {
+      _trie_insert(&self->ipv4, (const guint8 *) &network.s_addr, prefix);
+      return TRUE;
+    }
+#if SYSLOG_NG_ENABLE_IPV6
+  if (filter_netmask6_get_prefix(s, &network6, &prefix))
+    {
+      _trie_insert(&self->ipv6, network6.s6_addr, prefix);
+      return TRUE;
+    }
+#endif
+  return FALSE;
+}
+
+static gboolean
+_is_mergeable(FilterExprNode *s)
+{
+  struct in_addr network;
+#if SYSLOG_NG_ENABLE_IPV6
+  struct in6_addr network6;
+#endif
+  gint prefix;
+
+  if (s->comp)
+    return FALSE;
+
+  return _is_set(s) ||
+         filter_netmask_get_prefix(s, &network, &prefix)
+#if SYSLOG_NG_ENABLE_IPV6
+         || filter_netmask6_get_prefix(s, &network6, &prefix)
+#endif
+         ;
+}
+
+/*
+ * Merges "@e1 or @e2" into a single netmask set if both sides are
+ * non-negated netmask(), netmask6() or netmask set filters, consuming the
+ * references of @e1 and @e2.  Returns NULL (and leaves @e1 and @e2 alone)
+ * otherwise.
+ */
+FilterExprNode *
+filter_netmask_set_merge(FilterExprNode *e1, FilterExprNode *e2)
+{
+  FilterNetmaskSet *self;
+
+  if (!_is_mergeable(e1) || !_is_mergeable(e2))
+    return NULL;
+
+  if (_is_set(e1) && e1->ref_cnt == 1)
+    self = (FilterNetmaskSet *) filter_expr_ref(e1);
+  else
+    {
+      self = _new();
+      _add(self, e1);
+    }
+  _add(self, e2);
+
+  filter_expr_unref(e1);
+  filter_expr_unref(e2);
+  return &self->super;
+}
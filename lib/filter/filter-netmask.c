@@ -71,6 +71,27 @@ filter_netmask_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTempl
   return res ^ s->comp;
 }
 
+/* returns the network address and the prefix length if @s is a netmask()
+ * filter with a contiguous netmask */
+gboolean
+filter_netmask_get_prefix(FilterExprNode *s, struct in_addr *network, gint *prefix)
+{
+  FilterNetmask *self = (FilterNetmask *) s;
+
+  if (s->eval != filter_netmask_eval)
+    return FALSE;
+
+  guint32 host_bits = ~ntohl(self->netmask.s_addr);
+  if (host_bits & (host_bits + 1))
+    return FALSE;
+
+  *prefix = 32;
+  for (; host_bits; host_bits >>= 1)
+    (*prefix)--;
+  *network = self->address;
+  return TRUE;
+}
+
 FilterExprNode *
 filter_netmask_new(const gchar *cidr)
 {
@@ -27,6 +27,9 @@
 
 #include "filter-expr.h"
 
+#include <netinet/in.h>
+
 FilterExprNode *filter_netmask_new(const gchar *cidr);
+gboolean filter_netmask_get_prefix(FilterExprNode *s, struct in_addr *network, gint *prefix);
 
 #endif
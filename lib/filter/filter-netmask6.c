@@ -136,6 +136,21 @@ _eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTemplateEvalOptions
   return result ^ s->comp;
 }
 
+/* returns the network address and the prefix length if @s is a valid
+ * netmask6() filter */
+gboolean
+filter_netmask6_get_prefix(FilterExprNode *s, struct in6_addr *network, gint *prefix)
+{
+  FilterNetmask6 *self = (FilterNetmask6 *) s;
+
+  if (s->eval != _eval || !self->is_valid)
+    return FALSE;
+
+  *network = self->address;
+  *prefix = self->prefix;
+  return TRUE;
+}
+
 FilterExprNode *
 filter_netmask6_new(const gchar *cidr)
 {
@@ -28,6 +28,7 @@
 #include "filter-expr.h"
 
 FilterExprNode *filter_netmask6_new(const gchar *cidr);
+gboolean filter_netmask6_get_prefix(FilterExprNode *s, struct in6_addr *network, gint *prefix);
 void get_network_address(const struct in6_addr *address, int prefix, struct in6_addr *network);
 
 #endif
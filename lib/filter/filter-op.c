@@ -108,3 +108,17 @@ fop_and_new(FilterExprNode *e1, FilterExprNode *e2)
   self->super.type = "AND";
   return &self->super;
 }
+
+/* splits a non-negated "and" expression into its operands */
+gboolean
+fop_and_get_operands(FilterExprNode *s, FilterExprNode **left, FilterExprNode **right)
+{
+  FilterOp *self = (FilterOp *) s;
+
+  if (s->eval != fop_and_eval || s->comp)
+    return FALSE;
+
+  *left = self->left;
+  *right = self->right;
+  return TRUE;
+}
@@ -29,5 +29,6 @@
 
 FilterExprNode *fop_or_new(FilterExprNode *e1, FilterExprNode *e2);
 FilterExprNode *fop_and_new(FilterExprNode *e1, FilterExprNode *e2);
+gboolean fop_and_get_operands(FilterExprNode *s, FilterExprNode **left, FilterExprNode **right);
 
 #endif
@@ -23,6 +23,8 @@
  */
 
 #include "filter/filter-pipe.h"
+#include "filter/filter-op.h"
+#include "filter/filter-re.h"
 #include "stats/stats-registry.h"
 
 /*******************************************************************
@@ -125,3 +127,33 @@ log_filter_pipe_new(FilterExprNode *expr, GlobalConfig *cfg)
   self->expr = expr;
   return &self->super;
 }
+
+static gchar *
+_get_exact_match(FilterExprNode *expr, NVHandle *value_handle)
+{
+  FilterExprNode *left, *right;
+
+  if (fop_and_get_operands(expr, &left, &right))
+    {
+      gchar *literal = _get_exact_match(left, value_handle);
+
+      return literal ? : _get_exact_match(right, value_handle);
+    }
+  return filter_re_get_exact_match(expr, value_handle);
+}
+
+/*
+ * Returns the literal value that @value_handle must have for a message to
+ * pass @s, if @s is a filter pipe that is known to drop everything else.
+ * See filter_re_get_exact_match() for the details.
+ */
+gchar *
+log_filter_pipe_get_exact_match(LogPipe *s, NVHandle *value_handle)
+{
+  LogFilterPipe *self = (LogFilterPipe *) s;
+
+  if (s->queue != log_filter_pipe_queue)
+    return NULL;
+
+  return _get_exact_match(self->expr, value_handle);
+}
@@ -44,5 +44,6 @@ typedef struct _LogFilterPipe
 } LogFilterPipe;
 
 LogPipe *log_filter_pipe_new(FilterExprNode *expr, GlobalConfig *cfg);
+gchar *log_filter_pipe_get_exact_match(LogPipe *s, NVHandle *value_handle);
 
 #endif
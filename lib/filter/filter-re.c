@@ -36,6 +36,7 @@ typedef struct _FilterRE
   LogMatcher *matcher;
 } FilterRE;
 
+static gboolean filter_match_init(FilterExprNode *s, GlobalConfig *cfg);
 
 static gboolean
 filter_re_eval_string(FilterExprNode *s, LogMessage *msg, gint value_handle, const gchar *str, gssize str_len)
@@ -125,6 +126,65 @@ filter_re_init_instance(FilterRE *self, NVHandle value_handle)
   self->matcher_options.flags |= LMF_MATCH_ONLY;
 }
 
+static gboolean
+_is_literal_regexp_char(gchar c)
+{
+  return g_ascii_isalnum(c) || strchr("_-/:@,;=%!~<>#' \"", c) != NULL;
+}
+
+static gchar *
+_extract_exact_match(LogMatcherOptions *options, LogMatcher *matcher)
+{
+  const gchar *pattern = matcher->pattern;
+  gsize pattern_len = strlen(pattern);
+
+  if (matcher->flags & (LMF_ICASE + LMF_STORE_MATCHES + LMF_NEWLINE + LMF_SUBSTRING + LMF_PREFIX))
+    return NULL;
+
+  if (strcmp(options->type, "string") == 0)
+    return strpbrk(pattern, "\r\n") ? NULL : g_strdup(pattern);
+
+  if (strcmp(options->type, "glob") == 0)
+    return strpbrk(pattern, "*?\r\n") ? NULL : g_strdup(pattern);
+
+  if (strcmp(options->type, "pcre") == 0)
+    {
+      /* only "^literal$" style regexps qualify */
+      if (pattern_len < 2 || pattern[0] != '^' || pattern[pattern_len - 1] != '$')
+        return NULL;
+
+      for (gsize i = 1; i < pattern_len - 1; i++)
+        {
+          if (!_is_literal_regexp_char(pattern[i]))
+            return NULL;
+        }
+      return g_strndup(pattern + 1, pattern_len - 2);
+    }
+  return NULL;
+}
+
+/*
+ * Returns the literal that the value in @value_handle has to be equal to
+ * for @s to match, or NULL if @s is not this simple.  As regexps anchored
+ * with '$' also match before a trailing newline, callers have to ignore a
+ * trailing newline of the value they compare against the literal, which
+ * never contains one.
+ */
+gchar *
+filter_re_get_exact_match(FilterExprNode *s, NVHandle *value_handle)
+{
+  FilterRE *self = (FilterRE *) s;
+
+  if (s->init != filter_re_init && s->init != filter_match_init)
+    return NULL;
+
+  if (s->comp || !self->value_handle || !self->matcher || !self->matcher_options.type)
+    return NULL;
+
+  *value_handle = self->value_handle;
+  return _extract_exact_match(&self->matcher_options, self->matcher);
+}
+
 FilterExprNode *
 filter_re_new(NVHandle value_handle)
 {
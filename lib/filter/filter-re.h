@@ -30,6 +30,7 @@
 
 LogMatcherOptions *filter_re_get_matcher_options(FilterExprNode *s);
 gboolean filter_re_compile_pattern(FilterExprNode *s, const gchar *re, GError **error);
+gchar *filter_re_get_exact_match(FilterExprNode *s, NVHandle *value_handle);
 
 FilterExprNode *filter_re_new(NVHandle value_handle);
 FilterExprNode *filter_source_new(void);
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "filter/filter-pipe.h"
+#include "filter/filter-re.h"
+#include "filter/filter-op.h"
+#include "filter/filter-pri.h"
+#include "logmpx.h"
+#include "apphook.h"
+#include "cfg.h"
+
+#include <criterion/criterion.h>
+
+typedef struct _CountingPipe
+{
+  LogPipe super;
+  gint received;
+} CountingPipe;
+
+static GPtrArray *pipes;
+
+static void
+_counting_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  CountingPipe *self = (CountingPipe *) s;
+
+  self->received++;
+  log_msg_drop(msg, path_options, AT_PROCESSED);
+}
+
+static CountingPipe *
+_counting_pipe_new(void)
+{
+  CountingPipe *self = g_new0(CountingPipe, 1);
+
+  log_pipe_init_instance(&self->super, configuration);
+  self->super.queue = _counting_pipe_queue;
+  g_ptr_array_add(pipes, self);
+  return self;
+}
+
+static FilterExprNode *
+_program_filter(const gchar *pattern, const gchar *type, gint flags)
+{
+  FilterExprNode *filter = filter_re_new(LM_V_PROGRAM);
+  LogMatcherOptions *options = filter_re_get_matcher_options(filter);
+
+  if (type)
+    cr_assert(log_matcher_options_set_type(options, type));
+  options->flags |= flags;
+  cr_assert(filter_re_compile_pattern(filter, pattern, NULL));
+  return filter;
+}
+
+/* a branch the way cfg-tree compiles it: a do-nothing pipe, the filter and the destination */
+static CountingPipe *
+_add_branch(LogMultiplexer *mpx, FilterExprNode *filter, guint32 flags)
+{
+  LogPipe *head = log_pipe_new(configuration);
+  LogPipe *tail = head;
+  CountingPipe *destination = _counting_pipe_new();
+
+  g_ptr_array_add(pipes, head);
+  if (filter)
+    {
+      tail = log_filter_pipe_new(filter, configuration);
+      g_ptr_array_add(pipes, tail);
+      log_pipe_append(head, tail);
+    }
+  log_pipe_append(tail, &destination->super);
+  head->flags |= flags;
+  log_multiplexer_add_next_hop(mpx, head);
+  return destination;
+}
+
+static LogMultiplexer *
+_create_mpx(void)
+{
+  LogMultiplexer *mpx = log_multiplexer_new(configuration);
+
+  g_ptr_array_add(pipes, mpx);
+  return mpx;
+}
+
+static void
+_init_pipes(void)
+{
+  for (gint i = pipes->len - 1; i >= 0; i--)
+    cr_assert(log_pipe_init(g_ptr_array_index(pipes, i)));
+}
+
+static void
+_queue_program(LogMultiplexer *mpx, const gchar *program)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msg = log_msg_new_empty();
+
+  log_msg_set_value(msg, LM_V_PROGRAM, program, -1);
+  log_pipe_queue(&mpx->super, msg, &path_options);
+}
+
+Test(filter_dispatch, exact_program_filters_are_dispatched_by_value)
+{
+  LogMultiplexer *mpx = _create_mpx();
+  CountingPipe *foo_string = _add_branch(mpx, _program_filter("foo", "string", 0), 0);
+  CountingPipe *bar_pcre = _add_branch(mpx, _program_filter("^bar$", NULL, 0), 0);
+  CountingPipe *unfiltered = _add_branch(mpx, NULL, 0);
+  CountingPipe *foo_glob = _add_branch(mpx, _program_filter("foo", "glob", 0), 0);
+  CountingPipe *baz_substring = _add_branch(mpx, _program_filter("baz", NULL, 0), 0);
+  CountingPipe *foo_and_level = _add_branch(mpx, fop_and_new(filter_severity_new(0xff),
+                                                  _program_filter("foo", "string", 0)), 0);
+
+  _init_pipes();
+  cr_assert_not_null(mpx->dispatch);
+
+  _queue_program(mpx, "foo");
+  _queue_program(mpx, "bar");
+  _queue_program(mpx, "bar\n");
+  _queue_program(mpx, "foobar");
+  _queue_program(mpx, "xbazx");
+  _queue_program(mpx, "");
+
+  cr_assert_eq(foo_string->received, 1);
+  cr_assert_eq(bar_pcre->received, 2);
+  cr_assert_eq(unfiltered->received, 6);
+  cr_assert_eq(foo_glob->received, 1);
+  cr_assert_eq(baz_substring->received, 1);
+  cr_assert_eq(foo_and_level->received, 1);
+}
+
+Test(filter_dispatch, final_and_fallback_flags_are_kept)
+{
+  LogMultiplexer *mpx = _create_mpx();
+  CountingPipe *foo_final = _add_branch(mpx, _program_filter("foo", "string", 0), PIF_BRANCH_FINAL);
+  CountingPipe *bar = _add_branch(mpx, _program_filter("bar", "string", 0), 0);
+  CountingPipe *catch_all = _add_branch(mpx, NULL, 0);
+  CountingPipe *fallback = _add_branch(mpx, _program_filter("qux", "string", 0), PIF_BRANCH_FALLBACK);
+
+  _init_pipes();
+  cr_assert_not_null(mpx->dispatch);
+
+  _queue_program(mpx, "foo");
+  _queue_program(mpx, "bar");
+  _queue_program(mpx, "qux");
+
+  cr_assert_eq(foo_final->received, 1);
+  cr_assert_eq(bar->received, 1);
+  cr_assert_eq(catch_all->received, 2);
+  cr_assert_eq(fallback->received, 0);
+}
+
+Test(filter_dispatch, fallback_branches_are_dispatched_when_nothing_else_matches)
+{
+  LogMultiplexer *mpx = _create_mpx();
+  CountingPipe *foo = _add_branch(mpx, _program_filter("foo", "string", 0), 0);
+  CountingPipe *bar_fallback = _add_branch(mpx, _program_filter("bar", "string", 0), PIF_BRANCH_FALLBACK);
+
+  _init_pipes();
+  cr_assert_not_null(mpx->dispatch);
+
+  _queue_program(mpx, "foo");
+  _queue_program(mpx, "bar");
+
+  cr_assert_eq(foo->received, 1);
+  cr_assert_eq(bar_fallback->received, 1);
+}
+
+Test(filter_dispatch, inexact_filters_are_not_dispatched)
+{
+  LogMultiplexer *mpx = _create_mpx();
+  CountingPipe *foo_icase = _add_branch(mpx, _program_filter("foo", "string", LMF_ICASE), 0);
+  CountingPipe *foo_prefix = _add_branch(mpx, _program_filter("foo", "string", LMF_PREFIX), 0);
+  CountingPipe *foo_regexp = _add_branch(mpx, _program_filter("^fo+$", NULL, 0), 0);
+  CountingPipe *foo_dropping = _add_branch(mpx, _program_filter("foo", "string", 0), PIF_DROP_UNMATCHED);
+
+  _init_pipes();
+  cr_assert_null(mpx->dispatch);
+
+  _queue_program(mpx, "FOO");
+  _queue_program(mpx, "foooo");
+
+  cr_assert_eq(foo_icase->received, 1);
+  cr_assert_eq(foo_prefix->received, 1);
+  cr_assert_eq(foo_regexp->received, 1);
+  cr_assert_eq(foo_dropping->received, 0);
+}
+
+Test(filter_dispatch, long_values_are_dispatched_without_copying_them_to_the_stack)
+{
+  LogMultiplexer *mpx = _create_mpx();
+  gchar *long_program = g_strnfill(1000, 'x');
+  gchar *long_program_with_newline = g_strdup_printf("%s\n", long_program);
+  gchar *huge_program = g_strnfill(1024 * 1024, 'x');
+  CountingPipe *long_string = _add_branch(mpx, _program_filter(long_program, "string", 0), 0);
+  CountingPipe *bar = _add_branch(mpx, _program_filter("bar", "string", 0), 0);
+  CountingPipe *unfiltered = _add_branch(mpx, NULL, 0);
+
+  _init_pipes();
+  cr_assert_not_null(mpx->dispatch);
+
+  _queue_program(mpx, long_program);
+  _queue_program(mpx, long_program_with_newline);
+  _queue_program(mpx, huge_program);
+  _queue_program(mpx, "bar\n");
+
+  cr_assert_eq(long_string->received, 2);
+  cr_assert_eq(bar->received, 1);
+  cr_assert_eq(unfiltered->received, 4);
+
+  g_free(long_program);
+  g_free(long_program_with_newline);
+  g_free(huge_program);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  configuration = cfg_new_snippet();
+  cfg_init(configuration);
+  pipes = g_ptr_array_new();
+}
+
+static void
+teardown(void)
+{
+  for (gint i = 0; i < pipes->len; i++)
+    {
+      LogPipe *pipe = g_ptr_array_index(pipes, i);
+
+      log_pipe_deinit(pipe);
+      log_pipe_unref(pipe);
+    }
+  g_ptr_array_free(pipes, TRUE);
+  cfg_deinit(configuration);
+  cfg_free(configuration);
+  app_shutdown();
+}
+
+TestSuite(filter_dispatch, .init = setup, .fini = teardown);
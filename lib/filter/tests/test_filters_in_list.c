@@ -23,6 +23,7 @@
  */
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <glib.h>
 
 #include "cfg.h"
@@ -127,6 +128,43 @@ Test(template_filters, test_filter_with_long_line)
   g_free(list_file_with_long_line);
 }
 
+static gboolean
+_evaluate_value(FilterExprNode *filter_node, const gchar *value)
+{
+  LogMessage *log_msg = log_msg_new_empty();
+  gboolean result;
+
+  log_msg_set_value_by_name(log_msg, "PROGRAM", value, -1);
+  result = filter_expr_eval(filter_node, log_msg);
+  log_msg_unref(log_msg);
+  return result;
+}
+
+Test(template_filters, test_every_line_of_the_list_matches_but_nothing_else)
+{
+  gchar *list_file_which_has_a_lot_of_lines = g_strdup_printf(LIST_FILE_DIR "lot_of_lines.list", top_srcdir);
+  FilterExprNode *filter_node = filter_in_list_new(list_file_which_has_a_lot_of_lines, "PROGRAM");
+
+  cr_assert_not_null(filter_node, "Constructing an in-list filter");
+  cr_assert(_evaluate_value(filter_node, "test-program"));
+  for (gint i = 1; i <= 100; i++)
+    {
+      gchar value[32];
+
+      g_snprintf(value, sizeof(value), "foo-bar%d", i);
+      cr_assert(_evaluate_value(filter_node, value), "in-list filter should match: %s", value);
+
+      g_snprintf(value, sizeof(value), "foo-bar%dx", i);
+      cr_assert_not(_evaluate_value(filter_node, value), "in-list filter should not match: %s", value);
+    }
+  cr_assert_not(_evaluate_value(filter_node, "foo-bar"));
+  cr_assert_not(_evaluate_value(filter_node, "foo-bar101"));
+  cr_assert_not(_evaluate_value(filter_node, ""));
+
+  filter_expr_unref(filter_node);
+  g_free(list_file_which_has_a_lot_of_lines);
+}
+
 static void
 setup(void)
 {
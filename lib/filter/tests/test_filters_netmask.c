@@ -24,6 +24,7 @@
 #include "filter/filter-expr.h"
 #include "filter/filter-netmask6.h"
 #include "filter/filter-netmask.h"
+#include "filter/filter-netmask-set.h"
 #include "filter/filter-re.h"
 #include "filter/filter-pri.h"
 #include "filter/filter-op.h"
@@ -82,3 +83,82 @@ ParameterizedTest(FilterParamNetmask *param, filter, test_filter_netmask_ip4)
 {
   testcase(param->msg, filter_netmask_new(param->cidr), param->expected_result);
 }
+
+static FilterExprNode *
+_create_netmask(const gchar *cidr)
+{
+#if SYSLOG_NG_ENABLE_IPV6
+  if (strchr(cidr, ':'))
+    return filter_netmask6_new(cidr);
+#endif
+  return filter_netmask_new(cidr);
+}
+
+/* builds "netmask(cidrs[0]) or netmask(cidrs[1]) or ..." the same way the grammar does */
+static FilterExprNode *
+_create_netmask_chain(const gchar *cidrs[])
+{
+  FilterExprNode *result = _create_netmask(cidrs[0]);
+
+  for (gint i = 1; cidrs[i]; i++)
+    {
+      FilterExprNode *next = _create_netmask(cidrs[i]);
+      result = filter_netmask_set_merge(result, next) ? : fop_or_new(result, next);
+    }
+  return result;
+}
+
+typedef struct _FilterParamNetmaskSet
+{
+  const gchar *sockaddr;
+  const gchar *cidrs[5];
+  gboolean    expected_result;
+} FilterParamNetmaskSet;
+
+ParameterizedTestParameters(filter, test_filter_netmask_set)
+{
+  static FilterParamNetmaskSet test_data_list[] =
+  {
+    {.sockaddr = "10.10.0.1", .cidrs = {"192.168.0.0/16", "10.10.0.0/24", NULL}, .expected_result = TRUE},
+    {.sockaddr = "10.10.0.1", .cidrs = {"192.168.0.0/16", "10.10.1.0/24", NULL}, .expected_result = FALSE},
+    {.sockaddr = "10.10.0.1", .cidrs = {"172.16.0.0/12", "10.0.0.0/255.0.0.0", NULL}, .expected_result = TRUE},
+    {.sockaddr = "10.10.0.1", .cidrs = {"172.16.0.0/12", "10.10.0.0/23", "10.10.0.2", NULL}, .expected_result = TRUE},
+    {.sockaddr = "10.10.2.1", .cidrs = {"172.16.0.0/12", "10.10.0.0/23", "10.10.0.2", NULL}, .expected_result = FALSE},
+    {.sockaddr = "10.10.0.1", .cidrs = {"192.168.0.0/16", "0.0.0.0/0.0.0.0", NULL}, .expected_result = TRUE},
+    {.sockaddr = NULL, .cidrs = {"10.0.0.0/8", "127.0.0.1", NULL}, .expected_result = TRUE},
+    {.sockaddr = NULL, .cidrs = {"10.0.0.0/8", "127.0.0.2", NULL}, .expected_result = FALSE},
+#if SYSLOG_NG_ENABLE_IPV6
+    {.sockaddr = "2001:db8::1", .cidrs = {"10.0.0.0/8", "2001:db8::/32", NULL}, .expected_result = TRUE},
+    {.sockaddr = "2001:db8::1", .cidrs = {"2001:db9::/32", "2001:db8::2/127", NULL}, .expected_result = FALSE},
+    {.sockaddr = "2001:db8::1", .cidrs = {"2001:db9::/32", "2001:db8::/127", NULL}, .expected_result = TRUE},
+    {.sockaddr = "10.10.0.1", .cidrs = {"::ffff:10.10.0.0/120", "2001:db8::/32", NULL}, .expected_result = FALSE},
+    {.sockaddr = NULL, .cidrs = {"10.0.0.0/8", "::1", NULL}, .expected_result = TRUE},
+#endif
+  };
+
+  return cr_make_param_array(FilterParamNetmaskSet, test_data_list, G_N_ELEMENTS(test_data_list));
+}
+
+ParameterizedTest(FilterParamNetmaskSet *param, filter, test_filter_netmask_set)
+{
+  FilterExprNode *filter = _create_netmask_chain(param->cidrs);
+
+  cr_assert_str_eq(filter->type, "netmask-set");
+  testcase_with_socket("<15>Oct 15 16:19:01 host openvpn[2499]: PTHREAD support initialized",
+                       param->sockaddr, filter, param->expected_result);
+}
+
+Test(filter, test_filter_netmask_set_is_not_used_for_negated_or_non_contiguous_netmasks)
+{
+  FilterExprNode *negated = filter_netmask_new("10.0.0.0/8");
+  FilterExprNode *other = filter_netmask_new("192.168.0.0/16");
+
+  negated->comp = TRUE;
+  cr_assert_null(filter_netmask_set_merge(negated, other));
+  filter_expr_unref(negated);
+
+  FilterExprNode *non_contiguous = filter_netmask_new("10.0.0.0/255.0.255.0");
+  cr_assert_null(filter_netmask_set_merge(non_contiguous, other));
+  filter_expr_unref(non_contiguous);
+  filter_expr_unref(other);
+}
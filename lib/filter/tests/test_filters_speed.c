@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "filter/filter-expr.h"
+#include "filter/filter-netmask.h"
+#include "filter/filter-netmask-set.h"
+#include "filter/filter-in-list.h"
+#include "filter/filter-op.h"
+#include "logmsg/logmsg.h"
+#include "gsockaddr.h"
+#include "cfg.h"
+#include "test_filters_common.h"
+#include "libtest/stopwatch.h"
+
+#include <criterion/criterion.h>
+
+#define NETMASK_ITERATIONS 100000
+#define IN_LIST_ITERATIONS 1000000
+
+static void
+_perftest_filter(FilterExprNode *filter, LogMessage *msg, gint iterations, const gchar *description)
+{
+  gboolean result = TRUE;
+
+  start_stopwatch();
+  for (gint i = 0; i < iterations; i++)
+    result &= filter_expr_eval(filter, msg);
+  stop_stopwatch_and_display_result(iterations, "      %s", description);
+
+  cr_assert(result);
+}
+
+Test(filters_speed, test_netmask_or_chain_vs_netmask_set)
+{
+  FilterExprNode *or_chain = NULL;
+  FilterExprNode *merged = NULL;
+  LogMessage *msg = log_msg_new_empty();
+
+  for (gint i = 0; i < 64; i++)
+    {
+      gchar cidr[32];
+
+      g_snprintf(cidr, sizeof(cidr), "10.%d.0.0/16", i);
+      or_chain = or_chain ? fop_or_new(or_chain, filter_netmask_new(cidr)) : filter_netmask_new(cidr);
+
+      FilterExprNode *next = filter_netmask_new(cidr);
+      if (!merged)
+        merged = next;
+      else
+        merged = filter_netmask_set_merge(merged, next) ? : fop_or_new(merged, next);
+    }
+  cr_assert_str_eq(merged->type, "netmask-set");
+
+  log_msg_set_saddr_ref(msg, g_sockaddr_inet_new("10.63.0.1", 5000));
+  _perftest_filter(or_chain, msg, NETMASK_ITERATIONS, "64 netmask() filters, OR chain");
+  _perftest_filter(merged, msg, NETMASK_ITERATIONS, "64 netmask() filters, merged set");
+
+  log_msg_unref(msg);
+  filter_expr_unref(or_chain);
+  filter_expr_unref(merged);
+}
+
+Test(filters_speed, test_in_list)
+{
+  gchar *list_file = g_strdup_printf("%s/lib/filter/tests/filters-in-list/lot_of_lines.list", TOP_SRCDIR);
+  FilterExprNode *filter = filter_in_list_new(list_file, "PROGRAM");
+  LogMessage *msg = log_msg_new_empty();
+
+  cr_assert_not_null(filter);
+  log_msg_set_value_by_name(msg, "PROGRAM", "foo-bar57", -1);
+  _perftest_filter(filter, msg, IN_LIST_ITERATIONS, "in-list() with 101 entries");
+
+  log_msg_unref(msg);
+  filter_expr_unref(filter);
+  g_free(list_file);
+}
+
+TestSuite(filters_speed, .init = setup, .fini = teardown);
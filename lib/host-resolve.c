@@ -23,6 +23,7 @@
 #include "host-resolve.h"
 #include "hostname.h"
 #include "dnscache.h"
+#include "dns-resolver.h"
 #include "messages.h"
 #include "cfg.h"
 #include "tls-support.h"
@@ -323,6 +324,17 @@ resolve_address_using_gethostbyaddr(GSockAddr *saddr, gchar *buf, gsize buf_len)
 
 #endif
 
+/* resolves @saddr using the system resolver, blocks until the answer arrives */
+const gchar *
+resolve_sockaddr_to_dns_hostname(GSockAddr *saddr, gchar *buf, gsize buf_len)
+{
+#ifdef SYSLOG_NG_HAVE_GETNAMEINFO
+  return resolve_address_using_getnameinfo(saddr, buf, buf_len);
+#else
+  return resolve_address_using_gethostbyaddr(saddr, buf, buf_len);
+#endif
+}
+
 static void *
 sockaddr_to_dnscache_key(GSockAddr *saddr)
 {
@@ -347,6 +359,7 @@ resolve_sockaddr_to_inet_or_inet6_hostname(gsize *result_len, GSockAddr *saddr,
   const gchar *hname;
   gsize hname_len;
   gboolean positive;
+  gboolean cacheable = TRUE;
   void *dnscache_key;
 
   dnscache_key = sockaddr_to_dnscache_key(saddr);
@@ -362,12 +375,20 @@ resolve_sockaddr_to_inet_or_inet6_hostname(gsize *result_len, GSockAddr *saddr,
 
   if (!hname && host_resolve_options->use_dns && host_resolve_options->use_dns != 2)
     {
-#ifdef SYSLOG_NG_HAVE_GETNAMEINFO
-      hname = resolve_address_using_getnameinfo(saddr, hostname_buffer, sizeof(hostname_buffer));
-#else
-      hname = resolve_address_using_gethostbyaddr(saddr, hostname_buffer, sizeof(hostname_buffer));
-#endif
-      positive = (hname != NULL);
+      if (dns_resolver_is_enabled())
+        {
+          /* the IP address is used until the resolver threads come up
+           * with an answer, which must not end up in the cache */
+          if (dns_resolver_lookup(saddr, hostname_buffer, sizeof(hostname_buffer), &positive))
+            hname = positive ? hostname_buffer : NULL;
+          else
+            cacheable = FALSE;
+        }
+      else
+        {
+          hname = resolve_sockaddr_to_dns_hostname(saddr, hostname_buffer, sizeof(hostname_buffer));
+          positive = (hname != NULL);
+        }
     }
 
   if (!hname)
@@ -375,7 +396,7 @@ resolve_sockaddr_to_inet_or_inet6_hostname(gsize *result_len, GSockAddr *saddr,
       hname = g_sockaddr_format(saddr, hostname_buffer, sizeof(hostname_buffer), GSA_ADDRESS_ONLY);
       positive = FALSE;
     }
-  if (host_resolve_options->use_dns_cache)
+  if (host_resolve_options->use_dns_cache && cacheable)
     dns_caching_store(saddr->sa.sa_family, dnscache_key, hname, positive);
 
   return hostname_apply_options_fqdn(-1, result_len, hname, positive, host_resolve_options);
@@ -24,6 +24,200 @@
 
 #include "logmpx.h"
 #include "cfg-walker.h"
+#include "filter/filter-pipe.h"
+#include "messages.h"
+#include "scratch-buffers.h"
+
+#include <string.h>
+
+/*
+ * Sibling branches often start with a filter that only lets through
+ * messages with one specific value of a name-value pair (e.g.
+ * program("foo" type(string))).  Such branches are grouped by that value
+ * into a hash table when the multiplexer is initialized, and a message is
+ * only queued to the branches registered for its value and to those that
+ * are not gated this way.  The other branches would drop the message at
+ * their filter anyway.
+ */
+struct _LogMultiplexerDispatch
+{
+  NVHandle value_handle;
+  /* value -> GPtrArray of the branches to visit, in their original order */
+  GHashTable *next_hops_by_value;
+  GPtrArray *ungated_next_hops;
+  /* longer values cannot match any of the gates */
+  gsize max_value_len;
+};
+
+typedef struct _BranchGate
+{
+  NVHandle value_handle;
+  gchar *value;
+} BranchGate;
+
+static void
+_get_branch_gate(LogPipe *branch_head, BranchGate *gate)
+{
+  LogPipe *p = branch_head;
+
+  gate->value = NULL;
+
+  /* skip the do-nothing pipes the cfg-tree links between elements */
+  while (p && !p->queue && !(p->flags & PIF_DROP_UNMATCHED))
+    p = p->pipe_next;
+
+  if (!p || (p->flags & PIF_DROP_UNMATCHED))
+    return;
+
+  gate->value = log_filter_pipe_get_exact_match(p, &gate->value_handle);
+}
+
+static NVHandle
+_find_most_common_gate(BranchGate *gates, gint num_gates, gint *count)
+{
+  NVHandle best_handle = 0;
+
+  *count = 0;
+  for (gint i = 0; i < num_gates; i++)
+    {
+      gint handle_count = 0;
+
+      if (!gates[i].value)
+        continue;
+
+      for (gint j = 0; j < num_gates; j++)
+        {
+          if (gates[j].value && gates[j].value_handle == gates[i].value_handle)
+            handle_count++;
+        }
+      if (handle_count > *count)
+        {
+          *count = handle_count;
+          best_handle = gates[i].value_handle;
+        }
+    }
+  return best_handle;
+}
+
+static void
+_dispatch_free(LogMultiplexerDispatch *self)
+{
+  g_hash_table_destroy(self->next_hops_by_value);
+  g_ptr_array_free(self->ungated_next_hops, TRUE);
+  g_free(self);
+}
+
+static LogMultiplexerDispatch *
+_dispatch_new(LogMultiplexer *mpx, BranchGate *gates, NVHandle value_handle)
+{
+  LogMultiplexerDispatch *self = g_new0(LogMultiplexerDispatch, 1);
+  gint i;
+
+  self->value_handle = value_handle;
+  self->next_hops_by_value = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                                   (GDestroyNotify) g_ptr_array_unref);
+  self->ungated_next_hops = g_ptr_array_new();
+
+  for (i = 0; i < mpx->next_hops->len; i++)
+    {
+      if (gates[i].value && gates[i].value_handle == value_handle &&
+          !g_hash_table_contains(self->next_hops_by_value, gates[i].value))
+        {
+          g_hash_table_insert(self->next_hops_by_value, g_strdup(gates[i].value), g_ptr_array_new());
+          self->max_value_len = MAX(self->max_value_len, strlen(gates[i].value));
+        }
+    }
+
+  for (i = 0; i < mpx->next_hops->len; i++)
+    {
+      LogPipe *next_hop = g_ptr_array_index(mpx->next_hops, i);
+
+      if (gates[i].value && gates[i].value_handle == value_handle)
+        {
+          g_ptr_array_add(g_hash_table_lookup(self->next_hops_by_value, gates[i].value), next_hop);
+        }
+      else
+        {
+          GHashTableIter iter;
+          GPtrArray *next_hops;
+
+          g_ptr_array_add(self->ungated_next_hops, next_hop);
+          g_hash_table_iter_init(&iter, self->next_hops_by_value);
+          while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &next_hops))
+            g_ptr_array_add(next_hops, next_hop);
+        }
+    }
+  return self;
+}
+
+static GPtrArray *
+_dispatch_lookup(LogMultiplexerDispatch *self, LogMessage *msg)
+{
+  gssize value_len;
+  const gchar *value = log_msg_get_value(msg, self->value_handle, &value_len);
+  gsize key_len = strnlen(value, value_len);
+  gchar key_buf[128];
+  GPtrArray *next_hops;
+
+  /* gates never contain newlines, see filter_re_get_exact_match() */
+  if (key_len > 0 && value[key_len - 1] == '\n')
+    key_len--;
+  if (key_len > 0 && value[key_len - 1] == '\r')
+    key_len--;
+
+  if (key_len > self->max_value_len)
+    return self->ungated_next_hops;
+
+  /* the value is not NUL terminated at key_len, the key is copied to the
+   * stack, or to a scratch buffer if it does not fit */
+  if (value[key_len] != 0)
+    {
+      if (key_len < sizeof(key_buf))
+        {
+          memcpy(key_buf, value, key_len);
+          key_buf[key_len] = 0;
+          value = key_buf;
+        }
+      else
+        {
+          GString *key = scratch_buffers_alloc();
+
+          g_string_append_len(key, value, key_len);
+          value = key->str;
+        }
+    }
+
+  next_hops = g_hash_table_lookup(self->next_hops_by_value, value);
+  return next_hops ? : self->ungated_next_hops;
+}
+
+static void
+_setup_dispatch(LogMultiplexer *self)
+{
+  BranchGate *gates = g_new0(BranchGate, self->next_hops->len);
+  NVHandle value_handle;
+  gint num_gated;
+  gint i;
+
+  for (i = 0; i < self->next_hops->len; i++)
+    _get_branch_gate(g_ptr_array_index(self->next_hops, i), &gates[i]);
+
+  value_handle = _find_most_common_gate(gates, self->next_hops->len, &num_gated);
+  if (num_gated >= 2)
+    {
+      self->dispatch = _dispatch_new(self, gates, value_handle);
+      msg_debug("Log paths are dispatched by value instead of evaluating their filters one by one",
+                evt_tag_str("value", log_msg_get_value_name(value_handle, NULL)),
+                evt_tag_int("dispatched_paths", num_gated),
+                evt_tag_int("distinct_values", g_hash_table_size(self->dispatch->next_hops_by_value)),
+                evt_tag_int("other_paths", self->dispatch->ungated_next_hops->len),
+                log_pipe_location_tag(&self->super));
+    }
+
+  for (i = 0; i < self->next_hops->len; i++)
+    g_free(gates[i].value);
+  g_free(gates);
+}
 
 
 void
@@ -53,15 +247,39 @@ log_multiplexer_init(LogPipe *s)
           self->fallback_exists = TRUE;
         }
     }
+
+  if (self->dispatch)
+    {
+      _dispatch_free(self->dispatch);
+      self->dispatch = NULL;
+    }
+  _setup_dispatch(self);
   return TRUE;
 }
 
 static gboolean
-log_multiplexer_deinit(LogPipe *self)
+log_multiplexer_deinit(LogPipe *s)
 {
+  LogMultiplexer *self = (LogMultiplexer *) s;
+
+  if (self->dispatch)
+    {
+      _dispatch_free(self->dispatch);
+      self->dispatch = NULL;
+    }
   return TRUE;
 }
 
+static GPtrArray *
+_select_next_hops(LogMultiplexer *self, LogMessage *msg)
+{
+  /* the debugger wants to step through every pipe */
+  if (!self->dispatch || pipe_single_step_hook)
+    return self->next_hops;
+
+  return _dispatch_lookup(self->dispatch, msg);
+}
+
 static gboolean
 _has_multiple_arcs(LogMultiplexer *self)
 {
@@ -78,6 +296,7 @@ log_multiplexer_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_op
   gboolean matched;
   gboolean delivered = FALSE;
   gint fallback;
+  GPtrArray *next_hops;
 
   local_options.matched = &matched;
 
@@ -85,11 +304,12 @@ log_multiplexer_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_op
     {
       log_msg_write_protect(msg);
     }
+  next_hops = _select_next_hops(self, msg);
   for (fallback = 0; (fallback == 0) || (fallback == 1 && self->fallback_exists && !delivered); fallback++)
     {
-      for (i = 0; i < self->next_hops->len; i++)
+      for (i = 0; i < next_hops->len; i++)
         {
-          LogPipe *next_hop = g_ptr_array_index(self->next_hops, i);
+          LogPipe *next_hop = g_ptr_array_index(next_hops, i);
 
           if (G_UNLIKELY(fallback == 0 && (next_hop->flags & PIF_BRANCH_FALLBACK) != 0))
             {
@@ -139,6 +359,8 @@ log_multiplexer_free(LogPipe *s)
 {
   LogMultiplexer *self = (LogMultiplexer *) s;
 
+  if (self->dispatch)
+    _dispatch_free(self->dispatch);
   g_ptr_array_free(self->next_hops, TRUE);
   log_pipe_free_method(s);
 }
@@ -36,11 +36,14 @@
  * This object is used for example for each source to send messages to all
  * log pipelines that refer to the source.
  **/
+typedef struct _LogMultiplexerDispatch LogMultiplexerDispatch;
+
 typedef struct _LogMultiplexer
 {
   LogPipe super;
   GPtrArray *next_hops;
   gboolean fallback_exists;
+  LogMultiplexerDispatch *dispatch;
 } LogMultiplexer;
 
 LogMultiplexer *log_multiplexer_new(GlobalConfig *cfg);
@@ -510,6 +510,24 @@ _value_invalidates_legacy_header(NVHandle handle)
   return handle == LM_V_PROGRAM || handle == LM_V_PID;
 }
 
+/* A copy-on-write clone shares the payload of the original message until
+ * its first change.  The private copy is layered on top of the original's
+ * payload, so that only the changes are copied, which is cheap even with
+ * large payloads fanned out to many destinations.  The original is
+ * referenced and write protected by the clone, which keeps the parent
+ * layer alive and unchanged. */
+static inline void
+log_msg_make_payload_writable(LogMessage *self, gint additional_space)
+{
+  if (log_msg_chk_flag(self, LF_STATE_OWN_PAYLOAD))
+    return;
+
+  self->payload = nv_table_clone_layered(self->payload, additional_space);
+  log_msg_set_flag(self, LF_STATE_OWN_PAYLOAD);
+  self->allocated_bytes += self->payload->size;
+  stats_counter_add(count_allocated_bytes, self->payload->size);
+}
+
 void
 log_msg_set_value(LogMessage *self, NVHandle handle, const gchar *value, gssize value_len)
 {
@@ -536,13 +554,7 @@ log_msg_set_value(LogMessage *self, NVHandle handle, const gchar *value, gssize
   if (value_len < 0)
     value_len = strlen(value);
 
-  if (!log_msg_chk_flag(self, LF_STATE_OWN_PAYLOAD))
-    {
-      self->payload = nv_table_clone(self->payload, name_len + value_len + 2);
-      log_msg_set_flag(self, LF_STATE_OWN_PAYLOAD);
-      self->allocated_bytes += self->payload->size;
-      stats_counter_add(count_allocated_bytes, self->payload->size);
-    }
+  log_msg_make_payload_writable(self, name_len + value_len + 2);
 
   /* we need a loop here as a single realloc may not be enough. Might help
    * if we pass how much bytes we need though. */
@@ -576,6 +588,8 @@ log_msg_set_value(LogMessage *self, NVHandle handle, const gchar *value, gssize
 void
 log_msg_unset_value(LogMessage *self, NVHandle handle)
 {
+  log_msg_make_payload_writable(self, 0);
+
   while (!nv_table_unset_value(self->payload, handle))
     {
       /* error allocating string in payload, reallocate */
@@ -633,11 +647,7 @@ log_msg_set_value_indirect(LogMessage *self, NVHandle handle, NVHandle ref_handl
                 evt_tag_int("len", len));
     }
 
-  if (!log_msg_chk_flag(self, LF_STATE_OWN_PAYLOAD))
-    {
-      self->payload = nv_table_clone(self->payload, name_len + 1);
-      log_msg_set_flag(self, LF_STATE_OWN_PAYLOAD);
-    }
+  log_msg_make_payload_writable(self, name_len + 1);
 
   NVReferencedSlice referenced_slice =
   {
@@ -717,6 +727,8 @@ log_msg_clear_matches(LogMessage *self)
 #error "Unsupported word length, only 32 or 64 bit platforms are supported"
 #endif
 
+#define LOGMSG_TAGS_INLINE_BITS (LOGMSG_TAGS_INLINE_WORDS * LOGMSG_TAGS_BITS)
+
 static inline void
 log_msg_tags_foreach_item(const LogMessage *self, gint base, gulong item, LogMessageTagsForeachFunc callback,
                           gpointer user_data)
@@ -745,7 +757,10 @@ log_msg_tags_foreach(const LogMessage *self, LogMessageTagsForeachFunc callback,
 
   if (self->num_tags == 0)
     {
-      log_msg_tags_foreach_item(self, 0, (gulong) self->tags, callback, user_data);
+      for (i = 0; i != LOGMSG_TAGS_INLINE_WORDS; ++i)
+        {
+          log_msg_tags_foreach_item(self, i * LOGMSG_TAGS_BITS, self->tags_inline[i], callback, user_data);
+        }
     }
   else
     {
@@ -775,7 +790,6 @@ log_msg_get_bit(gulong *tags, gint index_)
 void
 log_msg_set_tag_by_id_onoff(LogMessage *self, LogTagId id, gboolean on)
 {
-  gulong *old_tags;
   gint old_num_tags;
   gboolean inline_tags;
 
@@ -788,10 +802,10 @@ log_msg_set_tag_by_id_onoff(LogMessage *self, LogTagId id, gboolean on)
 
   /* if num_tags is 0, it means that we use inline storage of tags */
   inline_tags = self->num_tags == 0;
-  if (inline_tags && id < LOGMSG_TAGS_BITS)
+  if (inline_tags && id < LOGMSG_TAGS_INLINE_BITS)
     {
       /* store this tag inline */
-      log_msg_set_bit((gulong *) &self->tags, id, on);
+      log_msg_set_bit(self->tags_inline, id, on);
     }
   else
     {
@@ -807,15 +821,18 @@ log_msg_set_tag_by_id_onoff(LogMessage *self, LogTagId id, gboolean on)
           old_num_tags = self->num_tags;
           self->num_tags = (id / LOGMSG_TAGS_BITS) + 1;
 
-          old_tags = self->tags;
-          if (old_num_tags)
-            self->tags = g_realloc(self->tags, sizeof(self->tags[0]) * self->num_tags);
-          else
-            self->tags = g_malloc(sizeof(self->tags[0]) * self->num_tags);
-          memset(&self->tags[old_num_tags], 0, (self->num_tags - old_num_tags) * sizeof(self->tags[0]));
-
           if (inline_tags)
-            self->tags[0] = (gulong) old_tags;
+            {
+              gulong *tags = g_new0(gulong, self->num_tags);
+
+              memcpy(tags, self->tags_inline, sizeof(self->tags_inline));
+              self->tags = tags;
+            }
+          else
+            {
+              self->tags = g_realloc(self->tags, sizeof(self->tags[0]) * self->num_tags);
+              memset(&self->tags[old_num_tags], 0, (self->num_tags - old_num_tags) * sizeof(self->tags[0]));
+            }
         }
 
       log_msg_set_bit(self->tags, id, on);
@@ -862,8 +879,8 @@ log_msg_is_tag_by_id(LogMessage *self, LogTagId id)
       msg_error("Invalid tag", evt_tag_int("id", (gint) id));
       return FALSE;
     }
-  if (self->num_tags == 0 && id < LOGMSG_TAGS_BITS)
-    return log_msg_get_bit((gulong *) &self->tags, id);
+  if (self->num_tags == 0)
+    return id < LOGMSG_TAGS_INLINE_BITS && log_msg_get_bit(self->tags_inline, id);
   else if (id < self->num_tags * LOGMSG_TAGS_BITS)
     return log_msg_get_bit(self->tags, id);
   else
@@ -1158,18 +1175,13 @@ log_msg_clear(LogMessage *self)
     nv_table_unref(self->payload);
   self->payload = nv_table_new(LM_V_MAX, 16, 256);
 
-  if (log_msg_chk_flag(self, LF_STATE_OWN_TAGS) && self->tags)
+  if (log_msg_chk_flag(self, LF_STATE_OWN_TAGS) && self->num_tags > 0)
     {
-      gboolean inline_tags = self->num_tags == 0;
-
-      if (inline_tags)
-        self->tags = NULL;
-      else
-        memset(self->tags, 0, self->num_tags * sizeof(self->tags[0]));
+      memset(self->tags, 0, self->num_tags * sizeof(self->tags[0]));
     }
   else
     {
-      self->tags = NULL;
+      memset(self->tags_inline, 0, sizeof(self->tags_inline));
       self->num_tags = 0;
     }
 
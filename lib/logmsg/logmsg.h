@@ -64,6 +64,10 @@ typedef void (*LMAckFunc)(LogMessage *lm, AckType ack_type);
 
 #define RE_MAX_MATCHES 256
 
+/* number of words in LogMessage used to store tags without a separate
+ * allocation, 128 tags on 64 bit platforms */
+#define LOGMSG_TAGS_INLINE_WORDS 2
+
 typedef enum
 {
   LM_TS_STAMP = 0,
@@ -190,7 +194,15 @@ struct _LogMessage
    */
   /* ==== start of directly copied part ==== */
   UnixTime timestamps[LM_TS_MAX];
-  gulong *tags;
+
+  /* tags are stored as a bitmap indexed by LogTagId.  If num_tags is 0,
+   * the bitmap is stored inline in tags_inline, otherwise it is a heap
+   * allocated array of num_tags words, pointed to by tags. */
+  union
+  {
+    gulong *tags;
+    gulong tags_inline[LOGMSG_TAGS_INLINE_WORDS];
+  };
   NVHandle *sdata;
 
   GSockAddr *saddr;
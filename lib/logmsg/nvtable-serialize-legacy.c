@@ -31,7 +31,6 @@
 
 #define NV_TABLE_OLD_SCALE 2
 #define NV_TABLE_MAGIC_V2  "NVT2"
-static const int NV_TABLE_HEADER_DIFF_V22_V26 = 4;
 static const int NV_TABLE_DYNVALUE_DIFF_V22_V26 = 4;
 static const int NV_TABLE_HANDLE_DIFF_V22_V26 = 2;
 static const int SIZE_DIFF_OF_OLD_NVENTRY_AND_NEW_NVENTRY = 12;
@@ -89,6 +88,9 @@ typedef struct _OldNVTable
   };
 } OldNVTable;
 
+/* the in-memory header has grown since, this is not a fixed value anymore */
+#define NV_TABLE_HEADER_DIFF_V22_V26 ((gint) (sizeof(NVTable) - sizeof(OldNVTable)))
+
 static inline void
 _swap_old_entry_flags(OldNVEntry *entry)
 {
@@ -318,6 +320,7 @@ nv_table_deserialize_22(SerializeArchive *sa)
 
   res->ref_cnt = 1;
   res->borrowed = FALSE;
+  res->parent = NULL;
 
   if (!_deserialize_struct_22(sa, res))
     {
@@ -454,6 +457,7 @@ nv_table_deserialize_legacy(SerializeArchive *sa)
 
   res->borrowed = FALSE;
   res->ref_cnt = 1;
+  res->parent = NULL;
 
   if (!_deserialize_blob_v22(sa, res, nv_table_get_top(res), swap_bytes))
     {
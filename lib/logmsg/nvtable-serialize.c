@@ -115,7 +115,9 @@ static gboolean
 _read_header(SerializeArchive *sa, NVTable **nvtable)
 {
   NVTable *res = NULL;
-  guint32 size;
+  guint32 size, used;
+  guint16 index_size;
+  guint8 num_static_entries;
 
   g_assert(*nvtable == NULL);
 
@@ -125,18 +127,25 @@ _read_header(SerializeArchive *sa, NVTable **nvtable)
   if (size > NV_TABLE_MAX_BYTES)
     goto error;
 
-  res = (NVTable *) g_malloc(size);
-  res->size = size;
-
-  if (!serialize_read_uint32(sa, &res->used))
+  if (!serialize_read_uint32(sa, &used))
     goto error;
 
-  if (!serialize_read_uint16(sa, &res->index_size))
+  if (!serialize_read_uint16(sa, &index_size))
     goto error;
 
-  if (!serialize_read_uint8(sa, &res->num_static_entries))
+  if (!serialize_read_uint8(sa, &num_static_entries))
     goto error;
 
+  /* the in-memory header may be larger than the one the table was
+   * serialized with, offsets are relative to the top so we can grow */
+  size = MAX(size, nv_table_get_alloc_size(num_static_entries, index_size, used));
+
+  res = (NVTable *) g_malloc(size);
+  res->size = size;
+  res->used = used;
+  res->index_size = index_size;
+  res->num_static_entries = num_static_entries;
+
   /* static entries has to be known by this syslog-ng, if they are over
    * LM_V_MAX, that means we have no clue how an entry is called, as static
    * entries don't contain names.  If there are less static entries, that
@@ -151,6 +160,7 @@ _read_header(SerializeArchive *sa, NVTable **nvtable)
 
   res->borrowed = FALSE;
   res->ref_cnt = 1;
+  res->parent = NULL;
   *nvtable = res;
   return TRUE;
 
@@ -242,6 +252,15 @@ nv_table_serialize(LogMessageSerializationState *state, NVTable *self)
   NVTableMetaData meta_data = { 0 };
   SerializeArchive *sa = state->sa;
 
+  if (nv_table_is_layered(self))
+    {
+      NVTable *flat = nv_table_flatten(self);
+      gboolean result = nv_table_serialize(state, flat);
+
+      nv_table_unref(flat);
+      return result;
+    }
+
   _fill_meta_data(self, &meta_data);
   _write_meta_data(sa, &meta_data);
 
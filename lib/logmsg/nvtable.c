@@ -291,6 +291,23 @@ nv_table_get_entry_slow(NVTable *self, NVHandle handle, NVIndexEntry **index_ent
   return NULL;
 }
 
+/* slow path for nv_table_get_entry() in layered tables, the handle was not
+ * found in the top layer */
+NVEntry *
+nv_table_get_entry_from_parents(NVTable *self, NVHandle handle)
+{
+  NVTable *layer;
+
+  for (layer = self->parent; layer; layer = layer->parent)
+    {
+      NVEntry *entry = __nv_table_get_entry(layer, handle, layer->num_static_entries, NULL, NULL);
+
+      if (entry)
+        return entry;
+    }
+  return NULL;
+}
+
 static inline gboolean
 _alloc_index_entry(NVTable *self, NVHandle handle, NVIndexEntry **index_entry, NVIndexEntry *index_slot)
 {
@@ -433,7 +450,13 @@ nv_table_add_value(NVTable *self, NVHandle handle, const gchar *name, gsize name
   if (!nv_table_break_references_to_entry(self, handle, entry))
     return FALSE;
 
-  if (entry && entry->alloc_len >= NV_ENTRY_DIRECT_SIZE(entry->name_len, value_len))
+  /* breaking references may have inserted new entries into the index of a layered table */
+  if (G_UNLIKELY(nv_table_is_layered(self)))
+    entry = nv_table_get_entry(self, handle, &index_entry, &index_slot);
+
+  /* entries inherited from a parent layer are never changed in place */
+  if (entry && nv_table_is_entry_local(self, entry) &&
+      entry->alloc_len >= NV_ENTRY_DIRECT_SIZE(entry->name_len, value_len))
     {
       _overwrite_with_a_direct_entry(self, handle, entry, name, name_len, value, value_len);
       return TRUE;
@@ -482,6 +505,18 @@ nv_table_unset_value(NVTable *self, NVHandle handle)
   if (!nv_table_break_references_to_entry(self, handle, entry))
     return FALSE;
 
+  if (!nv_table_is_entry_local(self, entry))
+    {
+      if (entry->unset)
+        return TRUE;
+
+      /* shadow the inherited entry with an empty one, which is then unset below */
+      if (!nv_table_add_value(self, handle, nv_entry_get_name(entry), entry->name_len, null_string, 0, NULL))
+        return FALSE;
+      entry = nv_table_get_entry(self, handle, &index_entry, NULL);
+      g_assert(nv_table_is_entry_local(self, entry));
+    }
+
   entry->unset = TRUE;
 
   /* make sure the actual value is also set to the null_string just in case
@@ -566,6 +601,13 @@ nv_table_add_value_indirect(NVTable *self, NVHandle handle, const gchar *name, g
       return nv_table_copy_referenced_value(self, ref_entry, handle, name, name_len, referenced_slice, new_entry);
     }
 
+  if (ref_entry && !nv_table_is_entry_local(self, ref_entry))
+    {
+      /* the value is inherited from a read-only parent layer, which we
+       * can't mark as referenced, copy the stuff */
+      return nv_table_copy_referenced_value(self, ref_entry, handle, name, name_len, referenced_slice, new_entry);
+    }
+
   entry = nv_table_get_entry(self, handle, &index_entry, &index_slot);
   if ((!entry && !new_entry && referenced_slice->len == 0) || !ref_entry)
     {
@@ -580,7 +622,10 @@ nv_table_add_value_indirect(NVTable *self, NVHandle handle, const gchar *name, g
   if (!nv_table_break_references_to_entry(self, handle, entry))
     return FALSE;
 
-  if (entry && (entry->alloc_len >= NV_ENTRY_INDIRECT_SIZE(name_len)))
+  if (G_UNLIKELY(nv_table_is_layered(self)))
+    entry = nv_table_get_entry(self, handle, &index_entry, &index_slot);
+
+  if (entry && nv_table_is_entry_local(self, entry) && (entry->alloc_len >= NV_ENTRY_INDIRECT_SIZE(name_len)))
     {
       /* this value already exists and the new reference fits in the old space */
       nv_table_set_indirect_entry(self, handle, entry, name, name_len, referenced_slice);
@@ -634,6 +679,69 @@ nv_table_foreach(NVTable *self, NVRegistry *registry, NVTableForeachFunc func, g
   return nv_table_foreach_entry(self, nv_table_call_foreach, data);
 }
 
+/* Iterates over the union of all layers in handle order, entries in upper
+ * layers shadowing the ones below them.  The callback may add new values to
+ * the top layer, which shifts its index, so the per-layer cursors are
+ * advanced by handle value and not by position.  */
+static gboolean
+_foreach_entry_layered(NVTable *self, NVTableForeachEntryFunc func, gpointer user_data)
+{
+  NVTable *layers[NV_TABLE_MAX_LAYERS + 1];
+  gint cursors[NV_TABLE_MAX_LAYERS + 1];
+  gint num_layers = 0;
+  NVTable *layer;
+  NVIndexEntry *index_entry;
+  NVEntry *entry;
+  NVHandle handle, last_handle = 0;
+  gint i;
+
+  for (layer = self; layer; layer = layer->parent)
+    {
+      g_assert(num_layers < G_N_ELEMENTS(layers));
+      layers[num_layers] = layer;
+      cursors[num_layers] = 0;
+      num_layers++;
+    }
+
+  for (i = 0; i < self->num_static_entries; i++)
+    {
+      entry = nv_table_get_entry(self, i + 1, NULL, NULL);
+      if (!entry)
+        continue;
+
+      if (func(i + 1, entry, NULL, user_data))
+        return TRUE;
+    }
+
+  while (TRUE)
+    {
+      handle = 0;
+      for (i = 0; i < num_layers; i++)
+        {
+          NVIndexEntry *index_table = nv_table_get_index(layers[i]);
+
+          while (cursors[i] < layers[i]->index_size && index_table[cursors[i]].handle <= last_handle)
+            cursors[i]++;
+
+          if (cursors[i] < layers[i]->index_size && (!handle || index_table[cursors[i]].handle < handle))
+            handle = index_table[cursors[i]].handle;
+        }
+
+      if (!handle)
+        break;
+      last_handle = handle;
+
+      entry = nv_table_get_entry(self, handle, &index_entry, NULL);
+      if (!entry)
+        continue;
+
+      if (func(handle, entry, nv_table_is_entry_local(self, entry) ? index_entry : NULL, user_data))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
 gboolean
 nv_table_foreach_entry(NVTable *self, NVTableForeachEntryFunc func, gpointer user_data)
 {
@@ -641,6 +749,9 @@ nv_table_foreach_entry(NVTable *self, NVTableForeachEntryFunc func, gpointer use
   NVEntry *entry;
   gint i;
 
+  if (G_UNLIKELY(nv_table_is_layered(self)))
+    return _foreach_entry_layered(self, func, user_data);
+
   for (i = 0; i < self->num_static_entries; i++)
     {
       entry = nv_table_get_entry_at_ofs(self, self->static_entries[i]);
@@ -676,6 +787,7 @@ nv_table_init(NVTable *self, gsize alloc_length, gint num_static_entries)
   self->num_static_entries = num_static_entries;
   self->ref_cnt = 1;
   self->borrowed = FALSE;
+  self->parent = NULL;
   memset(&self->static_entries[0], 0, self->num_static_entries * sizeof(self->static_entries[0]));
 }
 
@@ -806,11 +918,12 @@ _compact_foreach_entry(NVHandle handle, NVEntry *entry, NVIndexEntry *index_entr
   gpointer *args = (gpointer *) user_data;
   NVTable *old = (NVTable *) args[0];
   NVTable *new = (NVTable *) args[1];
+  gboolean keep_unset = GPOINTER_TO_INT(args[2]);
   const gchar *value, *name;
   gssize value_len, name_len;
 
-  /* unused entries are skipped */
-  if (entry->unset)
+  /* unused entries are skipped, unless they shadow a value of a parent layer */
+  if (entry->unset && !keep_unset)
     return FALSE;
 
   if (entry->name_len)
@@ -827,7 +940,13 @@ _compact_foreach_entry(NVHandle handle, NVEntry *entry, NVIndexEntry *index_entr
       name_len = 0;
     }
 
-  if (!entry->indirect)
+  if (entry->unset)
+    {
+      gboolean value_successfully_added = nv_table_add_value(new, handle, name, name_len, null_string, 0, NULL);
+      g_assert(value_successfully_added);
+      nv_table_unset_value(new, handle);
+    }
+  else if (!entry->indirect)
     {
       value = nv_table_resolve_direct(old, entry, &value_len);
 
@@ -843,15 +962,85 @@ _compact_foreach_entry(NVHandle handle, NVEntry *entry, NVIndexEntry *index_entr
   return FALSE;
 }
 
-NVTable *
-nv_table_compact(NVTable *self)
+static gsize
+_get_flattened_size(NVTable *self)
+{
+  gsize size = self->size;
+  NVTable *layer;
+
+  for (layer = self->parent; layer; layer = layer->parent)
+    size += layer->used + layer->index_size * sizeof(NVIndexEntry);
+
+  size = NV_TABLE_BOUND(size);
+  if (size > NV_TABLE_MAX_BYTES)
+    size = NV_TABLE_MAX_BYTES;
+  return size;
+}
+
+static NVTable *
+_copy_entries_to_a_flat_table(NVTable *self, gboolean keep_unset)
 {
-  gint new_size = self->size;
+  gint new_size = _get_flattened_size(self);
   NVTable *new = g_malloc(new_size);
-  gpointer args[2] = { self, new };
+  gpointer args[3] = { self, new, GINT_TO_POINTER(keep_unset) };
 
   nv_table_init(new, new_size, self->num_static_entries);
 
   nv_table_foreach_entry(self, _compact_foreach_entry, args);
   return new;
 }
+
+/* returns a flat (non-layered) copy of @self, with unset values dropped */
+NVTable *
+nv_table_compact(NVTable *self)
+{
+  return _copy_entries_to_a_flat_table(self, FALSE);
+}
+
+/* returns a flat copy of a layered @self, with the same set of values,
+ * including the unset ones */
+NVTable *
+nv_table_flatten(NVTable *self)
+{
+  return _copy_entries_to_a_flat_table(self, TRUE);
+}
+
+static gint
+_get_layer_depth(NVTable *self)
+{
+  gint depth = 0;
+
+  for (self = self->parent; self; self = self->parent)
+    depth++;
+  return depth;
+}
+
+/**
+ * nv_table_clone_layered:
+ * @self: payload to clone
+ * @additional_space: specifies how much additional space is needed in
+ *                    the newly allocated clone
+ *
+ * Returns a writable copy of @self, which is a new, empty layer on top of
+ * @self for larger tables.  Lookups fall through to @self, writes go to
+ * the new layer.  @self is not referenced by the clone, the caller has to
+ * keep it alive and unchanged for the lifetime of the clone, just like
+ * LogMessage does with its "original".  Small tables are copied, deep
+ * chains are flattened as both are cheap compared to the lookups they
+ * save.
+ **/
+NVTable *
+nv_table_clone_layered(NVTable *self, gint additional_space)
+{
+  NVTable *new;
+
+  if (self->used < NV_TABLE_LAYER_MIN_BYTES)
+    return nv_table_clone(self, additional_space);
+
+  if (_get_layer_depth(self) + 1 >= NV_TABLE_MAX_LAYERS)
+    return nv_table_flatten(self);
+
+  new = nv_table_new(self->num_static_entries, 4, NV_TABLE_BOUND(additional_space) + NV_TABLE_LAYER_MIN_BYTES);
+  new->parent = self;
+  return new;
+}
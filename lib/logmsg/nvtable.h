@@ -214,6 +214,23 @@ nv_entry_get_name(NVEntry *self)
  *   - It is possible to clone an NVTable, which basically copies the
  *     underlying memory contents.
  *
+ * Layering
+ * ========
+ *   - An NVTable may be layered on top of a read-only parent NVTable (see
+ *     nv_table_clone_layered()). Lookups that miss in the table itself
+ *     fall through to the parent (and its parents), while all changes are
+ *     stored in the top layer, shadowing the entries of the parents.
+ *     Unsetting a value inherited from a parent stores an unset entry.
+ *
+ *   - The parent is not referenced by the layer, its owner has to keep it
+ *     alive and unchanged while the layer exists (LogMessage does this by
+ *     referencing the original message of a copy-on-write clone).
+ *
+ *   - Indirect entries only ever reference entries within their own
+ *     layer, referencing a value inherited from a parent results in a copy.
+ *
+ *   - Layers are not serialized, serialization flattens them first.
+ *
  * Limits
  * ======
  * There might be various assumptions here and there in the code that fields
@@ -240,6 +257,10 @@ struct _NVTable
   guint8 ref_cnt:7,
          borrowed:1; /* specifies if the memory used by NVTable was borrowed from the container struct */
 
+  /* the read-only table this one is layered on, see "Layering" above,
+   * only exists in memory, it is never serialized */
+  NVTable *parent;
+
   /* variable data, see memory layout in the comment above */
   union
   {
@@ -260,6 +281,14 @@ struct _NVTable
  * static values */
 #define NV_TABLE_MIN_BYTES  128
 
+/* the number of layers after which nv_table_clone_layered() flattens the
+ * chain instead of adding yet another layer */
+#define NV_TABLE_MAX_LAYERS 4
+
+/* payloads using less than this are copied by nv_table_clone_layered(),
+ * also the initial free space of a new layer */
+#define NV_TABLE_LAYER_MIN_BYTES 512
+
 gboolean nv_table_add_value(NVTable *self, NVHandle handle, const gchar *name, gsize name_len, const gchar *value,
                             gsize value_len, gboolean *new_entry);
 gboolean nv_table_unset_value(NVTable *self, NVHandle handle);
@@ -273,7 +302,9 @@ NVTable *nv_table_new(gint num_static_values, gint index_size_hint, gint init_le
 NVTable *nv_table_init_borrowed(gpointer space, gsize space_len, gint num_static_entries);
 gboolean nv_table_realloc(NVTable *self, NVTable **new);
 NVTable *nv_table_compact(NVTable *self);
+NVTable *nv_table_flatten(NVTable *self);
 NVTable *nv_table_clone(NVTable *self, gint additional_space);
+NVTable *nv_table_clone_layered(NVTable *self, gint additional_space);
 NVTable *nv_table_ref(NVTable *self);
 void nv_table_unref(NVTable *self);
 
@@ -327,6 +358,7 @@ nv_table_alloc_check(NVTable *self, gsize alloc_size)
 
 /* private declarations for inline functions */
 NVEntry *nv_table_get_entry_slow(NVTable *self, NVHandle handle, NVIndexEntry **index_entry, NVIndexEntry **index_slot);
+NVEntry *nv_table_get_entry_from_parents(NVTable *self, NVHandle handle);
 const gchar *nv_table_resolve_indirect(NVTable *self, NVEntry *entry, gssize *len);
 
 
@@ -364,10 +396,30 @@ __nv_table_get_entry(NVTable *self, NVHandle handle, guint16 num_static_entries,
     }
 }
 
+/* looks up @handle in all layers, @index_entry and @index_slot always
+ * refer to the index of the top layer, even if the entry returned was
+ * inherited from a parent */
 static inline NVEntry *
 nv_table_get_entry(NVTable *self, NVHandle handle, NVIndexEntry **index_entry, NVIndexEntry **index_slot)
 {
-  return __nv_table_get_entry(self, handle, self->num_static_entries, index_entry, index_slot);
+  NVEntry *entry = __nv_table_get_entry(self, handle, self->num_static_entries, index_entry, index_slot);
+
+  if (G_UNLIKELY(!entry && self->parent))
+    return nv_table_get_entry_from_parents(self, handle);
+  return entry;
+}
+
+static inline gboolean
+nv_table_is_layered(NVTable *self)
+{
+  return self->parent != NULL;
+}
+
+/* whether @entry is stored in @self (as opposed to one of its parents) */
+static inline gboolean
+nv_table_is_entry_local(NVTable *self, NVEntry *entry)
+{
+  return (gchar *) entry >= (gchar *) self && (gchar *) entry < nv_table_get_top(self);
 }
 
 static inline gboolean
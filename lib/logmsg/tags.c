@@ -28,6 +28,30 @@
 #include "stats/stats-registry.h"
 #include "apphook.h"
 
+#include <string.h>
+
+/*
+ * The tag registry is read-mostly: tags are registered while the
+ * configuration is parsed or when a parser sees a new tag name for the
+ * first time, while lookups happen for every message.  Therefore lookups
+ * are lock-free and only the registration of a new tag takes
+ * log_tags_lock.
+ *
+ * Tags are never removed (until log_tags_global_deinit()), which makes this
+ * simple:
+ *   - LogTag entries are stored in fixed-size chunks, which are never
+ *     moved once allocated, so a LogTag pointer stays valid while new tags
+ *     are registered
+ *   - the name -> id index is an open addressing hash table, big enough to
+ *     hold LOG_TAGS_MAX entries without resizing
+ *   - a new tag is published by atomically storing its id in the index
+ *     (and in log_tags_num), after the LogTag entry was fully initialized
+ */
+
+#define LOG_TAGS_CHUNK_SIZE   256
+#define LOG_TAGS_MAX_CHUNKS   (LOG_TAGS_MAX / LOG_TAGS_CHUNK_SIZE)
+#define LOG_TAGS_INDEX_SIZE   (LOG_TAGS_MAX * 2)
+
 typedef struct _LogTag
 {
   LogTagId id;
@@ -35,12 +59,93 @@ typedef struct _LogTag
   StatsCounterItem *counter;
 } LogTag;
 
-static LogTag *log_tags_list = NULL;
-static GHashTable *log_tags_hash = NULL;
-static guint32 log_tags_num = 0;
-static guint32 log_tags_list_size = 4;
+static LogTag *log_tags_chunks[LOG_TAGS_MAX_CHUNKS];
+
+/* stores tag id + 1, 0 means unused slot */
+static gint log_tags_index[LOG_TAGS_INDEX_SIZE];
+static gint log_tags_num = 0;
+static gboolean log_tags_initialized = FALSE;
 static GStaticMutex log_tags_lock = G_STATIC_MUTEX_INIT;
 
+static inline LogTag *
+_get_tag(guint id)
+{
+  return &log_tags_chunks[id / LOG_TAGS_CHUNK_SIZE][id % LOG_TAGS_CHUNK_SIZE];
+}
+
+static inline gboolean
+_is_valid_id(guint id)
+{
+  return id < (guint) g_atomic_int_get(&log_tags_num);
+}
+
+/* returns the id of the tag or -1 if not found, in which case @slot is set
+ * to the index slot where the tag could be inserted */
+static gint
+_lookup_tag(const gchar *name, guint hash, guint *slot)
+{
+  guint i = hash & (LOG_TAGS_INDEX_SIZE - 1);
+
+  while (TRUE)
+    {
+      gint entry = g_atomic_int_get(&log_tags_index[i]);
+
+      if (entry == 0)
+        {
+          *slot = i;
+          return -1;
+        }
+      if (strcmp(_get_tag(entry - 1)->name, name) == 0)
+        return entry - 1;
+
+      i = (i + 1) & (LOG_TAGS_INDEX_SIZE - 1);
+    }
+}
+
+static void
+_register_tag_counter(LogTag *tag)
+{
+  StatsClusterKey sc_key;
+
+  stats_cluster_logpipe_key_set(&sc_key, SCS_TAG, tag->name, NULL );
+  stats_register_sharded_counter(3, &sc_key, SC_TYPE_PROCESSED, &tag->counter);
+}
+
+/* NOTE: must be called with log_tags_lock held */
+static guint
+_register_tag(const gchar *name, guint slot)
+{
+  guint id = log_tags_num;
+  LogTag *chunk;
+
+  if (id >= LOG_TAGS_MAX - 1)
+    return 0;
+
+  chunk = log_tags_chunks[id / LOG_TAGS_CHUNK_SIZE];
+  if (!chunk)
+    {
+      chunk = g_new0(LogTag, LOG_TAGS_CHUNK_SIZE);
+      log_tags_chunks[id / LOG_TAGS_CHUNK_SIZE] = chunk;
+    }
+
+  LogTag *tag = &chunk[id % LOG_TAGS_CHUNK_SIZE];
+  tag->id = id;
+  tag->name = g_strdup(name);
+  tag->counter = NULL;
+
+  /* NOTE: stats-level may not be set for calls that happen during
+   * config file parsing, those get fixed up by
+   * log_tags_reinit_stats() below */
+
+  stats_lock();
+  _register_tag_counter(tag);
+  stats_unlock();
+
+  /* publish the new entry, readers don't take the lock */
+  g_atomic_int_set(&log_tags_num, id + 1);
+  g_atomic_int_set(&log_tags_index[slot], id + 1);
+  return id;
+}
 
 /*
  * log_tags_get_by_name
@@ -56,49 +161,30 @@ static GStaticMutex log_tags_lock = G_STATIC_MUTEX_INIT;
 LogTagId
 log_tags_get_by_name(const gchar *name)
 {
-  /* If log_tags_hash() is NULL, this unit is already deinitialized
+  /* If the registry is not initialized, this unit is already deinitialized
      but other thread may refer the tag structure.
 
      If name is empty, it is an extremal element.
 
      In both cases the return value is 0.
    */
-  guint id;
+  guint hash = g_str_hash(name);
+  guint slot;
+  gint id;
 
-  g_assert(log_tags_hash != NULL);
+  g_assert(log_tags_initialized);
+
+  id = _lookup_tag(name, hash, &slot);
+  if (id >= 0)
+    return id;
 
   g_static_mutex_lock(&log_tags_lock);
 
-  id = GPOINTER_TO_UINT(g_hash_table_lookup(log_tags_hash, name)) - 1;
-  if (id == 0xffffffff)
-    {
-      if (log_tags_num < LOG_TAGS_MAX - 1)
-        {
-          id = log_tags_num++;
-          if (id == log_tags_list_size)
-            {
-              log_tags_list_size *= 2;
-              log_tags_list = g_renew(LogTag, log_tags_list, log_tags_list_size);
-            }
-          log_tags_list[id].id = id;
-          log_tags_list[id].name = g_strdup(name);
-          log_tags_list[id].counter = NULL;
-
-          /* NOTE: stats-level may not be set for calls that happen during
-           * config file parsing, those get fixed up by
-           * log_tags_reinit_stats() below */
-
-          stats_lock();
-          StatsClusterKey sc_key;
-          stats_cluster_logpipe_key_set(&sc_key, SCS_TAG, name, NULL );
-          stats_register_counter(3, &sc_key, SC_TYPE_PROCESSED, &log_tags_list[id].counter);
-          stats_unlock();
-
-          g_hash_table_insert(log_tags_hash, log_tags_list[id].name, GUINT_TO_POINTER(log_tags_list[id].id + 1));
-        }
-      else
-        id = 0;
-    }
+  /* somebody else might have registered the same tag while we were
+   * waiting for the lock */
+  id = _lookup_tag(name, hash, &slot);
+  if (id < 0)
+    id = _register_tag(name, slot);
 
   g_static_mutex_unlock(&log_tags_lock);
 
@@ -120,39 +206,24 @@ log_tags_get_by_name(const gchar *name)
 const gchar *
 log_tags_get_by_id(LogTagId id)
 {
-  gchar *name = NULL;
-
-  g_static_mutex_lock(&log_tags_lock);
-
-  if (id < log_tags_num)
-    name = log_tags_list[id].name;
-
-  g_static_mutex_unlock(&log_tags_lock);
+  if (!_is_valid_id(id))
+    return NULL;
 
-  return name;
+  return _get_tag(id)->name;
 }
 
 void
 log_tags_inc_counter(LogTagId id)
 {
-  g_static_mutex_lock(&log_tags_lock);
-
-  if (id < log_tags_num)
-    stats_counter_inc(log_tags_list[id].counter);
-
-  g_static_mutex_unlock(&log_tags_lock);
+  if (_is_valid_id(id))
+    stats_counter_inc(_get_tag(id)->counter);
 }
 
 void
 log_tags_dec_counter(LogTagId id)
 {
-  /* Reader lock because the log_tag_list is not written */
-  g_static_mutex_lock(&log_tags_lock);
-
-  if (id < log_tags_num)
-    stats_counter_dec(log_tags_list[id].counter);
-
-  g_static_mutex_unlock(&log_tags_lock);
+  if (_is_valid_id(id))
+    stats_counter_dec(_get_tag(id)->counter);
 }
 
 /*
@@ -170,21 +241,23 @@ log_tags_reinit_stats(void)
 {
   gint id;
 
+  g_static_mutex_lock(&log_tags_lock);
   stats_lock();
 
   for (id = 0; id < log_tags_num; id++)
     {
-      const gchar *name = log_tags_list[id].name;
+      LogTag *tag = _get_tag(id);
       StatsClusterKey sc_key;
-      stats_cluster_logpipe_key_set(&sc_key, SCS_TAG, name, NULL );
+      stats_cluster_logpipe_key_set(&sc_key, SCS_TAG, tag->name, NULL );
 
       if (stats_check_level(3))
-        stats_register_counter(3, &sc_key, SC_TYPE_PROCESSED, &log_tags_list[id].counter);
+        _register_tag_counter(tag);
       else
-        stats_unregister_counter(&sc_key, SC_TYPE_PROCESSED, &log_tags_list[id].counter);
+        stats_unregister_counter(&sc_key, SC_TYPE_PROCESSED, &tag->counter);
     }
 
   stats_unlock();
+  g_static_mutex_unlock(&log_tags_lock);
 }
 
 void
@@ -193,12 +266,9 @@ log_tags_global_init(void)
   /* Necessary only in case of reinitialized tags */
   g_static_mutex_lock(&log_tags_lock);
 
-  log_tags_hash = g_hash_table_new(g_str_hash, g_str_equal);
-
-  log_tags_list_size = 4;
+  memset(log_tags_index, 0, sizeof(log_tags_index));
   log_tags_num = 0;
-
-  log_tags_list = g_new0(LogTag, log_tags_list_size);
+  log_tags_initialized = TRUE;
 
   g_static_mutex_unlock(&log_tags_lock);
   register_application_hook(AH_CONFIG_CHANGED, (ApplicationHookFunc) log_tags_reinit_stats, NULL, AHM_RUN_REPEAT);
@@ -211,22 +281,27 @@ log_tags_global_deinit(void)
 
   g_static_mutex_lock(&log_tags_lock);
 
-  g_hash_table_destroy(log_tags_hash);
-
   stats_lock();
   StatsClusterKey sc_key;
   for (i = 0; i < log_tags_num; i++)
     {
-      stats_cluster_logpipe_key_set(&sc_key, SCS_TAG, log_tags_list[i].name, NULL );
-      stats_unregister_counter(&sc_key, SC_TYPE_PROCESSED, &log_tags_list[i].counter);
-      g_free(log_tags_list[i].name);
+      LogTag *tag = _get_tag(i);
+
+      stats_cluster_logpipe_key_set(&sc_key, SCS_TAG, tag->name, NULL );
+      stats_unregister_counter(&sc_key, SC_TYPE_PROCESSED, &tag->counter);
+      g_free(tag->name);
     }
   stats_unlock();
 
+  for (i = 0; i < LOG_TAGS_MAX_CHUNKS; i++)
+    {
+      g_free(log_tags_chunks[i]);
+      log_tags_chunks[i] = NULL;
+    }
+
   log_tags_num = 0;
-  g_free(log_tags_list);
-  log_tags_list = NULL;
-  log_tags_hash = NULL;
+  memset(log_tags_index, 0, sizeof(log_tags_index));
+  log_tags_initialized = FALSE;
 
   g_static_mutex_unlock(&log_tags_lock);
 }
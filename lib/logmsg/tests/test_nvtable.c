@@ -1132,3 +1132,243 @@ Test(nvtable, test_nvtable_compact_skips_unset_values)
 
   nv_table_unref(tab2);
 }
+
+/* layered NVTables */
+
+#define PADDING_HANDLE (DYN_HANDLE + 16)
+#define PADDING_NAME "padding"
+
+static NVTable *
+_create_parent_large_enough_to_be_layered(void)
+{
+  NVTable *parent;
+  gchar padding[NV_TABLE_LAYER_MIN_BYTES];
+
+  memset(padding, 'x', sizeof(padding));
+  parent = nv_table_new(STATIC_VALUES, STATIC_VALUES, 4096);
+  nv_table_add_value(parent, STATIC_HANDLE, STATIC_NAME, strlen(STATIC_NAME), "static-foo", 10, NULL);
+  nv_table_add_value(parent, DYN_HANDLE, DYN_NAME, strlen(DYN_NAME), "dyn-foo", 7, NULL);
+  nv_table_add_value(parent, PADDING_HANDLE, PADDING_NAME, strlen(PADDING_NAME), padding, sizeof(padding), NULL);
+  return parent;
+}
+
+static gboolean
+_append_handle_to_array(NVHandle handle, NVEntry *entry, NVIndexEntry *index_entry, gpointer user_data)
+{
+  GArray *handles = (GArray *) user_data;
+
+  if (!entry->unset)
+    g_array_append_val(handles, handle);
+  return FALSE;
+}
+
+Test(nvtable, test_nvtable_clone_layered_falls_back_to_copy_for_small_tables)
+{
+  NVTable *tab, *tab_clone;
+
+  tab = nv_table_new(STATIC_VALUES, STATIC_VALUES, 1024);
+  nv_table_add_value(tab, STATIC_HANDLE, STATIC_NAME, strlen(STATIC_NAME), "value", 5, NULL);
+
+  tab_clone = nv_table_clone_layered(tab, 64);
+  cr_assert_not(nv_table_is_layered(tab_clone));
+  assert_nvtable(tab_clone, STATIC_HANDLE, "value", 5);
+
+  nv_table_unref(tab_clone);
+  nv_table_unref(tab);
+}
+
+Test(nvtable, test_nvtable_layered_lookups_fall_through_to_the_parent)
+{
+  NVTable *parent, *tab;
+
+  parent = _create_parent_large_enough_to_be_layered();
+  tab = nv_table_clone_layered(parent, 64);
+
+  cr_assert(nv_table_is_layered(tab));
+  cr_assert_lt(tab->size, parent->size);
+  assert_nvtable(tab, STATIC_HANDLE, "static-foo", 10);
+  assert_nvtable(tab, DYN_HANDLE, "dyn-foo", 7);
+  cr_assert(nv_table_is_value_set(tab, DYN_HANDLE));
+  cr_assert_not(nv_table_is_value_set(tab, DYN_HANDLE + 1));
+
+  nv_table_unref(tab);
+  nv_table_unref(parent);
+}
+
+Test(nvtable, test_nvtable_layered_changes_shadow_the_parent_which_is_left_intact)
+{
+  NVTable *parent, *tab;
+  gboolean new_entry;
+
+  parent = _create_parent_large_enough_to_be_layered();
+  tab = nv_table_clone_layered(parent, 64);
+
+  cr_assert(nv_table_add_value(tab, STATIC_HANDLE, STATIC_NAME, strlen(STATIC_NAME), "bar", 3, &new_entry));
+  cr_assert_not(new_entry, "overriding an inherited value should not create a new entry");
+  cr_assert(nv_table_add_value(tab, DYN_HANDLE, DYN_NAME, strlen(DYN_NAME), "dyn-bar", 7, NULL));
+  cr_assert(nv_table_add_value(tab, DYN_HANDLE + 1, "VAL18", 5, "new", 3, &new_entry));
+  cr_assert(new_entry);
+
+  assert_nvtable(tab, STATIC_HANDLE, "bar", 3);
+  assert_nvtable(tab, DYN_HANDLE, "dyn-bar", 7);
+  assert_nvtable(tab, DYN_HANDLE + 1, "new", 3);
+
+  assert_nvtable(parent, STATIC_HANDLE, "static-foo", 10);
+  assert_nvtable(parent, DYN_HANDLE, "dyn-foo", 7);
+  cr_assert_not(nv_table_is_value_set(parent, DYN_HANDLE + 1));
+
+  nv_table_unref(tab);
+  nv_table_unref(parent);
+}
+
+Test(nvtable, test_nvtable_layered_unset_shadows_the_inherited_value)
+{
+  NVTable *parent, *tab;
+
+  parent = _create_parent_large_enough_to_be_layered();
+  tab = nv_table_clone_layered(parent, 64);
+
+  cr_assert(nv_table_unset_value(tab, DYN_HANDLE));
+  cr_assert(nv_table_unset_value(tab, STATIC_HANDLE));
+
+  cr_assert_null(nv_table_get_value_if_set(tab, DYN_HANDLE, NULL));
+  cr_assert_null(nv_table_get_value_if_set(tab, STATIC_HANDLE, NULL));
+  assert_nvtable(parent, STATIC_HANDLE, "static-foo", 10);
+  assert_nvtable(parent, DYN_HANDLE, "dyn-foo", 7);
+
+  nv_table_unref(tab);
+  nv_table_unref(parent);
+}
+
+Test(nvtable, test_nvtable_layered_inherited_indirect_values_survive_changing_the_referenced_value)
+{
+  NVTable *parent, *tab;
+  gssize size;
+  const gchar *value;
+
+  parent = _create_parent_large_enough_to_be_layered();
+  nv_table_add_value_indirect(parent, DYN_HANDLE + 1, "VAL18", 5,
+                              &(NVReferencedSlice)
+  {
+    STATIC_HANDLE, 1, 5, 0
+  },
+  NULL);
+  tab = nv_table_clone_layered(parent, 64);
+
+  cr_assert(nv_table_add_value(tab, STATIC_HANDLE, STATIC_NAME, strlen(STATIC_NAME), "overridden", 10, NULL));
+
+  value = nv_table_get_value(tab, DYN_HANDLE + 1, &size);
+  cr_assert_eq(size, 5);
+  cr_assert(strncmp(value, "tatic", 5) == 0);
+  assert_nvtable(tab, STATIC_HANDLE, "overridden", 10);
+
+  value = nv_table_get_value(parent, DYN_HANDLE + 1, &size);
+  cr_assert_eq(size, 5);
+  cr_assert(strncmp(value, "tatic", 5) == 0);
+
+  nv_table_unref(tab);
+  nv_table_unref(parent);
+}
+
+Test(nvtable, test_nvtable_layered_indirect_references_to_inherited_values_are_copied)
+{
+  NVTable *parent, *tab;
+  gssize size;
+  const gchar *value;
+
+  parent = _create_parent_large_enough_to_be_layered();
+  tab = nv_table_clone_layered(parent, 64);
+
+  cr_assert(nv_table_add_value_indirect(tab, DYN_HANDLE + 1, "VAL18", 5,
+                                        &(NVReferencedSlice)
+  {
+    DYN_HANDLE, 4, 3, 0
+  },
+  NULL));
+
+  value = nv_table_get_value(tab, DYN_HANDLE + 1, &size);
+  cr_assert_eq(size, 3);
+  cr_assert(strncmp(value, "foo", 3) == 0);
+  cr_assert_not(nv_table_get_entry(parent, DYN_HANDLE, NULL, NULL)->referenced);
+
+  nv_table_unref(tab);
+  nv_table_unref(parent);
+}
+
+Test(nvtable, test_nvtable_layered_foreach_merges_layers_in_handle_order)
+{
+  NVTable *parent, *tab;
+  GArray *handles = g_array_new(FALSE, FALSE, sizeof(NVHandle));
+
+  parent = _create_parent_large_enough_to_be_layered();
+  tab = nv_table_clone_layered(parent, 64);
+  nv_table_add_value(tab, DYN_HANDLE + 2, "VAL19", 5, "top", 3, NULL);
+  nv_table_add_value(tab, DYN_HANDLE, DYN_NAME, strlen(DYN_NAME), "dyn-bar", 7, NULL);
+  nv_table_unset_value(tab, PADDING_HANDLE);
+
+  nv_table_foreach_entry(tab, _append_handle_to_array, handles);
+
+  cr_assert_eq(handles->len, 3);
+  cr_assert_eq(g_array_index(handles, NVHandle, 0), STATIC_HANDLE);
+  cr_assert_eq(g_array_index(handles, NVHandle, 1), DYN_HANDLE);
+  cr_assert_eq(g_array_index(handles, NVHandle, 2), DYN_HANDLE + 2);
+
+  g_array_free(handles, TRUE);
+  nv_table_unref(tab);
+  nv_table_unref(parent);
+}
+
+Test(nvtable, test_nvtable_flatten_and_compact_copy_all_layers)
+{
+  NVTable *parent, *tab, *flat, *compacted;
+
+  parent = _create_parent_large_enough_to_be_layered();
+  tab = nv_table_clone_layered(parent, 64);
+  nv_table_add_value(tab, DYN_HANDLE, DYN_NAME, strlen(DYN_NAME), "dyn-bar", 7, NULL);
+  nv_table_unset_value(tab, STATIC_HANDLE);
+
+  flat = nv_table_flatten(tab);
+  compacted = nv_table_compact(tab);
+  nv_table_unref(tab);
+  nv_table_unref(parent);
+
+  cr_assert_not(nv_table_is_layered(flat));
+  assert_nvtable(flat, DYN_HANDLE, "dyn-bar", 7);
+  cr_assert_eq(nv_table_get_value(flat, PADDING_HANDLE, NULL)[0], 'x');
+  cr_assert(nv_table_is_value_set(flat, STATIC_HANDLE));
+  cr_assert_null(nv_table_get_value_if_set(flat, STATIC_HANDLE, NULL));
+
+  cr_assert_not(nv_table_is_layered(compacted));
+  assert_nvtable(compacted, DYN_HANDLE, "dyn-bar", 7);
+  cr_assert_not(nv_table_is_value_set(compacted, STATIC_HANDLE));
+
+  nv_table_unref(flat);
+  nv_table_unref(compacted);
+}
+
+Test(nvtable, test_nvtable_clone_layered_limits_the_number_of_layers)
+{
+  NVTable *layers[NV_TABLE_MAX_LAYERS + 1];
+  gint i, depth;
+
+  layers[0] = _create_parent_large_enough_to_be_layered();
+  for (i = 1; i <= NV_TABLE_MAX_LAYERS; i++)
+    {
+      NVTable *layer;
+
+      layers[i] = nv_table_clone_layered(layers[i - 1], 64);
+
+      /* make sure the layer is large enough to be layered again */
+      cr_assert(nv_table_add_value(layers[i], PADDING_HANDLE, PADDING_NAME, strlen(PADDING_NAME),
+                                   nv_table_get_value(layers[0], PADDING_HANDLE, NULL), NV_TABLE_LAYER_MIN_BYTES, NULL));
+
+      depth = 1;
+      for (layer = layers[i]; layer->parent; layer = layer->parent)
+        depth++;
+      cr_assert_leq(depth, NV_TABLE_MAX_LAYERS);
+      assert_nvtable(layers[i], DYN_HANDLE, "dyn-foo", 7);
+    }
+
+  for (i = NV_TABLE_MAX_LAYERS; i >= 0; i--)
+    nv_table_unref(layers[i]);
+}
@@ -131,7 +131,7 @@ Test(tags, test_msg_tags)
 
           cr_assert_not(set ^ log_msg_is_tag_by_id(msg, i), "Tag is %sset now (by id) %d\n", set ? "not " : "", i);
 
-          cr_assert_not(set && i < sizeof(gulong) * 8
+          cr_assert_not(set && i < LOGMSG_TAGS_INLINE_WORDS * sizeof(gulong) * 8
                         && msg->num_tags != 0, "Small IDs are set which should be stored in-line but num_tags is non-zero");
 
           g_free(name);
@@ -141,6 +141,76 @@ Test(tags, test_msg_tags)
 
 }
 
+Test(tags, test_inline_tags_are_cloned_and_cleared)
+{
+  const guint inline_bits = LOGMSG_TAGS_INLINE_WORDS * sizeof(gulong) * 8;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msg = log_msg_new_empty();
+
+  for (guint i = 0; i < inline_bits; i++)
+    {
+      gchar *name = get_tag_by_id(i);
+      log_tags_get_by_name(name);
+      g_free(name);
+    }
+
+  log_msg_set_tag_by_id(msg, 1);
+  log_msg_set_tag_by_id(msg, inline_bits - 1);
+  cr_assert_eq(msg->num_tags, 0, "Tags within the inline range should not be allocated on the heap");
+
+  LogMessage *clone = log_msg_clone_cow(msg, &path_options);
+  cr_assert(log_msg_is_tag_by_id(clone, 1));
+  cr_assert(log_msg_is_tag_by_id(clone, inline_bits - 1));
+
+  log_msg_clear_tag_by_id(clone, inline_bits - 1);
+  cr_assert_not(log_msg_is_tag_by_id(clone, inline_bits - 1));
+  cr_assert(log_msg_is_tag_by_id(msg, inline_bits - 1), "Clearing a tag in a clone should not affect the original");
+
+  log_msg_clear(msg);
+  cr_assert_not(log_msg_is_tag_by_id(msg, 1));
+  cr_assert_not(log_msg_is_tag_by_id(msg, inline_bits - 1));
+
+  log_msg_unref(clone);
+  log_msg_unref(msg);
+}
+
+static gpointer
+_register_tags_thread(gpointer user_data)
+{
+  LogTagId *ids = (LogTagId *) user_data;
+
+  for (gint i = 0; i < FILTER_TAGS; i++)
+    {
+      gchar *name = g_strdup_printf("concurrent-tag%d", i);
+      ids[i] = log_tags_get_by_name(name);
+      g_free(name);
+    }
+  return NULL;
+}
+
+Test(tags, test_concurrent_registration_yields_the_same_ids)
+{
+  enum { NUM_THREADS = 8 };
+  LogTagId ids[NUM_THREADS][FILTER_TAGS];
+  GThread *threads[NUM_THREADS];
+
+  for (gint t = 0; t < NUM_THREADS; t++)
+    threads[t] = g_thread_new(NULL, _register_tags_thread, ids[t]);
+
+  for (gint t = 0; t < NUM_THREADS; t++)
+    g_thread_join(threads[t]);
+
+  for (gint i = 0; i < FILTER_TAGS; i++)
+    {
+      gchar *name = g_strdup_printf("concurrent-tag%d", i);
+
+      for (gint t = 0; t < NUM_THREADS; t++)
+        cr_assert_eq(ids[t][i], ids[0][i], "Tag %s got different ids in different threads", name);
+      cr_assert_str_eq(log_tags_get_by_id(ids[0][i]), name);
+      g_free(name);
+    }
+}
+
 Test(tags, test_filters_true)
 {
   LogMessage *msg = log_msg_new_empty();
@@ -25,8 +25,56 @@
 #include "logpipe.h"
 #include "cfg-tree.h"
 #include "cfg-walker.h"
+#include "pipe-profiler.h"
+#include "tls-support.h"
+
+#include <time.h>
 
 gboolean (*pipe_single_step_hook)(LogPipe *pipe, LogMessage *msg, const LogPathOptions *path_options);
+gboolean pipe_profiling_enabled;
+
+TLS_BLOCK_START
+{
+  /* time spent in the pipes called by the pipe being profiled */
+  gint64 pipe_profile_child_nsec;
+}
+TLS_BLOCK_END;
+
+#define pipe_profile_child_nsec __tls_deref(pipe_profile_child_nsec)
+
+static inline gint64
+_get_monotonic_nsec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* As pipes call the next one in the pipeline from their queue method, the
+ * elapsed time includes the processing of everything that follows.  The
+ * time spent in nested log_pipe_queue() calls is collected in a per-thread
+ * variable, so that it can be subtracted to get the time spent in the pipe
+ * itself. */
+void
+log_pipe_dispatch_profiled(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  gint64 saved_child_nsec = pipe_profile_child_nsec;
+  gint64 start, elapsed;
+
+  pipe_profile_child_nsec = 0;
+  start = _get_monotonic_nsec();
+
+  log_pipe_dispatch(s, msg, path_options);
+
+  elapsed = _get_monotonic_nsec() - start;
+  if (G_UNLIKELY(!g_atomic_int_get(&s->profile.registered)))
+    pipe_profiler_register(s);
+  atomic_gssize_inc(&s->profile.calls);
+  atomic_gssize_add(&s->profile.total_nsec, elapsed);
+  atomic_gssize_add(&s->profile.self_nsec, MAX(elapsed - pipe_profile_child_nsec, 0));
+  pipe_profile_child_nsec = saved_child_nsec + elapsed;
+}
 
 EVTTAG *
 log_pipe_location_tag(LogPipe *pipe)
@@ -107,6 +155,8 @@ log_pipe_ref(LogPipe *self)
 static void
 _free(LogPipe *self)
 {
+  if (g_atomic_int_get(&self->profile.registered))
+    pipe_profiler_unregister(self);
   if (self->free_fn)
     self->free_fn(self);
   g_free((gpointer)self->persist_name);
@@ -29,6 +29,7 @@
 #include "logmsg/logmsg.h"
 #include "cfg.h"
 #include "atomic.h"
+#include "atomic-gssize.h"
 #include "messages.h"
 #include "signal-slot-connector/signal-slot-connector.h"
 
@@ -227,6 +228,12 @@ struct _LogPipe
   gchar *plugin_name;
   SignalSlotConnector *signal_slot_connector;
 
+  /* optional, expensive init-time work (loading databases, compiling
+   * rulesets) that does not depend on any other pipe. cfg_tree_start()
+   * runs these in parallel, before the sequential init() phase, so they
+   * must not touch the main loop or any shared state without locking.
+   */
+  gboolean (*preload)(LogPipe *self);
   gboolean (*pre_init)(LogPipe *self);
   gboolean (*init)(LogPipe *self);
   gboolean (*deinit)(LogPipe *self);
@@ -250,6 +257,16 @@ struct _LogPipe
   void (*free_fn)(LogPipe *self);
   void (*notify)(LogPipe *self, gint notify_code, gpointer user_data);
   GList *info;
+
+  /* updated by log_pipe_queue() while pipe profiling is enabled, see
+   * pipe-profiler.h */
+  struct
+  {
+    atomic_gssize calls;
+    atomic_gssize total_nsec;
+    atomic_gssize self_nsec;
+    gint registered;
+  } profile;
 };
 
 /*
@@ -263,6 +280,7 @@ struct _LogPipe
 G_STATIC_ASSERT(G_STRUCT_OFFSET(LogPipe, queue) - G_STRUCT_OFFSET(LogPipe, flags) <= 4);
 
 extern gboolean (*pipe_single_step_hook)(LogPipe *pipe, LogMessage *msg, const LogPathOptions *path_options);
+extern gboolean pipe_profiling_enabled;
 
 LogPipe *log_pipe_ref(LogPipe *self);
 gboolean log_pipe_unref(LogPipe *self);
@@ -292,6 +310,14 @@ log_pipe_reset_config(LogPipe *s)
   log_pipe_set_config(s, NULL);
 }
 
+static inline gboolean
+log_pipe_preload(LogPipe *s)
+{
+  if (s->preload && !(s->flags & PIF_INITIALIZED))
+    return s->preload(s);
+  return TRUE;
+}
+
 static inline gboolean
 log_pipe_init(LogPipe *s)
 {
@@ -351,6 +377,21 @@ log_pipe_forward_msg(LogPipe *self, LogMessage *msg, const LogPathOptions *path_
     }
 }
 
+static inline void
+log_pipe_dispatch(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  if (s->queue)
+    {
+      s->queue(s, msg, path_options);
+    }
+  else
+    {
+      log_pipe_forward_msg(s, msg, path_options);
+    }
+}
+
+void log_pipe_dispatch_profiled(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options);
+
 static inline void
 log_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
 {
@@ -376,14 +417,10 @@ log_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
       msg_trace("Requesting flow control", log_pipe_location_tag(s));
     }
 
-  if (s->queue)
-    {
-      s->queue(s, msg, path_options);
-    }
+  if (G_UNLIKELY(pipe_profiling_enabled))
+    log_pipe_dispatch_profiled(s, msg, path_options);
   else
-    {
-      log_pipe_forward_msg(s, msg, path_options);
-    }
+    log_pipe_dispatch(s, msg, path_options);
 
   if (path_options->matched && !(*path_options->matched) && (s->flags & PIF_DROP_UNMATCHED))
     {
@@ -72,6 +72,8 @@ struct _LogProtoClient
   LogProtoStatus (*post)(LogProtoClient *s, LogMessage *logmsg, guchar *msg, gsize msg_len, gboolean *consumed);
   LogProtoStatus (*process_in)(LogProtoClient *s);
   LogProtoStatus (*flush)(LogProtoClient *s);
+  /* msec until flush() has work to do even without new messages, -1 if never */
+  gint (*get_idle_flush_timeout)(LogProtoClient *s);
   gboolean (*validate_options)(LogProtoClient *s);
   gboolean (*handshake_in_progess)(LogProtoClient *s);
   LogProtoStatus (*handshake)(LogProtoClient *s);
@@ -148,6 +150,14 @@ log_proto_client_flush(LogProtoClient *s)
     return LPS_SUCCESS;
 }
 
+static inline gint
+log_proto_client_get_idle_flush_timeout(LogProtoClient *s)
+{
+  if (s->get_idle_flush_timeout)
+    return s->get_idle_flush_timeout(s);
+  return -1;
+}
+
 static inline LogProtoStatus
 log_proto_client_process_in(LogProtoClient *s)
 {
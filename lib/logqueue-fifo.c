@@ -546,6 +546,7 @@ log_queue_fifo_ack_backlog(LogQueue *s, gint rewind_count)
         self->backlog_queue.non_flow_controlled_len--;
 
       path_options.ack_needed = node->ack_needed;
+      log_queue_record_ack_latency(s, msg);
       log_msg_ack(msg, &path_options, AT_PROCESSED);
       log_msg_free_queue_node(node);
       log_msg_unref(msg);
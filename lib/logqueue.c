@@ -214,9 +214,10 @@ log_queue_check_items(LogQueue *self, gint *timeout, LogQueuePushNotifyFunc para
 static void
 _register_common_counters(LogQueue *self, gint stats_level, const StatsClusterKey *sc_key)
 {
-  stats_register_counter(stats_level, sc_key, SC_TYPE_QUEUED, &self->queued_messages);
-  stats_register_counter(stats_level, sc_key, SC_TYPE_DROPPED, &self->dropped_messages);
+  stats_register_contended_counter(stats_level, sc_key, SC_TYPE_QUEUED, &self->queued_messages);
+  stats_register_contended_counter(stats_level, sc_key, SC_TYPE_DROPPED, &self->dropped_messages);
   stats_register_counter_and_index(STATS_LEVEL1, sc_key, SC_TYPE_MEMORY_USAGE, &self->memory_usage);
+  self->ack_latency = stats_register_latency_histogram(STATS_LEVEL1, sc_key->component, sc_key->id, sc_key->instance);
   atomic_gssize_set(&self->stats_cache.queued_messages, log_queue_get_length(self));
   stats_counter_add(self->queued_messages, atomic_gssize_get_unsigned(&self->stats_cache.queued_messages));
   stats_counter_add(self->memory_usage, atomic_gssize_get_unsigned(&self->stats_cache.memory_usage));
@@ -239,6 +240,7 @@ _unregister_common_counters(LogQueue *self, const StatsClusterKey *sc_key)
   stats_unregister_counter(sc_key, SC_TYPE_QUEUED, &self->queued_messages);
   stats_unregister_counter(sc_key, SC_TYPE_MEMORY_USAGE, &self->memory_usage);
   stats_unregister_counter(sc_key, SC_TYPE_DROPPED, &self->dropped_messages);
+  stats_unregister_latency_histogram(sc_key->component, sc_key->id, sc_key->instance, &self->ack_latency);
 }
 
 void
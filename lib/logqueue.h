@@ -51,6 +51,9 @@ struct _LogQueue
   StatsCounterItem *dropped_messages;
   StatsCounterItem *memory_usage;
 
+  /* time from receiving a message until it is acked by the destination */
+  StatsHistogram *ack_latency;
+
   struct
   {
     atomic_gssize memory_usage;
@@ -113,6 +116,22 @@ log_queue_push_head(LogQueue *self, LogMessage *msg, const LogPathOptions *path_
   self->push_head(self, msg, path_options);
 }
 
+/* NOTE: to be called by the implementations when a message on the backlog
+ * is acked */
+static inline void
+log_queue_record_ack_latency(LogQueue *self, LogMessage *msg)
+{
+  StatsHistogram *ack_latency = self->ack_latency;
+  const UnixTime *recvd = &msg->timestamps[LM_TS_RECVD];
+
+  if (ack_latency)
+    {
+      gint64 latency = g_get_real_time() - (recvd->ut_sec * G_USEC_PER_SEC + recvd->ut_usec);
+
+      stats_histogram_record(ack_latency, MAX(latency, 0));
+    }
+}
+
 static inline LogMessage *
 log_queue_pop_head(LogQueue *self, LogPathOptions *path_options)
 {
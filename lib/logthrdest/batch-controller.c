@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "logthrdest/batch-controller.h"
+
+void
+log_threaded_batch_controller_init(LogThreadedBatchController *self, LogThreadedBatchAdaptation adaptation,
+                                   gint max_lines, gint max_timeout, gint latency_target)
+{
+  self->adaptation = adaptation;
+  self->max_lines = MAX(max_lines, 1);
+  self->max_timeout = max_timeout;
+  self->latency_target = latency_target;
+
+  self->lines = self->max_lines;
+  self->timeout = self->max_timeout;
+  self->avg_flush_usec = 0;
+}
+
+/* flushing more often than a flush takes makes no sense */
+static gint
+_get_min_timeout(LogThreadedBatchController *self)
+{
+  return CLAMP(self->avg_flush_usec / 1000, 1, self->max_timeout);
+}
+
+static void
+_adapt_for_throughput(LogThreadedBatchController *self, gint flushed_lines, gssize queue_depth)
+{
+  if (queue_depth >= self->lines)
+    {
+      /* messages are piling up, larger batches amortize the cost of a flush */
+      self->lines = MIN(self->lines * 2, self->max_lines);
+      if (self->max_timeout > 0)
+        self->timeout = MIN(self->timeout * 2, self->max_timeout);
+    }
+  else if (flushed_lines < self->lines)
+    {
+      /* the batch was flushed before filling up, waiting for it only adds
+       * latency */
+      if (flushed_lines < self->lines / 2)
+        self->lines = MAX(flushed_lines, self->lines / 2);
+      if (self->max_timeout > 0)
+        self->timeout = MAX(self->timeout / 2, _get_min_timeout(self));
+    }
+}
+
+static void
+_adapt_for_latency(LogThreadedBatchController *self, gint64 batch_age_usec, gint64 flush_usec,
+                   gssize queue_depth)
+{
+  gint64 target_usec = (gint64) self->latency_target * 1000;
+  gint64 observed_usec = batch_age_usec + flush_usec;
+
+  if (observed_usec > target_usec)
+    self->lines = MAX(self->lines / 2, 1);
+  else if (observed_usec < target_usec / 2 && queue_depth >= self->lines)
+    self->lines = MIN(self->lines + MAX(self->lines / 4, 1), self->max_lines);
+
+  /* leave room for the flush itself within the target */
+  if (self->max_timeout > 0)
+    self->timeout = CLAMP(self->latency_target - self->avg_flush_usec / 1000, 1, self->max_timeout);
+}
+
+/* NOTE: called by the worker after each flush() of a non-empty batch */
+void
+log_threaded_batch_controller_update(LogThreadedBatchController *self, gint flushed_lines,
+                                     gint64 batch_age_usec, gint64 flush_usec, gssize queue_depth)
+{
+  if (self->adaptation == LTBA_NONE || self->max_lines <= 1 || flushed_lines <= 0)
+    return;
+
+  if (self->avg_flush_usec == 0)
+    self->avg_flush_usec = flush_usec;
+  else
+    self->avg_flush_usec = (self->avg_flush_usec * 7 + flush_usec) / 8;
+
+  if (self->adaptation == LTBA_THROUGHPUT)
+    _adapt_for_throughput(self, flushed_lines, queue_depth);
+  else
+    _adapt_for_latency(self, batch_age_usec, flush_usec, queue_depth);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef LOGTHRDEST_BATCH_CONTROLLER_H
+#define LOGTHRDEST_BATCH_CONTROLLER_H
+
+#include "syslog-ng.h"
+
+typedef enum
+{
+  LTBA_NONE,
+  LTBA_THROUGHPUT,
+  LTBA_LATENCY,
+} LogThreadedBatchAdaptation;
+
+/* Adjusts the effective batch size and flush deadline of a worker between
+ * 1 and batch-lines() and batch-timeout() respectively, based on what it
+ * observes at each flush.  With LTBA_THROUGHPUT, batches grow while the
+ * queue is backlogged and the deadline shrinks when batches are flushed
+ * before filling up.  With LTBA_LATENCY, batches shrink when the oldest
+ * message of a batch is delivered later than latency_target and grow while
+ * well below the target. */
+typedef struct _LogThreadedBatchController
+{
+  LogThreadedBatchAdaptation adaptation;
+
+  /* the configured bounds, in lines and msec */
+  gint max_lines;
+  gint max_timeout;
+  gint latency_target;
+
+  /* the effective values */
+  gint lines;
+  gint timeout;
+
+  gint64 avg_flush_usec;
+} LogThreadedBatchController;
+
+void log_threaded_batch_controller_init(LogThreadedBatchController *self, LogThreadedBatchAdaptation adaptation,
+                                        gint max_lines, gint max_timeout, gint latency_target);
+void log_threaded_batch_controller_update(LogThreadedBatchController *self, gint flushed_lines,
+                                          gint64 batch_age_usec, gint64 flush_usec, gssize queue_depth);
+
+#endif
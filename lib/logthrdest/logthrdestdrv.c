@@ -23,13 +23,19 @@
  */
 
 #include "stats/stats-cluster-logpipe.h"
+#include "stats/stats-cluster-single.h"
 #include "logthrdestdrv.h"
 #include "seqnum.h"
 #include "scratch-buffers.h"
 #include "timeutils/misc.h"
 
+#include <string.h>
+
 #define MAX_RETRIES_ON_ERROR_DEFAULT 3
 #define MAX_RETRIES_BEFORE_SUSPEND_DEFAULT 3
+#define WORKER_STEALING_BATCH_MIN 100
+#define WORKER_STEALING_POLL_MSEC 1000
+#define BATCH_LATENCY_TARGET_DEFAULT 1000
 
 static void _init_stats_key(LogThreadedDestDriver *self, StatsClusterKey *sc_key);
 
@@ -69,6 +75,30 @@ log_threaded_dest_driver_set_batch_timeout(LogDriver *s, gint batch_timeout)
   self->batch_timeout = batch_timeout;
 }
 
+gboolean
+log_threaded_dest_driver_set_batch_adaptation(LogDriver *s, const gchar *batch_adaptation)
+{
+  LogThreadedDestDriver *self = (LogThreadedDestDriver *) s;
+
+  if (strcmp(batch_adaptation, "none") == 0)
+    self->batch_adaptation = LTBA_NONE;
+  else if (strcmp(batch_adaptation, "throughput") == 0)
+    self->batch_adaptation = LTBA_THROUGHPUT;
+  else if (strcmp(batch_adaptation, "latency") == 0)
+    self->batch_adaptation = LTBA_LATENCY;
+  else
+    return FALSE;
+  return TRUE;
+}
+
+void
+log_threaded_dest_driver_set_batch_latency_target(LogDriver *s, gint batch_latency_target)
+{
+  LogThreadedDestDriver *self = (LogThreadedDestDriver *) s;
+
+  self->batch_latency_target = batch_latency_target;
+}
+
 void
 log_threaded_dest_driver_set_time_reopen(LogDriver *s, time_t time_reopen)
 {
@@ -77,11 +107,18 @@ log_threaded_dest_driver_set_time_reopen(LogDriver *s, time_t time_reopen)
   self->time_reopen = time_reopen;
 }
 
+/* the queue the messages of the current batch were popped from */
+static inline LogQueue *
+_get_batch_queue(LogThreadedDestWorker *self)
+{
+  return self->stolen_queue ? self->stolen_queue : self->queue;
+}
+
 /* this should be used in combination with LTR_EXPLICIT_ACK_MGMT to actually confirm message delivery. */
 void
 log_threaded_dest_worker_ack_messages(LogThreadedDestWorker *self, gint batch_size)
 {
-  log_queue_ack_backlog(self->queue, batch_size);
+  log_queue_ack_backlog(_get_batch_queue(self), batch_size);
   stats_counter_add(self->owner->written_messages, batch_size);
   self->retries_on_error_counter = 0;
   self->batch_size -= batch_size;
@@ -90,7 +127,7 @@ log_threaded_dest_worker_ack_messages(LogThreadedDestWorker *self, gint batch_si
 void
 log_threaded_dest_worker_drop_messages(LogThreadedDestWorker *self, gint batch_size)
 {
-  log_queue_ack_backlog(self->queue, batch_size);
+  log_queue_ack_backlog(_get_batch_queue(self), batch_size);
   stats_counter_add(self->owner->dropped_messages, batch_size);
   self->retries_on_error_counter = 0;
   self->batch_size -= batch_size;
@@ -99,7 +136,7 @@ log_threaded_dest_worker_drop_messages(LogThreadedDestWorker *self, gint batch_s
 void
 log_threaded_dest_worker_rewind_messages(LogThreadedDestWorker *self, gint batch_size)
 {
-  log_queue_rewind_backlog(self->queue, batch_size);
+  log_queue_rewind_backlog(_get_batch_queue(self), batch_size);
   self->rewound_batch_size = self->batch_size;
   self->batch_size -= batch_size;
 }
@@ -124,6 +161,24 @@ _format_queue_persist_name(LogThreadedDestWorker *self)
 }
 
 
+/* the effective batch-lines() and batch-timeout() of the worker, which
+ * are adjusted continuously with batch-adaptation() */
+static inline gint
+_get_batch_lines(LogThreadedDestWorker *self)
+{
+  if (self->batching.adaptation != LTBA_NONE)
+    return self->batching.lines;
+  return self->owner->batch_lines;
+}
+
+static inline gint
+_get_batch_timeout(LogThreadedDestWorker *self)
+{
+  if (self->batching.adaptation != LTBA_NONE)
+    return self->batching.timeout;
+  return self->owner->batch_timeout;
+}
+
 static gboolean
 _should_flush_now(LogThreadedDestWorker *self)
 {
@@ -139,7 +194,7 @@ _should_flush_now(LogThreadedDestWorker *self)
   now = iv_now;
   diff = timespec_diff_msec(&now, &self->last_flush_time);
 
-  return (diff >= self->owner->batch_timeout);
+  return (diff >= _get_batch_timeout(self));
 }
 
 static void
@@ -368,6 +423,48 @@ _process_result(LogThreadedDestWorker *self, gint result)
 
 }
 
+/* NOTE: the latency counter is the cumulative time spent in insert() and
+ * flush(), divide it by the processed counter for the average */
+static inline gint64
+_latency_measurement_start(LogThreadedDestWorker *self)
+{
+  if (self->stats.latency || self->batching.adaptation != LTBA_NONE)
+    return g_get_monotonic_time();
+  return 0;
+}
+
+static inline gint64
+_latency_measurement_stop(LogThreadedDestWorker *self, gint64 start)
+{
+  gint64 elapsed;
+
+  if (!start)
+    return 0;
+
+  elapsed = g_get_monotonic_time() - start;
+  stats_counter_add(self->stats.latency, elapsed);
+  return elapsed;
+}
+
+/* NOTE: runs in the worker thread after a flush, flush_start is the
+ * monotonic time the flush was started at, the batch age is the time the
+ * oldest message of the batch waited for it */
+static void
+_adapt_batching(LogThreadedDestWorker *self, gint flushed_lines, gint64 flush_start, gint64 flush_usec)
+{
+  gint64 batch_age_usec;
+
+  if (self->batching.adaptation == LTBA_NONE || flushed_lines <= 0)
+    return;
+
+  batch_age_usec = flush_start - self->batch_start_time;
+  log_threaded_batch_controller_update(&self->batching, flushed_lines, MAX(batch_age_usec, 0), flush_usec,
+                                       atomic_gssize_get(&self->queue->stats_cache.queued_messages));
+
+  stats_counter_set(self->stats.batch_lines, self->batching.lines);
+  stats_counter_set(self->stats.batch_timeout, MAX(self->batching.timeout, 0));
+}
+
 static void
 _perform_flush(LogThreadedDestWorker *self)
 {
@@ -384,22 +481,29 @@ _perform_flush(LogThreadedDestWorker *self)
                 evt_tag_int("worker_index", self->worker_index),
                 evt_tag_int("batch_size", self->batch_size));
 
+      gint flushed_lines = self->batch_size;
+      gint64 start = _latency_measurement_start(self);
       LogThreadedResult result = log_threaded_dest_worker_flush(self, LTF_FLUSH_NORMAL);
+      gint64 flush_usec = _latency_measurement_stop(self, start);
       _process_result(self, result);
+      _adapt_batching(self, flushed_lines, start, flush_usec);
     }
 
   iv_invalidate_now();
 }
 
 /* NOTE: runs in the worker thread, whenever items on our queue are
- * available. It iterates all elements on the queue, however will terminate
- * if the mainloop requests that we exit. */
-static void
-_perform_inserts(LogThreadedDestWorker *self)
+ * available. It iterates all elements on the queue (or at most
+ * max_messages of them if it is not -1), however will terminate if the
+ * mainloop requests that we exit. Returns the number of messages popped. */
+static gint
+_perform_inserts(LogThreadedDestWorker *self, gint max_messages)
 {
+  LogQueue *queue = _get_batch_queue(self);
   LogMessage *msg;
   LogThreadedResult result;
   LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  gint popped = 0;
 
   if (self->batch_size == 0)
     {
@@ -413,21 +517,28 @@ _perform_inserts(LogThreadedDestWorker *self)
 
   while (G_LIKELY(!self->owner->under_termination) &&
          !self->suspended &&
-         (msg = log_queue_pop_head(self->queue, &path_options)) != NULL)
+         (max_messages < 0 || popped < max_messages) &&
+         (msg = log_queue_pop_head(queue, &path_options)) != NULL)
     {
+      popped++;
       msg_set_context(msg);
       log_msg_refcache_start_consumer(msg, &path_options);
 
+      if (self->batch_size == 0 && self->batching.adaptation != LTBA_NONE)
+        self->batch_start_time = g_get_monotonic_time();
       self->batch_size++;
       ScratchBuffersMarker mark;
       scratch_buffers_mark(&mark);
 
+      gint64 start = _latency_measurement_start(self);
       result = log_threaded_dest_worker_insert(self, msg);
+      _latency_measurement_stop(self, start);
+      stats_counter_inc(self->stats.processed_messages);
       scratch_buffers_reclaim_marked(mark);
 
       _process_result(self, result);
 
-      if (self->enable_batching && self->batch_size >= self->owner->batch_lines)
+      if (self->enable_batching && self->batch_size >= _get_batch_lines(self))
         _perform_flush(self);
 
       log_msg_unref(msg);
@@ -444,6 +555,7 @@ _perform_inserts(LogThreadedDestWorker *self)
       iv_invalidate_now();
     }
   self->rewound_batch_size = 0;
+  return popped;
 }
 
 /* this callback is invoked by LogQueue and is registered using
@@ -475,7 +587,7 @@ static void
 _schedule_restart_on_batch_timeout(LogThreadedDestWorker *self)
 {
   self->timer_flush.expires = self->last_flush_time;
-  timespec_add_msec(&self->timer_flush.expires, self->owner->batch_timeout);
+  timespec_add_msec(&self->timer_flush.expires, _get_batch_timeout(self));
   iv_timer_register(&self->timer_flush);
 }
 
@@ -508,12 +620,107 @@ _schedule_restart_on_throttle_timeout(LogThreadedDestWorker *self, gint timeout_
   iv_timer_register(&self->timer_throttle);
 }
 
+/* worker-stealing() is ignored with a worker-partition-key(), as that
+ * would break the ordering of the messages within a partition */
+static inline gboolean
+_is_worker_stealing_enabled(LogThreadedDestDriver *self)
+{
+  return self->worker_stealing && !self->worker_partition_key && self->num_workers > 1;
+}
+
+static inline void
+_lock_queue_consumer(LogThreadedDestWorker *self)
+{
+  if (_is_worker_stealing_enabled(self->owner))
+    g_mutex_lock(self->consumer_lock);
+}
+
+static inline void
+_unlock_queue_consumer(LogThreadedDestWorker *self)
+{
+  if (_is_worker_stealing_enabled(self->owner))
+    g_mutex_unlock(self->consumer_lock);
+}
+
+/* Returns the sibling with the most messages waiting in its queue, with its
+ * consumer_lock held, or NULL if there's nothing to steal.
+ *
+ * The backlog of a LogQueue is acked/rewound by message count, so a queue
+ * must not have two consumers with outstanding batches at the same time:
+ * a sibling that is running (holding its consumer_lock) or has a partial
+ * batch pending is skipped. */
+static LogThreadedDestWorker *
+_lock_most_backlogged_sibling(LogThreadedDestWorker *self)
+{
+  LogThreadedDestDriver *owner = self->owner;
+  LogThreadedDestWorker *victim = NULL;
+  gssize max_depth = 0;
+
+  for (gint i = 0; i < owner->num_workers; i++)
+    {
+      LogThreadedDestWorker *dw = owner->workers[i];
+      gssize depth = atomic_gssize_get(&dw->queue->stats_cache.queued_messages);
+
+      if (dw != self && depth > max_depth)
+        {
+          victim = dw;
+          max_depth = depth;
+        }
+    }
+
+  if (!victim || !g_mutex_trylock(victim->consumer_lock))
+    return NULL;
+
+  if (victim->batch_size > 0)
+    {
+      g_mutex_unlock(victim->consumer_lock);
+      return NULL;
+    }
+  return victim;
+}
+
+/* NOTE: runs in the worker thread, when our own queue is empty.  A batch is
+ * popped from the most backlogged sibling queue and delivered using our
+ * connection.  The batch is acked/rewound on the sibling queue and it is
+ * completed before the sibling is released, LTR_EXPLICIT_ACK_MGMT
+ * messages not confirmed by the end of the flush are rewound.  */
+static gboolean
+_steal_batch(LogThreadedDestWorker *self)
+{
+  LogThreadedDestWorker *victim = _lock_most_backlogged_sibling(self);
+  gint stolen;
+
+  if (!victim)
+    return FALSE;
+
+  self->stolen_queue = victim->queue;
+  stolen = _perform_inserts(self, MAX(self->owner->batch_lines, WORKER_STEALING_BATCH_MIN));
+  _perform_flush(self);
+  if (self->batch_size > 0)
+    {
+      _rewind_batch(self);
+      self->rewound_batch_size = 0;
+    }
+  self->stolen_queue = NULL;
+  g_mutex_unlock(victim->consumer_lock);
+
+  msg_trace("Messages stolen from sibling worker",
+            evt_tag_str("driver", self->owner->super.super.id),
+            evt_tag_int("worker_index", self->worker_index),
+            evt_tag_int("sibling_worker_index", victim->worker_index),
+            evt_tag_int("stolen", stolen));
+
+  stats_counter_add(self->stats.stolen_messages, stolen);
+  return stolen > 0;
+}
+
 static void
 _perform_work(gpointer data)
 {
   LogThreadedDestWorker *self = (LogThreadedDestWorker *) data;
   gint timeout_msec = 0;
 
+  _lock_queue_consumer(self);
   self->suspended = FALSE;
   main_loop_worker_run_gc();
   _stop_watches(self);
@@ -534,7 +741,7 @@ _perform_work(gpointer data)
                 evt_tag_int("worker_index", self->worker_index));
 
       /* Something is in the queue, buffer them up and flush (if needed) */
-      _perform_inserts(self);
+      _perform_inserts(self, -1);
       if (_should_flush_now(self))
         _perform_flush(self);
       _schedule_restart(self);
@@ -574,6 +781,12 @@ _perform_work(gpointer data)
       _schedule_restart_on_throttle_timeout(self, timeout_msec);
 
     }
+  else if (_is_worker_stealing_enabled(self->owner) && _steal_batch(self))
+    {
+      /* our queue is empty, but a sibling had a backlog, go on stealing
+       * until there's nothing left */
+      _schedule_restart(self);
+    }
   else
     {
       /* NOTE: at this point we are not doing anything but keep the
@@ -585,8 +798,14 @@ _perform_work(gpointer data)
        * need to exit.  That happens in the shutdown_event_callback(), or
        * here in this very function, as log_queue_check_items() will cancel
        * outstanding parallel push callbacks automatically.
+       *
+       * NOTE/3: with worker-stealing() we also wake up periodically to
+       * check our siblings, as we are not notified when their queues grow.
        */
+      if (_is_worker_stealing_enabled(self->owner))
+        _schedule_restart_on_throttle_timeout(self, WORKER_STEALING_POLL_MSEC);
     }
+  _unlock_queue_consumer(self);
 }
 
 void
@@ -683,6 +902,16 @@ _wait_for_startup_finished(LogThreadedDestWorker *self)
   g_mutex_unlock(self->owner->lock);
 }
 
+static void
+_init_worker_stats_key(LogThreadedDestWorker *self, StatsClusterKey *sc_key, const gchar *name)
+{
+  stats_cluster_single_key_set_with_name(sc_key, self->owner->stats_source | SCS_DESTINATION,
+                                         self->owner->super.super.id, self->stats.stats_instance, name);
+}
+
+/* the queue counters of the workers are summed up in the driver's
+ * counters, in addition to that each worker of a multi-worker driver gets
+ * its own counters so that an overloaded worker can be spotted */
 static void
 _register_worker_stats(LogThreadedDestWorker *self)
 {
@@ -691,6 +920,31 @@ _register_worker_stats(LogThreadedDestWorker *self)
   stats_lock();
   _init_stats_key(self->owner, &sc_key);
   log_queue_register_stats_counters(self->queue, 0, &sc_key);
+
+  if (self->owner->num_workers > 1 || self->batching.adaptation != LTBA_NONE)
+    {
+      self->stats.stats_instance = g_strdup_printf("%s#%d", self->owner->format_stats_instance(self->owner),
+                                                   self->worker_index);
+
+      _init_worker_stats_key(self, &sc_key, "queued");
+      stats_register_external_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &self->queue->stats_cache.queued_messages);
+      _init_worker_stats_key(self, &sc_key, "processed");
+      stats_register_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &self->stats.processed_messages);
+      _init_worker_stats_key(self, &sc_key, "latency_usec");
+      stats_register_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &self->stats.latency);
+      _init_worker_stats_key(self, &sc_key, "stolen");
+      stats_register_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &self->stats.stolen_messages);
+
+      if (self->batching.adaptation != LTBA_NONE)
+        {
+          _init_worker_stats_key(self, &sc_key, "batch_lines");
+          stats_register_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &self->stats.batch_lines);
+          _init_worker_stats_key(self, &sc_key, "batch_timeout_msec");
+          stats_register_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &self->stats.batch_timeout);
+          stats_counter_set(self->stats.batch_lines, self->batching.lines);
+          stats_counter_set(self->stats.batch_timeout, MAX(self->batching.timeout, 0));
+        }
+    }
   stats_unlock();
 }
 
@@ -702,6 +956,26 @@ _unregister_worker_stats(LogThreadedDestWorker *self)
   stats_lock();
   _init_stats_key(self->owner, &sc_key);
   log_queue_unregister_stats_counters(self->queue, &sc_key);
+
+  if (self->stats.stats_instance)
+    {
+      _init_worker_stats_key(self, &sc_key, "queued");
+      stats_unregister_external_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &self->queue->stats_cache.queued_messages);
+      _init_worker_stats_key(self, &sc_key, "processed");
+      stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &self->stats.processed_messages);
+      _init_worker_stats_key(self, &sc_key, "latency_usec");
+      stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &self->stats.latency);
+      _init_worker_stats_key(self, &sc_key, "stolen");
+      stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &self->stats.stolen_messages);
+
+      _init_worker_stats_key(self, &sc_key, "batch_lines");
+      stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &self->stats.batch_lines);
+      _init_worker_stats_key(self, &sc_key, "batch_timeout_msec");
+      stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &self->stats.batch_timeout);
+
+      g_free(self->stats.stats_instance);
+      self->stats.stats_instance = NULL;
+    }
   stats_unlock();
 }
 
@@ -715,9 +989,11 @@ _perform_final_flush(LogThreadedDestWorker *self)
   if (!cfg_is_shutting_down(cfg))
     mode = LTF_FLUSH_EXPEDITE;
 
+  _lock_queue_consumer(self);
   result = log_threaded_dest_worker_flush(self, mode);
   _process_result(self, result);
   log_queue_rewind_backlog_all(self->queue);
+  _unlock_queue_consumer(self);
 }
 
 static void
@@ -743,7 +1019,9 @@ _worker_thread(gpointer arg)
   /* if we have anything on the backlog, that was a partial, potentially
    * not-flushed batch.  Rewind it, so we start with that */
 
+  _lock_queue_consumer(self);
   log_queue_rewind_backlog_all(self->queue);
+  _unlock_queue_consumer(self);
 
   _schedule_restart(self);
   iv_main();
@@ -790,6 +1068,9 @@ log_threaded_dest_worker_init_method(LogThreadedDestWorker *self)
   if (self->time_reopen == -1)
     self->time_reopen = self->owner->time_reopen;
 
+  log_threaded_batch_controller_init(&self->batching, self->owner->batch_adaptation,
+                                     self->owner->batch_lines, self->owner->batch_timeout,
+                                     self->owner->batch_latency_target);
   _register_worker_stats(self);
 
   return TRUE;
@@ -805,6 +1086,7 @@ void
 log_threaded_dest_worker_free_method(LogThreadedDestWorker *self)
 {
   g_cond_free(self->started_up);
+  g_mutex_free(self->consumer_lock);
 }
 
 void
@@ -817,6 +1099,7 @@ log_threaded_dest_worker_init_instance(LogThreadedDestWorker *self, LogThreadedD
   self->owner = owner;
   self->time_reopen = -1;
   self->started_up = g_cond_new();
+  self->consumer_lock = g_mutex_new();
   _init_watches(self);
 }
 
@@ -958,13 +1241,125 @@ log_threaded_dest_driver_set_max_retries_on_error(LogDriver *s, gint max_retries
   self->retries_on_error_max = max_retries;
 }
 
-LogThreadedDestWorker *
+gboolean
+log_threaded_dest_driver_set_worker_selection(LogDriver *s, const gchar *worker_selection)
+{
+  LogThreadedDestDriver *self = (LogThreadedDestDriver *)s;
+
+  if (strcmp(worker_selection, "round-robin") == 0)
+    self->worker_selection = LTWS_ROUND_ROBIN;
+  else if (strcmp(worker_selection, "least-queue-depth") == 0)
+    self->worker_selection = LTWS_LEAST_QUEUE_DEPTH;
+  else
+    return FALSE;
+  return TRUE;
+}
+
+void
+log_threaded_dest_driver_set_worker_partition_key_ref(LogDriver *s, LogTemplate *worker_partition_key)
+{
+  LogThreadedDestDriver *self = (LogThreadedDestDriver *)s;
+
+  log_template_unref(self->worker_partition_key);
+  self->worker_partition_key = worker_partition_key;
+}
+
+void
+log_threaded_dest_driver_set_worker_stealing(LogDriver *s, gboolean worker_stealing)
+{
+  LogThreadedDestDriver *self = (LogThreadedDestDriver *)s;
+
+  self->worker_stealing = worker_stealing;
+}
+
+static guint
+_hash_partition_key(const gchar *key, gssize key_len)
+{
+  guint hash = 2166136261U;
+
+  for (gssize i = 0; i < key_len; i++)
+    hash = (hash ^ (guchar) key[i]) * 16777619U;
+  return hash;
+}
+
+/* messages with the same partition key always go to the same worker, so
+ * their order is kept */
+static gint
+_lookup_worker_by_partition_key(LogThreadedDestDriver *self, LogMessage *msg)
+{
+  guint hash;
+
+  if (log_template_is_trivial(self->worker_partition_key))
+    {
+      gssize key_len;
+      const gchar *key = log_template_get_trivial_value(self->worker_partition_key, msg, &key_len);
+
+      hash = _hash_partition_key(key, key_len);
+    }
+  else
+    {
+      ScratchBuffersMarker mark;
+      GString *key = scratch_buffers_alloc_and_mark(&mark);
+      LogTemplateEvalOptions options = {&log_pipe_get_config(&self->super.super.super)->template_options, LTZ_SEND, 0, NULL};
+
+      log_template_format(self->worker_partition_key, msg, &options, key);
+      hash = _hash_partition_key(key->str, key->len);
+      scratch_buffers_reclaim_marked(mark);
+    }
+  return hash % self->num_workers;
+}
+
+/* picks the worker with the fewest messages waiting in its queue,
+ * preferring connected workers.  The queue lengths are read without
+ * locking, so this is only a heuristic.  Ties are broken in a round-robin
+ * fashion. */
+static gint
+_lookup_least_loaded_worker(LogThreadedDestDriver *self)
+{
+  gint start = self->last_worker++ % self->num_workers;
+  gint best_index = start;
+  gssize best_depth = G_MAXSSIZE;
+  gboolean best_connected = FALSE;
+
+  for (gint i = 0; i < self->num_workers; i++)
+    {
+      gint worker_index = (start + i) % self->num_workers;
+      LogThreadedDestWorker *dw = self->workers[worker_index];
+      gboolean connected = dw->connected && !dw->suspended;
+      gssize depth = atomic_gssize_get(&dw->queue->stats_cache.queued_messages);
+
+      if ((connected && !best_connected) || (connected == best_connected && depth < best_depth))
+        {
+          best_index = worker_index;
+          best_depth = depth;
+          best_connected = connected;
+        }
+    }
+  return best_index;
+}
+
+static LogThreadedDestWorker *
 _lookup_worker(LogThreadedDestDriver *self, LogMessage *msg)
 {
-  gint worker_index = self->last_worker % self->num_workers;
-  self->last_worker++;
+  gint worker_index;
+
+  if (self->num_workers == 1)
+    return self->workers[0];
+
+  if (self->worker_partition_key)
+    {
+      worker_index = _lookup_worker_by_partition_key(self, msg);
+    }
+  else if (self->worker_selection == LTWS_LEAST_QUEUE_DEPTH)
+    {
+      worker_index = _lookup_least_loaded_worker(self);
+    }
+  else
+    {
+      worker_index = self->last_worker % self->num_workers;
+      self->last_worker++;
+    }
 
-  /* here would come the lookup mechanism that maps msg -> worker that doesn't exist yet. */
   return self->workers[worker_index];
 }
 
@@ -1006,9 +1401,9 @@ _register_stats(LogThreadedDestDriver *self)
     StatsClusterKey sc_key;
 
     _init_stats_key(self, &sc_key);
-    stats_register_counter(0, &sc_key, SC_TYPE_DROPPED, &self->dropped_messages);
-    stats_register_counter(0, &sc_key, SC_TYPE_PROCESSED, &self->processed_messages);
-    stats_register_counter(0, &sc_key, SC_TYPE_WRITTEN, &self->written_messages);
+    stats_register_contended_counter(0, &sc_key, SC_TYPE_DROPPED, &self->dropped_messages);
+    stats_register_contended_counter(0, &sc_key, SC_TYPE_PROCESSED, &self->processed_messages);
+    stats_register_contended_counter(0, &sc_key, SC_TYPE_WRITTEN, &self->written_messages);
   }
   stats_unlock();
 }
@@ -1077,6 +1472,15 @@ log_threaded_dest_driver_init_method(LogPipe *s)
   if (!self->shared_seq_num)
     init_sequence_number(&self->shared_seq_num);
 
+  if (self->batch_latency_target == -1)
+    self->batch_latency_target = self->batch_timeout > 0 ? self->batch_timeout : BATCH_LATENCY_TARGET_DEFAULT;
+
+  if (self->worker_stealing && self->worker_partition_key)
+    msg_warning("WARNING: worker-stealing() is ignored when worker-partition-key() is set, "
+                "as it would break the ordering of messages within a partition",
+                evt_tag_str("driver", self->super.super.id),
+                log_expr_node_location_tag(self->super.super.super.expr_node));
+
   _register_stats(self);
 
   if (!_create_workers(self))
@@ -1132,6 +1536,7 @@ log_threaded_dest_driver_free(LogPipe *s)
   LogThreadedDestDriver *self = (LogThreadedDestDriver *)s;
 
   log_threaded_dest_worker_free_method(&self->worker.instance);
+  log_template_unref(self->worker_partition_key);
   g_mutex_free(self->lock);
   g_free(self->workers);
   log_dest_driver_free((LogPipe *)self);
@@ -1152,6 +1557,8 @@ log_threaded_dest_driver_init_instance(LogThreadedDestDriver *self, GlobalConfig
   self->time_reopen = -1;
   self->batch_lines = -1;
   self->batch_timeout = -1;
+  self->batch_adaptation = LTBA_NONE;
+  self->batch_latency_target = -1;
   self->num_workers = 1;
   self->last_worker = 0;
 
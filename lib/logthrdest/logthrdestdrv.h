@@ -31,6 +31,8 @@
 #include "logqueue.h"
 #include "mainloop-worker.h"
 #include "seqnum.h"
+#include "template/templates.h"
+#include "logthrdest/batch-controller.h"
 
 #include <iv.h>
 #include <iv_event.h>
@@ -59,6 +61,12 @@ typedef enum
   LTR_MAX
 } LogThreadedResult;
 
+typedef enum
+{
+  LTWS_ROUND_ROBIN,
+  LTWS_LEAST_QUEUE_DEPTH,
+} LogThreadedWorkerSelection;
+
 typedef struct _LogThreadedDestDriver LogThreadedDestDriver;
 typedef struct _LogThreadedDestWorker LogThreadedDestWorker;
 
@@ -89,6 +97,31 @@ struct _LogThreadedDestWorker
   GCond *started_up;
   time_t time_reopen;
 
+  /* held while the queue is consumed, either by this worker or by a
+   * sibling stealing from it, see worker-stealing() */
+  GMutex *consumer_lock;
+
+  /* the sibling queue the current batch was stolen from, NULL if the batch
+   * comes from our own queue */
+  LogQueue *stolen_queue;
+
+  LogThreadedBatchController batching;
+  /* monotonic time the first message of the current batch was inserted,
+   * only maintained with batch-adaptation() */
+  gint64 batch_start_time;
+
+  /* per-worker counters, only registered if the driver has multiple
+   * workers or uses batch-adaptation() */
+  struct
+  {
+    gchar *stats_instance;
+    StatsCounterItem *processed_messages;
+    StatsCounterItem *latency;
+    StatsCounterItem *stolen_messages;
+    StatsCounterItem *batch_lines;
+    StatsCounterItem *batch_timeout;
+  } stats;
+
   gboolean (*thread_init)(LogThreadedDestWorker *s);
   void (*thread_deinit)(LogThreadedDestWorker *s);
   gboolean (*connect)(LogThreadedDestWorker *s);
@@ -111,6 +144,8 @@ struct _LogThreadedDestDriver
 
   gint batch_lines;
   gint batch_timeout;
+  LogThreadedBatchAdaptation batch_adaptation;
+  gint batch_latency_target;
   gboolean under_termination;
   time_t time_reopen;
   gint retries_on_error_max;
@@ -137,6 +172,9 @@ struct _LogThreadedDestDriver
   gint num_workers;
   gint created_workers;
   guint last_worker;
+  LogThreadedWorkerSelection worker_selection;
+  LogTemplate *worker_partition_key;
+  gboolean worker_stealing;
 
   gint stats_source;
 
@@ -235,8 +273,13 @@ void log_threaded_dest_driver_free(LogPipe *s);
 
 void log_threaded_dest_driver_set_max_retries_on_error(LogDriver *s, gint max_retries);
 void log_threaded_dest_driver_set_num_workers(LogDriver *s, gint num_workers);
+gboolean log_threaded_dest_driver_set_worker_selection(LogDriver *s, const gchar *worker_selection);
+void log_threaded_dest_driver_set_worker_partition_key_ref(LogDriver *s, LogTemplate *worker_partition_key);
+void log_threaded_dest_driver_set_worker_stealing(LogDriver *s, gboolean worker_stealing);
 void log_threaded_dest_driver_set_batch_lines(LogDriver *s, gint batch_lines);
 void log_threaded_dest_driver_set_batch_timeout(LogDriver *s, gint batch_timeout);
+gboolean log_threaded_dest_driver_set_batch_adaptation(LogDriver *s, const gchar *batch_adaptation);
+void log_threaded_dest_driver_set_batch_latency_target(LogDriver *s, gint batch_latency_target);
 void log_threaded_dest_driver_set_time_reopen(LogDriver *s, time_t time_reopen);
 
 #endif
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "logthrdest/batch-controller.h"
+
+#include <criterion/criterion.h>
+
+Test(batch_controller, no_adaptation_keeps_the_configured_values)
+{
+  LogThreadedBatchController controller;
+
+  log_threaded_batch_controller_init(&controller, LTBA_NONE, 100, 1000, 1000);
+  log_threaded_batch_controller_update(&controller, 1, 0, 100, 1000);
+  cr_assert_eq(controller.lines, 100);
+  cr_assert_eq(controller.timeout, 1000);
+}
+
+Test(batch_controller, throughput_shrinks_half_empty_batches_and_grows_them_under_backlog)
+{
+  LogThreadedBatchController controller;
+
+  log_threaded_batch_controller_init(&controller, LTBA_THROUGHPUT, 100, 1000, 1000);
+
+  /* light load: batches are flushed by their deadline with a few messages in them */
+  for (gint i = 0; i < 20; i++)
+    log_threaded_batch_controller_update(&controller, 2, 900000, 5000, 0);
+  cr_assert_eq(controller.lines, 3);
+  cr_assert_eq(controller.timeout, 5, "the deadline must not go below the flush latency, timeout=%d",
+               controller.timeout);
+
+  /* heavy load: messages pile up in the queue */
+  for (gint i = 0; i < 20; i++)
+    log_threaded_batch_controller_update(&controller, controller.lines, 1000, 5000, 10000);
+  cr_assert_eq(controller.lines, 100);
+  cr_assert_eq(controller.timeout, 1000);
+}
+
+Test(batch_controller, latency_shrinks_batches_missing_the_target)
+{
+  LogThreadedBatchController controller;
+
+  log_threaded_batch_controller_init(&controller, LTBA_LATENCY, 64, 1000, 100);
+
+  /* the flush alone takes 150ms */
+  log_threaded_batch_controller_update(&controller, 64, 10000, 150000, 1000);
+  cr_assert_eq(controller.lines, 32);
+  cr_assert_eq(controller.timeout, 1);
+
+  for (gint i = 0; i < 10; i++)
+    log_threaded_batch_controller_update(&controller, controller.lines, 10000, 150000, 1000);
+  cr_assert_eq(controller.lines, 1);
+}
+
+Test(batch_controller, latency_grows_batches_well_below_the_target_under_backlog)
+{
+  LogThreadedBatchController controller;
+
+  log_threaded_batch_controller_init(&controller, LTBA_LATENCY, 64, 1000, 100);
+  controller.lines = 8;
+
+  /* no backlog, no reason to grow */
+  log_threaded_batch_controller_update(&controller, 8, 1000, 10000, 0);
+  cr_assert_eq(controller.lines, 8);
+  cr_assert_eq(controller.timeout, 90);
+
+  for (gint i = 0; i < 100; i++)
+    log_threaded_batch_controller_update(&controller, controller.lines, 1000, 10000, 1000);
+  cr_assert_eq(controller.lines, 64);
+  cr_assert_eq(controller.timeout, 90);
+}
+
+Test(batch_controller, batching_disabled_is_left_alone)
+{
+  LogThreadedBatchController controller;
+
+  log_threaded_batch_controller_init(&controller, LTBA_THROUGHPUT, 0, -1, 1000);
+  log_threaded_batch_controller_update(&controller, 1, 0, 1000, 1000);
+  cr_assert_eq(controller.lines, 1);
+  cr_assert_eq(controller.timeout, -1);
+}
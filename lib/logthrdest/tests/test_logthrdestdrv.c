@@ -696,6 +696,32 @@ Test(logthrdestdrv, batch_timeout_limits_flush_frequency)
   cr_assert(dd->flush_size == 10);
 }
 
+Test(logthrdestdrv, latency_batch_adaptation_shrinks_batches_that_wait_longer_than_the_target)
+{
+  /* the batch controller is set up when the driver is initialized */
+  _teardown_dd();
+  dd = test_threaded_dd_new(main_loop_get_current_config(main_loop));
+  dd->super.worker.insert = _insert_batched_message_success;
+  dd->super.worker.flush = _flush_batched_message_success;
+  dd->super.batch_lines = 8;
+  dd->super.batch_timeout = 300;
+  cr_assert(log_threaded_dest_driver_set_batch_adaptation(&dd->super.super.super, "latency"));
+  log_threaded_dest_driver_set_batch_latency_target(&dd->super.super.super, 50);
+  cr_assert(log_pipe_init(&dd->super.super.super.super));
+  cr_assert(log_pipe_on_config_inited(&dd->super.super.super.super));
+
+  LogThreadedDestWorker *worker = &dd->super.worker.instance;
+  cr_assert_eq(stats_counter_get(worker->stats.batch_lines), 8);
+
+  /* the batch does not fill up, so its messages wait for batch-timeout(),
+   * well beyond the latency target */
+  _generate_messages_and_wait_for_processing(dd, 2, dd->super.written_messages);
+  cr_assert_eq(dd->flush_counter, 1);
+
+  _spin_for_counter_value(worker->stats.batch_lines, 4);
+  cr_assert_eq(stats_counter_get(worker->stats.batch_timeout), 50);
+}
+
 static gboolean
 _connect_failure(LogThreadedDestDriver *s)
 {
@@ -771,6 +797,162 @@ Test(logthrdestdrv, test_explicit_ack_accept)
   cr_assert(dd->super.shared_seq_num == 11, "%d", dd->super.shared_seq_num);
 }
 
+typedef struct _TestWorker
+{
+  LogThreadedDestWorker super;
+  GHashTable *seen_keys;
+  gint insert_counter;
+} TestWorker;
+
+static LogThreadedResult
+_test_worker_insert(LogThreadedDestWorker *s, LogMessage *msg)
+{
+  TestWorker *self = (TestWorker *) s;
+
+  g_hash_table_add(self->seen_keys, g_strdup(log_msg_get_value(msg, LM_V_PID, NULL)));
+  self->insert_counter++;
+  return LTR_SUCCESS;
+}
+
+static gboolean
+_test_worker_connect_failure(LogThreadedDestWorker *s)
+{
+  return FALSE;
+}
+
+static void
+_test_worker_free(LogThreadedDestWorker *s)
+{
+  TestWorker *self = (TestWorker *) s;
+
+  g_hash_table_destroy(self->seen_keys);
+  log_threaded_dest_worker_free_method(s);
+}
+
+static LogThreadedDestWorker *
+_construct_test_worker(LogThreadedDestDriver *o, gint worker_index)
+{
+  TestWorker *self = g_new0(TestWorker, 1);
+
+  log_threaded_dest_worker_init_instance(&self->super, o, worker_index);
+  self->super.insert = _test_worker_insert;
+  self->super.free_fn = _test_worker_free;
+  self->seen_keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  return &self->super;
+}
+
+static void
+_recreate_dd_with_workers(gint num_workers)
+{
+  _teardown_dd();
+  dd = test_threaded_dd_new(main_loop_get_current_config(main_loop));
+  dd->super.worker.construct = _construct_test_worker;
+  log_threaded_dest_driver_set_num_workers(&dd->super.super.super, num_workers);
+}
+
+static void
+_generate_messages_with_keys(TestThreadedDestDriver *self, gint n, gint num_keys)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT_NOACK;
+  gchar buf[32];
+
+  for (gint i = 0; i < n; i++)
+    {
+      LogMessage *msg = create_sample_message();
+
+      g_snprintf(buf, sizeof(buf), "key%d", i % num_keys);
+      log_msg_set_value(msg, LM_V_PID, buf, -1);
+      log_pipe_queue(&self->super.super.super.super, msg, &path_options);
+    }
+}
+
+Test(logthrdestdrv, worker_partition_key_sends_messages_with_the_same_key_to_the_same_worker)
+{
+  LogTemplate *partition_key = log_template_new(main_loop_get_current_config(main_loop), NULL);
+  gint total_inserts = 0;
+  gssize total_processed = 0;
+
+  _recreate_dd_with_workers(4);
+  cr_assert(log_template_compile(partition_key, "$PID", NULL));
+  log_threaded_dest_driver_set_worker_partition_key_ref(&dd->super.super.super, partition_key);
+  cr_assert(log_pipe_init(&dd->super.super.super.super));
+  cr_assert(log_pipe_on_config_inited(&dd->super.super.super.super));
+
+  _generate_messages_with_keys(dd, 100, 7);
+  _spin_for_counter_value(dd->super.written_messages, 100);
+
+  for (gint key = 0; key < 7; key++)
+    {
+      gchar buf[32];
+      gint owners = 0;
+
+      g_snprintf(buf, sizeof(buf), "key%d", key);
+      for (gint i = 0; i < dd->super.num_workers; i++)
+        {
+          TestWorker *worker = (TestWorker *) dd->super.workers[i];
+
+          if (g_hash_table_contains(worker->seen_keys, buf))
+            owners++;
+        }
+      cr_assert_eq(owners, 1, "messages with the same partition key were processed by %d workers", owners);
+    }
+
+  for (gint i = 0; i < dd->super.num_workers; i++)
+    {
+      TestWorker *worker = (TestWorker *) dd->super.workers[i];
+
+      total_inserts += worker->insert_counter;
+      total_processed += stats_counter_get(worker->super.stats.processed_messages);
+    }
+  cr_assert_eq(total_inserts, 100);
+  cr_assert_eq(total_processed, 100);
+}
+
+Test(logthrdestdrv, least_queue_depth_worker_selection_avoids_disconnected_workers)
+{
+  _recreate_dd_with_workers(3);
+  cr_assert(log_threaded_dest_driver_set_worker_selection(&dd->super.super.super, "least-queue-depth"));
+  cr_assert_not(log_threaded_dest_driver_set_worker_selection(&dd->super.super.super, "random"));
+  cr_assert(log_pipe_init(&dd->super.super.super.super));
+
+  /* the first worker never manages to connect */
+  dd->super.workers[0]->connect = _test_worker_connect_failure;
+  dd->super.workers[0]->time_reopen = 60;
+  cr_assert(log_pipe_on_config_inited(&dd->super.super.super.super));
+
+  for (gint c = 0; c < MAX_SPIN_ITERATIONS && !(dd->super.workers[1]->connected && dd->super.workers[2]->connected); c++)
+    _sleep_msec(1);
+
+  _generate_messages_with_keys(dd, 30, 30);
+  _spin_for_counter_value(dd->super.written_messages, 30);
+
+  cr_assert_eq(((TestWorker *) dd->super.workers[0])->insert_counter, 0);
+  cr_assert_eq(((TestWorker *) dd->super.workers[1])->insert_counter +
+               ((TestWorker *) dd->super.workers[2])->insert_counter, 30);
+}
+
+Test(logthrdestdrv, worker_stealing_delivers_the_queue_of_a_disconnected_worker)
+{
+  _recreate_dd_with_workers(3);
+  log_threaded_dest_driver_set_worker_stealing(&dd->super.super.super, TRUE);
+  cr_assert(log_pipe_init(&dd->super.super.super.super));
+
+  /* the first worker never manages to connect, round-robin still routes
+   * every third message to it */
+  dd->super.workers[0]->connect = _test_worker_connect_failure;
+  dd->super.workers[0]->time_reopen = 60;
+  cr_assert(log_pipe_on_config_inited(&dd->super.super.super.super));
+
+  _generate_messages_with_keys(dd, 30, 30);
+  _spin_for_counter_value(dd->super.written_messages, 30);
+
+  cr_assert_eq(((TestWorker *) dd->super.workers[0])->insert_counter, 0);
+  cr_assert_eq(stats_counter_get(dd->super.workers[1]->stats.stolen_messages) +
+               stats_counter_get(dd->super.workers[2]->stats.stolen_messages), 10);
+  cr_assert_eq(stats_counter_get(dd->super.workers[0]->queue->queued_messages), 0);
+  cr_assert_eq(stats_counter_get(dd->super.dropped_messages), 0);
+}
+
 MainLoopOptions main_loop_options = {0};
 
 static void
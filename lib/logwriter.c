@@ -475,6 +475,11 @@ log_writer_update_watches(LogWriter *self)
        * log_queue_check_items and its parallel_push argument above
        */
       log_writer_update_fd_callbacks(self, 0);
+
+      /* the protocol may still have deferred work, e.g. a periodic sync */
+      gint idle_flush_msec = log_proto_client_get_idle_flush_timeout(self->proto);
+      if (idle_flush_msec >= 0)
+        log_writer_arm_suspend_timer(self, (void (*)(void *)) log_writer_update_watches, (glong)idle_flush_msec);
     }
 
   if (idle_timeout > 0)
@@ -1399,10 +1404,11 @@ _register_counters(LogWriter *self)
                                   self->stats_instance);
 
     if (self->options->suppress > 0)
-      stats_register_counter(self->options->stats_level, &sc_key, SC_TYPE_SUPPRESSED, &self->suppressed_messages);
-    stats_register_counter(self->options->stats_level, &sc_key, SC_TYPE_DROPPED, &self->dropped_messages);
-    stats_register_counter(self->options->stats_level, &sc_key, SC_TYPE_PROCESSED, &self->processed_messages);
-    stats_register_counter(self->options->stats_level, &sc_key, SC_TYPE_WRITTEN, &self->written_messages);
+      stats_register_contended_counter(self->options->stats_level, &sc_key, SC_TYPE_SUPPRESSED,
+                                       &self->suppressed_messages);
+    stats_register_contended_counter(self->options->stats_level, &sc_key, SC_TYPE_DROPPED, &self->dropped_messages);
+    stats_register_contended_counter(self->options->stats_level, &sc_key, SC_TYPE_PROCESSED, &self->processed_messages);
+    stats_register_contended_counter(self->options->stats_level, &sc_key, SC_TYPE_WRITTEN, &self->written_messages);
     log_queue_register_stats_counters(self->queue, self->options->stats_level, &sc_key);
 
     StatsClusterKey sc_key_truncated_count;
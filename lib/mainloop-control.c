@@ -31,6 +31,7 @@
 #include "secret-storage/secret-storage.h"
 #include "cfg-walker.h"
 #include "logpipe.h"
+#include "pipe-profiler.h"
 
 #include <string.h>
 
@@ -409,6 +410,43 @@ export_config_graph(ControlConnection *cc, GString *command, gpointer user_data)
   control_connection_send_reply(cc, result);
 }
 
+static void
+control_connection_profile(ControlConnection *cc, GString *command, gpointer user_data)
+{
+  gchar **arguments = g_strsplit(command->str, " ", 3);
+  GString *result;
+
+  if (!arguments[1] || g_str_equal(arguments[1], "SHOW"))
+    {
+      result = pipe_profiler_format_report();
+    }
+  else if (g_str_equal(arguments[1], "START"))
+    {
+      pipe_profiler_reset();
+      pipe_profiling_enabled = TRUE;
+      msg_info("Pipe profiling started");
+      result = g_string_new("OK Pipe profiling started");
+    }
+  else if (g_str_equal(arguments[1], "STOP"))
+    {
+      pipe_profiling_enabled = FALSE;
+      msg_info("Pipe profiling stopped");
+      result = g_string_new("OK Pipe profiling stopped");
+    }
+  else if (g_str_equal(arguments[1], "RESET"))
+    {
+      pipe_profiler_reset();
+      result = g_string_new("OK Pipe profile reset");
+    }
+  else
+    {
+      result = g_string_new("FAIL Invalid arguments received");
+    }
+
+  g_strfreev(arguments);
+  control_connection_send_reply(cc, result);
+}
+
 ControlCommand default_commands[] =
 {
   { "LOG", control_connection_message_log },
@@ -420,6 +458,7 @@ ControlCommand default_commands[] =
   { "PWD", process_credentials },
   { "LISTFILES", control_connection_list_files },
   { "EXPORT_CONFIG_GRAPH", export_config_graph },
+  { "PROFILE", control_connection_profile },
   { NULL, NULL },
 };
 
@@ -158,6 +158,8 @@ struct _MainLoop
   GlobalConfig *old_config;
   /* the pending configuration we wish to switch to */
   GlobalConfig *new_config;
+  /* when the workers were asked to stop for the reload, in usec */
+  gint64 reload_pause_start;
 
   MainLoopOptions *options;
   ControlServer *control_server;
@@ -291,7 +293,8 @@ main_loop_reload_config_apply(gpointer user_data)
       return;
     }
 
-  msg_verbose("New configuration initialized");
+  msg_verbose("New configuration initialized",
+              evt_tag_long("pause_msec", (g_get_monotonic_time() - self->reload_pause_start) / 1000));
   persist_config_free(self->new_config->persist);
   self->new_config->persist = NULL;
   cfg_free(self->old_config);
@@ -338,6 +341,21 @@ main_loop_reload_config_prepare(MainLoop *self, GError **error)
                   "Syntax error parsing configuration file");
       return FALSE;
     }
+
+  /* Resolve references and build the pipeline of the new configuration
+   * while the old one is still running: this only creates new objects, so
+   * it does not need the workers to be stopped and errors can be reported
+   * without a revert.  cfg_init() skips an already compiled tree. */
+  if (!cfg_tree_compile(&self->new_config->tree))
+    {
+      cfg_free(self->new_config);
+      self->new_config = NULL;
+      self->old_config = NULL;
+      service_management_publish_status("Error compiling new configuration, using the old config");
+      g_set_error(error, MAIN_LOOP_ERROR, MAIN_LOOP_ERROR_RELOAD_FAILED,
+                  "Error compiling the processing pipeline of the configuration");
+      return FALSE;
+    }
   is_reloading_scheduled = TRUE;
   return TRUE;
 }
@@ -346,6 +364,7 @@ void
 main_loop_reload_config_commence(MainLoop *self)
 {
   g_assert(is_reloading_scheduled == TRUE);
+  self->reload_pause_start = g_get_monotonic_time();
   main_loop_worker_sync_call(main_loop_reload_config_apply, self);
 }
 
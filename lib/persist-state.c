@@ -118,14 +118,44 @@ typedef struct _PersistValueHeader
 
 /* lowest layer, "store" functions manage the file on disk */
 
+/* flag in mapped_counter, set while _grow_store() is waiting for the
+ * mappings to be released and while it remaps the file.  New mappings are
+ * not granted while it is set.  */
+#define PERSIST_STATE_MAP_GROWING 0x40000000
+
 static void
 _wait_until_map_release(PersistState *self)
 {
+  gint old_value;
+
   g_mutex_lock(self->mapped_lock);
-  while (self->mapped_counter)
+
+  do
+    old_value = g_atomic_counter_get(&self->mapped_counter);
+  while (!g_atomic_counter_compare_and_exchange(&self->mapped_counter, old_value,
+                                                old_value | PERSIST_STATE_MAP_GROWING));
+
+  while (g_atomic_counter_get(&self->mapped_counter) != PERSIST_STATE_MAP_GROWING)
     g_cond_wait(self->mapped_release_cond, self->mapped_lock);
 }
 
+static void
+_allow_mappings(PersistState *self)
+{
+  g_atomic_counter_exchange_and_add(&self->mapped_counter, -PERSIST_STATE_MAP_GROWING);
+  g_cond_broadcast(self->mapped_release_cond);
+  g_mutex_unlock(self->mapped_lock);
+}
+
+static void
+_wait_until_grow_finished(PersistState *self)
+{
+  g_mutex_lock(self->mapped_lock);
+  while (g_atomic_counter_get(&self->mapped_counter) & PERSIST_STATE_MAP_GROWING)
+    g_cond_wait(self->mapped_release_cond, self->mapped_lock);
+  g_mutex_unlock(self->mapped_lock);
+}
+
 static gboolean
 _increase_file_size(PersistState *self, guint32 new_size)
 {
@@ -177,7 +207,7 @@ _grow_store(PersistState *self, guint32 new_size)
     }
   result = TRUE;
 exit:
-  g_mutex_unlock(self->mapped_lock);
+  _allow_mappings(self);
   return result;
 }
 
@@ -727,12 +757,23 @@ close_and_exit:
 gpointer
 persist_state_map_entry(PersistState *self, PersistEntryHandle handle)
 {
+  gint old_value;
+
   /* we count the number of mapped entries in order to know if we're
-   * safe to remap the file region */
+   * safe to remap the file region, this is a single compare-and-exchange
+   * unless the file is being grown */
   g_assert(handle);
-  g_mutex_lock(self->mapped_lock);
-  self->mapped_counter++;
-  g_mutex_unlock(self->mapped_lock);
+  while (TRUE)
+    {
+      old_value = g_atomic_counter_get(&self->mapped_counter);
+      if (G_UNLIKELY(old_value & PERSIST_STATE_MAP_GROWING))
+        {
+          _wait_until_grow_finished(self);
+          continue;
+        }
+      if (g_atomic_counter_compare_and_exchange(&self->mapped_counter, old_value, old_value + 1))
+        break;
+    }
   return (gpointer) (((gchar *) self->current_map) + (guint32) handle);
 }
 
@@ -742,14 +783,16 @@ persist_state_map_entry(PersistState *self, PersistEntryHandle handle)
 void
 persist_state_unmap_entry(PersistState *self, PersistEntryHandle handle)
 {
-  g_mutex_lock(self->mapped_lock);
-  g_assert(self->mapped_counter >= 1);
-  self->mapped_counter--;
-  if (self->mapped_counter == 0)
+  gint old_value = g_atomic_counter_exchange_and_add(&self->mapped_counter, -1);
+
+  g_assert((old_value & ~PERSIST_STATE_MAP_GROWING) >= 1);
+  if (G_UNLIKELY(old_value == (PERSIST_STATE_MAP_GROWING | 1)))
     {
-      g_cond_signal(self->mapped_release_cond);
+      /* the last mapping is gone, wake up _grow_store() */
+      g_mutex_lock(self->mapped_lock);
+      g_cond_broadcast(self->mapped_release_cond);
+      g_mutex_unlock(self->mapped_lock);
     }
-  g_mutex_unlock(self->mapped_lock);
 }
 
 static PersistValueHeader *
@@ -965,9 +1008,7 @@ persist_state_commit(PersistState *self)
 static void
 _destroy(PersistState *self)
 {
-  g_mutex_lock(self->mapped_lock);
-  g_assert(self->mapped_counter == 0);
-  g_mutex_unlock(self->mapped_lock);
+  g_assert(g_atomic_counter_get(&self->mapped_counter) == 0);
 
   if (self->fd >= 0)
     close(self->fd);
@@ -26,6 +26,7 @@
 #define PERSIST_STATE_H_INCLUDED
 
 #include "syslog-ng.h"
+#include "atomic.h"
 
 typedef struct _PersistFileHeader
 {
@@ -69,7 +70,9 @@ struct _PersistState
   gchar *committed_filename;
   gchar *temp_filename;
   gint fd;
-  gint mapped_counter;
+  /* number of live mappings, PERSIST_STATE_MAP_GROWING is set while the
+   * file is being remapped, mapped_lock is only taken if it is set */
+  GAtomicCounter mapped_counter;
   GMutex *mapped_lock;
   GCond *mapped_release_cond;
   guint32 current_size;
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "pipe-profiler.h"
+#include "cfg-tree.h"
+
+#include <string.h>
+
+/* the pipes with samples, protected by profiled_pipes_lock */
+G_LOCK_DEFINE_STATIC(profiled_pipes_lock);
+static GHashTable *profiled_pipes;
+
+typedef struct _PipeProfile
+{
+  gchar *location;
+  gchar *object;
+  const gchar *plugin_name;
+  guint64 calls;
+  guint64 total_nsec;
+  guint64 self_nsec;
+} PipeProfile;
+
+static void
+_pipe_profile_free(PipeProfile *self)
+{
+  g_free(self->location);
+  g_free(self->object);
+  g_free(self);
+}
+
+/* the innermost named config object the pipe belongs to, e.g. "filter f_error" */
+static gchar *
+_format_object(LogExprNode *node)
+{
+  for (; node; node = node->parent)
+    {
+      if (node->name)
+        return g_strdup_printf("%s %s", log_expr_node_get_content_name(node->content), node->name);
+    }
+  return g_strdup("");
+}
+
+static PipeProfile *
+_lookup_profile(GHashTable *profiles, LogPipe *pipe)
+{
+  gchar location[256];
+  gchar *key;
+  PipeProfile *profile;
+
+  if (pipe->expr_node)
+    log_expr_node_format_location(pipe->expr_node, location, sizeof(location));
+  else
+    g_strlcpy(location, "#unknown", sizeof(location));
+
+  /* clones of the same pipe share their location, the plugin name tells
+   * apart the pipes of drivers that are not tied to a location */
+  key = g_strdup_printf("%s;%s", location, pipe->plugin_name ? : "");
+  profile = g_hash_table_lookup(profiles, key);
+  if (!profile)
+    {
+      profile = g_new0(PipeProfile, 1);
+      profile->location = g_strdup(location);
+      profile->object = _format_object(pipe->expr_node);
+      profile->plugin_name = pipe->plugin_name;
+      g_hash_table_insert(profiles, key, profile);
+    }
+  else
+    {
+      g_free(key);
+    }
+  return profile;
+}
+
+static gint
+_compare_by_self_time(gconstpointer a, gconstpointer b)
+{
+  const PipeProfile *pa = *(const PipeProfile **) a;
+  const PipeProfile *pb = *(const PipeProfile **) b;
+
+  if (pa->self_nsec != pb->self_nsec)
+    return pa->self_nsec > pb->self_nsec ? -1 : 1;
+  return strcmp(pa->location, pb->location);
+}
+
+static void
+_append_profile(PipeProfile *self, GString *report)
+{
+  g_string_append_printf(report, "%s;%s;%s;%" G_GUINT64_FORMAT ";%" G_GUINT64_FORMAT ";%" G_GUINT64_FORMAT
+                         ";%" G_GUINT64_FORMAT "\n",
+                         self->location, self->object, self->plugin_name ? : "",
+                         self->calls, self->total_nsec / 1000, self->self_nsec / 1000,
+                         self->self_nsec / self->calls);
+}
+
+/* called from log_pipe_queue() by any thread, once per pipe */
+void
+pipe_profiler_register(LogPipe *pipe)
+{
+  G_LOCK(profiled_pipes_lock);
+  if (!pipe->profile.registered)
+    {
+      if (!profiled_pipes)
+        profiled_pipes = g_hash_table_new(g_direct_hash, g_direct_equal);
+      g_hash_table_add(profiled_pipes, pipe);
+      g_atomic_int_set(&pipe->profile.registered, TRUE);
+    }
+  G_UNLOCK(profiled_pipes_lock);
+}
+
+void
+pipe_profiler_unregister(LogPipe *pipe)
+{
+  G_LOCK(profiled_pipes_lock);
+  if (pipe->profile.registered)
+    {
+      g_hash_table_remove(profiled_pipes, pipe);
+      g_atomic_int_set(&pipe->profile.registered, FALSE);
+    }
+  G_UNLOCK(profiled_pipes_lock);
+}
+
+static void
+_reset_pipe(gpointer key, gpointer value, gpointer user_data)
+{
+  LogPipe *pipe = (LogPipe *) key;
+
+  atomic_gssize_set(&pipe->profile.calls, 0);
+  atomic_gssize_set(&pipe->profile.total_nsec, 0);
+  atomic_gssize_set(&pipe->profile.self_nsec, 0);
+}
+
+void
+pipe_profiler_reset(void)
+{
+  G_LOCK(profiled_pipes_lock);
+  if (profiled_pipes)
+    g_hash_table_foreach(profiled_pipes, _reset_pipe, NULL);
+  G_UNLOCK(profiled_pipes_lock);
+}
+
+typedef struct _PipeProfilerReport
+{
+  GHashTable *profiles;
+  GPtrArray *sorted;
+} PipeProfilerReport;
+
+static void
+_add_pipe_to_report(gpointer key, gpointer value, gpointer user_data)
+{
+  LogPipe *pipe = (LogPipe *) key;
+  PipeProfilerReport *report = (PipeProfilerReport *) user_data;
+  gsize calls = atomic_gssize_get_unsigned(&pipe->profile.calls);
+
+  if (calls == 0)
+    return;
+
+  PipeProfile *profile = _lookup_profile(report->profiles, pipe);
+  if (profile->calls == 0)
+    g_ptr_array_add(report->sorted, profile);
+  profile->calls += calls;
+  profile->total_nsec += atomic_gssize_get_unsigned(&pipe->profile.total_nsec);
+  profile->self_nsec += atomic_gssize_get_unsigned(&pipe->profile.self_nsec);
+}
+
+GString *
+pipe_profiler_format_report(void)
+{
+  GHashTable *profiles = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                               (GDestroyNotify) _pipe_profile_free);
+  GPtrArray *sorted = g_ptr_array_new();
+  GString *report = g_string_new("Location;Object;Plugin;Calls;TotalUsec;SelfUsec;SelfNsecPerCall\n");
+  PipeProfilerReport state = { profiles, sorted };
+
+  /* the lock keeps the pipes from being freed while they are read */
+  G_LOCK(profiled_pipes_lock);
+  if (profiled_pipes)
+    g_hash_table_foreach(profiled_pipes, _add_pipe_to_report, &state);
+  G_UNLOCK(profiled_pipes_lock);
+
+  g_ptr_array_sort(sorted, _compare_by_self_time);
+  g_ptr_array_foreach(sorted, (GFunc) _append_profile, report);
+
+  g_ptr_array_free(sorted, TRUE);
+  g_hash_table_destroy(profiles);
+  return report;
+}
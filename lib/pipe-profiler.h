@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef PIPE_PROFILER_H_INCLUDED
+#define PIPE_PROFILER_H_INCLUDED 1
+
+#include "logpipe.h"
+
+/* Pipe profiler
+ *
+ * While pipe_profiling_enabled is set, log_pipe_queue() counts the
+ * invocations of each LogPipe and the time spent in it, both including
+ * (total) and excluding (self) the pipes it forwarded the message to.
+ * When disabled, the only cost is a single branch in log_pipe_queue().
+ *
+ * A pipe is registered with the profiler when its first sample is taken
+ * and unregistered when it is freed, so pipes created at runtime (writers,
+ * file readers, threaded destination workers) are reported as well as the
+ * ones in the configuration tree.
+ *
+ * The report aggregates the pipes by their location in the configuration
+ * and sorts them by self time, so the most expensive filters, parsers and
+ * rewrite rules come first.
+ */
+void pipe_profiler_register(LogPipe *pipe);
+void pipe_profiler_unregister(LogPipe *pipe);
+
+void pipe_profiler_reset(void);
+GString *pipe_profiler_format_report(void);
+
+#endif
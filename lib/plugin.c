@@ -317,8 +317,8 @@ plugin_register(PluginContext *context, Plugin *p, gint number)
     }
 }
 
-Plugin *
-plugin_find(PluginContext *context, gint plugin_type, const gchar *plugin_name)
+static Plugin *
+_find_or_load_plugin(PluginContext *context, gint plugin_type, const gchar *plugin_name)
 {
   Plugin *p;
   PluginCandidate *candidate;
@@ -354,6 +354,24 @@ plugin_find(PluginContext *context, gint plugin_type, const gchar *plugin_name)
   return NULL;
 }
 
+/*
+ * Lookups may autoload a module and thus modify the plugin lists, and they
+ * can happen from the preload threads of cfg_tree_start() (e.g. when
+ * compiling template functions), so serialize them.
+ */
+static GStaticRecMutex plugin_find_lock = G_STATIC_REC_MUTEX_INIT;
+
+Plugin *
+plugin_find(PluginContext *context, gint plugin_type, const gchar *plugin_name)
+{
+  Plugin *p;
+
+  g_static_rec_mutex_lock(&plugin_find_lock);
+  p = _find_or_load_plugin(context, plugin_type, plugin_name);
+  g_static_rec_mutex_unlock(&plugin_find_lock);
+  return p;
+}
+
 gboolean
 plugin_load_module(PluginContext *context, const gchar *module_name, CfgArgs *args)
 {
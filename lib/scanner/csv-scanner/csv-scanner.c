@@ -176,6 +176,21 @@ _parse_left_whitespace(CSVScanner *self)
   _skip_whitespace(&self->src);
 }
 
+static void
+_parse_quoted_literal_characters(CSVScanner *self)
+{
+  const gchar stop_chars[] =
+  {
+    self->current_quote,
+    self->options->dialect == CSV_SCANNER_ESCAPE_BACKSLASH ? '\\' : 0,
+    0
+  };
+  const gchar *end = str_find_first_of(self->src, stop_chars);
+
+  g_string_append_len(self->current_value, self->src, end - self->src);
+  self->src = end;
+}
+
 static void
 _parse_character_with_quotation(CSVScanner *self)
 {
@@ -263,10 +278,14 @@ _parse_delimiter(CSVScanner *self)
 }
 
 static void
-_parse_unquoted_literal_character(CSVScanner *self)
+_parse_unquoted_literal_characters(CSVScanner *self)
 {
-  g_string_append_c(self->current_value, *self->src);
-  self->src++;
+  const gchar *end = self->src + 1;
+
+  if (self->delimiter_chars[0])
+    end = str_find_first_of(end, self->delimiter_chars);
+  g_string_append_len(self->current_value, self->src, end - self->src);
+  self->src = end;
 }
 
 static void
@@ -277,14 +296,16 @@ _parse_value_with_whitespace_and_delimiter(CSVScanner *self)
       if (self->current_quote)
         {
           /* within quotation marks */
-          _parse_character_with_quotation(self);
+          _parse_quoted_literal_characters(self);
+          if (*self->src)
+            _parse_character_with_quotation(self);
         }
       else
         {
           /* unquoted value */
           if (_parse_delimiter(self))
             break;
-          _parse_unquoted_literal_character(self);
+          _parse_unquoted_literal_characters(self);
         }
     }
 }
@@ -408,6 +429,35 @@ csv_scanner_is_scan_complete(CSVScanner *self)
   return self->state == CSV_STATE_FINISH;
 }
 
+static void
+_init_delimiter_chars(CSVScanner *self)
+{
+  gsize len = 0;
+  GList *l;
+
+  for (const gchar *d = self->options->delimiters; d && *d; d++)
+    {
+      if (len == sizeof(self->delimiter_chars) - 1)
+        goto disable;
+      self->delimiter_chars[len++] = *d;
+    }
+
+  for (l = self->options->string_delimiters; l; l = l->next)
+    {
+      const gchar *string_delimiter = l->data;
+
+      /* an empty string delimiter matches anywhere, we can't skip ahead */
+      if (!string_delimiter[0] || len == sizeof(self->delimiter_chars) - 1)
+        goto disable;
+      self->delimiter_chars[len++] = string_delimiter[0];
+    }
+  self->delimiter_chars[len] = 0;
+  return;
+
+disable:
+  self->delimiter_chars[0] = 0;
+}
+
 void
 csv_scanner_init(CSVScanner *scanner, CSVScannerOptions *options, const gchar *input)
 {
@@ -417,6 +467,7 @@ csv_scanner_init(CSVScanner *scanner, CSVScannerOptions *options, const gchar *i
   scanner->current_value = scratch_buffers_alloc();
   scanner->current_column = NULL;
   scanner->options = options;
+  _init_delimiter_chars(scanner);
 }
 
 void
@@ -79,6 +79,8 @@ typedef struct
   const gchar *src;
   GString *current_value;
   gchar current_quote;
+  /* characters that may start a delimiter, empty if not known */
+  gchar delimiter_chars[16];
 } CSVScanner;
 
 const gchar *csv_scanner_get_current_name(CSVScanner *pstate);
@@ -25,6 +25,8 @@
 #include "apphook.h"
 #include "csv-scanner.h"
 #include "string-list.h"
+#include "str-utils.h"
+#include "testutils.h"
 
 CSVScannerOptions options;
 CSVScanner scanner;
@@ -190,6 +192,128 @@ Test(csv_scanner, greedy_column)
   csv_scanner_deinit(&scanner);
 }
 
+Test(csv_scanner, long_values_spanning_multiple_vector_blocks)
+{
+  const gchar *columns[] = { "foo", "bar", "baz", NULL };
+
+  csv_scanner_init(&scanner, _default_options(columns),
+                   "unquoted value that is longer than thirty-two characters, so it spans blocks,"
+                   "\"quoted value with \"\"doubled\"\" quotes, commas and it is also quite long\","
+                   "'last'");
+
+  cr_expect(_scan_next());
+  cr_expect(_column_nv_equals("foo", "unquoted value that is longer than thirty-two characters"));
+  cr_expect(_scan_next());
+  cr_expect(_column_nv_equals("bar", "so it spans blocks"));
+  cr_expect(_scan_next());
+  cr_expect(_column_nv_equals("baz", "quoted value with \"doubled\" quotes, commas and it is also quite long"));
+  cr_expect(!_scan_next());
+  cr_expect(!_scan_complete());
+  csv_scanner_deinit(&scanner);
+}
+
+Test(csv_scanner, string_delimiters_are_found_after_long_runs)
+{
+  const gchar *columns[] = { "foo", "bar", "baz", NULL };
+  const gchar *string_delimiters[] = { "<=>", NULL };
+
+  _default_options(columns);
+  csv_scanner_options_set_string_delimiters(&options, string_array_to_list(string_delimiters));
+  csv_scanner_options_set_dialect(&options, CSV_SCANNER_ESCAPE_BACKSLASH);
+  csv_scanner_init(&scanner, &options,
+                   "a < b and b = c, but not <= or => in a value that is longer than a vector<=>"
+                   "\"escaped \\\" quote\"");
+
+  cr_expect(_scan_next());
+  cr_expect(_column_nv_equals("foo", "a < b and b = c"));
+  cr_expect(_scan_next());
+  cr_expect(_column_nv_equals("bar", "but not <= or => in a value that is longer than a vector"));
+  cr_expect(_scan_next());
+  cr_expect(_column_nv_equals("baz", "escaped \" quote"));
+  cr_expect(!_scan_next());
+  cr_expect(_scan_complete());
+  csv_scanner_deinit(&scanner);
+}
+
+static gchar *
+_scan_columns_to_string(const gchar *input)
+{
+  GString *result = g_string_new("");
+
+  csv_scanner_init(&scanner, &options, input);
+  while (_scan_next())
+    g_string_append_printf(result, "[%s/%s]", csv_scanner_get_current_name(&scanner),
+                           csv_scanner_get_current_value(&scanner));
+  g_string_append_printf(result, "[complete: %d]", _scan_complete());
+  csv_scanner_deinit(&scanner);
+  scratch_buffers_reclaim_allocations();
+  return g_string_free(result, FALSE);
+}
+
+static void
+_expect_same_columns_with_and_without_run_skipping(const gchar *input)
+{
+  gchar *skipping = _scan_columns_to_string(input);
+
+  str_find_first_of_disabled = TRUE;
+  gchar *char_by_char = _scan_columns_to_string(input);
+  str_find_first_of_disabled = FALSE;
+
+  cr_expect_str_eq(skipping, char_by_char, "csv-scanner output differs when skipping runs, input=%s", input);
+  g_free(skipping);
+  g_free(char_by_char);
+}
+
+static gchar *
+_random_input(GRand *rand, const gchar *alphabet)
+{
+  gint len = g_rand_int_range(rand, 0, 160);
+  gchar *input = g_malloc(len + 1);
+
+  for (gint i = 0; i < len; i++)
+    input[i] = alphabet[g_rand_int_range(rand, 0, strlen(alphabet))];
+  input[len] = 0;
+  return input;
+}
+
+static void
+_expect_same_columns_for_random_inputs(void)
+{
+  /* mostly ordinary characters, so there are long runs to skip */
+  const gchar *alphabet = "abcdefghijklmnop0123456789 ,;<=>\"'\\\t";
+  GRand *rand = g_rand_new_with_seed(38);
+
+  for (gint i = 0; i < 1000; i++)
+    {
+      gchar *input = _random_input(rand, alphabet);
+      gchar *input_at_page_end = str_at_page_end_new(input);
+
+      _expect_same_columns_with_and_without_run_skipping(input);
+      _expect_same_columns_with_and_without_run_skipping(input_at_page_end);
+
+      str_at_page_end_free(input_at_page_end);
+      g_free(input);
+    }
+  g_rand_free(rand);
+}
+
+Test(csv_scanner, run_skipping_does_not_change_the_output)
+{
+  const gchar *columns[] = { "foo", "bar", "baz", NULL };
+  const gchar *string_delimiters[] = { "<=>", NULL };
+
+  _default_options(columns);
+  _expect_same_columns_for_random_inputs();
+
+  csv_scanner_options_set_dialect(&options, CSV_SCANNER_ESCAPE_BACKSLASH);
+  csv_scanner_options_set_delimiters(&options, ",;");
+  _expect_same_columns_for_random_inputs();
+
+  csv_scanner_options_set_string_delimiters(&options, string_array_to_list(string_delimiters));
+  csv_scanner_options_set_flags(&options, CSV_SCANNER_GREEDY);
+  _expect_same_columns_for_random_inputs();
+}
+
 static void
 setup(void)
 {
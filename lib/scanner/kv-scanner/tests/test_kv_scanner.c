@@ -23,9 +23,11 @@
 #include <criterion/criterion.h>
 #include <stdio.h>
 #include "stopwatch.h"
+#include "testutils.h"
 #include "scratch-buffers.h"
 #include "apphook.h"
 #include "kv-scanner.h"
+#include "str-utils.h"
 
 static gboolean
 _expect_no_more_tokens(KVScanner *scanner, gchar **error)
@@ -452,6 +454,17 @@ Test(kv_scanner, quotes_embedded_in_an_unquoted_value_are_left_intact)
 
 }
 
+Test(kv_scanner, long_values_spanning_multiple_vector_blocks)
+{
+  _EXPECT_KV_PAIRS("msg=\"a quoted value with an \\\"embedded\\\" quote that is longer than thirty-two characters\" "
+                   "path=/an/unquoted/value/that/is/longer/than/thirty-two/characters,as/well "
+                   "words=several space separated words that do not look like keys, src=10.0.0.1",
+  { "msg", "a quoted value with an \"embedded\" quote that is longer than thirty-two characters" },
+  { "path", "/an/unquoted/value/that/is/longer/than/thirty-two/characters,as/well" },
+  { "words", "several space separated words that do not look like keys" },
+  { "src", "10.0.0.1" });
+}
+
 Test(kv_scanner, separator_in_an_unquoted_value_is_taken_literally)
 {
   _EXPECT_KV_PAIRS("k=a=b c=d",
@@ -802,6 +815,71 @@ Test(kv_scanner, key_buffer_underrun)
   _EXPECT_KV_PAIRS(input);
 }
 
+static gchar *
+_scan_kv_pairs_to_string(const gchar *input, const gchar *pair_separator)
+{
+  KVScanner scanner;
+  GString *result = g_string_new("");
+
+  kv_scanner_init(&scanner, '=', pair_separator, TRUE);
+  kv_scanner_input(&scanner, input);
+  while (kv_scanner_scan_next(&scanner))
+    g_string_append_printf(result, "[%s/%s/%d]", kv_scanner_get_current_key(&scanner),
+                           kv_scanner_get_current_value(&scanner), scanner.value_was_quoted);
+  g_string_append_printf(result, "[stray: %s]", kv_scanner_get_stray_words(&scanner));
+  kv_scanner_deinit(&scanner);
+  scratch_buffers_reclaim_allocations();
+  return g_string_free(result, FALSE);
+}
+
+static void
+_expect_same_kv_pairs_with_and_without_run_skipping(const gchar *input, const gchar *pair_separator)
+{
+  gchar *skipping = _scan_kv_pairs_to_string(input, pair_separator);
+
+  str_find_first_of_disabled = TRUE;
+  gchar *char_by_char = _scan_kv_pairs_to_string(input, pair_separator);
+  str_find_first_of_disabled = FALSE;
+
+  cr_expect_str_eq(skipping, char_by_char, "kv-scanner output differs when skipping runs, input=%s", input);
+  g_free(skipping);
+  g_free(char_by_char);
+}
+
+static gchar *
+_random_input(GRand *rand, const gchar *alphabet)
+{
+  gint len = g_rand_int_range(rand, 0, 160);
+  gchar *input = g_malloc(len + 1);
+
+  for (gint i = 0; i < len; i++)
+    input[i] = alphabet[g_rand_int_range(rand, 0, strlen(alphabet))];
+  input[len] = 0;
+  return input;
+}
+
+Test(kv_scanner, run_skipping_does_not_change_the_output)
+{
+  /* mostly ordinary characters, so there are long runs to skip */
+  const gchar *alphabet = "abcdefghijklmnop0123456789= ,;\"'\\\t";
+  GRand *rand = g_rand_new_with_seed(38);
+
+  for (gint i = 0; i < 2000; i++)
+    {
+      gchar *input = _random_input(rand, alphabet);
+      gchar *input_at_page_end = str_at_page_end_new(input);
+
+      _expect_same_kv_pairs_with_and_without_run_skipping(input, NULL);
+      _expect_same_kv_pairs_with_and_without_run_skipping(input, ";");
+      _expect_same_kv_pairs_with_and_without_run_skipping(input_at_page_end, NULL);
+      _expect_same_kv_pairs_with_and_without_run_skipping(input_at_page_end, ";");
+
+      str_at_page_end_free(input_at_page_end);
+      g_free(input);
+    }
+  g_rand_free(rand);
+}
+
 static Testcase *
 _provide_cases_for_performance_test_nothing_to_parse(void)
 {
@@ -966,6 +1044,28 @@ _provide_cases_for_performance_test_parse_long_msg(void)
   return g_memdup(tc, sizeof(tc));
 }
 
+static Testcase *
+_provide_cases_for_performance_test_parse_quoted_values(void)
+{
+  Testcase tc[] =
+  {
+    {
+      .input = "proto=\"TCP\" src=\"192.168.2.115\" \
+msg=\"a long quoted message field that spans multiple vector blocks, with a comma and an \\\"escaped\\\" quote\" \
+user='root' action=\"allowed by the default policy of the firewall\"",
+      .expected = INIT_KVCONTAINER(
+      {"proto", "TCP"},
+      {"src", "192.168.2.115"},
+      {"msg", "a long quoted message field that spans multiple vector blocks, with a comma and an \"escaped\" quote"},
+      {"user", "root"},
+      {"action", "allowed by the default policy of the firewall"},
+      ),
+    },
+    {}
+  };
+  return g_memdup(tc, sizeof(tc));
+}
+
 #define ITERATION_NUMBER 100000
 
 static void
@@ -1008,6 +1108,7 @@ Test(kv_scanner, performance_tests)
 {
   _test_performance(_provide_cases_for_performance_test_nothing_to_parse(), "Nothing to parse in the message");
   _test_performance(_provide_cases_for_performance_test_parse_long_msg(), "Parse long strings");
+  _test_performance(_provide_cases_for_performance_test_parse_quoted_values(), "Parse quoted values");
 }
 
 static void
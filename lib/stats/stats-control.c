@@ -25,6 +25,7 @@
 #include "stats/stats-control.h"
 #include "stats/stats-csv.h"
 #include "stats/stats-counter.h"
+#include "stats/stats-prometheus.h"
 #include "stats/stats-registry.h"
 #include "stats/stats-query-commands.h"
 #include "control/control-commands.h"
@@ -57,12 +58,16 @@ _reset_counters(void)
 {
   stats_lock();
   stats_foreach_counter(_reset_counter_if_needed, NULL);
+  stats_reset_latency_histograms();
   stats_unlock();
 }
 
 static GString *
 _send_stats_get_result(ControlConnection *cc, GString *command, gpointer user_data)
 {
+  if (g_str_equal(command->str, "STATS PROMETHEUS"))
+    return stats_prometheus_format();
+
   gchar *stats = stats_generate_csv();
   GString *response = g_string_new(stats);
   g_free(stats);
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "stats/stats-counter.h"
+#include "tls-support.h"
+
+TLS_BLOCK_START
+{
+  /* the shard index is shifted by one, to make 0 the unassigned state */
+  gint stats_counter_shard_index;
+}
+TLS_BLOCK_END;
+
+#define stats_counter_shard_index __tls_deref(stats_counter_shard_index)
+
+static gint stats_counter_next_shard_index;
+
+gint
+stats_counter_get_shard_index(void)
+{
+  if (G_UNLIKELY(!stats_counter_shard_index))
+    {
+      gint index_ = g_atomic_int_add(&stats_counter_next_shard_index, 1);
+      stats_counter_shard_index = (index_ % STATS_COUNTER_SHARDS) + 1;
+    }
+  return stats_counter_shard_index - 1;
+}
+
+/* NOTE: must be called with stats_lock() held, the counter stays sharded
+ * until it is freed.  Updates racing with this call may still end up in
+ * the embedded value, which is fine as reads sum up both. */
+void
+stats_counter_enable_sharding(StatsCounterItem *counter)
+{
+  g_assert(!counter->external);
+
+  if (counter->shards)
+    return;
+
+  StatsCounterShard *shards = g_new0(StatsCounterShard, STATS_COUNTER_SHARDS);
+  g_atomic_pointer_set(&counter->shards, shards);
+}
@@ -27,6 +27,25 @@
 #include "syslog-ng.h"
 #include "atomic-gssize.h"
 
+/* Sharded counters
+ *
+ * A counter that is updated by many threads at the same time makes the
+ * cache line holding it bounce between CPUs.  A counter can be switched to
+ * sharded mode with stats_counter_enable_sharding(), in which case updates
+ * go to a per-thread slot (each on its own cache line) and the slots are
+ * only summed up when the counter is read, e.g.  by stats-query or the CSV
+ * output.  Threads are assigned to slots in a round-robin fashion, so
+ * slots are only shared if there are more threads than slots.
+ */
+#define STATS_COUNTER_SHARDS           16
+#define STATS_COUNTER_CACHE_LINE_SIZE  64
+
+typedef struct _StatsCounterShard
+{
+  atomic_gssize value;
+  gchar __padding[STATS_COUNTER_CACHE_LINE_SIZE - sizeof(atomic_gssize)];
+} StatsCounterShard;
+
 typedef struct _StatsCounterItem
 {
   union
@@ -34,11 +53,14 @@ typedef struct _StatsCounterItem
     atomic_gssize value;
     atomic_gssize *value_ref;
   };
+  StatsCounterShard *shards;
   gchar *name;
   gint type;
   gboolean external;
 } StatsCounterItem;
 
+gint stats_counter_get_shard_index(void);
+void stats_counter_enable_sharding(StatsCounterItem *counter);
 
 static gboolean
 stats_counter_read_only(StatsCounterItem *counter)
@@ -46,13 +68,23 @@ stats_counter_read_only(StatsCounterItem *counter)
   return counter->external;
 }
 
+static inline atomic_gssize *
+stats_counter_get_writable_value(StatsCounterItem *counter)
+{
+  StatsCounterShard *shards = counter->shards;
+
+  if (shards)
+    return &shards[stats_counter_get_shard_index()].value;
+  return &counter->value;
+}
+
 static inline void
 stats_counter_add(StatsCounterItem *counter, gssize add)
 {
   if (counter)
     {
       g_assert(!stats_counter_read_only(counter));
-      atomic_gssize_add(&counter->value, add);
+      atomic_gssize_add(stats_counter_get_writable_value(counter), add);
     }
 }
 
@@ -62,7 +94,7 @@ stats_counter_sub(StatsCounterItem *counter, gssize sub)
   if (counter)
     {
       g_assert(!stats_counter_read_only(counter));
-      atomic_gssize_sub(&counter->value, sub);
+      atomic_gssize_sub(stats_counter_get_writable_value(counter), sub);
     }
 }
 
@@ -72,7 +104,7 @@ stats_counter_inc(StatsCounterItem *counter)
   if (counter)
     {
       g_assert(!stats_counter_read_only(counter));
-      atomic_gssize_inc(&counter->value);
+      atomic_gssize_inc(stats_counter_get_writable_value(counter));
     }
 }
 
@@ -82,7 +114,7 @@ stats_counter_dec(StatsCounterItem *counter)
   if (counter)
     {
       g_assert(!stats_counter_read_only(counter));
-      atomic_gssize_dec(&counter->value);
+      atomic_gssize_dec(stats_counter_get_writable_value(counter));
     }
 }
 
@@ -93,6 +125,11 @@ stats_counter_set(StatsCounterItem *counter, gsize value)
   if (counter && !stats_counter_read_only(counter))
     {
       atomic_gssize_racy_set(&counter->value, value);
+      if (counter->shards)
+        {
+          for (gint i = 0; i < STATS_COUNTER_SHARDS; i++)
+            atomic_gssize_racy_set(&counter->shards[i].value, 0);
+        }
     }
 }
 
@@ -108,6 +145,12 @@ stats_counter_get(StatsCounterItem *counter)
         result = atomic_gssize_get_unsigned(&counter->value);
       else
         result = atomic_gssize_get_unsigned(counter->value_ref);
+
+      if (counter->shards)
+        {
+          for (gint i = 0; i < STATS_COUNTER_SHARDS; i++)
+            result += atomic_gssize_get_unsigned(&counter->shards[i].value);
+        }
     }
   return result;
 }
@@ -124,6 +167,7 @@ static inline void
 stats_counter_free(StatsCounterItem *counter)
 {
   g_free(counter->name);
+  g_free(counter->shards);
 }
 
 #endif
@@ -93,6 +93,7 @@ stats_generate_csv(void)
   g_string_append_printf(csv, "%s;%s;%s;%s;%s;%s\n", "SourceName", "SourceId", "SourceInstance", "State", "Type",
                          "Number");
   stats_lock();
+  stats_publish_latency_histograms();
   stats_foreach_counter(stats_format_csv, csv);
   stats_unlock();
   return g_string_free(csv, FALSE);
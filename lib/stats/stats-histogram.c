@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "stats/stats-histogram.h"
+
+#include <string.h>
+
+/* the largest value counted in the bucket, used when reporting a
+ * percentile so that it is never underestimated */
+guint64
+stats_histogram_get_bucket_upper_bound(gint index)
+{
+  gint shift;
+  guint64 sub_bucket;
+
+  if (index < STATS_HISTOGRAM_SUB_BUCKETS)
+    return index;
+
+  shift = index / STATS_HISTOGRAM_SUB_BUCKETS - 1;
+  sub_bucket = index % STATS_HISTOGRAM_SUB_BUCKETS;
+  return ((STATS_HISTOGRAM_SUB_BUCKETS + sub_bucket + 1) << shift) - 1;
+}
+
+/* NOTE: values recorded concurrently may or may not be included */
+void
+stats_histogram_snapshot(StatsHistogram *self, StatsHistogramSnapshot *snapshot)
+{
+  memset(snapshot, 0, sizeof(*snapshot));
+
+  for (gint shard = 0; shard < STATS_HISTOGRAM_SHARDS; shard++)
+    {
+      StatsHistogramShard *s = &self->shards[shard];
+
+      snapshot->sum += atomic_gssize_get_unsigned(&s->sum);
+      for (gint i = 0; i < STATS_HISTOGRAM_BUCKETS; i++)
+        {
+          gsize value = atomic_gssize_get_unsigned(&s->buckets[i]);
+
+          snapshot->buckets[i] += value;
+          snapshot->count += value;
+        }
+    }
+}
+
+guint64
+stats_histogram_snapshot_get_percentile(StatsHistogramSnapshot *self, gdouble percentile)
+{
+  /* rank is calculated in integers, as rounding errors of 99.9 / 100 * count
+   * would push the rank into the next bucket */
+  guint64 parts_per_million = (guint64) (CLAMP(percentile, 0, 100) * 10000 + 0.5);
+  guint64 rank, cumulative = 0;
+
+  if (self->count == 0)
+    return 0;
+
+  rank = (parts_per_million * self->count + 999999) / 1000000;
+  rank = CLAMP(rank, 1, self->count);
+
+  for (gint i = 0; i < STATS_HISTOGRAM_BUCKETS; i++)
+    {
+      cumulative += self->buckets[i];
+      if (cumulative >= rank)
+        return stats_histogram_get_bucket_upper_bound(i);
+    }
+  return stats_histogram_get_bucket_upper_bound(STATS_HISTOGRAM_BUCKETS - 1);
+}
+
+guint64
+stats_histogram_snapshot_get_max(StatsHistogramSnapshot *self)
+{
+  for (gint i = STATS_HISTOGRAM_BUCKETS - 1; i >= 0; i--)
+    {
+      if (self->buckets[i])
+        return stats_histogram_get_bucket_upper_bound(i);
+    }
+  return 0;
+}
+
+/* NOTE: this is _not_ atomic, values recorded concurrently may be lost */
+void
+stats_histogram_reset(StatsHistogram *self)
+{
+  for (gint shard = 0; shard < STATS_HISTOGRAM_SHARDS; shard++)
+    {
+      StatsHistogramShard *s = &self->shards[shard];
+
+      atomic_gssize_racy_set(&s->sum, 0);
+      for (gint i = 0; i < STATS_HISTOGRAM_BUCKETS; i++)
+        atomic_gssize_racy_set(&s->buckets[i], 0);
+    }
+}
+
+StatsHistogram *
+stats_histogram_new(void)
+{
+  return g_new0(StatsHistogram, 1);
+}
+
+void
+stats_histogram_free(StatsHistogram *self)
+{
+  g_free(self);
+}
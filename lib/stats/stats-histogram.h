@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef STATS_HISTOGRAM_H_INCLUDED
+#define STATS_HISTOGRAM_H_INCLUDED 1
+
+#include "stats/stats-counter.h"
+
+/* Log-bucketed histograms
+ *
+ * Values (typically latencies in microseconds) are counted in buckets whose
+ * width grows with the magnitude of the value: every power of two range is
+ * split into STATS_HISTOGRAM_SUB_BUCKETS equal buckets, so the relative
+ * error of a reported percentile is at most 1/STATS_HISTOGRAM_SUB_BUCKETS,
+ * similar to HdrHistogram.  Values below STATS_HISTOGRAM_SUB_BUCKETS are
+ * counted exactly, values above 2^(STATS_HISTOGRAM_MAX_EXPONENT+1) end up
+ * in the last bucket.
+ *
+ * Recording a value is a single atomic increment on a per-thread shard
+ * (see the sharded counters in stats-counter.h), the shards are only merged
+ * when the histogram is read.
+ */
+#define STATS_HISTOGRAM_SUB_BUCKET_BITS 3
+#define STATS_HISTOGRAM_SUB_BUCKETS     (1 << STATS_HISTOGRAM_SUB_BUCKET_BITS)
+#define STATS_HISTOGRAM_MAX_EXPONENT    40
+#define STATS_HISTOGRAM_BUCKETS         ((STATS_HISTOGRAM_MAX_EXPONENT - STATS_HISTOGRAM_SUB_BUCKET_BITS + 2) * \
+                                         STATS_HISTOGRAM_SUB_BUCKETS)
+#define STATS_HISTOGRAM_SHARDS          4
+
+typedef struct _StatsHistogramShard
+{
+  atomic_gssize sum;
+  atomic_gssize buckets[STATS_HISTOGRAM_BUCKETS];
+  gchar __padding[STATS_COUNTER_CACHE_LINE_SIZE];
+} StatsHistogramShard;
+
+typedef struct _StatsHistogram
+{
+  StatsHistogramShard shards[STATS_HISTOGRAM_SHARDS];
+} StatsHistogram;
+
+typedef struct _StatsHistogramSnapshot
+{
+  guint64 buckets[STATS_HISTOGRAM_BUCKETS];
+  guint64 count;
+  guint64 sum;
+} StatsHistogramSnapshot;
+
+static inline gint
+stats_histogram_get_bucket_index(guint64 value)
+{
+  gint msb, shift;
+
+  if (value < STATS_HISTOGRAM_SUB_BUCKETS)
+    return value;
+
+  if (value >> (STATS_HISTOGRAM_MAX_EXPONENT + 1))
+    return STATS_HISTOGRAM_BUCKETS - 1;
+
+  msb = (value >> 32) ? g_bit_storage(value >> 32) + 31 : g_bit_storage(value) - 1;
+  shift = msb - STATS_HISTOGRAM_SUB_BUCKET_BITS;
+  return (shift + 1) * STATS_HISTOGRAM_SUB_BUCKETS + ((value >> shift) & (STATS_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+static inline void
+stats_histogram_record(StatsHistogram *self, guint64 value)
+{
+  StatsHistogramShard *shard = &self->shards[stats_counter_get_shard_index() % STATS_HISTOGRAM_SHARDS];
+
+  atomic_gssize_inc(&shard->buckets[stats_histogram_get_bucket_index(value)]);
+  atomic_gssize_add(&shard->sum, value);
+}
+
+guint64 stats_histogram_get_bucket_upper_bound(gint index);
+
+void stats_histogram_snapshot(StatsHistogram *self, StatsHistogramSnapshot *snapshot);
+guint64 stats_histogram_snapshot_get_percentile(StatsHistogramSnapshot *self, gdouble percentile);
+guint64 stats_histogram_snapshot_get_max(StatsHistogramSnapshot *self);
+
+void stats_histogram_reset(StatsHistogram *self);
+StatsHistogram *stats_histogram_new(void);
+void stats_histogram_free(StatsHistogram *self);
+
+#endif
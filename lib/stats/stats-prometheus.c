@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "stats/stats-prometheus.h"
+#include "stats/stats-registry.h"
+
+#include <string.h>
+
+#define STATS_PROMETHEUS_PREFIX "syslogng_"
+
+typedef struct _StatsPrometheusSample
+{
+  StatsCluster *sc;
+  gint type;
+  const gchar *family;
+  const gchar *header;
+  gchar *prefix;
+} StatsPrometheusSample;
+
+typedef struct _StatsPrometheusCluster
+{
+  StatsCluster *sc;
+  guint16 live_mask;
+} StatsPrometheusCluster;
+
+typedef struct _StatsPrometheusLayout
+{
+  GAtomicCounter ref_cnt;
+  guint generation;
+
+  /* StatsCluster pointers are only dereferenced with stats_lock() held
+   * and while the generation of the registry matches */
+  GArray *clusters;
+  GArray *samples;
+
+  /* metric family name -> "# TYPE" header */
+  GHashTable *families;
+} StatsPrometheusLayout;
+
+typedef struct _StatsPrometheusSnapshot
+{
+  GAtomicCounter ref_cnt;
+  StatsPrometheusLayout *layout;
+  gssize *values;
+  gboolean *alive;
+} StatsPrometheusSnapshot;
+
+static GStaticMutex snapshot_lock = G_STATIC_MUTEX_INIT;
+
+/* the snapshot readers are served from, protected by snapshot_lock */
+static StatsPrometheusSnapshot *current_snapshot;
+
+/* the other half of the double buffer, only accessed with stats_lock() held */
+static StatsPrometheusSnapshot *spare_snapshot;
+
+static StatsPrometheusLayout *current_layout;
+
+/* Layout */
+
+static gboolean
+_is_monotonic_counter(const gchar *type_name)
+{
+  static const gchar *monotonic_types[] =
+  {
+    "dropped", "processed", "suppressed", "discarded", "matched", "not_matched", "written", NULL
+  };
+
+  for (gint i = 0; monotonic_types[i]; i++)
+    {
+      if (strcmp(type_name, monotonic_types[i]) == 0)
+        return TRUE;
+    }
+  return FALSE;
+}
+
+static void
+_append_sanitized_name(GString *name, const gchar *value)
+{
+  for (const gchar *p = value; *p; p++)
+    g_string_append_c(name, g_ascii_isalnum(*p) ? *p : '_');
+}
+
+static void
+_append_label(GString *labels, const gchar *name, const gchar *value)
+{
+  if (!value || !value[0])
+    return;
+
+  if (labels->len)
+    g_string_append_c(labels, ',');
+  g_string_append_printf(labels, "%s=\"", name);
+  for (const gchar *p = value; *p; p++)
+    {
+      switch (*p)
+        {
+        case '\\':
+          g_string_append(labels, "\\\\");
+          break;
+        case '"':
+          g_string_append(labels, "\\\"");
+          break;
+        case '\n':
+          g_string_append(labels, "\\n");
+          break;
+        default:
+          g_string_append_c(labels, *p);
+          break;
+        }
+    }
+  g_string_append_c(labels, '"');
+}
+
+static gchar *
+_format_labels(StatsCluster *sc)
+{
+  GString *labels = g_string_new("");
+  gchar buf[64];
+  guint16 component = sc->key.component;
+  guint16 source = component & SCS_SOURCE_MASK;
+
+  _append_label(labels, "component", stats_cluster_get_component_name(sc, buf, sizeof(buf)));
+
+  if (component & SCS_SOURCE)
+    _append_label(labels, "source", sc->key.id);
+  else if (component & SCS_DESTINATION)
+    _append_label(labels, "destination", sc->key.id);
+  else
+    _append_label(labels, "id", sc->key.id);
+
+  if (source == SCS_HOST || source == SCS_SENDER)
+    _append_label(labels, "host", sc->key.instance);
+  else
+    _append_label(labels, "instance", sc->key.instance);
+
+  return g_string_free(labels, FALSE);
+}
+
+static const gchar *
+_intern_family(StatsPrometheusLayout *self, const gchar *type_name, gboolean monotonic)
+{
+  GString *family = g_string_new(STATS_PROMETHEUS_PREFIX);
+  gpointer orig_key, header;
+
+  _append_sanitized_name(family, type_name);
+  if (g_hash_table_lookup_extended(self->families, family->str, &orig_key, &header))
+    {
+      g_string_free(family, TRUE);
+      return orig_key;
+    }
+
+  header = g_strdup_printf("# TYPE %s %s\n", family->str, monotonic ? "counter" : "gauge");
+  g_hash_table_insert(self->families, family->str, header);
+  return g_string_free(family, FALSE);
+}
+
+static void
+_add_cluster_to_layout(StatsCluster *sc, gpointer user_data)
+{
+  StatsPrometheusLayout *self = (StatsPrometheusLayout *) user_data;
+  StatsPrometheusCluster cluster = { sc, sc->live_mask };
+  gchar *labels = NULL;
+
+  g_array_append_val(self->clusters, cluster);
+
+  for (gint type = 0; type < sc->counter_group.capacity; type++)
+    {
+      if (!stats_cluster_is_alive(sc, type))
+        continue;
+
+      const gchar *type_name = stats_cluster_get_type_name(sc, type);
+      gboolean monotonic = _is_monotonic_counter(type_name);
+      StatsPrometheusSample sample = { sc, type };
+
+      if (!labels)
+        labels = _format_labels(sc);
+
+      sample.family = _intern_family(self, type_name, monotonic);
+      sample.header = g_hash_table_lookup(self->families, sample.family);
+      sample.prefix = g_strdup_printf("%s%s{%s} ", sample.family, monotonic ? "_total" : "", labels);
+      g_array_append_val(self->samples, sample);
+    }
+  g_free(labels);
+}
+
+static gint
+_compare_samples(gconstpointer a, gconstpointer b)
+{
+  const StatsPrometheusSample *sa = (const StatsPrometheusSample *) a;
+  const StatsPrometheusSample *sb = (const StatsPrometheusSample *) b;
+
+  /* samples of the same metric family have to be grouped together */
+  gint result = strcmp(sa->family, sb->family);
+  if (result)
+    return result;
+  return strcmp(sa->prefix, sb->prefix);
+}
+
+static StatsPrometheusLayout *
+_layout_new(void)
+{
+  StatsPrometheusLayout *self = g_new0(StatsPrometheusLayout, 1);
+
+  g_atomic_counter_set(&self->ref_cnt, 1);
+  self->generation = stats_registry_get_generation();
+  self->clusters = g_array_new(FALSE, FALSE, sizeof(StatsPrometheusCluster));
+  self->samples = g_array_new(FALSE, FALSE, sizeof(StatsPrometheusSample));
+  self->families = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+  stats_foreach_cluster(_add_cluster_to_layout, self);
+  g_array_sort(self->samples, _compare_samples);
+  return self;
+}
+
+static StatsPrometheusLayout *
+_layout_ref(StatsPrometheusLayout *self)
+{
+  g_atomic_counter_inc(&self->ref_cnt);
+  return self;
+}
+
+static void
+_layout_unref(StatsPrometheusLayout *self)
+{
+  if (!self || !g_atomic_counter_dec_and_test(&self->ref_cnt))
+    return;
+
+  for (gint i = 0; i < self->samples->len; i++)
+    g_free(g_array_index(self->samples, StatsPrometheusSample, i).prefix);
+  g_array_free(self->samples, TRUE);
+  g_array_free(self->clusters, TRUE);
+  g_hash_table_destroy(self->families);
+  g_free(self);
+}
+
+/* counters registered into existing clusters do not change the generation */
+static gboolean
+_layout_is_current(StatsPrometheusLayout *self)
+{
+  if (self->generation != stats_registry_get_generation())
+    return FALSE;
+
+  for (gint i = 0; i < self->clusters->len; i++)
+    {
+      StatsPrometheusCluster *cluster = &g_array_index(self->clusters, StatsPrometheusCluster, i);
+
+      if (cluster->sc->live_mask & ~cluster->live_mask)
+        return FALSE;
+    }
+  return TRUE;
+}
+
+/* Snapshot */
+
+static StatsPrometheusSnapshot *
+_snapshot_new(StatsPrometheusLayout *layout)
+{
+  StatsPrometheusSnapshot *self = g_new0(StatsPrometheusSnapshot, 1);
+
+  g_atomic_counter_set(&self->ref_cnt, 1);
+  self->layout = _layout_ref(layout);
+  self->values = g_new0(gssize, layout->samples->len);
+  self->alive = g_new0(gboolean, layout->samples->len);
+  return self;
+}
+
+static StatsPrometheusSnapshot *
+_snapshot_ref(StatsPrometheusSnapshot *self)
+{
+  g_atomic_counter_inc(&self->ref_cnt);
+  return self;
+}
+
+static void
+_snapshot_unref(StatsPrometheusSnapshot *self)
+{
+  if (!self || !g_atomic_counter_dec_and_test(&self->ref_cnt))
+    return;
+
+  _layout_unref(self->layout);
+  g_free(self->values);
+  g_free(self->alive);
+  g_free(self);
+}
+
+/* the spare buffer can be reused if no reader holds it anymore */
+static StatsPrometheusSnapshot *
+_grab_spare_snapshot(StatsPrometheusLayout *layout)
+{
+  StatsPrometheusSnapshot *snapshot = spare_snapshot;
+
+  spare_snapshot = NULL;
+  if (snapshot && snapshot->layout == layout && g_atomic_counter_get(&snapshot->ref_cnt) == 1)
+    return snapshot;
+
+  _snapshot_unref(snapshot);
+  return _snapshot_new(layout);
+}
+
+static void
+_copy_values(StatsPrometheusSnapshot *self)
+{
+  GArray *samples = self->layout->samples;
+
+  for (gint i = 0; i < samples->len; i++)
+    {
+      StatsPrometheusSample *sample = &g_array_index(samples, StatsPrometheusSample, i);
+
+      self->alive[i] = stats_cluster_is_alive(sample->sc, sample->type);
+      if (self->alive[i])
+        self->values[i] = stats_counter_get(&sample->sc->counter_group.counters[sample->type]);
+    }
+}
+
+void
+stats_prometheus_refresh_snapshot(void)
+{
+  StatsPrometheusSnapshot *snapshot, *previous;
+
+  stats_lock();
+  stats_publish_latency_histograms();
+
+  if (!current_layout || !_layout_is_current(current_layout))
+    {
+      _layout_unref(current_layout);
+      current_layout = _layout_new();
+    }
+
+  snapshot = _grab_spare_snapshot(current_layout);
+  _copy_values(snapshot);
+
+  g_static_mutex_lock(&snapshot_lock);
+  previous = current_snapshot;
+  current_snapshot = snapshot;
+  g_static_mutex_unlock(&snapshot_lock);
+
+  spare_snapshot = previous;
+  stats_unlock();
+}
+
+static StatsPrometheusSnapshot *
+_get_current_snapshot(void)
+{
+  StatsPrometheusSnapshot *snapshot = NULL;
+
+  g_static_mutex_lock(&snapshot_lock);
+  if (current_snapshot)
+    snapshot = _snapshot_ref(current_snapshot);
+  g_static_mutex_unlock(&snapshot_lock);
+  return snapshot;
+}
+
+/* Rendering, does not need stats_lock() */
+
+GString *
+stats_prometheus_format(void)
+{
+  StatsPrometheusSnapshot *snapshot = NULL;
+  GString *result = g_string_sized_new(4096);
+
+  if (stats_check_periodic_snapshot())
+    snapshot = _get_current_snapshot();
+
+  if (!snapshot)
+    {
+      stats_prometheus_refresh_snapshot();
+      snapshot = _get_current_snapshot();
+    }
+
+  if (snapshot)
+    {
+      GArray *samples = snapshot->layout->samples;
+      const gchar *last_family = NULL;
+
+      for (gint i = 0; i < samples->len; i++)
+        {
+          StatsPrometheusSample *sample = &g_array_index(samples, StatsPrometheusSample, i);
+
+          if (!snapshot->alive[i])
+            continue;
+
+          if (sample->family != last_family)
+            {
+              g_string_append(result, sample->header);
+              last_family = sample->family;
+            }
+          g_string_append(result, sample->prefix);
+          g_string_append_printf(result, "%" G_GSSIZE_FORMAT "\n", snapshot->values[i]);
+        }
+      _snapshot_unref(snapshot);
+    }
+
+  g_string_append(result, "# EOF\n");
+  return result;
+}
+
+void
+stats_prometheus_init(void)
+{
+  g_static_mutex_init(&snapshot_lock);
+}
+
+void
+stats_prometheus_deinit(void)
+{
+  _snapshot_unref(current_snapshot);
+  _snapshot_unref(spare_snapshot);
+  _layout_unref(current_layout);
+  current_snapshot = NULL;
+  spare_snapshot = NULL;
+  current_layout = NULL;
+  g_static_mutex_free(&snapshot_lock);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef STATS_PROMETHEUS_H_INCLUDED
+#define STATS_PROMETHEUS_H_INCLUDED 1
+
+#include "syslog-ng.h"
+
+/* Prometheus/OpenMetrics exposition of the counters
+ *
+ * Walking the registry and formatting every counter under stats_lock() is
+ * expensive with a lot of (dynamic) counters and blocks the registration
+ * of new ones.  Instead, the counter values are copied into a snapshot,
+ * which is then rendered without holding stats_lock().
+ *
+ * The snapshot refers to a layout, which contains the cluster/type pairs to
+ * copy and the pre-formatted metric name and labels of each sample.  The
+ * layout is only rebuilt if clusters were added or removed, so refreshing a
+ * snapshot is a copy of the values.  Snapshots are double-buffered: a
+ * refresh fills the buffer that is not in use by readers and then swaps
+ * it in.
+ *
+ * Snapshots are refreshed periodically if stats-snapshot-freq() is set,
+ * otherwise on demand whenever the metrics are requested.
+ */
+void stats_prometheus_refresh_snapshot(void);
+GString *stats_prometheus_format(void);
+
+void stats_prometheus_init(void);
+void stats_prometheus_deinit(void);
+
+#endif
@@ -256,9 +256,20 @@ _get_aggregated_counters(const gchar *filter)
   return counters;
 }
 
+/* latency histograms are merged into their counters on demand */
+static void
+_publish_latency_histograms(void)
+{
+  stats_lock();
+  stats_publish_latency_histograms();
+  stats_unlock();
+}
+
 static GList *
 _get_counters(const gchar *key_str)
 {
+  _publish_latency_histograms();
+
   GList *simple_counters = _query_counter_hash(key_str);
   GList *aggregated_counters = _get_aggregated_counters(key_str);
 
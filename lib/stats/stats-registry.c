@@ -23,6 +23,7 @@
  */
 #include "stats/stats-registry.h"
 #include "stats/stats-query.h"
+#include "stats/stats-cluster-single.h"
 #include "cfg.h"
 #include <string.h>
 
@@ -30,10 +31,16 @@ typedef struct _StatsClusterContainer
 {
   GHashTable *static_clusters;
   GHashTable *dynamic_clusters;
+
+  /* StatsCluster of the first counter -> StatsLatencyHistogram */
+  GHashTable *latency_histograms;
 } StatsClusterContainer;
 
 static StatsClusterContainer stats_cluster_container;
 
+/* changes whenever a cluster is added or removed, see stats_registry_get_generation() */
+static guint stats_registry_generation;
+
 static guint
 _number_of_dynamic_clusters(void)
 {
@@ -46,6 +53,7 @@ gboolean stats_locked;
 static void
 _insert_cluster(StatsCluster *sc)
 {
+  stats_registry_generation++;
   if (sc->dynamic)
     g_hash_table_insert(stats_cluster_container.dynamic_clusters, &sc->key, sc);
   else
@@ -210,6 +218,33 @@ stats_register_counter(gint stats_level, const StatsClusterKey *sc_key, gint typ
   return _register_counter(stats_level, sc_key, type, FALSE, counter);
 }
 
+/* Registers a counter just like stats_register_counter(), but switches it to
+ * sharded mode, see stats-counter.h.  Use it for counters that are updated
+ * from many threads concurrently. */
+StatsCluster *
+stats_register_sharded_counter(gint stats_level, const StatsClusterKey *sc_key, gint type,
+                               StatsCounterItem **counter)
+{
+  StatsCluster *sc = _register_counter(stats_level, sc_key, type, FALSE, counter);
+
+  if (*counter && !(*counter)->external)
+    stats_counter_enable_sharding(*counter);
+  return sc;
+}
+
+/* Registers a counter that sits on a hot path (e.g. processed/dropped
+ * counters of sources, destinations and queues).  It is sharded only if
+ * the global stats-sharded-counters() option is enabled, otherwise this
+ * is the same as stats_register_counter(). */
+StatsCluster *
+stats_register_contended_counter(gint stats_level, const StatsClusterKey *sc_key, gint type,
+                                 StatsCounterItem **counter)
+{
+  if (stats_check_sharded_counters())
+    return stats_register_sharded_counter(stats_level, sc_key, type, counter);
+  return stats_register_counter(stats_level, sc_key, type, counter);
+}
+
 StatsCluster *
 stats_register_external_counter(gint stats_level, const StatsClusterKey *sc_key, gint type,
                                 atomic_gssize *external_counter)
@@ -220,6 +255,8 @@ stats_register_external_counter(gint stats_level, const StatsClusterKey *sc_key,
 StatsCluster *
 stats_register_alias_counter(gint level, const StatsClusterKey *sc_key, gint type, StatsCounterItem *aliased_counter)
 {
+  /* an alias only refers to the embedded value, which is partial for sharded counters */
+  g_assert(!aliased_counter->shards);
   return stats_register_external_counter(level, sc_key, type, &aliased_counter->value);
 }
 
@@ -349,6 +386,154 @@ _lookup_cluster(const StatsClusterKey *sc_key)
   return sc;
 }
 
+/* Latency histograms
+ *
+ * A latency histogram is published as a set of single-value counters next
+ * to the counters of its owner, which are updated from the histogram
+ * whenever the counters are queried, see stats_publish_latency_histograms().
+ * Unlike counters, histograms are too large to be kept around for owners
+ * that come and go (e.g.  the files of a templated file() destination), so
+ * a histogram is freed when its last owner unregisters it and starts out
+ * empty when it is registered again (e.g.  after a reload).  The published
+ * counters keep their last values.
+ */
+enum
+{
+  SC_LATENCY_COUNT,
+  SC_LATENCY_MEAN,
+  SC_LATENCY_P50,
+  SC_LATENCY_P90,
+  SC_LATENCY_P99,
+  SC_LATENCY_P999,
+  SC_LATENCY_MAX,
+  SC_LATENCY_COUNTERS_MAX
+};
+
+static const gchar *latency_counter_names[SC_LATENCY_COUNTERS_MAX] =
+{
+  "latency_count",
+  "latency_mean_usec",
+  "latency_p50_usec",
+  "latency_p90_usec",
+  "latency_p99_usec",
+  "latency_p999_usec",
+  "latency_max_usec",
+};
+
+typedef struct _StatsLatencyHistogram
+{
+  StatsHistogram *histogram;
+  StatsCounterItem *counters[SC_LATENCY_COUNTERS_MAX];
+} StatsLatencyHistogram;
+
+static void
+_latency_histogram_free(StatsLatencyHistogram *self)
+{
+  stats_histogram_free(self->histogram);
+  g_free(self);
+}
+
+StatsHistogram *
+stats_register_latency_histogram(gint stats_level, guint16 component, const gchar *id, const gchar *instance)
+{
+  StatsCounterItem *counters[SC_LATENCY_COUNTERS_MAX];
+  StatsCluster *handle = NULL;
+  StatsClusterKey sc_key;
+
+  g_assert(stats_locked);
+
+  for (gint i = 0; i < SC_LATENCY_COUNTERS_MAX; i++)
+    {
+      stats_cluster_single_key_set_with_name(&sc_key, component, id, instance, latency_counter_names[i]);
+      StatsCluster *sc = stats_register_counter(stats_level, &sc_key, SC_TYPE_SINGLE_VALUE, &counters[i]);
+
+      /* all counters share the same level, either all or none of them are registered */
+      if (!sc)
+        return NULL;
+      if (!handle)
+        handle = sc;
+    }
+
+  StatsLatencyHistogram *latency = g_hash_table_lookup(stats_cluster_container.latency_histograms, handle);
+  if (!latency)
+    {
+      latency = g_new0(StatsLatencyHistogram, 1);
+      latency->histogram = stats_histogram_new();
+      memcpy(latency->counters, counters, sizeof(counters));
+      g_hash_table_insert(stats_cluster_container.latency_histograms, handle, latency);
+    }
+  return latency->histogram;
+}
+
+void
+stats_unregister_latency_histogram(guint16 component, const gchar *id, const gchar *instance,
+                                   StatsHistogram **histogram)
+{
+  StatsCluster *handle = NULL;
+  StatsClusterKey sc_key;
+
+  g_assert(stats_locked);
+
+  if (!*histogram)
+    return;
+
+  for (gint i = 0; i < SC_LATENCY_COUNTERS_MAX; i++)
+    {
+      stats_cluster_single_key_set_with_name(&sc_key, component, id, instance, latency_counter_names[i]);
+      if (!handle)
+        handle = _lookup_cluster(&sc_key);
+      StatsCounterItem *counter = stats_get_counter(&sc_key, SC_TYPE_SINGLE_VALUE);
+      stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &counter);
+    }
+
+  if (handle && handle->use_count == 0)
+    g_hash_table_remove(stats_cluster_container.latency_histograms, handle);
+  *histogram = NULL;
+}
+
+static void
+_publish_latency_histogram(gpointer key, gpointer value, gpointer user_data)
+{
+  StatsLatencyHistogram *latency = (StatsLatencyHistogram *) value;
+  StatsHistogramSnapshot *snapshot = (StatsHistogramSnapshot *) user_data;
+
+  stats_histogram_snapshot(latency->histogram, snapshot);
+  stats_counter_set(latency->counters[SC_LATENCY_COUNT], snapshot->count);
+  stats_counter_set(latency->counters[SC_LATENCY_MEAN], snapshot->count ? snapshot->sum / snapshot->count : 0);
+  stats_counter_set(latency->counters[SC_LATENCY_P50], stats_histogram_snapshot_get_percentile(snapshot, 50));
+  stats_counter_set(latency->counters[SC_LATENCY_P90], stats_histogram_snapshot_get_percentile(snapshot, 90));
+  stats_counter_set(latency->counters[SC_LATENCY_P99], stats_histogram_snapshot_get_percentile(snapshot, 99));
+  stats_counter_set(latency->counters[SC_LATENCY_P999], stats_histogram_snapshot_get_percentile(snapshot, 99.9));
+  stats_counter_set(latency->counters[SC_LATENCY_MAX], stats_histogram_snapshot_get_max(snapshot));
+}
+
+/* merges the shards of the latency histograms and updates their counters,
+ * to be called before the counters are read */
+void
+stats_publish_latency_histograms(void)
+{
+  StatsHistogramSnapshot *snapshot = g_new(StatsHistogramSnapshot, 1);
+
+  g_assert(stats_locked);
+  g_hash_table_foreach(stats_cluster_container.latency_histograms, _publish_latency_histogram, snapshot);
+  g_free(snapshot);
+}
+
+static void
+_reset_latency_histogram(gpointer key, gpointer value, gpointer user_data)
+{
+  StatsLatencyHistogram *latency = (StatsLatencyHistogram *) value;
+
+  stats_histogram_reset(latency->histogram);
+}
+
+void
+stats_reset_latency_histograms(void)
+{
+  g_assert(stats_locked);
+  g_hash_table_foreach(stats_cluster_container.latency_histograms, _reset_latency_histogram, NULL);
+}
+
 gboolean
 stats_contains_counter(const StatsClusterKey *sc_key, gint type)
 {
@@ -404,7 +589,11 @@ _foreach_cluster_remove_helper(gpointer key, gpointer value, gpointer user_data)
   gpointer func_data = args[1];
   StatsCluster *sc = (StatsCluster *) value;
 
-  return func(sc, func_data);
+  if (!func(sc, func_data))
+    return FALSE;
+
+  stats_registry_generation++;
+  return TRUE;
 }
 
 void
@@ -443,17 +632,32 @@ stats_registry_init(void)
   stats_cluster_container.dynamic_clusters = g_hash_table_new_full((GHashFunc) stats_cluster_hash,
                                              (GEqualFunc) stats_cluster_equal, NULL,
                                              (GDestroyNotify) stats_cluster_free);
+  stats_cluster_container.latency_histograms = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                               (GDestroyNotify) _latency_histogram_free);
 
   g_static_mutex_init(&stats_mutex);
+  stats_registry_generation++;
+}
+
+/* cached views of the registry (e.g. stats snapshots) may keep pointers to
+ * clusters as long as the generation does not change */
+guint
+stats_registry_get_generation(void)
+{
+  g_assert(stats_locked);
+  return stats_registry_generation;
 }
 
 void
 stats_registry_deinit(void)
 {
+  g_hash_table_destroy(stats_cluster_container.latency_histograms);
   g_hash_table_destroy(stats_cluster_container.static_clusters);
   g_hash_table_destroy(stats_cluster_container.dynamic_clusters);
   stats_cluster_container.static_clusters = NULL;
   stats_cluster_container.dynamic_clusters = NULL;
+  stats_cluster_container.latency_histograms = NULL;
+  stats_registry_generation++;
   g_static_mutex_free(&stats_mutex);
 }
 
@@ -26,6 +26,7 @@
 
 #include "stats/stats.h"
 #include "stats/stats-cluster.h"
+#include "stats/stats-histogram.h"
 
 typedef void (*StatsForeachClusterFunc)(StatsCluster *sc, gpointer user_data);
 typedef gboolean (*StatsForeachClusterRemoveFunc)(StatsCluster *sc, gpointer user_data);
@@ -34,6 +35,10 @@ void stats_lock(void);
 void stats_unlock(void);
 gboolean stats_check_level(gint level);
 StatsCluster *stats_register_counter(gint level, const StatsClusterKey *sc_key, gint type, StatsCounterItem **counter);
+StatsCluster *stats_register_sharded_counter(gint level, const StatsClusterKey *sc_key, gint type,
+                                             StatsCounterItem **counter);
+StatsCluster *stats_register_contended_counter(gint level, const StatsClusterKey *sc_key, gint type,
+                                               StatsCounterItem **counter);
 
 StatsCluster *stats_register_external_counter(gint level, const StatsClusterKey *sc_key, gint type,
                                               atomic_gssize *external_counter);
@@ -53,6 +58,13 @@ void stats_unregister_external_counter(const StatsClusterKey *sc_key, gint type,
 void stats_unregister_alias_counter(const StatsClusterKey *sc_key, gint type, StatsCounterItem *aliased_counter);
 void stats_unregister_dynamic_counter(StatsCluster *handle, gint type, StatsCounterItem **counter);
 
+StatsHistogram *stats_register_latency_histogram(gint stats_level, guint16 component, const gchar *id,
+                                                 const gchar *instance);
+void stats_unregister_latency_histogram(guint16 component, const gchar *id, const gchar *instance,
+                                        StatsHistogram **histogram);
+void stats_publish_latency_histograms(void);
+void stats_reset_latency_histograms(void);
+
 gboolean stats_contains_counter(const StatsClusterKey *sc_key, gint type);
 StatsCounterItem *stats_get_counter(const StatsClusterKey *sc_key, gint type);
 
@@ -62,8 +74,11 @@ void stats_foreach_cluster_remove(StatsForeachClusterRemoveFunc func, gpointer u
 
 void stats_registry_init(void);
 void stats_registry_deinit(void);
+guint stats_registry_get_generation(void);
 
 gboolean stats_check_dynamic_clusters_limit(guint number_of_clusters);
 gint stats_number_of_dynamic_clusters_limit(void);
+gboolean stats_check_sharded_counters(void);
+gboolean stats_check_periodic_snapshot(void);
 
 #endif
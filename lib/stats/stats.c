@@ -24,6 +24,7 @@
 
 #include "stats/stats-control.h"
 #include "stats/stats-log.h"
+#include "stats/stats-prometheus.h"
 #include "stats/stats-query.h"
 #include "stats/stats-registry.h"
 #include "stats/stats.h"
@@ -157,6 +158,8 @@ stats_publish_and_prune_counters(StatsOptions *options)
     st.stats_event = msg_event_create(EVT_PRI_INFO, "Log statistics", NULL);
 
   stats_lock();
+  if (publish)
+    stats_publish_latency_histograms();
   stats_foreach_cluster_remove(stats_format_and_prune_cluster, &st);
   stats_unlock();
 
@@ -225,6 +228,39 @@ stats_timer_reinit(StatsOptions *options)
   stats_timer_rearm(options, &stats_timer);
 }
 
+static struct iv_timer stats_snapshot_timer;
+
+static void
+stats_snapshot_timer_rearm(StatsOptions *options)
+{
+  if (options->snapshot_freq > 0)
+    {
+      iv_validate_now();
+      stats_snapshot_timer.expires = iv_now;
+      timespec_add_msec(&stats_snapshot_timer.expires, options->snapshot_freq * 1000);
+      iv_timer_register(&stats_snapshot_timer);
+    }
+}
+
+static void
+stats_snapshot_timer_elapsed(gpointer st)
+{
+  StatsOptions *options = (StatsOptions *) st;
+
+  stats_prometheus_refresh_snapshot();
+  stats_snapshot_timer_rearm(options);
+}
+
+static void
+stats_snapshot_timer_reinit(StatsOptions *options)
+{
+  stats_timer_kill(&stats_snapshot_timer);
+  stats_timer_init(&stats_snapshot_timer, stats_snapshot_timer_elapsed, options);
+  if (options->snapshot_freq > 0)
+    stats_prometheus_refresh_snapshot();
+  stats_snapshot_timer_rearm(options);
+}
+
 static StatsOptions *stats_options;
 
 void
@@ -232,6 +268,7 @@ stats_reinit(StatsOptions *options)
 {
   stats_options = options;
   stats_timer_reinit(options);
+  stats_snapshot_timer_reinit(options);
 }
 
 void
@@ -240,11 +277,13 @@ stats_init(void)
   stats_cluster_init();
   stats_registry_init();
   stats_query_init();
+  stats_prometheus_init();
 }
 
 void
 stats_destroy(void)
 {
+  stats_prometheus_deinit();
   stats_query_deinit();
   stats_registry_deinit();
   stats_cluster_deinit();
@@ -257,6 +296,8 @@ stats_options_defaults(StatsOptions *options)
   options->log_freq = 600;
   options->lifetime = 600;
   options->max_dynamic = -1;
+  options->sharded_counters = FALSE;
+  options->snapshot_freq = 0;
 }
 
 gboolean
@@ -285,3 +326,19 @@ stats_number_of_dynamic_clusters_limit(void)
     return -1;
   return stats_options->max_dynamic;
 }
+
+gboolean
+stats_check_sharded_counters(void)
+{
+  if (!stats_options)
+    return FALSE;
+  return stats_options->sharded_counters;
+}
+
+gboolean
+stats_check_periodic_snapshot(void)
+{
+  if (!stats_options)
+    return FALSE;
+  return stats_options->snapshot_freq > 0;
+}
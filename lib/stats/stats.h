@@ -34,6 +34,8 @@ typedef struct _StatsOptions
   gint level;
   gint lifetime;
   gint max_dynamic;
+  gboolean sharded_counters;
+  gint snapshot_freq;
 } StatsOptions;
 
 enum
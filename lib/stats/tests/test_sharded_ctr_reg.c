@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "apphook.h"
+#include "stats/stats-cluster.h"
+#include "stats/stats-cluster-logpipe.h"
+#include "stats/stats-counter.h"
+#include "stats/stats-registry.h"
+#include "syslog-ng.h"
+
+#include <criterion/criterion.h>
+
+TestSuite(stats_sharded_counter, .init = app_startup, .fini = app_shutdown);
+
+static StatsCounterItem *
+_register_sharded_counter(const gchar *id)
+{
+  StatsCounterItem *counter = NULL;
+
+  stats_lock();
+  {
+    StatsClusterKey sc_key;
+    stats_cluster_logpipe_key_set(&sc_key, SCS_GLOBAL, id, NULL);
+    StatsCluster *sc = stats_register_sharded_counter(0, &sc_key, SC_TYPE_PROCESSED, &counter);
+    cr_assert_not_null(sc);
+  }
+  stats_unlock();
+
+  cr_assert_not_null(counter);
+  cr_assert_not_null(counter->shards);
+  return counter;
+}
+
+Test(stats_sharded_counter, updates_are_summed_on_read)
+{
+  StatsCounterItem *counter = _register_sharded_counter("test_ctr");
+
+  stats_counter_inc(counter);
+  stats_counter_add(counter, 10);
+  stats_counter_dec(counter);
+  stats_counter_sub(counter, 2);
+  cr_expect_eq(stats_counter_get(counter), 8);
+
+  stats_counter_set(counter, 0);
+  cr_expect_eq(stats_counter_get(counter), 0);
+}
+
+Test(stats_sharded_counter, value_is_preserved_when_sharding_is_enabled)
+{
+  StatsCounterItem *counter = NULL;
+
+  stats_lock();
+  {
+    StatsClusterKey sc_key;
+    stats_cluster_logpipe_key_set(&sc_key, SCS_GLOBAL, "test_ctr", NULL);
+    stats_register_counter(0, &sc_key, SC_TYPE_PROCESSED, &counter);
+    stats_counter_add(counter, 5);
+
+    StatsCounterItem *sharded_counter = NULL;
+    stats_register_sharded_counter(0, &sc_key, SC_TYPE_PROCESSED, &sharded_counter);
+    cr_assert_eq(counter, sharded_counter);
+  }
+  stats_unlock();
+
+  stats_counter_inc(counter);
+  cr_expect_eq(stats_counter_get(counter), 6);
+}
+
+#define NUM_THREADS 8
+#define NUM_INCREMENTS 100000
+
+static gpointer
+_increment_thread(gpointer user_data)
+{
+  StatsCounterItem *counter = (StatsCounterItem *) user_data;
+
+  for (gint i = 0; i < NUM_INCREMENTS; i++)
+    stats_counter_inc(counter);
+  return NULL;
+}
+
+Test(stats_sharded_counter, concurrent_updates_are_not_lost)
+{
+  StatsCounterItem *counter = _register_sharded_counter("test_ctr");
+  GThread *threads[NUM_THREADS];
+
+  for (gint i = 0; i < NUM_THREADS; i++)
+    threads[i] = g_thread_new(NULL, _increment_thread, counter);
+
+  for (gint i = 0; i < NUM_THREADS; i++)
+    g_thread_join(threads[i]);
+
+  cr_expect_eq(stats_counter_get(counter), NUM_THREADS * NUM_INCREMENTS);
+}
+
+static StatsCounterItem *
+_register_contended_counter(gboolean sharded_counters)
+{
+  static StatsOptions stats_opts;
+  StatsCounterItem *counter = NULL;
+
+  stats_options_defaults(&stats_opts);
+  stats_opts.sharded_counters = sharded_counters;
+  stats_reinit(&stats_opts);
+
+  stats_lock();
+  {
+    StatsClusterKey sc_key;
+    stats_cluster_logpipe_key_set(&sc_key, SCS_GLOBAL, "test_ctr", NULL);
+    stats_register_contended_counter(0, &sc_key, SC_TYPE_PROCESSED, &counter);
+  }
+  stats_unlock();
+
+  cr_assert_not_null(counter);
+  return counter;
+}
+
+Test(stats_sharded_counter, contended_counters_are_sharded_only_if_enabled)
+{
+  cr_expect_null(_register_contended_counter(FALSE)->shards);
+  cr_expect_not_null(_register_contended_counter(TRUE)->shards);
+}
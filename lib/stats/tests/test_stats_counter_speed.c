@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "apphook.h"
+#include "stats/stats-cluster-logpipe.h"
+#include "stats/stats-registry.h"
+#include "libtest/stopwatch.h"
+
+#include <criterion/criterion.h>
+
+#define MAX_THREADS 8
+#define NUM_INCREMENTS 1000000
+
+static gpointer
+_increment_thread(gpointer user_data)
+{
+  StatsCounterItem *counter = (StatsCounterItem *) user_data;
+
+  for (gint i = 0; i < NUM_INCREMENTS; i++)
+    stats_counter_inc(counter);
+  return NULL;
+}
+
+static void
+_perftest_counter(const gchar *id, gboolean sharded, gint num_threads)
+{
+  StatsCounterItem *counter = NULL;
+  GThread *threads[MAX_THREADS];
+
+  stats_lock();
+  {
+    StatsClusterKey sc_key;
+    stats_cluster_logpipe_key_set(&sc_key, SCS_GLOBAL, id, NULL);
+    if (sharded)
+      stats_register_sharded_counter(0, &sc_key, SC_TYPE_PROCESSED, &counter);
+    else
+      stats_register_counter(0, &sc_key, SC_TYPE_PROCESSED, &counter);
+  }
+  stats_unlock();
+
+  start_stopwatch();
+  for (gint i = 0; i < num_threads; i++)
+    threads[i] = g_thread_new(NULL, _increment_thread, counter);
+  for (gint i = 0; i < num_threads; i++)
+    g_thread_join(threads[i]);
+  stop_stopwatch_and_display_result(num_threads * NUM_INCREMENTS, "%s counter, %d threads",
+                                    sharded ? "sharded" : "plain", num_threads);
+
+  cr_assert_eq(stats_counter_get(counter), num_threads * NUM_INCREMENTS);
+}
+
+Test(stats_counter_speed, test_counter_increment_speed)
+{
+  app_startup();
+
+  for (gint num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2)
+    {
+      gchar plain_id[32], sharded_id[32];
+
+      g_snprintf(plain_id, sizeof(plain_id), "plain_%d", num_threads);
+      g_snprintf(sharded_id, sizeof(sharded_id), "sharded_%d", num_threads);
+      _perftest_counter(plain_id, FALSE, num_threads);
+      _perftest_counter(sharded_id, TRUE, num_threads);
+    }
+
+  app_shutdown();
+}
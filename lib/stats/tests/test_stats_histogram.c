@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "apphook.h"
+#include "stats/stats-cluster-single.h"
+#include "stats/stats-histogram.h"
+#include "stats/stats-registry.h"
+#include "syslog-ng.h"
+
+#include <criterion/criterion.h>
+
+TestSuite(stats_histogram, .init = app_startup, .fini = app_shutdown);
+
+Test(stats_histogram, small_values_are_counted_exactly)
+{
+  for (guint64 value = 0; value < STATS_HISTOGRAM_SUB_BUCKETS; value++)
+    {
+      gint index = stats_histogram_get_bucket_index(value);
+
+      cr_expect_eq(index, value);
+      cr_expect_eq(stats_histogram_get_bucket_upper_bound(index), value);
+    }
+}
+
+Test(stats_histogram, bucket_bounds_limit_the_relative_error)
+{
+  guint64 values[] = { 8, 9, 15, 16, 17, 100, 1000, 12345, 1000000, G_GUINT64_CONSTANT(1) << 40 };
+
+  for (gint i = 0; i < G_N_ELEMENTS(values); i++)
+    {
+      gint index = stats_histogram_get_bucket_index(values[i]);
+      guint64 upper_bound = stats_histogram_get_bucket_upper_bound(index);
+
+      cr_expect(index < STATS_HISTOGRAM_BUCKETS);
+      cr_expect_geq(upper_bound, values[i], "value: %" G_GUINT64_FORMAT, values[i]);
+      cr_expect_leq(upper_bound - values[i], values[i] / STATS_HISTOGRAM_SUB_BUCKETS,
+                    "value: %" G_GUINT64_FORMAT, values[i]);
+      cr_expect_eq(stats_histogram_get_bucket_index(upper_bound), index);
+      cr_expect_eq(stats_histogram_get_bucket_index(upper_bound + 1), index + 1);
+    }
+}
+
+Test(stats_histogram, values_out_of_range_end_up_in_the_last_bucket)
+{
+  cr_expect_eq(stats_histogram_get_bucket_index(G_MAXUINT64), STATS_HISTOGRAM_BUCKETS - 1);
+  cr_expect_eq(stats_histogram_get_bucket_index(G_GUINT64_CONSTANT(1) << (STATS_HISTOGRAM_MAX_EXPONENT + 1)),
+               STATS_HISTOGRAM_BUCKETS - 1);
+}
+
+Test(stats_histogram, percentiles_are_calculated_from_the_snapshot)
+{
+  StatsHistogram *histogram = stats_histogram_new();
+  StatsHistogramSnapshot snapshot;
+
+  for (gint i = 1; i <= 1000; i++)
+    stats_histogram_record(histogram, i < 1000 ? 5 : 5000);
+
+  stats_histogram_snapshot(histogram, &snapshot);
+  cr_expect_eq(snapshot.count, 1000);
+  cr_expect_eq(snapshot.sum, 999 * 5 + 5000);
+  cr_expect_eq(stats_histogram_snapshot_get_percentile(&snapshot, 50), 5);
+  cr_expect_eq(stats_histogram_snapshot_get_percentile(&snapshot, 99.9), 5);
+  cr_expect_eq(stats_histogram_snapshot_get_percentile(&snapshot, 100),
+               stats_histogram_get_bucket_upper_bound(stats_histogram_get_bucket_index(5000)));
+  cr_expect_eq(stats_histogram_snapshot_get_max(&snapshot),
+               stats_histogram_get_bucket_upper_bound(stats_histogram_get_bucket_index(5000)));
+
+  stats_histogram_reset(histogram);
+  stats_histogram_snapshot(histogram, &snapshot);
+  cr_expect_eq(snapshot.count, 0);
+  cr_expect_eq(stats_histogram_snapshot_get_percentile(&snapshot, 50), 0);
+  cr_expect_eq(stats_histogram_snapshot_get_max(&snapshot), 0);
+
+  stats_histogram_free(histogram);
+}
+
+static gssize
+_get_latency_counter(const gchar *name)
+{
+  StatsClusterKey sc_key;
+
+  stats_cluster_single_key_set_with_name(&sc_key, SCS_GLOBAL, "d_file", "/tmp/x", name);
+  return stats_counter_get(stats_get_counter(&sc_key, SC_TYPE_SINGLE_VALUE));
+}
+
+Test(stats_histogram, latency_histograms_are_published_as_counters)
+{
+  StatsHistogram *histogram;
+
+  stats_lock();
+  histogram = stats_register_latency_histogram(0, SCS_GLOBAL, "d_file", "/tmp/x");
+  stats_unlock();
+  cr_assert_not_null(histogram);
+
+  stats_histogram_record(histogram, 2);
+  stats_histogram_record(histogram, 4);
+
+  stats_lock();
+  stats_publish_latency_histograms();
+  cr_expect_eq(_get_latency_counter("latency_count"), 2);
+  cr_expect_eq(_get_latency_counter("latency_mean_usec"), 3);
+  cr_expect_eq(_get_latency_counter("latency_p50_usec"), 2);
+  cr_expect_eq(_get_latency_counter("latency_max_usec"), 4);
+
+  stats_reset_latency_histograms();
+  stats_publish_latency_histograms();
+  cr_expect_eq(_get_latency_counter("latency_count"), 0);
+
+  /* owners of the same counters share the histogram */
+  StatsHistogram *other_owner = stats_register_latency_histogram(0, SCS_GLOBAL, "d_file", "/tmp/x");
+  cr_expect_eq(other_owner, histogram);
+  stats_unregister_latency_histogram(SCS_GLOBAL, "d_file", "/tmp/x", &histogram);
+  cr_expect_null(histogram);
+  stats_unlock();
+
+  stats_histogram_record(other_owner, 7);
+  stats_lock();
+  stats_publish_latency_histograms();
+  cr_expect_eq(_get_latency_counter("latency_count"), 1);
+
+  /* it is freed with its last owner, registering it again starts a new one */
+  stats_unregister_latency_histogram(SCS_GLOBAL, "d_file", "/tmp/x", &other_owner);
+  histogram = stats_register_latency_histogram(0, SCS_GLOBAL, "d_file", "/tmp/x");
+  stats_unlock();
+
+  stats_histogram_record(histogram, 5);
+  stats_lock();
+  stats_publish_latency_histograms();
+  cr_expect_eq(_get_latency_counter("latency_count"), 1);
+  cr_expect_eq(_get_latency_counter("latency_max_usec"), 5);
+  stats_unregister_latency_histogram(SCS_GLOBAL, "d_file", "/tmp/x", &histogram);
+  stats_unlock();
+}
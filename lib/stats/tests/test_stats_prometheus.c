@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "apphook.h"
+#include "stats/stats-cluster-logpipe.h"
+#include "stats/stats-cluster-single.h"
+#include "stats/stats-prometheus.h"
+#include "stats/stats-registry.h"
+#include "syslog-ng.h"
+
+#include <criterion/criterion.h>
+#include <string.h>
+
+static guint SCS_FILE;
+static guint SCS_TCP;
+
+static void
+setup(void)
+{
+  app_startup();
+  SCS_FILE = stats_register_type("file");
+  SCS_TCP = stats_register_type("tcp");
+}
+
+TestSuite(stats_prometheus, .init = setup, .fini = app_shutdown);
+
+static StatsCounterItem *
+_register_counter(guint16 component, const gchar *id, const gchar *instance, gint type)
+{
+  StatsCounterItem *counter = NULL;
+  StatsClusterKey sc_key;
+
+  stats_lock();
+  stats_cluster_logpipe_key_set(&sc_key, component, id, instance);
+  stats_register_counter(0, &sc_key, type, &counter);
+  stats_unlock();
+
+  cr_assert_not_null(counter);
+  return counter;
+}
+
+static void
+_assert_metrics_contain(const gchar *expected)
+{
+  GString *metrics = stats_prometheus_format();
+
+  cr_expect(strstr(metrics->str, expected), "expected: %s, metrics: %s", expected, metrics->str);
+  cr_expect(g_str_has_suffix(metrics->str, "# EOF\n"), "metrics: %s", metrics->str);
+  g_string_free(metrics, TRUE);
+}
+
+static void
+_assert_metrics_do_not_contain(const gchar *unexpected)
+{
+  GString *metrics = stats_prometheus_format();
+
+  cr_expect_not(strstr(metrics->str, unexpected), "unexpected: %s, metrics: %s", unexpected, metrics->str);
+  g_string_free(metrics, TRUE);
+}
+
+Test(stats_prometheus, counters_are_rendered_with_labels)
+{
+  StatsCounterItem *processed = _register_counter(SCS_DESTINATION | SCS_FILE, "d_file", "/var/log/messages",
+                                                  SC_TYPE_PROCESSED);
+  StatsCounterItem *queued = _register_counter(SCS_DESTINATION | SCS_FILE, "d_file", "/var/log/messages",
+                                               SC_TYPE_QUEUED);
+  _register_counter(SCS_HOST | SCS_SOURCE, "", "web01", SC_TYPE_PROCESSED);
+
+  stats_counter_add(processed, 42);
+  stats_counter_set(queued, 7);
+
+  _assert_metrics_contain("# TYPE syslogng_processed counter\n");
+  _assert_metrics_contain("syslogng_processed_total{component=\"dst.file\",destination=\"d_file\","
+                          "instance=\"/var/log/messages\"} 42\n");
+  _assert_metrics_contain("# TYPE syslogng_queued gauge\n");
+  _assert_metrics_contain("syslogng_queued{component=\"dst.file\",destination=\"d_file\","
+                          "instance=\"/var/log/messages\"} 7\n");
+  _assert_metrics_contain("syslogng_processed_total{component=\"src.host\",host=\"web01\"} 0\n");
+}
+
+Test(stats_prometheus, single_value_counters_are_rendered_by_their_name)
+{
+  StatsCounterItem *counter = NULL;
+  StatsClusterKey sc_key;
+
+  stats_lock();
+  stats_cluster_single_key_set_with_name(&sc_key, SCS_GLOBAL, "id", "", "latency-p99.usec");
+  stats_register_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &counter);
+  stats_unlock();
+  stats_counter_set(counter, 12);
+
+  _assert_metrics_contain("# TYPE syslogng_latency_p99_usec gauge\n"
+                          "syslogng_latency_p99_usec{component=\"global\",id=\"id\"} 12\n");
+}
+
+Test(stats_prometheus, label_values_are_escaped)
+{
+  _register_counter(SCS_DESTINATION | SCS_FILE, "d_file", "/tmp/\"quoted\"\\", SC_TYPE_DROPPED);
+
+  _assert_metrics_contain("instance=\"/tmp/\\\"quoted\\\"\\\\\"} 0\n");
+}
+
+Test(stats_prometheus, snapshot_follows_the_registry)
+{
+  StatsCounterItem *counter = _register_counter(SCS_SOURCE | SCS_TCP, "s_net", "10.0.0.1", SC_TYPE_PROCESSED);
+
+  _assert_metrics_contain("source=\"s_net\",instance=\"10.0.0.1\"} 0\n");
+
+  stats_counter_inc(counter);
+  _assert_metrics_contain("source=\"s_net\",instance=\"10.0.0.1\"} 1\n");
+
+  /* a new counter type in an existing cluster */
+  _register_counter(SCS_SOURCE | SCS_TCP, "s_net", "10.0.0.1", SC_TYPE_DROPPED);
+  _assert_metrics_contain("syslogng_dropped_total{component=\"src.tcp\",source=\"s_net\",instance=\"10.0.0.1\"} 0\n");
+
+  /* a new cluster */
+  _register_counter(SCS_SOURCE | SCS_TCP, "s_net", "10.0.0.2", SC_TYPE_PROCESSED);
+  _assert_metrics_contain("source=\"s_net\",instance=\"10.0.0.2\"} 0\n");
+}
+
+Test(stats_prometheus, unregistered_external_counters_are_not_rendered)
+{
+  static atomic_gssize external_counter;
+  StatsClusterKey sc_key;
+
+  stats_cluster_logpipe_key_set(&sc_key, SCS_SOURCE | SCS_FILE, "s_file", "/tmp/in");
+  atomic_gssize_set(&external_counter, 3);
+
+  stats_lock();
+  stats_register_external_counter(0, &sc_key, SC_TYPE_PROCESSED, &external_counter);
+  stats_unlock();
+  _assert_metrics_contain("source=\"s_file\",instance=\"/tmp/in\"} 3\n");
+
+  stats_lock();
+  stats_unregister_external_counter(&sc_key, SC_TYPE_PROCESSED, &external_counter);
+  stats_unlock();
+  _assert_metrics_do_not_contain("source=\"s_file\"");
+}
@@ -22,6 +22,7 @@
  *
  */
 #include "str-repr/decode.h"
+#include "str-utils.h"
 
 #include <string.h>
 
@@ -77,8 +78,38 @@ typedef struct _StrReprDecodeState
   const gchar *cur;
   gchar quote_char;
   const StrReprDecodeOptions *options;
+  /* characters that may end an unquoted value, empty if any character may */
+  gchar delimiter_set[4];
 } StrReprDecodeState;
 
+static void
+_init_delimiter_set(StrReprDecodeState *state)
+{
+  const StrReprDecodeOptions *options = state->options;
+  gint len = 0;
+
+  if (options->delimiter_chars[0])
+    {
+      for (gsize i = 0; i < G_N_ELEMENTS(options->delimiter_chars); i++)
+        {
+          if (options->delimiter_chars[i])
+            state->delimiter_set[len++] = options->delimiter_chars[i];
+        }
+    }
+  state->delimiter_set[len] = 0;
+}
+
+/* append the current character and the run of ordinary characters after it,
+ * leaving state->cur at the last character appended */
+static void
+_append_run(StrReprDecodeState *state, const gchar *stop_chars)
+{
+  const gchar *end = str_find_first_of(state->cur + 1, stop_chars);
+
+  g_string_append_len(state->value, state->cur, end - state->cur);
+  state->cur = end - 1;
+}
+
 static gboolean
 _invoke_match_delimiter(StrReprDecodeState *state, const gchar **new_cur)
 {
@@ -147,7 +178,8 @@ _process_quoted_string_characters(StrReprDecodeState *state)
   else if (*state->cur == '\\')
     return KV_QUOTE_BACKSLASH;
 
-  g_string_append_c(state->value, *state->cur);
+  const gchar stop_chars[] = { state->quote_char, '\\', 0 };
+  _append_run(state, stop_chars);
   return KV_QUOTE_STRING;
 }
 
@@ -179,7 +211,11 @@ _process_unquoted_characters(StrReprDecodeState *state)
 {
   if (_match_and_skip_delimiter(state))
     return KV_FINISH_SUCCESS;
-  g_string_append_c(state->value, *state->cur);
+
+  if (state->delimiter_set[0])
+    _append_run(state, state->delimiter_set);
+  else
+    g_string_append_c(state->value, *state->cur);
   return KV_UNQUOTED_CHARACTERS;
 }
 
@@ -243,6 +279,7 @@ str_repr_decode_append_with_options(GString *value, const gchar *input, const gc
   };
   gsize initial_len = value->len;
 
+  _init_delimiter_set(&state);
   gboolean success = _decode(&state);
   *end = state.cur;
 
@@ -23,6 +23,11 @@
  */
 #include "str-utils.h"
 
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__SANITIZE_ADDRESS__)
+#define STR_FIND_FIRST_OF_X86 1
+#include <immintrin.h>
+#endif
+
 GString *
 g_string_assign_len(GString *s, const gchar *val, gint len)
 {
@@ -73,3 +78,139 @@ normalize_flag(const gchar *buffer)
 {
   return str_replace_char(buffer, '_', '-');
 }
+
+const gchar *
+str_find_first_of_generic(const gchar *str, const gchar *chars)
+{
+  const gchar *p = str;
+
+  while (*p && !strchr(chars, *p))
+    p++;
+  return p;
+}
+
+#if STR_FIND_FIRST_OF_X86
+
+#define STR_FIND_FIRST_OF_MAX_VECTOR_CHARS 8
+
+typedef const gchar *(*StrFindFirstOfFunc)(const gchar *str, const gchar *chars, gint chars_len);
+
+/*
+ * The vectorized variants only ever use aligned loads: an aligned load
+ * never crosses a page boundary, so reading the bytes around the
+ * terminating NUL is harmless even though they are outside of the string.
+ * Matches before the start of the string are masked out.
+ */
+
+static inline guint32
+_match_sse2(__m128i block, const __m128i *needles, gint needles_len)
+{
+  __m128i matches = _mm_cmpeq_epi8(block, _mm_setzero_si128());
+
+  for (gint i = 0; i < needles_len; i++)
+    matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, needles[i]));
+  return (guint32) _mm_movemask_epi8(matches);
+}
+
+static const gchar *
+_find_first_of_sse2(const gchar *str, const gchar *chars, gint chars_len)
+{
+  __m128i needles[STR_FIND_FIRST_OF_MAX_VECTOR_CHARS];
+
+  for (gint i = 0; i < chars_len; i++)
+    needles[i] = _mm_set1_epi8(chars[i]);
+
+  gsize misalignment = (guintptr) str & 15;
+  const __m128i *p = (const __m128i *) (str - misalignment);
+  guint32 mask = _match_sse2(_mm_load_si128(p), needles, chars_len) & (0xFFFFFFFF << misalignment);
+
+  while (!mask)
+    {
+      p++;
+      mask = _match_sse2(_mm_load_si128(p), needles, chars_len);
+    }
+  return (const gchar *) p + __builtin_ctz(mask);
+}
+
+__attribute__((target("avx2")))
+static inline guint32
+_match_avx2(__m256i block, const __m256i *needles, gint needles_len)
+{
+  __m256i matches = _mm256_cmpeq_epi8(block, _mm256_setzero_si256());
+
+  for (gint i = 0; i < needles_len; i++)
+    matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(block, needles[i]));
+  return (guint32) _mm256_movemask_epi8(matches);
+}
+
+__attribute__((target("avx2")))
+static const gchar *
+_find_first_of_avx2(const gchar *str, const gchar *chars, gint chars_len)
+{
+  __m256i needles[STR_FIND_FIRST_OF_MAX_VECTOR_CHARS];
+
+  for (gint i = 0; i < chars_len; i++)
+    needles[i] = _mm256_set1_epi8(chars[i]);
+
+  gsize misalignment = (guintptr) str & 31;
+  const __m256i *p = (const __m256i *) (str - misalignment);
+  guint32 mask = _match_avx2(_mm256_load_si256(p), needles, chars_len) & (0xFFFFFFFF << misalignment);
+
+  while (!mask)
+    {
+      p++;
+      mask = _match_avx2(_mm256_load_si256(p), needles, chars_len);
+    }
+  return (const gchar *) p + __builtin_ctz(mask);
+}
+
+static StrFindFirstOfFunc
+_resolve_find_first_of(void)
+{
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return _find_first_of_avx2;
+  return _find_first_of_sse2;
+}
+
+static StrFindFirstOfFunc
+_get_find_first_of_vectorized(void)
+{
+  static gsize find_first_of_vectorized;
+
+  if (g_once_init_enter(&find_first_of_vectorized))
+    g_once_init_leave(&find_first_of_vectorized, (gsize) _resolve_find_first_of());
+  return (StrFindFirstOfFunc) find_first_of_vectorized;
+}
+
+static const gchar *
+_find_first_of(const gchar *str, const gchar *chars)
+{
+  gsize chars_len = strlen(chars);
+
+  if (chars_len > STR_FIND_FIRST_OF_MAX_VECTOR_CHARS)
+    return str + strcspn(str, chars);
+
+  return _get_find_first_of_vectorized()(str, chars, chars_len);
+}
+
+#else
+
+static const gchar *
+_find_first_of(const gchar *str, const gchar *chars)
+{
+  return str + strcspn(str, chars);
+}
+
+#endif
+
+gboolean str_find_first_of_disabled;
+
+const gchar *
+str_find_first_of(const gchar *str, const gchar *chars)
+{
+  if (G_UNLIKELY(str_find_first_of_disabled))
+    return str;
+
+  return _find_first_of(str, chars);
+}
@@ -115,6 +115,27 @@ _strchr_optimized_for_single_char_haystack(const char *str, int c)
   return strchr(str + 1, c);
 }
 
+/*
+ * Returns a pointer to the first character of @str that is present in
+ * @chars, or to the terminating NUL if there's no such character, e.g. it
+ * is equivalent to str + strcspn(str, chars).
+ *
+ * Scanners use it to skip runs of ordinary characters.  When @chars is
+ * short (up to 8 characters) it is vectorized, the SSE2 or AVX2 variant is
+ * selected at runtime based on what the CPU supports.
+ */
+const gchar *str_find_first_of(const gchar *str, const gchar *chars);
+
+/*
+ * When set, str_find_first_of() returns @str unchanged, so the scanners
+ * fall back to processing one character at a time.  Unit tests use it to
+ * compare the output of the two.
+ */
+extern gboolean str_find_first_of_disabled;
+
+/* byte-by-byte reference implementation of str_find_first_of() */
+const gchar *str_find_first_of_generic(const gchar *str, const gchar *chars);
+
 /*
  * strsplit() splits the `str` into `maxtokens` pieces.
  * This version skips multiple `delims`.
@@ -28,6 +28,12 @@
 #include "cfg-tree.h"
 #include "apphook.h"
 #include "logpipe.h"
+#include "cfg.h"
+#include "cfg-lexer.h"
+#include "filter/filter-expr.h"
+#include "filter/filter-expr-parser.h"
+
+#include <string.h>
 
 /*
  * The Always Pipe. Always returns the same thing at init time.
@@ -38,6 +44,8 @@ typedef struct
   LogPipe super;
 
   gboolean return_value;
+  gboolean preload_return_value;
+  gboolean preload_called;
   gboolean init_called;
   gboolean deinit_called;
 } AlmightyAlwaysPipe;
@@ -46,6 +54,15 @@ typedef struct
  * Helper functions
  */
 
+static gboolean
+almighty_always_pipe_preload (LogPipe *s)
+{
+  AlmightyAlwaysPipe *self = (AlmightyAlwaysPipe *)s;
+
+  self->preload_called = TRUE;
+  return self->preload_return_value;
+}
+
 static gboolean
 almighty_always_pipe_init (LogPipe *s)
 {
@@ -92,6 +109,37 @@ create_and_attach_almighty_pipe (CfgTree *tree, gboolean pipe_value)
   return pipe;
 }
 
+/* parses filter expressions the way patterndb conditions and $(if) do */
+static gboolean
+filter_parsing_pipe_preload (LogPipe *s)
+{
+  const gchar *expr = "program(\"foo\") and message(\"bar\") or host(\"baz\")";
+
+  for (gint i = 0; i < 100; i++)
+    {
+      CfgLexer *lexer = cfg_lexer_new_buffer (configuration, expr, strlen (expr));
+      FilterExprNode *filter = NULL;
+
+      if (!cfg_run_parser_with_main_context (configuration, lexer, &filter_expr_parser, (gpointer *) &filter, NULL,
+                                             "filter expression"))
+        return FALSE;
+      filter_expr_unref (filter);
+    }
+  return TRUE;
+}
+
+static AlmightyAlwaysPipe *
+create_and_attach_almighty_preloaded_pipe (CfgTree *tree, gboolean preload_value)
+{
+  AlmightyAlwaysPipe *pipe;
+
+  pipe = create_and_attach_almighty_pipe (tree, TRUE);
+  pipe->super.preload = almighty_always_pipe_preload;
+  pipe->preload_return_value = preload_value;
+
+  return pipe;
+}
+
 /*
  * Tests
  */
@@ -188,6 +236,112 @@ Test(cfg_tree, test_pipe_init_multi_with_bad_node)
   cfg_tree_free_instance (&tree);
 }
 
+Test(cfg_tree, test_compiled_tree_is_started_without_recompiling)
+{
+  AlmightyAlwaysPipe *pipe;
+  CfgTree tree;
+
+  cfg_tree_init_instance (&tree, NULL);
+
+  pipe = create_and_attach_almighty_pipe (&tree, TRUE);
+
+  cr_assert(cfg_tree_compile (&tree),
+            "Compiling a tree of all-good nodes works");
+  cr_assert_not(pipe->init_called,
+                "The initializer is NOT called by compiling the tree");
+
+  guint compiled_pipes = tree.initialized_pipes->len;
+
+  cr_assert(cfg_tree_start (&tree),
+            "Starting a compiled tree works");
+  cr_assert_eq(tree.initialized_pipes->len, compiled_pipes,
+               "Starting a compiled tree does not compile it again");
+  cr_assert(pipe->init_called,
+            "The initializer is called by starting the tree");
+  cr_assert(cfg_tree_stop (&tree),
+            "Stopping a compiled tree works");
+
+  cfg_tree_free_instance (&tree);
+}
+
+Test(cfg_tree, test_pipes_are_preloaded_before_init)
+{
+  AlmightyAlwaysPipe *pipes[4];
+  CfgTree tree;
+  guint i;
+
+  cfg_tree_init_instance (&tree, NULL);
+
+  for (i = 0; i < G_N_ELEMENTS(pipes); i++)
+    pipes[i] = create_and_attach_almighty_preloaded_pipe (&tree, TRUE);
+
+  cr_assert(cfg_tree_start (&tree),
+            "Starting a tree of all-good preloaded nodes works");
+
+  for (i = 0; i < G_N_ELEMENTS(pipes); i++)
+    {
+      cr_assert(pipes[i]->preload_called,
+                "The preloader of every pipe is called");
+      cr_assert(pipes[i]->init_called,
+                "The initializer of every pipe is called");
+    }
+
+  cr_assert(cfg_tree_stop (&tree),
+            "Stopping a tree of all-good preloaded nodes works");
+
+  cfg_tree_free_instance (&tree);
+}
+
+Test(cfg_tree, test_preload_failure_fails_start_before_init)
+{
+  AlmightyAlwaysPipe *pipe1, *pipe2, *pipe3;
+  CfgTree tree;
+
+  cfg_tree_init_instance (&tree, NULL);
+
+  pipe1 = create_and_attach_almighty_preloaded_pipe (&tree, TRUE);
+  pipe2 = create_and_attach_almighty_preloaded_pipe (&tree, FALSE);
+  pipe3 = create_and_attach_almighty_pipe (&tree, TRUE);
+
+  cr_assert_not(cfg_tree_start (&tree),
+                "Starting a tree with a failing preloader fails");
+  cr_assert(cfg_tree_stop (&tree),
+            "Stopping a tree with a failing preloader works");
+
+  cr_assert(pipe1->preload_called,
+            "The preloader of the good pipe is called");
+  cr_assert(pipe2->preload_called,
+            "The preloader of the bad pipe is called");
+  cr_assert_not(pipe1->init_called || pipe2->init_called || pipe3->init_called,
+                "No initializer is called if preloading fails");
+
+  cfg_tree_free_instance (&tree);
+}
+
+Test(cfg_tree, test_preloaders_can_parse_config_snippets_in_parallel)
+{
+  AlmightyAlwaysPipe *pipes[8];
+  CfgTree tree;
+  guint i;
+
+  configuration = cfg_new_snippet ();
+  cfg_tree_init_instance (&tree, NULL);
+
+  for (i = 0; i < G_N_ELEMENTS(pipes); i++)
+    {
+      pipes[i] = create_and_attach_almighty_pipe (&tree, TRUE);
+      pipes[i]->super.preload = filter_parsing_pipe_preload;
+    }
+
+  cr_assert(cfg_tree_start (&tree),
+            "Parsing filter expressions from parallel preloaders works");
+  cr_assert(cfg_tree_stop (&tree));
+
+  cfg_tree_free_instance (&tree);
+  cfg_free (configuration);
+  configuration = NULL;
+}
+
 static void
 setup(void)
 {
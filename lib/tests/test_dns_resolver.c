@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "dns-resolver.h"
+#include "apphook.h"
+#include "gsockaddr.h"
+#include "timeutils/cache.h"
+
+#include <criterion/criterion.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FAILING_ADDRESS "10.0.0.2"
+
+static DNSCacheOptions dns_cache_options;
+static gint resolve_calls;
+
+/* stand-in for the system resolver, every address except FAILING_ADDRESS resolves to "host-<address>" */
+static const gchar *
+_resolve_locally(GSockAddr *saddr, gchar *buf, gsize buf_len)
+{
+  gchar address[64];
+
+  g_atomic_int_inc(&resolve_calls);
+  g_sockaddr_format(saddr, address, sizeof(address), GSA_ADDRESS_ONLY);
+  if (strcmp(address, FAILING_ADDRESS) == 0)
+    return NULL;
+
+  g_snprintf(buf, buf_len, "host-%s", address);
+  return buf;
+}
+
+static gboolean
+_lookup_until_resolved(const gchar *address, gchar *buf, gsize buf_len, gboolean *positive)
+{
+  GSockAddr *saddr = g_sockaddr_inet_new(address, 0);
+  gboolean resolved = FALSE;
+
+  for (gint i = 0; i < 1000 && !resolved; i++)
+    {
+      resolved = dns_resolver_lookup(saddr, buf, buf_len, positive);
+      if (!resolved)
+        g_usleep(1000);
+    }
+  g_sockaddr_unref(saddr);
+  return resolved;
+}
+
+static void
+setup(void)
+{
+  app_startup();
+
+  resolve_calls = 0;
+  dns_resolver_set_resolve_func(_resolve_locally);
+  dns_cache_options_defaults(&dns_cache_options);
+  dns_cache_options.async = TRUE;
+  dns_cache_options.expire = 1;
+  dns_cache_options.expire_failed = 1;
+  dns_resolver_update_options(&dns_cache_options);
+}
+
+static void
+teardown(void)
+{
+  app_shutdown();
+}
+
+TestSuite(dns_resolver, .init = setup, .fini = teardown);
+
+Test(dns_resolver, first_lookup_is_queued_without_blocking)
+{
+  GSockAddr *saddr = g_sockaddr_inet_new("10.0.0.1", 0);
+  gchar buf[256];
+  gboolean positive;
+
+  cr_assert(dns_resolver_is_enabled());
+  cr_assert_not(dns_resolver_lookup(saddr, buf, sizeof(buf), &positive));
+  g_sockaddr_unref(saddr);
+}
+
+Test(dns_resolver, positive_results_are_cached)
+{
+  gchar buf[256];
+  gboolean positive = FALSE;
+
+  cr_assert(_lookup_until_resolved("10.0.0.1", buf, sizeof(buf), &positive));
+  cr_assert(positive);
+  cr_assert_str_eq(buf, "host-10.0.0.1");
+
+  cr_assert(_lookup_until_resolved("10.0.0.1", buf, sizeof(buf), &positive));
+  cr_assert_eq(resolve_calls, 1);
+}
+
+Test(dns_resolver, negative_results_are_cached)
+{
+  gchar buf[256];
+  gboolean positive = TRUE;
+
+  cr_assert(_lookup_until_resolved(FAILING_ADDRESS, buf, sizeof(buf), &positive));
+  cr_assert_not(positive);
+
+  cr_assert(_lookup_until_resolved(FAILING_ADDRESS, buf, sizeof(buf), &positive));
+  cr_assert_eq(resolve_calls, 1);
+}
+
+Test(dns_resolver, expired_results_are_resolved_again)
+{
+  gchar buf[256];
+  gboolean positive;
+
+  cr_assert(_lookup_until_resolved("10.0.0.1", buf, sizeof(buf), &positive));
+
+  sleep(2);
+  invalidate_cached_time();
+
+  cr_assert(_lookup_until_resolved("10.0.0.1", buf, sizeof(buf), &positive));
+  for (gint i = 0; i < 1000 && g_atomic_int_get(&resolve_calls) < 2; i++)
+    g_usleep(1000);
+  cr_assert_eq(resolve_calls, 2);
+}
+
+Test(dns_resolver, expired_positive_results_are_served_while_resolved_again)
+{
+  GSockAddr *saddr = g_sockaddr_inet_new("10.0.0.1", 0);
+  gchar buf[256];
+  gboolean positive = FALSE;
+
+  cr_assert(_lookup_until_resolved("10.0.0.1", buf, sizeof(buf), &positive));
+
+  sleep(2);
+  invalidate_cached_time();
+
+  memset(buf, 0, sizeof(buf));
+  positive = FALSE;
+  cr_assert(dns_resolver_lookup(saddr, buf, sizeof(buf), &positive),
+            "expired positive results should be served until the refresh completes");
+  cr_assert(positive);
+  cr_assert_str_eq(buf, "host-10.0.0.1");
+  g_sockaddr_unref(saddr);
+}
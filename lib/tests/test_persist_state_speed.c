@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "persist-state.h"
+#include "apphook.h"
+#include "libtest/persist_lib.h"
+#include "libtest/stopwatch.h"
+
+#include <criterion/criterion.h>
+
+#define MAX_THREADS 16
+#define NUM_UPDATES 200000
+#define NUM_GROW_ENTRIES 256
+
+typedef struct _Bookmark
+{
+  guint64 position;
+} Bookmark;
+
+typedef struct _BookmarkThread
+{
+  PersistState *state;
+  PersistEntryHandle handle;
+} BookmarkThread;
+
+static gpointer
+_update_bookmark_thread(gpointer user_data)
+{
+  BookmarkThread *self = (BookmarkThread *) user_data;
+
+  for (gint i = 0; i < NUM_UPDATES; i++)
+    {
+      Bookmark *bookmark = (Bookmark *) persist_state_map_entry(self->state, self->handle);
+      bookmark->position++;
+      persist_state_unmap_entry(self->state, self->handle);
+    }
+  return NULL;
+}
+
+/* allocating new entries grows the persist file, which remaps it while
+ * the bookmark threads keep on updating their entries */
+static void
+_grow_persist_file(PersistState *state)
+{
+  for (gint i = 0; i < NUM_GROW_ENTRIES; i++)
+    {
+      gchar name[32];
+
+      g_snprintf(name, sizeof(name), "grow_%d", i);
+      cr_assert(persist_state_alloc_entry(state, name, 1024));
+    }
+}
+
+static void
+_perftest_bookmark_updates(gint num_threads, gboolean grow)
+{
+  PersistState *state = clean_and_create_persist_state_for_test("test_persist_state_speed.persist");
+  BookmarkThread threads[MAX_THREADS];
+  GThread *thread_ids[MAX_THREADS];
+
+  for (gint i = 0; i < num_threads; i++)
+    {
+      gchar name[32];
+
+      g_snprintf(name, sizeof(name), "bookmark_%d", i);
+      threads[i].state = state;
+      threads[i].handle = persist_state_alloc_entry(state, name, sizeof(Bookmark));
+      cr_assert(threads[i].handle);
+
+      Bookmark *bookmark = (Bookmark *) persist_state_map_entry(state, threads[i].handle);
+      bookmark->position = 0;
+      persist_state_unmap_entry(state, threads[i].handle);
+    }
+
+  start_stopwatch();
+  for (gint i = 0; i < num_threads; i++)
+    thread_ids[i] = g_thread_new(NULL, _update_bookmark_thread, &threads[i]);
+  if (grow)
+    _grow_persist_file(state);
+  for (gint i = 0; i < num_threads; i++)
+    g_thread_join(thread_ids[i]);
+  stop_stopwatch_and_display_result(num_threads * NUM_UPDATES, "bookmark updates, %d threads%s",
+                                    num_threads, grow ? ", growing the file" : "");
+
+  for (gint i = 0; i < num_threads; i++)
+    {
+      Bookmark *bookmark = (Bookmark *) persist_state_map_entry(state, threads[i].handle);
+      cr_assert_eq(bookmark->position, NUM_UPDATES, "Bookmark updates were lost, thread: %d", i);
+      persist_state_unmap_entry(state, threads[i].handle);
+    }
+
+  cancel_and_destroy_persist_state(state);
+}
+
+Test(persist_state_speed, test_concurrent_bookmark_updates)
+{
+  app_startup();
+
+  for (gint num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2)
+    _perftest_bookmark_updates(num_threads, FALSE);
+
+  app_shutdown();
+}
+
+Test(persist_state_speed, test_concurrent_bookmark_updates_while_the_file_grows)
+{
+  app_startup();
+
+  for (gint num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2)
+    _perftest_bookmark_updates(num_threads, TRUE);
+
+  app_shutdown();
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "syslog-ng.h"
+#include "pipe-profiler.h"
+#include "logpipe.h"
+#include "logmsg/logmsg.h"
+#include "apphook.h"
+
+#include <criterion/criterion.h>
+#include <string.h>
+
+static void
+_slow_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  g_usleep(1000);
+  log_msg_drop(msg, path_options, AT_PROCESSED);
+}
+
+static LogPipe *
+_create_pipe(const gchar *plugin_name)
+{
+  LogPipe *pipe = log_pipe_new(NULL);
+
+  pipe->plugin_name = g_strdup(plugin_name);
+  cr_assert(log_pipe_init(pipe));
+  return pipe;
+}
+
+static LogPipe *head, *tail;
+
+static void
+_queue_messages(gint count)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT_NOACK;
+
+  for (gint i = 0; i < count; i++)
+    log_pipe_queue(head, log_msg_new_empty(), &path_options);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+
+  head = _create_pipe("head");
+  tail = _create_pipe("tail");
+  tail->queue = _slow_queue;
+  log_pipe_append(head, tail);
+}
+
+static void
+teardown(void)
+{
+  pipe_profiling_enabled = FALSE;
+  log_pipe_deinit(head);
+  log_pipe_deinit(tail);
+  log_pipe_unref(head);
+  log_pipe_unref(tail);
+  app_shutdown();
+}
+
+TestSuite(pipe_profiler, .init = setup, .fini = teardown);
+
+Test(pipe_profiler, nothing_is_recorded_while_disabled)
+{
+  _queue_messages(2);
+
+  cr_expect_eq(atomic_gssize_get(&head->profile.calls), 0);
+  cr_expect_eq(atomic_gssize_get(&tail->profile.calls), 0);
+}
+
+Test(pipe_profiler, time_spent_in_the_next_pipes_is_excluded_from_self_time)
+{
+  pipe_profiling_enabled = TRUE;
+  _queue_messages(2);
+
+  cr_expect_eq(atomic_gssize_get(&head->profile.calls), 2);
+  cr_expect_eq(atomic_gssize_get(&tail->profile.calls), 2);
+
+  gssize head_total = atomic_gssize_get(&head->profile.total_nsec);
+  gssize tail_total = atomic_gssize_get(&tail->profile.total_nsec);
+
+  cr_expect_geq(tail_total, 2 * 1000000);
+  cr_expect_geq(head_total, tail_total);
+  cr_expect_eq(atomic_gssize_get(&head->profile.self_nsec), head_total - tail_total);
+  cr_expect_eq(atomic_gssize_get(&tail->profile.self_nsec), tail_total);
+}
+
+Test(pipe_profiler, report_is_sorted_by_self_time)
+{
+  pipe_profiling_enabled = TRUE;
+  _queue_messages(1);
+
+  GString *report = pipe_profiler_format_report();
+  gchar **lines = g_strsplit(report->str, "\n", -1);
+
+  cr_assert_eq(g_strv_length(lines), 4, "report: %s", report->str);
+  cr_expect_str_eq(lines[0], "Location;Object;Plugin;Calls;TotalUsec;SelfUsec;SelfNsecPerCall");
+  cr_expect(g_str_has_prefix(lines[1], "#unknown;;tail;1;"), "line: %s", lines[1]);
+  cr_expect(g_str_has_prefix(lines[2], "#unknown;;head;1;"), "line: %s", lines[2]);
+  cr_expect_str_eq(lines[3], "");
+
+  g_strfreev(lines);
+  g_string_free(report, TRUE);
+
+  pipe_profiler_reset();
+  report = pipe_profiler_format_report();
+  cr_expect_str_eq(report->str, "Location;Object;Plugin;Calls;TotalUsec;SelfUsec;SelfNsecPerCall\n");
+  g_string_free(report, TRUE);
+}
+
+Test(pipe_profiler, pipes_outside_of_the_config_tree_are_reported_until_freed)
+{
+  LogPipe *writer = _create_pipe("writer");
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT_NOACK;
+
+  /* e.g. a LogWriter, created by its driver at runtime */
+  log_pipe_append(writer, head);
+
+  pipe_profiling_enabled = TRUE;
+  log_pipe_queue(writer, log_msg_new_empty(), &path_options);
+  cr_assert(writer->profile.registered);
+
+  GString *report = pipe_profiler_format_report();
+  cr_expect(strstr(report->str, "#unknown;;writer;1;"), "report: %s", report->str);
+  g_string_free(report, TRUE);
+
+  log_pipe_deinit(writer);
+  log_pipe_unref(writer);
+
+  report = pipe_profiler_format_report();
+  cr_expect_not(strstr(report->str, ";writer;"), "report: %s", report->str);
+  cr_expect(strstr(report->str, "#unknown;;head;1;"), "report: %s", report->str);
+  g_string_free(report, TRUE);
+}
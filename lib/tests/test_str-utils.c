@@ -153,3 +153,40 @@ Test(strsplit, when_tokens_limited_join_remaining_tokens)
 
   g_strfreev(tokens);
 }
+
+Test(str_find_first_of, finds_the_first_matching_character_or_the_terminating_nul)
+{
+  const gchar *str = "key=value, other='quoted value'";
+  const gchar *empty = "";
+
+  cr_assert_eq(str_find_first_of(str, "="), str + 3);
+  cr_assert_eq(str_find_first_of(str, ",'"), str + 9);
+  cr_assert_eq(str_find_first_of(str, "'"), str + 17);
+  cr_assert_eq(str_find_first_of(str, "#"), str + strlen(str));
+  cr_assert_eq(str_find_first_of(str, ""), str + strlen(str));
+  cr_assert_eq(str_find_first_of(empty, "="), empty);
+}
+
+Test(str_find_first_of, matches_the_generic_implementation)
+{
+  const gchar *sets[] = { "", " ", ",;", " =\"'", "abcdefgh", "abcdefghi", "\\\"", NULL };
+  const gchar alphabet[] = "abcxyz ,;=\"'\\hij";
+  gchar buf[256 + 64 + 1];
+
+  /* every alignment of the start and of the terminating NUL relative to
+   * the vector blocks, with random content */
+  for (gint ofs = 0; ofs < 64; ofs++)
+    {
+      for (gint len = 0; len < 256; len++)
+        {
+          for (gint i = 0; i < len; i++)
+            buf[ofs + i] = alphabet[g_random_int_range(0, sizeof(alphabet) - 1)];
+          buf[ofs + len] = 0;
+
+          for (gint set = 0; sets[set]; set++)
+            cr_assert_eq(str_find_first_of(&buf[ofs], sets[set]), str_find_first_of_generic(&buf[ofs], sets[set]),
+                         "str_find_first_of() differs from the generic implementation, str=%s, chars=%s",
+                         &buf[ofs], sets[set]);
+        }
+    }
+}
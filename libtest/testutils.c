@@ -30,6 +30,8 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <math.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 static gboolean testutils_global_success = TRUE;
 GString *current_testcase_description = NULL;
@@ -463,6 +465,41 @@ assert_msg_field_unset_non_fatal(LogMessage *msg, const gchar *field_name, const
   return success;
 }
 
+static gsize
+_page_end_area_size(gsize len)
+{
+  gsize page_size = sysconf(_SC_PAGESIZE);
+
+  /* the pages holding the string and an inaccessible one after them */
+  return (len + page_size - 1) / page_size * page_size + page_size;
+}
+
+gchar *
+str_at_page_end_new(const gchar *str)
+{
+  gsize page_size = sysconf(_SC_PAGESIZE);
+  gsize len = strlen(str) + 1;
+  gsize size = _page_end_area_size(len);
+  gchar *area = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  g_assert(area != MAP_FAILED);
+  g_assert(mprotect(area + size - page_size, page_size, PROT_NONE) == 0);
+
+  gchar *result = area + size - page_size - len;
+  memcpy(result, str, len);
+  return result;
+}
+
+void
+str_at_page_end_free(gchar *str)
+{
+  gsize page_size = sysconf(_SC_PAGESIZE);
+  gsize len = strlen(str) + 1;
+  gsize size = _page_end_area_size(len);
+
+  munmap(str + len + page_size - size, size);
+}
+
 gboolean
 testutils_deinit(void)
 {
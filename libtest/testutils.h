@@ -54,6 +54,11 @@ gboolean assert_grabbed_messages_contain_non_fatal(const gchar *pattern, const g
 
 gchar **fill_string_array(gint number_of_elements, ...);
 
+/* copies @str so that its terminating NUL is the last byte of a page
+ * followed by an inaccessible one, reading past it crashes the test */
+gchar *str_at_page_end_new(const gchar *str);
+void str_at_page_end_free(gchar *str);
+
 gboolean assert_guint16_non_fatal(guint16 actual, guint16 expected, const gchar *error_message,
                                   ...) G_GNUC_PRINTF(3, 4);
 gboolean assert_gint64_non_fatal(gint64 actual, gint64 expected, const gchar *error_message,
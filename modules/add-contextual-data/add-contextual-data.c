@@ -30,11 +30,13 @@
 #include "add-contextual-data-selector.h"
 #include "template/templates.h"
 #include "context-info-db.h"
+#include "context-info-db-file.h"
 #include "pathutils.h"
 #include "scratch-buffers.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 
 typedef struct AddContextualData
 {
@@ -43,6 +45,7 @@ typedef struct AddContextualData
   AddContextualDataSelector *selector;
   gchar *default_selector;
   gchar *filename;
+  gchar *compiled_database;
   gchar *prefix;
   gboolean ignore_case;
 } AddContextualData;
@@ -56,6 +59,15 @@ add_contextual_data_set_filename(LogParser *p, const gchar *filename)
   self->filename = g_strdup(filename);
 }
 
+void
+add_contextual_data_set_compiled_database(LogParser *p, const gchar *compiled_database)
+{
+  AddContextualData *self = (AddContextualData *) p;
+
+  g_free(self->compiled_database);
+  self->compiled_database = g_strdup(compiled_database);
+}
+
 void
 add_contextual_data_set_prefix(LogParser *p, const gchar *prefix)
 {
@@ -154,6 +166,7 @@ _clone(LogPipe *s)
   _replace_context_info_db(&cloned->context_info_db, self->context_info_db);
   add_contextual_data_set_prefix(&cloned->super, self->prefix);
   add_contextual_data_set_filename(&cloned->super, self->filename);
+  add_contextual_data_set_compiled_database(&cloned->super, self->compiled_database);
   add_contextual_data_set_default_selector(&cloned->super,
                                            self->default_selector);
   add_contextual_data_set_ignore_case(&cloned->super, self->ignore_case);
@@ -169,6 +182,7 @@ _free(LogPipe *s)
 
   context_info_db_unref(self->context_info_db);
   g_free(self->filename);
+  g_free(self->compiled_database);
   g_free(self->prefix);
   g_free(self->default_selector);
   add_contextual_data_selector_free(self->selector);
@@ -189,23 +203,21 @@ _complete_relative_path_with_config_path(const gchar *filename)
                      filename, NULL);
 }
 
+static gchar *
+_get_absolute_path(const gchar *filename)
+{
+  if (_is_relative_path(filename))
+    return _complete_relative_path_with_config_path(filename);
+  return g_strdup(filename);
+}
+
 static FILE *
 _open_data_file(const gchar *filename)
 {
-  FILE *f = NULL;
-
-  if (_is_relative_path(filename))
-    {
-      gchar *absolute_path =
-        _complete_relative_path_with_config_path(filename);
-      f = fopen(absolute_path, "r");
-      g_free(absolute_path);
-    }
-  else
-    {
-      f = fopen(filename, "r");
-    }
+  gchar *absolute_path = _get_absolute_path(filename);
+  FILE *f = fopen(absolute_path, "r");
 
+  g_free(absolute_path);
   return f;
 }
 
@@ -224,6 +236,111 @@ _get_scanner(AddContextualData *self)
   return contextual_data_record_scanner_new(log_pipe_get_config(&self->super.super), self->prefix);
 }
 
+/* the clones of a parser are preloaded in parallel, each of them loading
+ * the same compiled database: the first one compiles it if needed, the
+ * others wait for it and load its result */
+typedef struct _CompileLock
+{
+  GMutex *lock;
+  gint ref_cnt;
+} CompileLock;
+
+G_LOCK_DEFINE_STATIC(compile_locks);
+static GHashTable *compile_locks;
+
+static void
+_compile_lock_free(CompileLock *self)
+{
+  g_mutex_free(self->lock);
+  g_free(self);
+}
+
+static CompileLock *
+_compile_lock_acquire(const gchar *compiled_database)
+{
+  CompileLock *compile_lock;
+
+  G_LOCK(compile_locks);
+  if (!compile_locks)
+    compile_locks = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) _compile_lock_free);
+
+  compile_lock = g_hash_table_lookup(compile_locks, compiled_database);
+  if (!compile_lock)
+    {
+      compile_lock = g_new0(CompileLock, 1);
+      compile_lock->lock = g_mutex_new();
+      g_hash_table_insert(compile_locks, g_strdup(compiled_database), compile_lock);
+    }
+  compile_lock->ref_cnt++;
+  G_UNLOCK(compile_locks);
+
+  g_mutex_lock(compile_lock->lock);
+  return compile_lock;
+}
+
+static void
+_compile_lock_release(CompileLock *compile_lock, const gchar *compiled_database)
+{
+  g_mutex_unlock(compile_lock->lock);
+
+  G_LOCK(compile_locks);
+  if (--compile_lock->ref_cnt == 0)
+    g_hash_table_remove(compile_locks, compiled_database);
+  if (g_hash_table_size(compile_locks) == 0)
+    {
+      g_hash_table_destroy(compile_locks);
+      compile_locks = NULL;
+    }
+  G_UNLOCK(compile_locks);
+}
+
+/* the compiled database is used as long as it matches the CSV file, it is
+ * (re)compiled otherwise, which only happens once per CSV change */
+static gboolean
+_load_compiled_context_info_db(AddContextualData *self, FILE *f, ContextualDataRecordScanner *scanner)
+{
+  GlobalConfig *cfg = log_pipe_get_config(&self->super.super);
+  gchar *compiled_database = _get_absolute_path(self->compiled_database);
+  CompileLock *compile_lock = NULL;
+  gboolean result = FALSE;
+  struct stat st;
+
+  if (fstat(fileno(f), &st) < 0)
+    {
+      msg_error("add-contextual-data(): Error querying database file",
+                evt_tag_str("filename", self->filename),
+                evt_tag_error("error"));
+      goto exit;
+    }
+
+  compile_lock = _compile_lock_acquire(compiled_database);
+  if (context_info_db_load_file(self->context_info_db, compiled_database, &st, self->prefix, cfg))
+    {
+      result = TRUE;
+      goto exit;
+    }
+
+  msg_info("add-contextual-data(): Compiling database",
+           evt_tag_str("filename", self->filename),
+           evt_tag_str("compiled_database", compiled_database));
+
+  if (!context_info_db_file_compile(compiled_database, f, self->filename, &st, scanner, self->prefix) ||
+      !context_info_db_load_file(self->context_info_db, compiled_database, &st, self->prefix, cfg))
+    {
+      msg_error("add-contextual-data(): Error while compiling database",
+                evt_tag_str("filename", self->filename),
+                evt_tag_str("compiled_database", compiled_database));
+      goto exit;
+    }
+  result = TRUE;
+
+exit:
+  if (compile_lock)
+    _compile_lock_release(compile_lock, compiled_database);
+  g_free(compiled_database);
+  return result;
+}
+
 static gboolean
 _load_context_info_db(AddContextualData *self)
 {
@@ -243,13 +360,19 @@ _load_context_info_db(AddContextualData *self)
       goto error;
     }
 
-  if (!context_info_db_import(self->context_info_db, f, self->filename, scanner))
+  if (self->compiled_database)
+    {
+      result = _load_compiled_context_info_db(self, f, scanner);
+    }
+  else if (context_info_db_import(self->context_info_db, f, self->filename, scanner))
+    {
+      result = TRUE;
+    }
+  else
     {
       msg_error("add-contextual-data(): Error while parsing database",
                 evt_tag_str("filename", self->filename));
-      goto error;
     }
-  result = TRUE;
 
 error:
   if (scanner)
@@ -280,7 +403,24 @@ _init_context_info_db(AddContextualData *self)
   if (self->selector && add_contextual_data_selector_is_ordering_required(self->selector))
     context_info_db_enable_ordering(self->context_info_db);
 
-  return _load_context_info_db(self);
+  if (!_load_context_info_db(self))
+    {
+      context_info_db_unref(self->context_info_db);
+      self->context_info_db = NULL;
+      return FALSE;
+    }
+  return TRUE;
+}
+
+/* importing the database is the expensive part of our init, it only
+ * depends on our own options so it can run in parallel with the other
+ * pipes, see cfg_tree_start() */
+static gboolean
+_preload(LogPipe *s)
+{
+  AddContextualData *self = (AddContextualData *)s;
+
+  return _init_context_info_db(self);
 }
 
 static gboolean
@@ -316,6 +456,7 @@ add_contextual_data_parser_new(GlobalConfig *cfg)
 
   self->super.super.clone = _clone;
   self->super.super.free_fn = _free;
+  self->super.super.preload = _preload;
   self->super.super.init = _init;
   self->default_selector = NULL;
   self->prefix = NULL;
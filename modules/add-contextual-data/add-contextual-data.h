@@ -28,6 +28,7 @@
 
 
 void add_contextual_data_set_filename(LogParser *p, const gchar *filename);
+void add_contextual_data_set_compiled_database(LogParser *p, const gchar *compiled_database);
 void add_contextual_data_set_selector(LogParser *p, AddContextualDataSelector *selector);
 void add_contextual_data_set_default_selector(LogParser *p,
                                               const gchar *default_selector);
@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include "context-info-db-file.h"
+#include "messages.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define CONTEXT_INFO_DB_FILE_MAGIC "SNGCDB02"
+#define CONTEXT_INFO_DB_FILE_BYTE_ORDER 0x01020304
+
+/* everything is in host byte order, a file compiled on a different
+ * architecture is recompiled */
+typedef struct _ContextInfoDBFileHeader
+{
+  gchar magic[8];
+  guint32 byte_order;
+  guint32 num_records;
+  guint64 source_size;
+  gint64 source_mtime;
+  gint64 source_mtime_nsec;
+  guint64 source_ino;
+  guint64 source_dev;
+  guint64 pool_size;
+  guint32 prefix_ofs;
+  guint32 __reserved;
+} ContextInfoDBFileHeader;
+
+struct _ContextInfoDBFile
+{
+  gpointer map;
+  gsize map_size;
+  const ContextInfoDBFileHeader *header;
+  const ContextInfoDBFileRecord *records;
+  const gchar *pool;
+};
+
+static gint64
+_get_mtime_nsec(const struct stat *st)
+{
+#if defined(__APPLE__) && defined(__MACH__)
+  return st->st_mtimespec.tv_nsec;
+#else
+  return st->st_mtim.tv_nsec;
+#endif
+}
+
+/**********************************************************************
+ * compile a CSV file
+ **********************************************************************/
+
+typedef struct _ContextInfoDBFileBuilder
+{
+  GArray *records;
+  GString *pool;
+  /* deduplicates the strings in the pool, maps them to their offset */
+  GHashTable *strings;
+  const gchar *csv_filename;
+} ContextInfoDBFileBuilder;
+
+static gboolean
+_builder_add_string(ContextInfoDBFileBuilder *self, const gchar *str, guint32 *ofs)
+{
+  gpointer stored_ofs;
+  gsize len = strlen(str);
+
+  if (g_hash_table_lookup_extended(self->strings, str, NULL, &stored_ofs))
+    {
+      *ofs = GPOINTER_TO_UINT(stored_ofs);
+      return TRUE;
+    }
+
+  if (self->pool->len + len + 1 > G_MAXUINT32)
+    {
+      msg_error("add-contextual-data(): database too large to be compiled, the string pool would exceed 4GiB",
+                evt_tag_str("filename", self->csv_filename));
+      return FALSE;
+    }
+
+  *ofs = self->pool->len;
+  g_string_append_len(self->pool, str, len + 1);
+  g_hash_table_insert(self->strings, g_strdup(str), GUINT_TO_POINTER(*ofs));
+  return TRUE;
+}
+
+static gboolean
+_builder_add_record(gpointer user_data, ContextualDataRecord *record, gint lineno)
+{
+  ContextInfoDBFileBuilder *self = (ContextInfoDBFileBuilder *) user_data;
+  ContextInfoDBFileRecord file_record = { 0 };
+  const gchar *value;
+  gboolean result = FALSE;
+
+  if (log_template_is_literal_string(record->value))
+    {
+      value = log_template_get_literal_value(record->value, NULL);
+      file_record.flags |= CONTEXT_INFO_DB_FILE_RECORD_LITERAL;
+    }
+  else
+    {
+      value = record->value->template;
+    }
+  file_record.lineno = lineno;
+
+  if (!_builder_add_string(self, record->selector->str, &file_record.selector_ofs) ||
+      !_builder_add_string(self, log_msg_get_value_name(record->value_handle, NULL), &file_record.name_ofs) ||
+      !_builder_add_string(self, value, &file_record.value_ofs))
+    goto exit;
+
+  g_array_append_val(self->records, file_record);
+  result = TRUE;
+
+exit:
+  contextual_data_record_clean(record);
+  return result;
+}
+
+static gint
+_builder_record_cmp(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  const ContextInfoDBFileRecord *r1 = (const ContextInfoDBFileRecord *) a;
+  const ContextInfoDBFileRecord *r2 = (const ContextInfoDBFileRecord *) b;
+  const gchar *pool = (const gchar *) user_data;
+  gint result;
+
+  result = g_ascii_strcasecmp(pool + r1->selector_ofs, pool + r2->selector_ofs);
+  if (result)
+    return result;
+
+  /* keep the records of the same selector in their original order */
+  return (r1->lineno > r2->lineno) - (r1->lineno < r2->lineno);
+}
+
+static gboolean
+_write_all(gint fd, gconstpointer buf, gsize len)
+{
+  const gchar *p = (const gchar *) buf;
+
+  while (len > 0)
+    {
+      gssize rc = write(fd, p, len);
+
+      if (rc < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return FALSE;
+        }
+      p += rc;
+      len -= rc;
+    }
+  return TRUE;
+}
+
+static gboolean
+_builder_write(ContextInfoDBFileBuilder *self, const gchar *filename, const struct stat *csv_st, guint32 prefix_ofs)
+{
+  ContextInfoDBFileHeader header = { { 0 } };
+  gchar *temp_filename = g_strdup_printf("%s.XXXXXX", filename);
+  gboolean result = FALSE;
+  gint fd;
+
+  memcpy(header.magic, CONTEXT_INFO_DB_FILE_MAGIC, sizeof(header.magic));
+  header.byte_order = CONTEXT_INFO_DB_FILE_BYTE_ORDER;
+  header.num_records = self->records->len;
+  header.source_size = csv_st->st_size;
+  header.source_mtime = csv_st->st_mtime;
+  header.source_mtime_nsec = _get_mtime_nsec(csv_st);
+  header.source_ino = csv_st->st_ino;
+  header.source_dev = csv_st->st_dev;
+  header.pool_size = self->pool->len;
+  header.prefix_ofs = prefix_ofs;
+
+  /* a unique name in the target directory: parsers and processes sharing
+   * the same compiled-database() do not write each other's file */
+  fd = g_mkstemp(temp_filename);
+  if (fd < 0)
+    {
+      msg_error("add-contextual-data(): Error creating compiled database",
+                evt_tag_str("filename", temp_filename),
+                evt_tag_error("error"));
+      goto exit;
+    }
+
+  if (fchmod(fd, 0644) < 0 ||
+      !_write_all(fd, &header, sizeof(header)) ||
+      !_write_all(fd, self->records->data, self->records->len * sizeof(ContextInfoDBFileRecord)) ||
+      !_write_all(fd, self->pool->str, self->pool->len) ||
+      fsync(fd) < 0)
+    {
+      msg_error("add-contextual-data(): Error writing compiled database",
+                evt_tag_str("filename", temp_filename),
+                evt_tag_error("error"));
+      close(fd);
+      unlink(temp_filename);
+      goto exit;
+    }
+  close(fd);
+
+  /* readers either see the old or the new file, never a partial one */
+  if (rename(temp_filename, filename) < 0)
+    {
+      msg_error("add-contextual-data(): Error renaming compiled database",
+                evt_tag_str("filename", temp_filename),
+                evt_tag_str("new_filename", filename),
+                evt_tag_error("error"));
+      unlink(temp_filename);
+      goto exit;
+    }
+  result = TRUE;
+
+exit:
+  g_free(temp_filename);
+  return result;
+}
+
+/*
+ * Parses the CSV file in @fp and writes its compiled form to @filename.
+ * The records are validated by @scanner just like when loading the CSV
+ * directly, but only their source strings are kept.
+ */
+gboolean
+context_info_db_file_compile(const gchar *filename, FILE *fp, const gchar *csv_filename,
+                             const struct stat *csv_st, ContextualDataRecordScanner *scanner,
+                             const gchar *prefix)
+{
+  ContextInfoDBFileBuilder builder;
+  guint32 prefix_ofs;
+  gboolean result = FALSE;
+
+  builder.records = g_array_new(FALSE, FALSE, sizeof(ContextInfoDBFileRecord));
+  builder.pool = g_string_sized_new(4096);
+  builder.strings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  builder.csv_filename = csv_filename;
+
+  /* offset 0 is the empty string */
+  if (!_builder_add_string(&builder, "", &prefix_ofs) ||
+      !_builder_add_string(&builder, prefix ? : "", &prefix_ofs))
+    goto exit;
+
+  if (!contextual_data_record_scanner_foreach_record(scanner, fp, csv_filename, _builder_add_record, &builder))
+    goto exit;
+
+  g_array_sort_with_data(builder.records, _builder_record_cmp, builder.pool->str);
+
+  result = _builder_write(&builder, filename, csv_st, prefix_ofs);
+  if (result)
+    msg_debug("add-contextual-data(): database compiled",
+              evt_tag_str("filename", csv_filename),
+              evt_tag_str("compiled_database", filename),
+              evt_tag_int("records", builder.records->len));
+
+exit:
+  g_hash_table_unref(builder.strings);
+  g_string_free(builder.pool, TRUE);
+  g_array_free(builder.records, TRUE);
+  return result;
+}
+
+/**********************************************************************
+ * open a compiled file
+ **********************************************************************/
+
+static gboolean
+_is_header_valid(ContextInfoDBFile *self)
+{
+  const ContextInfoDBFileHeader *header = self->header;
+
+  if (memcmp(header->magic, CONTEXT_INFO_DB_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->byte_order != CONTEXT_INFO_DB_FILE_BYTE_ORDER)
+    return FALSE;
+
+  if (header->pool_size == 0 ||
+      self->map_size != sizeof(*header) + header->num_records * sizeof(ContextInfoDBFileRecord) + header->pool_size)
+    return FALSE;
+
+  /* all strings in the pool are NUL terminated, so checking the offsets
+   * makes the strings safe to use */
+  if (self->pool[header->pool_size - 1] != 0 || header->prefix_ofs >= header->pool_size)
+    return FALSE;
+
+  for (guint32 i = 0; i < header->num_records; i++)
+    {
+      const ContextInfoDBFileRecord *record = &self->records[i];
+
+      if (record->selector_ofs >= header->pool_size ||
+          record->name_ofs >= header->pool_size ||
+          record->value_ofs >= header->pool_size)
+        return FALSE;
+    }
+  return TRUE;
+}
+
+static gboolean
+_is_up_to_date(ContextInfoDBFile *self, const struct stat *csv_st, const gchar *prefix)
+{
+  const ContextInfoDBFileHeader *header = self->header;
+
+  /* an edit keeping the size within the same second is only caught by the
+   * nanosecond part, a replaced file (e.g. mv) by the inode */
+  return header->source_size == csv_st->st_size &&
+         header->source_mtime == csv_st->st_mtime &&
+         header->source_mtime_nsec == _get_mtime_nsec(csv_st) &&
+         header->source_ino == (guint64) csv_st->st_ino &&
+         header->source_dev == (guint64) csv_st->st_dev &&
+         strcmp(self->pool + header->prefix_ofs, prefix ? : "") == 0;
+}
+
+/*
+ * Returns NULL if @filename does not exist, is invalid or was compiled
+ * from a different version of the CSV file described by @csv_st.
+ */
+ContextInfoDBFile *
+context_info_db_file_open(const gchar *filename, const struct stat *csv_st, const gchar *prefix)
+{
+  ContextInfoDBFile *self;
+  struct stat st;
+  gpointer map;
+  gint fd;
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    {
+      if (errno != ENOENT)
+        msg_warning("add-contextual-data(): Error opening compiled database, recompiling",
+                    evt_tag_str("filename", filename),
+                    evt_tag_error("error"));
+      return NULL;
+    }
+
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(ContextInfoDBFileHeader))
+    {
+      close(fd);
+      return NULL;
+    }
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    {
+      msg_warning("add-contextual-data(): Error mapping compiled database, recompiling",
+                  evt_tag_str("filename", filename),
+                  evt_tag_error("error"));
+      return NULL;
+    }
+
+  self = g_new0(ContextInfoDBFile, 1);
+  self->map = map;
+  self->map_size = st.st_size;
+  self->header = (const ContextInfoDBFileHeader *) map;
+  self->records = (const ContextInfoDBFileRecord *) (self->header + 1);
+  self->pool = (const gchar *) (self->records + self->header->num_records);
+
+  if (!_is_header_valid(self))
+    {
+      msg_warning("add-contextual-data(): Invalid compiled database, recompiling",
+                  evt_tag_str("filename", filename));
+      context_info_db_file_free(self);
+      return NULL;
+    }
+
+  if (!_is_up_to_date(self, csv_st, prefix))
+    {
+      msg_debug("add-contextual-data(): Compiled database is out of date, recompiling",
+                evt_tag_str("filename", filename));
+      context_info_db_file_free(self);
+      return NULL;
+    }
+
+  return self;
+}
+
+void
+context_info_db_file_free(ContextInfoDBFile *self)
+{
+  munmap(self->map, self->map_size);
+  g_free(self);
+}
+
+/**********************************************************************
+ * lookups
+ **********************************************************************/
+
+/* returns the index of the first record not sorted before @selector, or
+ * with @past_matches, the first record sorted after it */
+static guint32
+_bisect(ContextInfoDBFile *self, const gchar *selector, gboolean past_matches)
+{
+  guint32 l = 0, h = self->header->num_records;
+
+  while (l < h)
+    {
+      guint32 m = l + ((h - l) >> 1);
+      gint cmp = g_ascii_strcasecmp(self->pool + self->records[m].selector_ofs, selector);
+
+      if (cmp < 0 || (past_matches && cmp == 0))
+        l = m + 1;
+      else
+        h = m;
+    }
+  return l;
+}
+
+/*
+ * Looks up the records whose selector matches @selector case
+ * insensitively, the range is [first, last). Case sensitive lookups have
+ * to filter the range.
+ */
+gboolean
+context_info_db_file_lookup(ContextInfoDBFile *self, const gchar *selector, guint32 *first, guint32 *last)
+{
+  *first = _bisect(self, selector, FALSE);
+  *last = _bisect(self, selector, TRUE);
+  return *first < *last;
+}
+
+guint32
+context_info_db_file_get_number_of_records(ContextInfoDBFile *self)
+{
+  return self->header->num_records;
+}
+
+const ContextInfoDBFileRecord *
+context_info_db_file_get_record(ContextInfoDBFile *self, guint32 index)
+{
+  g_assert(index < self->header->num_records);
+  return &self->records[index];
+}
+
+const gchar *
+context_info_db_file_get_string(ContextInfoDBFile *self, guint32 ofs)
+{
+  return self->pool + ofs;
+}
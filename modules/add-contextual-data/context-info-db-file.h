@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#ifndef CONTEXT_INFO_DB_FILE_H_INCLUDED
+#define CONTEXT_INFO_DB_FILE_H_INCLUDED
+
+#include "syslog-ng.h"
+#include "contextual-data-record-scanner.h"
+
+#include <stdio.h>
+#include <sys/stat.h>
+
+/*
+ * Compiled, read-only representation of an add-contextual-data CSV file,
+ * which is mmap()-ed and searched in place instead of being parsed on
+ * every startup and reload.
+ *
+ * Layout: a header, followed by the record table sorted by the
+ * case-insensitive selector (records with the same selector in CSV order),
+ * followed by a pool of NUL terminated strings the records refer to.
+ * The header stores the size, mtime (with nanoseconds), inode and device
+ * of the CSV file it was compiled from, along with the name prefix in
+ * effect, a stale file is simply recompiled.
+ */
+
+#define CONTEXT_INFO_DB_FILE_RECORD_LITERAL 0x0001
+
+typedef struct _ContextInfoDBFileRecord
+{
+  /* offsets into the string pool */
+  guint32 selector_ofs;
+  guint32 name_ofs;
+  guint32 value_ofs;
+  guint16 flags;
+  guint16 __reserved;
+  /* the line number of the record in the CSV file */
+  guint32 lineno;
+} ContextInfoDBFileRecord;
+
+typedef struct _ContextInfoDBFile ContextInfoDBFile;
+
+gboolean context_info_db_file_compile(const gchar *filename, FILE *fp, const gchar *csv_filename,
+                                      const struct stat *csv_st, ContextualDataRecordScanner *scanner,
+                                      const gchar *prefix);
+ContextInfoDBFile *context_info_db_file_open(const gchar *filename, const struct stat *csv_st, const gchar *prefix);
+void context_info_db_file_free(ContextInfoDBFile *self);
+
+gboolean context_info_db_file_lookup(ContextInfoDBFile *self, const gchar *selector, guint32 *first, guint32 *last);
+guint32 context_info_db_file_get_number_of_records(ContextInfoDBFile *self);
+const ContextInfoDBFileRecord *context_info_db_file_get_record(ContextInfoDBFile *self, guint32 index);
+const gchar *context_info_db_file_get_string(ContextInfoDBFile *self, guint32 ofs);
+
+#endif
@@ -21,6 +21,7 @@
  */
 
 #include "context-info-db.h"
+#include "context-info-db-file.h"
 #include "atomic.h"
 #include "messages.h"
 #include <string.h>
@@ -36,8 +37,20 @@ struct _ContextInfoDB
   gboolean is_ordering_enabled;
   GList *ordered_selectors;
   gboolean ignore_case;
+
+  /* set if the records are looked up in a compiled file instead of data/index */
+  ContextInfoDBFile *file;
+  GlobalConfig *cfg;
+  /* records of the compiled file indexed by their position, each slot is
+   * filled once, when the record is first used, as its template is
+   * compiled on demand */
+  ContextualDataRecord **file_records;
+  guint32 num_file_records;
 };
 
+/* marks the slot of a record whose template failed to compile */
+static ContextualDataRecord invalid_file_record;
+
 typedef struct _element_range
 {
   gsize offset;
@@ -180,9 +193,38 @@ _free_array(GArray *array)
   g_array_free(array, TRUE);
 }
 
+static void
+_file_record_free(gpointer p)
+{
+  ContextualDataRecord *record = (ContextualDataRecord *) p;
+
+  contextual_data_record_clean(record);
+  g_free(record);
+}
+
+static void
+_close_file(ContextInfoDB *self)
+{
+  if (!self->file)
+    return;
+
+  for (guint32 i = 0; i < self->num_file_records; i++)
+    {
+      if (self->file_records[i] && self->file_records[i] != &invalid_file_record)
+        _file_record_free(self->file_records[i]);
+    }
+  g_free(self->file_records);
+  self->file_records = NULL;
+  self->num_file_records = 0;
+  context_info_db_file_free(self->file);
+  self->file = NULL;
+}
+
 static void
 _free(ContextInfoDB *self)
 {
+  _close_file(self);
+
   if (self->index)
     {
       g_hash_table_unref(self->index);
@@ -208,6 +250,7 @@ _get_range_of_records(ContextInfoDB *self, const gchar *selector)
 void
 context_info_db_purge(ContextInfoDB *self)
 {
+  _close_file(self);
   g_hash_table_remove_all(self->index);
   if (self->data->len > 0)
     self->data = g_array_remove_range(self->data, 0, self->data->len);
@@ -218,18 +261,200 @@ void
 context_info_db_insert(ContextInfoDB *self,
                        const ContextualDataRecord *record)
 {
+  g_assert(!self->file);
   g_array_append_val(self->data, *record);
   self->is_data_indexed = FALSE;
   if (self->is_ordering_enabled && !g_list_find_custom(self->ordered_selectors, record->selector->str, _g_strcmp))
     self->ordered_selectors = g_list_append(self->ordered_selectors, record->selector->str);
 }
 
+static ContextualDataRecord *
+_compile_file_record(ContextInfoDB *self, const ContextInfoDBFileRecord *file_record)
+{
+  ContextualDataRecord *record = g_new(ContextualDataRecord, 1);
+  const gchar *name = context_info_db_file_get_string(self->file, file_record->name_ofs);
+  const gchar *value = context_info_db_file_get_string(self->file, file_record->value_ofs);
+  GError *error = NULL;
+
+  contextual_data_record_init(record);
+  record->value_handle = log_msg_get_value_handle(name);
+  record->value = log_template_new(self->cfg, NULL);
+
+  if (file_record->flags & CONTEXT_INFO_DB_FILE_RECORD_LITERAL)
+    {
+      log_template_compile_literal_string(record->value, value);
+    }
+  else if (!log_template_compile(record->value, value, &error))
+    {
+      msg_error("add-contextual-data(): error compiling template from compiled database",
+                evt_tag_str("selector", context_info_db_file_get_string(self->file, file_record->selector_ofs)),
+                evt_tag_str("name", name),
+                evt_tag_str("value", value),
+                evt_tag_str("error", error->message));
+      g_clear_error(&error);
+      _file_record_free(record);
+      return NULL;
+    }
+  return record;
+}
+
+/* lock-free: concurrent first lookups of the same record may both compile
+ * it, only the first one is published, the others are dropped */
+static ContextualDataRecord *
+_get_file_record(ContextInfoDB *self, guint32 index)
+{
+  ContextualDataRecord *record = g_atomic_pointer_get(&self->file_records[index]);
+
+  if (!record)
+    {
+      ContextualDataRecord *compiled = _compile_file_record(self, context_info_db_file_get_record(self->file, index));
+
+      if (!compiled)
+        compiled = &invalid_file_record;
+
+      if (g_atomic_pointer_compare_and_exchange(&self->file_records[index], NULL, compiled))
+        {
+          record = compiled;
+        }
+      else
+        {
+          if (compiled != &invalid_file_record)
+            _file_record_free(compiled);
+          record = g_atomic_pointer_get(&self->file_records[index]);
+        }
+    }
+
+  return record != &invalid_file_record ? record : NULL;
+}
+
+/* the compiled file is sorted case insensitively, case sensitive lookups
+ * need to filter the matching range */
+static inline gboolean
+_file_record_matches(ContextInfoDB *self, guint32 index, const gchar *selector)
+{
+  const ContextInfoDBFileRecord *file_record = context_info_db_file_get_record(self->file, index);
+
+  return self->ignore_case ||
+         strcmp(context_info_db_file_get_string(self->file, file_record->selector_ofs), selector) == 0;
+}
+
+static gsize
+_file_number_of_records(ContextInfoDB *self, const gchar *selector)
+{
+  guint32 first, last;
+  gsize n = 0;
+
+  if (!context_info_db_file_lookup(self->file, selector, &first, &last))
+    return 0;
+
+  for (guint32 i = first; i < last; i++)
+    {
+      if (_file_record_matches(self, i, selector))
+        n++;
+    }
+  return n;
+}
+
+static void
+_file_foreach_record(ContextInfoDB *self, const gchar *selector, ADD_CONTEXT_INFO_CB callback, gpointer arg)
+{
+  guint32 first, last;
+
+  if (!context_info_db_file_lookup(self->file, selector, &first, &last))
+    return;
+
+  for (guint32 i = first; i < last; i++)
+    {
+      if (!_file_record_matches(self, i, selector))
+        continue;
+
+      ContextualDataRecord *record = _get_file_record(self, i);
+      if (record)
+        callback(arg, record);
+    }
+}
+
+static gint
+_file_record_lineno_cmp(gconstpointer a, gconstpointer b)
+{
+  const ContextInfoDBFileRecord *r1 = *(const ContextInfoDBFileRecord **) a;
+  const ContextInfoDBFileRecord *r2 = *(const ContextInfoDBFileRecord **) b;
+
+  return (r1->lineno > r2->lineno) - (r1->lineno < r2->lineno);
+}
+
+/* distinct selectors of the compiled file, in the order of the file or
+ * in the order of their first occurrence in the CSV */
+static GList *
+_file_get_selectors(ContextInfoDB *self, gboolean in_csv_order)
+{
+  /* ordered selectors are distinct case sensitively, just like in context_info_db_insert() */
+  GHashTable *seen = (self->ignore_case && !in_csv_order)
+                     ? g_hash_table_new(_strcase_hash, _strcase_eq)
+                     : g_hash_table_new(g_str_hash, g_str_equal);
+  guint32 num_records = context_info_db_file_get_number_of_records(self->file);
+  GArray *first_records = g_array_new(FALSE, FALSE, sizeof(const ContextInfoDBFileRecord *));
+  GList *selectors = NULL;
+
+  for (guint32 i = 0; i < num_records; i++)
+    {
+      const ContextInfoDBFileRecord *file_record = context_info_db_file_get_record(self->file, i);
+      const gchar *selector = context_info_db_file_get_string(self->file, file_record->selector_ofs);
+
+      if (g_hash_table_lookup_extended(seen, selector, NULL, NULL))
+        continue;
+      g_hash_table_insert(seen, (gpointer) selector, NULL);
+      g_array_append_val(first_records, file_record);
+    }
+
+  if (in_csv_order)
+    g_array_sort(first_records, _file_record_lineno_cmp);
+
+  for (gint i = first_records->len - 1; i >= 0; i--)
+    {
+      const ContextInfoDBFileRecord *file_record = g_array_index(first_records, const ContextInfoDBFileRecord *, i);
+      selectors = g_list_prepend(selectors, (gpointer) context_info_db_file_get_string(self->file,
+                                 file_record->selector_ofs));
+    }
+
+  g_array_free(first_records, TRUE);
+  g_hash_table_unref(seen);
+  return selectors;
+}
+
+gboolean
+context_info_db_load_file(ContextInfoDB *self, const gchar *filename, const struct stat *csv_st,
+                          const gchar *prefix, GlobalConfig *cfg)
+{
+  ContextInfoDBFile *file = context_info_db_file_open(filename, csv_st, prefix);
+
+  if (!file)
+    return FALSE;
+
+  context_info_db_purge(self);
+  self->file = file;
+  self->cfg = cfg;
+  self->num_file_records = context_info_db_file_get_number_of_records(file);
+  self->file_records = g_new0(ContextualDataRecord *, self->num_file_records);
+  self->is_data_indexed = TRUE;
+
+  if (self->is_ordering_enabled)
+    {
+      g_list_free(self->ordered_selectors);
+      self->ordered_selectors = _file_get_selectors(self, TRUE);
+    }
+  return TRUE;
+}
+
 gboolean
 context_info_db_contains(ContextInfoDB *self, const gchar *selector)
 {
   if (!selector)
     return FALSE;
 
+  if (self->file)
+    return _file_number_of_records(self, selector) > 0;
+
   _ensure_indexed_db(self);
   return (_get_range_of_records(self, selector) != NULL);
 }
@@ -238,6 +463,9 @@ gsize
 context_info_db_number_of_records(ContextInfoDB *self,
                                   const gchar *selector)
 {
+  if (self->file)
+    return _file_number_of_records(self, selector);
+
   _ensure_indexed_db(self);
 
   gsize n = 0;
@@ -253,6 +481,12 @@ void
 context_info_db_foreach_record(ContextInfoDB *self, const gchar *selector,
                                ADD_CONTEXT_INFO_CB callback, gpointer arg)
 {
+  if (self->file)
+    {
+      _file_foreach_record(self, selector, callback, arg);
+      return;
+    }
+
   _ensure_indexed_db(self);
 
   element_range *record_range = _get_range_of_records(self, selector);
@@ -278,34 +512,31 @@ context_info_db_is_indexed(const ContextInfoDB *self)
 gboolean
 context_info_db_is_loaded(const ContextInfoDB *self)
 {
+  if (self->file)
+    return context_info_db_file_get_number_of_records(self->file) > 0;
   return (self->data != NULL && self->data->len > 0);
 }
 
 GList *
 context_info_db_get_selectors(ContextInfoDB *self)
 {
+  if (self->file)
+    return _file_get_selectors(self, FALSE);
+
   _ensure_indexed_db(self);
   return g_hash_table_get_keys(self->index);
 }
 
-static void
-_truncate_eol(gchar *line, gsize line_len)
-{
-  if (line_len >= 2 && line[line_len - 2] == '\r' && line[line_len - 1] == '\n')
-    line[line_len - 2] = '\0';
-  else if (line_len >= 1 && line[line_len - 1] == '\n')
-    line[line_len - 1] = '\0';
-}
-
 static gboolean
-_get_line_without_eol(gchar **line_buf, gsize *line_buf_len, FILE *fp)
+_import_record(gpointer user_data, ContextualDataRecord *record, gint lineno)
 {
-  gssize n;
-  if ((n = getline(line_buf, line_buf_len, fp)) == -1)
-    return FALSE;
+  ContextInfoDB *self = (ContextInfoDB *) user_data;
 
-  _truncate_eol(*line_buf, n);
-  *line_buf_len = strlen(*line_buf);
+  msg_trace("add-contextual-data(): adding database entry",
+            evt_tag_str("selector", record->selector->str),
+            evt_tag_str("name", log_msg_get_value_name(record->value_handle, NULL)),
+            evt_tag_str("value", record->value->template));
+  context_info_db_insert(self, record);
   return TRUE;
 }
 
@@ -313,31 +544,12 @@ gboolean
 context_info_db_import(ContextInfoDB *self, FILE *fp, const gchar *filename,
                        ContextualDataRecordScanner *scanner)
 {
-  size_t line_buf_len;
-  gchar *line_buf = NULL;
-  gint lineno = 0;
-  const ContextualDataRecord *next_record;
-
-  while (_get_line_without_eol(&line_buf, &line_buf_len, fp))
+  if (!contextual_data_record_scanner_foreach_record(scanner, fp, filename, _import_record, self))
     {
-      lineno++;
-      if (line_buf_len == 0)
-        continue;
-      next_record = contextual_data_record_scanner_get_next(scanner, line_buf, filename, lineno);
-      if (!next_record)
-        {
-          context_info_db_purge(self);
-          g_free(line_buf);
-          return FALSE;
-        }
-      msg_trace("add-contextual-data(): adding database entry",
-                evt_tag_str("selector", next_record->selector->str),
-                evt_tag_str("name", log_msg_get_value_name(next_record->value_handle, NULL)),
-                evt_tag_str("value", next_record->value->template));
-      context_info_db_insert(self, next_record);
+      context_info_db_purge(self);
+      return FALSE;
     }
 
-  g_free(line_buf);
   context_info_db_index(self);
 
   return TRUE;
@@ -26,6 +26,7 @@
 #include "syslog-ng.h"
 #include "contextual-data-record-scanner.h"
 #include <stdio.h>
+#include <sys/stat.h>
 
 typedef struct _ContextInfoDB ContextInfoDB;
 
@@ -59,6 +60,8 @@ GList *context_info_db_get_selectors(ContextInfoDB *self);
 
 gboolean context_info_db_import(ContextInfoDB *self, FILE *fp, const gchar *filename,
                                 ContextualDataRecordScanner *scanner);
+gboolean context_info_db_load_file(ContextInfoDB *self, const gchar *filename, const struct stat *csv_st,
+                                   const gchar *prefix, GlobalConfig *cfg);
 
 
 ContextInfoDB *context_info_db_new(gboolean ignore_case);
@@ -170,6 +170,56 @@ contextual_data_record_scanner_get_next(ContextualDataRecordScanner *self,
   return &self->last_record;
 }
 
+static void
+_truncate_eol(gchar *line, gsize line_len)
+{
+  if (line_len >= 2 && line[line_len - 2] == '\r' && line[line_len - 1] == '\n')
+    line[line_len - 2] = '\0';
+  else if (line_len >= 1 && line[line_len - 1] == '\n')
+    line[line_len - 1] = '\0';
+}
+
+static gboolean
+_get_line_without_eol(gchar **line_buf, gsize *line_buf_len, FILE *fp)
+{
+  gssize n;
+  if ((n = getline(line_buf, line_buf_len, fp)) == -1)
+    return FALSE;
+
+  _truncate_eol(*line_buf, n);
+  *line_buf_len = strlen(*line_buf);
+  return TRUE;
+}
+
+/* scans @fp line-by-line, returns FALSE if a line could not be parsed or
+ * if @func stopped the scan */
+gboolean
+contextual_data_record_scanner_foreach_record(ContextualDataRecordScanner *self, FILE *fp, const gchar *filename,
+                                              ContextualDataRecordFunc func, gpointer user_data)
+{
+  size_t line_buf_len;
+  gchar *line_buf = NULL;
+  gint lineno = 0;
+  ContextualDataRecord *next_record;
+  gboolean result = TRUE;
+
+  while (_get_line_without_eol(&line_buf, &line_buf_len, fp))
+    {
+      lineno++;
+      if (line_buf_len == 0)
+        continue;
+      next_record = contextual_data_record_scanner_get_next(self, line_buf, filename, lineno);
+      if (!next_record || !func(user_data, next_record, lineno))
+        {
+          result = FALSE;
+          break;
+        }
+    }
+
+  g_free(line_buf);
+  return result;
+}
+
 void
 contextual_data_record_scanner_free(ContextualDataRecordScanner *self)
 {
@@ -25,13 +25,20 @@
 
 #include "contextual-data-record.h"
 
+#include <stdio.h>
 
 typedef struct _ContextualDataRecordScanner ContextualDataRecordScanner;
 
+/* the callback takes over the ownership of @record, returning FALSE stops the scan */
+typedef gboolean (*ContextualDataRecordFunc)(gpointer user_data, ContextualDataRecord *record, gint lineno);
+
 ContextualDataRecord *contextual_data_record_scanner_get_next(ContextualDataRecordScanner *self,
     const gchar *input,
     const gchar *filename,
     gint lineno);
+gboolean contextual_data_record_scanner_foreach_record(ContextualDataRecordScanner *self, FILE *fp,
+                                                       const gchar *filename, ContextualDataRecordFunc func,
+                                                       gpointer user_data);
 
 ContextualDataRecordScanner *contextual_data_record_scanner_new(GlobalConfig *cfg, const gchar *name_prefix);
 void contextual_data_record_scanner_free(ContextualDataRecordScanner *self);
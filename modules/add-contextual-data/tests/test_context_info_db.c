@@ -21,6 +21,8 @@
  */
 
 #include "context-info-db.h"
+#include "context-info-db-file.h"
+#include "add-contextual-data.h"
 #include "apphook.h"
 #include "scratch-buffers.h"
 #include "cfg.h"
@@ -29,6 +31,8 @@
 #include <criterion/parameterized.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
 
@@ -538,6 +542,220 @@ Test(add_contextual_data, test_selected_nvpairs_when_ignore_case_on)
   contextual_data_record_scanner_free(scanner);
 }
 
+#define COMPILED_TEST_CSV "test_context_info_db_compiled.csv"
+#define COMPILED_TEST_DB "test_context_info_db_compiled.cdb"
+
+static ContextInfoDB *
+_compile_and_load_csv(const gchar *csv_content, gboolean ignore_case, const gchar *prefix)
+{
+  ContextInfoDB *db = context_info_db_new(ignore_case);
+  ContextualDataRecordScanner *scanner = contextual_data_record_scanner_new(configuration, prefix);
+  struct stat st;
+  FILE *fp;
+
+  unlink(COMPILED_TEST_DB);
+  cr_assert(g_file_set_contents(COMPILED_TEST_CSV, csv_content, -1, NULL));
+  cr_assert_eq(stat(COMPILED_TEST_CSV, &st), 0);
+
+  cr_assert_not(context_info_db_load_file(db, COMPILED_TEST_DB, &st, prefix, configuration),
+                "Loading a non-existent compiled database should fail");
+
+  fp = fopen(COMPILED_TEST_CSV, "r");
+  cr_assert(context_info_db_file_compile(COMPILED_TEST_DB, fp, COMPILED_TEST_CSV, &st, scanner, prefix));
+  fclose(fp);
+  contextual_data_record_scanner_free(scanner);
+
+  cr_assert(context_info_db_load_file(db, COMPILED_TEST_DB, &st, prefix, configuration));
+  return db;
+}
+
+Test(add_contextual_data, test_compiled_database_lookups)
+{
+  ContextInfoDB *db = _compile_and_load_csv("selector3,name3,value3\n"
+                                            "selector1,name1,value1\n"
+                                            "selector2,name2,value2\n"
+                                            "selector1,name1.1,$(echo $HOST_FROM)\n"
+                                            "SELECTOR1,name1.2,value1.2\n", FALSE, NULL);
+
+  cr_assert(context_info_db_is_loaded(db));
+  cr_assert(context_info_db_is_indexed(db));
+  cr_assert(context_info_db_contains(db, "selector2"));
+  cr_assert_not(context_info_db_contains(db, "selector4"));
+  cr_assert_not(context_info_db_contains(db, "Selector2"));
+  cr_assert_eq(context_info_db_number_of_records(db, "selector1"), 2);
+  cr_assert_eq(context_info_db_number_of_records(db, "SELECTOR1"), 1);
+
+  TestNVPair expected_nvpairs_selector1[] =
+  {
+    {.name = "name1", .value = "value1"},
+    {.name = "name1.1", .value = "kismacska"},
+  };
+  _assert_context_info_db_contains_name_value_pairs_by_selector(db, "selector1", expected_nvpairs_selector1,
+      ARRAY_SIZE(expected_nvpairs_selector1));
+
+  GList *selectors = context_info_db_get_selectors(db);
+  cr_assert_eq(g_list_length(selectors), 4);
+  g_list_free(selectors);
+
+  context_info_db_unref(db);
+}
+
+Test(add_contextual_data, test_compiled_database_ignore_case_keeps_csv_order)
+{
+  ContextInfoDB *db = _compile_and_load_csv("selector,name1,value1\n"
+                                            "SeLeCtOr,name2,value2\n"
+                                            "another,name4,value4\n"
+                                            "sElEcToR,name3,value3\n", TRUE, NULL);
+
+  TestNVPair expected_nvpairs[] =
+  {
+    {.name = "name1", .value = "value1"},
+    {.name = "name2", .value = "value2"},
+    {.name = "name3", .value = "value3"},
+  };
+  _assert_context_info_db_contains_name_value_pairs_by_selector(db, "SELECTOR", expected_nvpairs,
+      ARRAY_SIZE(expected_nvpairs));
+  cr_assert(context_info_db_contains(db, "ANOTHER"));
+
+  context_info_db_unref(db);
+}
+
+Test(add_contextual_data, test_compiled_database_ordered_selectors_follow_the_csv)
+{
+  ContextInfoDB *db = context_info_db_new(FALSE);
+  ContextualDataRecordScanner *scanner = contextual_data_record_scanner_new(configuration, NULL);
+  struct stat st;
+  FILE *fp;
+
+  context_info_db_enable_ordering(db);
+  cr_assert(g_file_set_contents(COMPILED_TEST_CSV, "zzz,name,value\naaa,name,value\nzzz,name2,value2\n", -1, NULL));
+  cr_assert_eq(stat(COMPILED_TEST_CSV, &st), 0);
+  fp = fopen(COMPILED_TEST_CSV, "r");
+  cr_assert(context_info_db_file_compile(COMPILED_TEST_DB, fp, COMPILED_TEST_CSV, &st, scanner, NULL));
+  fclose(fp);
+  cr_assert(context_info_db_load_file(db, COMPILED_TEST_DB, &st, NULL, configuration));
+
+  GList *selectors = context_info_db_ordered_selectors(db);
+  cr_assert_eq(g_list_length(selectors), 2);
+  cr_assert_str_eq(selectors->data, "zzz");
+  cr_assert_str_eq(selectors->next->data, "aaa");
+
+  context_info_db_unref(db);
+  contextual_data_record_scanner_free(scanner);
+}
+
+Test(add_contextual_data, test_compiled_database_is_rejected_if_out_of_date)
+{
+  ContextInfoDB *db = _compile_and_load_csv("selector1,name1,value1\n", FALSE, "prefix.");
+  struct stat st;
+
+  TestNVPair expected_nvpairs[] =
+  {
+    {.name = "prefix.name1", .value = "value1"},
+  };
+  _assert_context_info_db_contains_name_value_pairs_by_selector(db, "selector1", expected_nvpairs,
+      ARRAY_SIZE(expected_nvpairs));
+
+  cr_assert_eq(stat(COMPILED_TEST_CSV, &st), 0);
+  cr_assert_not(context_info_db_load_file(db, COMPILED_TEST_DB, &st, "other-prefix.", configuration));
+
+  st.st_size++;
+  cr_assert_not(context_info_db_load_file(db, COMPILED_TEST_DB, &st, "prefix.", configuration));
+  st.st_size--;
+
+  /* same size and mtime, but a different file, e.g. replaced by mv */
+  st.st_ino++;
+  cr_assert_not(context_info_db_load_file(db, COMPILED_TEST_DB, &st, "prefix.", configuration));
+  st.st_ino--;
+
+  cr_assert(context_info_db_load_file(db, COMPILED_TEST_DB, &st, "prefix.", configuration));
+
+  context_info_db_unref(db);
+}
+
+Test(add_contextual_data, test_compiled_database_compile_fails_on_invalid_csv)
+{
+  ContextualDataRecordScanner *scanner = contextual_data_record_scanner_new(configuration, NULL);
+  struct stat st;
+  FILE *fp;
+
+  unlink(COMPILED_TEST_DB);
+  cr_assert(g_file_set_contents(COMPILED_TEST_CSV, "selector1,name1,value1\nselector2,name2\n", -1, NULL));
+  cr_assert_eq(stat(COMPILED_TEST_CSV, &st), 0);
+  fp = fopen(COMPILED_TEST_CSV, "r");
+  cr_assert_not(context_info_db_file_compile(COMPILED_TEST_DB, fp, COMPILED_TEST_CSV, &st, scanner, NULL));
+  fclose(fp);
+  cr_assert_neq(access(COMPILED_TEST_DB, F_OK), 0);
+
+  contextual_data_record_scanner_free(scanner);
+}
+
+static gpointer
+_preload_parser(gpointer user_data)
+{
+  return GINT_TO_POINTER(log_pipe_preload((LogPipe *) user_data));
+}
+
+static void
+_assert_no_temp_files_left(const gchar *compiled_database)
+{
+  gchar *temp_prefix = g_strdup_printf("%s.", compiled_database);
+  GDir *dir = g_dir_open(".", 0, NULL);
+  const gchar *fname;
+
+  cr_assert(dir);
+  while ((fname = g_dir_read_name(dir)))
+    cr_assert_not(g_str_has_prefix(fname, temp_prefix), "Temporary file left behind: %s", fname);
+  g_dir_close(dir);
+  g_free(temp_prefix);
+}
+
+Test(add_contextual_data, test_compiled_database_shared_by_parser_clones)
+{
+  gchar *cwd = g_get_current_dir();
+  gchar *csv = g_build_filename(cwd, COMPILED_TEST_CSV, NULL);
+  gchar *compiled_database = g_build_filename(cwd, COMPILED_TEST_DB, NULL);
+  LogParser *parser = add_contextual_data_parser_new(configuration);
+  struct stat st;
+
+  cr_assert(g_file_set_contents(csv, "selector1,name1,value1\nselector2,name2,value2\n", -1, NULL));
+  add_contextual_data_set_filename(parser, csv);
+  add_contextual_data_set_compiled_database(parser, compiled_database);
+
+  /* a parser referenced from two log paths: its clones are preloaded in
+   * parallel and compile the same database */
+  for (gint round = 0; round < 20; round++)
+    {
+      LogPipe *clones[2];
+      GThread *threads[2];
+
+      unlink(compiled_database);
+      for (gint i = 0; i < G_N_ELEMENTS(clones); i++)
+        clones[i] = log_pipe_clone(&parser->super);
+      for (gint i = 0; i < G_N_ELEMENTS(clones); i++)
+        threads[i] = g_thread_create(_preload_parser, clones[i], TRUE, NULL);
+      for (gint i = 0; i < G_N_ELEMENTS(clones); i++)
+        {
+          cr_assert(GPOINTER_TO_INT(g_thread_join(threads[i])), "Preloading a clone failed");
+          log_pipe_unref(clones[i]);
+        }
+    }
+
+  _assert_no_temp_files_left(COMPILED_TEST_DB);
+
+  ContextInfoDB *db = context_info_db_new(FALSE);
+  cr_assert_eq(stat(csv, &st), 0);
+  cr_assert(context_info_db_load_file(db, compiled_database, &st, NULL, configuration),
+            "The compiled database is valid and up to date");
+  cr_assert_eq(context_info_db_number_of_records(db, "selector2"), 1);
+  context_info_db_unref(db);
+
+  log_pipe_unref(&parser->super);
+  g_free(compiled_database);
+  g_free(csv);
+  g_free(cwd);
+}
+
 static void
 setup(void)
 {
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include "affile-dest-writer-cache.h"
+#include "template/repr.h"
+#include "template/macros.h"
+#include "logmsg/logmsg.h"
+#include "timeutils/zoneinfo.h"
+#include "timeutils/misc.h"
+#include "mainloop-worker.h"
+
+#include <string.h>
+
+#define AFFILE_DW_CACHE_MAX_ENTRIES 4096
+
+typedef enum
+{
+  FTI_VALUE,
+  FTI_HOST,
+  FTI_PRI,
+  FTI_TIME,
+} FilenameTemplateInputType;
+
+typedef struct _FilenameTemplateInput
+{
+  FilenameTemplateInputType type;
+  NVHandle handle;
+  gint timestamp;
+  glong granularity;
+} FilenameTemplateInput;
+
+typedef struct _AFFileDestWriterCacheKey
+{
+  gsize len;
+  const gchar *data;
+} AFFileDestWriterCacheKey;
+
+typedef struct _AFFileDestWriterThreadCache
+{
+  GHashTable *entries;
+  guint generation;
+  GString *key;
+  gboolean key_valid;
+} AFFileDestWriterThreadCache;
+
+struct _AFFileDestWriterCache
+{
+  GArray *inputs;
+  const LogTemplateOptions *template_options;
+  AFFileDestWriterThreadCache *threads[MAIN_LOOP_MAX_WORKER_THREADS];
+};
+
+static guint
+_key_hash(gconstpointer k)
+{
+  const AFFileDestWriterCacheKey *key = (const AFFileDestWriterCacheKey *) k;
+  guint hash = 5381;
+
+  for (gsize i = 0; i < key->len; i++)
+    hash = (hash << 5) + hash + (guchar) key->data[i];
+  return hash;
+}
+
+static gboolean
+_key_equal(gconstpointer a, gconstpointer b)
+{
+  const AFFileDestWriterCacheKey *key_a = (const AFFileDestWriterCacheKey *) a;
+  const AFFileDestWriterCacheKey *key_b = (const AFFileDestWriterCacheKey *) b;
+
+  return key_a->len == key_b->len && memcmp(key_a->data, key_b->data, key_a->len) == 0;
+}
+
+static AFFileDestWriterCacheKey *
+_key_dup(const GString *key_data)
+{
+  AFFileDestWriterCacheKey *key = g_malloc(sizeof(AFFileDestWriterCacheKey) + key_data->len);
+  gchar *data = (gchar *) (key + 1);
+
+  memcpy(data, key_data->str, key_data->len);
+  key->data = data;
+  key->len = key_data->len;
+  return key;
+}
+
+/* how long the value of a time macro stays the same, in seconds of wall clock time */
+static glong
+_get_time_macro_granularity(gint id)
+{
+  switch (id)
+    {
+    case M_YEAR:
+    case M_YEAR_DAY:
+    case M_MONTH:
+    case M_MONTH_WEEK:
+    case M_MONTH_ABBREV:
+    case M_MONTH_NAME:
+    case M_DAY:
+    case M_WEEK_DAY:
+    case M_WEEK_DAY_ABBREV:
+    case M_WEEK_DAY_NAME:
+    case M_WEEK:
+    case M_ISOWEEK:
+    case M_TZOFFSET:
+    case M_TZ:
+      return 24 * 3600;
+    case M_HOUR:
+    case M_HOUR12:
+    case M_AMPM:
+      return 3600;
+    case M_MIN:
+      return 60;
+    case M_SEC:
+      return 1;
+    default:
+      /* these depend on the fraction of the second or on ts-format() */
+      return 0;
+    }
+}
+
+static gboolean
+_analyze_time_macro(gint id, FilenameTemplateInput *input)
+{
+  if (id >= M_TIME_FIRST && id <= M_TIME_LAST)
+    {
+      input->timestamp = LM_TS_STAMP;
+    }
+  else if (id >= M_TIME_FIRST + M_RECVD_OFS && id <= M_TIME_LAST + M_RECVD_OFS)
+    {
+      id -= M_RECVD_OFS;
+      input->timestamp = LM_TS_RECVD;
+    }
+  else if (id >= M_TIME_FIRST + M_STAMP_OFS && id <= M_TIME_LAST + M_STAMP_OFS)
+    {
+      id -= M_STAMP_OFS;
+      input->timestamp = LM_TS_STAMP;
+    }
+  else
+    {
+      /* C_ and P_ macros use the current time */
+      return FALSE;
+    }
+
+  input->type = FTI_TIME;
+  input->granularity = _get_time_macro_granularity(id);
+  return input->granularity > 0;
+}
+
+static gboolean
+_analyze_macro(gint id, FilenameTemplateInput *input)
+{
+  switch (id)
+    {
+    case M_HOST:
+      input->type = FTI_HOST;
+      return TRUE;
+    case M_FACILITY:
+    case M_FACILITY_NUM:
+    case M_SEVERITY:
+    case M_SEVERITY_NUM:
+    case M_PRI:
+      input->type = FTI_PRI;
+      return TRUE;
+    default:
+      return _analyze_time_macro(id, input);
+    }
+}
+
+static gboolean
+_analyze_template(AFFileDestWriterCache *self, const LogTemplate *filename_template)
+{
+  for (GList *l = filename_template->compiled_template; l; l = l->next)
+    {
+      LogTemplateElem *e = (LogTemplateElem *) l->data;
+      FilenameTemplateInput input = { 0 };
+
+      if (e->msg_ref != 0)
+        return FALSE;
+
+      switch (e->type)
+        {
+        case LTE_MACRO:
+          if (e->macro == M_NONE)
+            continue;
+          if (!_analyze_macro(e->macro, &input))
+            return FALSE;
+          break;
+        case LTE_VALUE:
+          input.type = FTI_VALUE;
+          input.handle = e->value_handle;
+          break;
+        default:
+          /* template functions may depend on anything */
+          return FALSE;
+        }
+      g_array_append_val(self->inputs, input);
+    }
+  return TRUE;
+}
+
+static void
+_append_value(GString *key, const gchar *value, gssize value_len)
+{
+  g_string_append_len(key, (const gchar *) &value_len, sizeof(value_len));
+  g_string_append_len(key, value, value_len);
+}
+
+static void
+_append_time_bucket(AFFileDestWriterCache *self, GString *key, const UnixTime *stamp, glong granularity)
+{
+  gint32 gmtoff = time_zone_info_get_offset(self->template_options->time_zone_info[LTZ_LOCAL], stamp->ut_sec);
+
+  /* the same fallbacks as convert_unix_time_to_wall_clock_time_with_tz_override() */
+  if (gmtoff == -1)
+    gmtoff = stamp->ut_gmtoff;
+  if (gmtoff == -1)
+    gmtoff = get_local_timezone_ofs(stamp->ut_sec);
+
+  gint64 local_time = (gint64) stamp->ut_sec + gmtoff;
+  gint64 bucket = local_time / granularity - (local_time % granularity < 0);
+
+  g_string_append_len(key, (const gchar *) &gmtoff, sizeof(gmtoff));
+  g_string_append_len(key, (const gchar *) &bucket, sizeof(bucket));
+}
+
+static void
+_format_key(AFFileDestWriterCache *self, LogMessage *msg, GString *key)
+{
+  const gchar *value;
+  gssize value_len;
+
+  g_string_truncate(key, 0);
+  for (guint i = 0; i < self->inputs->len; i++)
+    {
+      FilenameTemplateInput *input = &g_array_index(self->inputs, FilenameTemplateInput, i);
+
+      switch (input->type)
+        {
+        case FTI_VALUE:
+          value = log_msg_get_value(msg, input->handle, &value_len);
+          _append_value(key, value, value_len);
+          break;
+        case FTI_HOST:
+          value = log_msg_get_value(msg, LM_V_HOST, &value_len);
+          _append_value(key, value, value_len);
+          g_string_append_c(key, (msg->flags & LF_CHAINED_HOSTNAME) ? 1 : 0);
+          break;
+        case FTI_PRI:
+          g_string_append_len(key, (const gchar *) &msg->pri, sizeof(msg->pri));
+          break;
+        case FTI_TIME:
+          _append_time_bucket(self, key, &msg->timestamps[input->timestamp], input->granularity);
+          break;
+        default:
+          g_assert_not_reached();
+        }
+    }
+}
+
+static AFFileDestWriterThreadCache *
+_get_thread_cache(AFFileDestWriterCache *self)
+{
+  gint thread_id = main_loop_worker_get_thread_id();
+
+  /* threads without a worker id render the template every time */
+  if (thread_id < 0 || thread_id >= MAIN_LOOP_MAX_WORKER_THREADS)
+    return NULL;
+
+  if (!self->threads[thread_id])
+    {
+      AFFileDestWriterThreadCache *thread_cache = g_new0(AFFileDestWriterThreadCache, 1);
+
+      thread_cache->entries = g_hash_table_new_full(_key_hash, _key_equal, g_free, NULL);
+      thread_cache->key = g_string_sized_new(64);
+      self->threads[thread_id] = thread_cache;
+    }
+  return self->threads[thread_id];
+}
+
+static void
+_thread_cache_free(AFFileDestWriterThreadCache *self)
+{
+  g_hash_table_destroy(self->entries);
+  g_string_free(self->key, TRUE);
+  g_free(self);
+}
+
+gboolean
+affile_dw_cache_lookup(AFFileDestWriterCache *self, LogMessage *msg, gpointer *writer, guint *generation)
+{
+  AFFileDestWriterThreadCache *thread_cache = _get_thread_cache(self);
+
+  if (!thread_cache)
+    return FALSE;
+
+  _format_key(self, msg, thread_cache->key);
+  thread_cache->key_valid = TRUE;
+
+  AFFileDestWriterCacheKey key = { .len = thread_cache->key->len, .data = thread_cache->key->str };
+  *writer = g_hash_table_lookup(thread_cache->entries, &key);
+  *generation = thread_cache->generation;
+  return *writer != NULL;
+}
+
+void
+affile_dw_cache_store(AFFileDestWriterCache *self, gpointer writer, guint generation)
+{
+  AFFileDestWriterThreadCache *thread_cache = _get_thread_cache(self);
+
+  if (!thread_cache || !thread_cache->key_valid)
+    return;
+
+  thread_cache->key_valid = FALSE;
+  if (thread_cache->generation != generation ||
+      g_hash_table_size(thread_cache->entries) >= AFFILE_DW_CACHE_MAX_ENTRIES)
+    {
+      g_hash_table_remove_all(thread_cache->entries);
+      thread_cache->generation = generation;
+    }
+  g_hash_table_insert(thread_cache->entries, _key_dup(thread_cache->key), writer);
+}
+
+AFFileDestWriterCache *
+affile_dw_cache_new(const LogTemplate *filename_template, const LogTemplateOptions *template_options)
+{
+  AFFileDestWriterCache *self = g_new0(AFFileDestWriterCache, 1);
+
+  self->inputs = g_array_new(FALSE, TRUE, sizeof(FilenameTemplateInput));
+  self->template_options = template_options;
+  if (!_analyze_template(self, filename_template))
+    {
+      affile_dw_cache_free(self);
+      return NULL;
+    }
+  return self;
+}
+
+void
+affile_dw_cache_free(AFFileDestWriterCache *self)
+{
+  for (gint i = 0; i < MAIN_LOOP_MAX_WORKER_THREADS; i++)
+    {
+      if (self->threads[i])
+        _thread_cache_free(self->threads[i]);
+    }
+  g_array_free(self->inputs, TRUE);
+  g_free(self);
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#ifndef AFFILE_DEST_WRITER_CACHE_H_INCLUDED
+#define AFFILE_DEST_WRITER_CACHE_H_INCLUDED
+
+#include "syslog-ng.h"
+#include "template/templates.h"
+
+/*
+ * Per-thread cache mapping the inputs of a templated filename (the
+ * name-value pairs it refers to, plus the time bucket of its date macros)
+ * to an already opened AFFileDestWriter, so that the template does not
+ * need to be rendered for every message.
+ *
+ * The cache does not hold references: every entry is tagged with the
+ * generation it was stored with.  The destination driver bumps its
+ * generation whenever a writer may go away (reap, reopen, deinit) and
+ * only uses an entry if the generations still match, under its lock.
+ */
+typedef struct _AFFileDestWriterCache AFFileDestWriterCache;
+
+/* returns NULL if the template depends on something we can't key on */
+AFFileDestWriterCache *affile_dw_cache_new(const LogTemplate *filename_template,
+                                           const LogTemplateOptions *template_options);
+void affile_dw_cache_free(AFFileDestWriterCache *self);
+
+gboolean affile_dw_cache_lookup(AFFileDestWriterCache *self, LogMessage *msg,
+                                gpointer *writer, guint *generation);
+/* stores @writer under the key of the last lookup on the current thread */
+void affile_dw_cache_store(AFFileDestWriterCache *self, gpointer writer, guint generation);
+
+#endif
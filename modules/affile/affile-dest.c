@@ -34,6 +34,7 @@
 #include "transport/transport-pipe.h"
 #include "logwriter.h"
 #include "affile-dest-internal-queue-filter.h"
+#include "affile-dest-writer-cache.h"
 #include "file-specializations.h"
 #include "apphook.h"
 #include "timeutils/cache.h"
@@ -84,6 +85,13 @@
  * forwarding it to the next pipe, thus a reference is taken under the
  * protection of the lock, keeping a the next pipe alive, even if that would
  * go away in a parallel reaper process.
+ *
+ * With a templated filename, worker threads also remember which writer
+ * the inputs of the template (e.g. $HOST and the day of the timestamp)
+ * resolved to last time (writer_cache).  These entries are not references,
+ * they are only used if writer_generation has not changed since they were
+ * stored; it is bumped under the lock whenever a writer is reaped or
+ * reopened.
  */
 
 static GList *affile_dest_drivers = NULL;
@@ -95,6 +103,7 @@ struct _AFFileDestWriter
   AFFileDestDriver *owner;
   gchar *filename;
   LogWriter *writer;
+  LogProtoFileWriterStats write_stats;
   time_t last_msg_stamp;
   time_t last_open_stamp;
   gboolean reopen_pending, queue_pending;
@@ -159,7 +168,8 @@ affile_dw_reopen(AFFileDestWriter *self)
       LogTransport *transport = file_opener_construct_transport(self->owner->file_opener, fd);
 
       proto = file_opener_construct_dst_proto(self->owner->file_opener, transport,
-                                              &self->owner->writer_options.proto_options.super);
+                                              &self->owner->writer_options.proto_options.super,
+                                              &self->write_stats);
     }
   else if (open_result == FILE_OPENER_RESULT_ERROR_PERMANENT)
     {
@@ -177,6 +187,41 @@ affile_dw_reopen(AFFileDestWriter *self)
   return TRUE;
 }
 
+static void
+affile_dw_register_write_stats(AFFileDestWriter *self)
+{
+  const LogWriterOptions *writer_options = &self->owner->writer_options;
+  StatsClusterKey sc_key;
+
+  stats_lock();
+  stats_cluster_single_key_set_with_name(&sc_key, writer_options->stats_source | SCS_DESTINATION,
+                                         self->owner->super.super.id, self->filename, "writes");
+  stats_register_counter(writer_options->stats_level, &sc_key, SC_TYPE_SINGLE_VALUE, &self->write_stats.writes);
+
+  /* cumulative time spent in write() and sync calls, divide by writes for the average */
+  stats_cluster_single_key_set_with_name(&sc_key, writer_options->stats_source | SCS_DESTINATION,
+                                         self->owner->super.super.id, self->filename, "write_latency_usec");
+  stats_register_counter(writer_options->stats_level, &sc_key, SC_TYPE_SINGLE_VALUE,
+                         &self->write_stats.write_latency);
+  stats_unlock();
+}
+
+static void
+affile_dw_unregister_write_stats(AFFileDestWriter *self)
+{
+  const LogWriterOptions *writer_options = &self->owner->writer_options;
+  StatsClusterKey sc_key;
+
+  stats_lock();
+  stats_cluster_single_key_set_with_name(&sc_key, writer_options->stats_source | SCS_DESTINATION,
+                                         self->owner->super.super.id, self->filename, "writes");
+  stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &self->write_stats.writes);
+  stats_cluster_single_key_set_with_name(&sc_key, writer_options->stats_source | SCS_DESTINATION,
+                                         self->owner->super.super.id, self->filename, "write_latency_usec");
+  stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &self->write_stats.write_latency);
+  stats_unlock();
+}
+
 static gboolean
 affile_dw_init(LogPipe *s)
 {
@@ -203,11 +248,13 @@ affile_dw_init(LogPipe *s)
     }
 
   log_pipe_append(&self->super, (LogPipe *) self->writer);
+  affile_dw_register_write_stats(self);
 
   if (!affile_dw_reopen(self))
     {
       log_pipe_deinit((LogPipe *) self->writer);
       log_writer_set_queue(self->writer, NULL);
+      affile_dw_unregister_write_stats(self);
       goto error;
     }
 
@@ -231,6 +278,7 @@ affile_dw_deinit(LogPipe *s)
     }
 
   log_writer_set_queue(self->writer, NULL);
+  affile_dw_unregister_write_stats(self);
 
   return TRUE;
 }
@@ -357,6 +405,11 @@ static void
 affile_dd_reopen_all_writers(gpointer data, gpointer user_data)
 {
   AFFileDestDriver *driver = (AFFileDestDriver *) data;
+
+  g_static_mutex_lock(&driver->lock);
+  driver->writer_generation++;
+  g_static_mutex_unlock(&driver->lock);
+
   if (driver->single_writer)
     affile_dw_reopen(driver->single_writer);
   else if (driver->writer_hash)
@@ -390,7 +443,23 @@ affile_dd_set_fsync(LogDriver *s, gboolean use_fsync)
 {
   AFFileDestDriver *self = (AFFileDestDriver *) s;
 
-  self->use_fsync = use_fsync;
+  self->file_writer_options.fsync = use_fsync;
+}
+
+void
+affile_dd_set_sync_interval(LogDriver *s, gint sync_interval)
+{
+  AFFileDestDriver *self = (AFFileDestDriver *) s;
+
+  self->file_writer_options.sync_interval = sync_interval;
+}
+
+void
+affile_dd_set_preallocate(LogDriver *s, gint64 preallocate)
+{
+  AFFileDestDriver *self = (AFFileDestDriver *) s;
+
+  self->file_writer_options.preallocate = preallocate;
 }
 
 void
@@ -434,6 +503,7 @@ affile_dd_reap_writer(AFFileDestDriver *self, AFFileDestWriter *dw)
     {
       /* remove from hash table */
       g_hash_table_remove(self->writer_hash, dw->filename);
+      self->writer_generation++;
     }
   else
     {
@@ -494,6 +564,7 @@ affile_dd_init(LogPipe *s)
       self->writer_hash = cfg_persist_config_fetch(cfg, affile_dd_format_persist_name(s));
       if (self->writer_hash)
         g_hash_table_foreach(self->writer_hash, affile_dd_reuse_writer, self);
+      self->writer_cache = affile_dw_cache_new(self->filename_template, &self->writer_options.template_options);
     }
   else
     {
@@ -564,6 +635,13 @@ affile_dd_deinit(LogPipe *s)
 {
   AFFileDestDriver *self = (AFFileDestDriver *) s;
   GlobalConfig *cfg = log_pipe_get_config(s);
+
+  if (self->writer_cache)
+    {
+      affile_dw_cache_free(self->writer_cache);
+      self->writer_cache = NULL;
+    }
+
   /* NOTE: we free all AFFileDestWriter instances here as otherwise we'd
    * have circular references between AFFileDestDriver and file writers */
   if (self->single_writer)
@@ -675,6 +753,66 @@ affile_dd_open_writer(gpointer args[])
   return NULL;
 }
 
+static AFFileDestWriter *
+affile_dd_lookup_cached_writer(AFFileDestDriver *self, LogMessage *msg)
+{
+  AFFileDestWriter *next = NULL;
+  gpointer cached_writer;
+  guint generation;
+
+  if (!self->writer_cache ||
+      !affile_dw_cache_lookup(self->writer_cache, msg, &cached_writer, &generation))
+    return NULL;
+
+  g_static_mutex_lock(&self->lock);
+  if (generation == self->writer_generation)
+    {
+      next = (AFFileDestWriter *) cached_writer;
+      log_pipe_ref(&next->super);
+      next->queue_pending = TRUE;
+    }
+  g_static_mutex_unlock(&self->lock);
+  return next;
+}
+
+static AFFileDestWriter *
+affile_dd_find_or_open_templated_writer(AFFileDestDriver *self, LogMessage *msg)
+{
+  AFFileDestWriter *next;
+  gpointer args[2] = { self, NULL };
+  GString *filename;
+  guint generation;
+
+  filename = g_string_sized_new(32);
+  LogTemplateEvalOptions options = {&self->writer_options.template_options, LTZ_LOCAL, 0, NULL};
+  log_template_format(self->filename_template, msg, &options, filename);
+
+  g_static_mutex_lock(&self->lock);
+  generation = self->writer_generation;
+  if (self->writer_hash)
+    next = g_hash_table_lookup(self->writer_hash, filename->str);
+  else
+    next = NULL;
+
+  if (next)
+    {
+      log_pipe_ref(&next->super);
+      next->queue_pending = TRUE;
+      g_static_mutex_unlock(&self->lock);
+    }
+  else
+    {
+      g_static_mutex_unlock(&self->lock);
+      args[1] = filename;
+      next = main_loop_call((void *(*)(void *)) affile_dd_open_writer, args, TRUE);
+    }
+  g_string_free(filename, TRUE);
+
+  if (next && self->writer_cache)
+    affile_dw_cache_store(self->writer_cache, next, generation);
+  return next;
+}
+
 static void
 affile_dd_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
 {
@@ -704,31 +842,9 @@ affile_dd_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
     }
   else
     {
-      GString *filename;
-
-      filename = g_string_sized_new(32);
-      LogTemplateEvalOptions options = {&self->writer_options.template_options, LTZ_LOCAL, 0, NULL};
-      log_template_format(self->filename_template, msg, &options, filename);
-
-      g_static_mutex_lock(&self->lock);
-      if (self->writer_hash)
-        next = g_hash_table_lookup(self->writer_hash, filename->str);
-      else
-        next = NULL;
-
-      if (next)
-        {
-          log_pipe_ref(&next->super);
-          next->queue_pending = TRUE;
-          g_static_mutex_unlock(&self->lock);
-        }
-      else
-        {
-          g_static_mutex_unlock(&self->lock);
-          args[1] = filename;
-          next = main_loop_call((void *(*)(void *)) affile_dd_open_writer, args, TRUE);
-        }
-      g_string_free(filename, TRUE);
+      next = affile_dd_lookup_cached_writer(self, msg);
+      if (!next)
+        next = affile_dd_find_or_open_templated_writer(self, msg);
     }
   if (next)
     {
@@ -781,6 +897,7 @@ affile_dd_new_instance(LogTemplate *filename_template, GlobalConfig *cfg)
       self->filename_is_a_template = TRUE;
     }
   file_opener_options_defaults(&self->file_opener_options);
+  log_proto_file_writer_options_defaults(&self->file_writer_options);
 
   affile_dd_set_time_reap(&self->super.super, self->filename_is_a_template ? -1 : 0);
   g_static_mutex_init(&self->lock);
@@ -797,7 +914,7 @@ affile_dd_new(LogTemplate *filename_template, GlobalConfig *cfg)
 
   self->writer_flags |= LW_SOFT_FLOW_CONTROL;
   self->writer_options.stats_source = stats_register_type("file");
-  self->file_opener = file_opener_for_regular_dest_files_new(&self->writer_options, &self->use_fsync);
+  self->file_opener = file_opener_for_regular_dest_files_new(&self->writer_options, &self->file_writer_options);
   return &self->super.super;
 }
 
@@ -27,6 +27,8 @@
 #include "driver.h"
 #include "logwriter.h"
 #include "file-opener.h"
+#include "logproto-file-writer.h"
+#include "affile-dest-writer-cache.h"
 
 typedef struct _AFFileDestWriter AFFileDestWriter;
 
@@ -38,13 +40,15 @@ typedef struct _AFFileDestDriver
   AFFileDestWriter *single_writer;
   gboolean filename_is_a_template;
   gboolean template_escape;
-  gboolean use_fsync;
+  LogProtoFileWriterOptions file_writer_options;
   FileOpenerOptions file_opener_options;
   FileOpener *file_opener;
   TimeZoneInfo *local_time_zone_info;
   LogWriterOptions writer_options;
   guint32 writer_flags;
   GHashTable *writer_hash;
+  AFFileDestWriterCache *writer_cache;
+  guint writer_generation;
 
   gint overwrite_if_older;
   gboolean use_time_recvd;
@@ -55,6 +59,8 @@ LogDriver *affile_dd_new(LogTemplate *filename_template, GlobalConfig *cfg);
 
 void affile_dd_set_create_dirs(LogDriver *s, gboolean create_dirs);
 void affile_dd_set_fsync(LogDriver *s, gboolean enable);
+void affile_dd_set_sync_interval(LogDriver *s, gint sync_interval);
+void affile_dd_set_preallocate(LogDriver *s, gint64 preallocate);
 void affile_dd_set_overwrite_if_older(LogDriver *s, gint overwrite_if_older);
 void affile_dd_set_local_time_zone(LogDriver *s, const gchar *local_time_zone);
 void affile_dd_set_time_reap(LogDriver *s, gint time_reap);
@@ -45,6 +45,8 @@ static CfgLexerKeyword affile_keywords[] =
   { "force_directory_polling", KW_FORCE_DIRECTORY_POLLING, KWS_OBSOLETE, "Use wildcard-file(monitor-method())" },
 
   { "fsync",              KW_FSYNC },
+  { "sync_interval",      KW_SYNC_INTERVAL },
+  { "preallocate",        KW_PREALLOCATE },
   { "remove_if_older",    KW_OVERWRITE_IF_OLDER, KWS_OBSOLETE, "overwrite_if_older" },
   { "overwrite_if_older", KW_OVERWRITE_IF_OLDER },
   { "follow_freq",        KW_FOLLOW_FREQ },
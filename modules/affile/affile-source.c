@@ -111,6 +111,7 @@ affile_sd_deinit(LogPipe *s)
   AFFileSourceDriver *self = (AFFileSourceDriver *) s;
 
   log_pipe_deinit(&self->file_reader->super);
+  file_reader_options_deinit_inotify(&self->file_reader_options);
   if (!log_src_driver_deinit_method(s))
     return FALSE;
 
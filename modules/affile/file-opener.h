@@ -32,6 +32,7 @@
 #include "logproto/logproto-server.h"
 #include "logproto/logproto-client.h"
 #include "logproto-file-reader.h"
+#include "logproto-file-writer.h"
 #include <string.h>
 
 typedef enum
@@ -64,7 +65,8 @@ struct _FileOpener
   LogTransport *(*construct_transport)(FileOpener *self, gint fd);
   LogProtoServer *(*construct_src_proto)(FileOpener *self, LogTransport *transport,
                                          LogProtoFileReaderOptions *proto_options);
-  LogProtoClient *(*construct_dst_proto)(FileOpener *self, LogTransport *transport, LogProtoClientOptions *proto_options);
+  LogProtoClient *(*construct_dst_proto)(FileOpener *self, LogTransport *transport, LogProtoClientOptions *proto_options,
+                                         LogProtoFileWriterStats *stats);
 };
 
 static inline LogTransport *
@@ -80,9 +82,10 @@ file_opener_construct_src_proto(FileOpener *self, LogTransport *transport, LogPr
 }
 
 static inline LogProtoClient *
-file_opener_construct_dst_proto(FileOpener *self, LogTransport *transport, LogProtoClientOptions *proto_options)
+file_opener_construct_dst_proto(FileOpener *self, LogTransport *transport, LogProtoClientOptions *proto_options,
+                                LogProtoFileWriterStats *stats)
 {
-  return self->construct_dst_proto(self, transport, proto_options);
+  return self->construct_dst_proto(self, transport, proto_options, stats);
 }
 
 FileOpenerResult file_opener_open_fd(FileOpener *self, const gchar *name, FileDirection dir, gint *fd);
@@ -92,19 +92,31 @@ _is_fd_pollable(gint fd)
   return pollable;
 }
 
+static PollEvents *
+_construct_poll_file_changes(FileReader *self, gint fd)
+{
+  LogProtoFileReaderOptions *proto_opts = file_reader_options_get_log_proto_options(self->options);
+  PollEvents *poll_events;
+
+  if (proto_opts->super.mode == MLM_NONE)
+    poll_events = poll_file_changes_new(fd, self->filename->str, self->options->follow_freq, &self->super);
+  else
+    poll_events = poll_multiline_file_changes_new(fd, self->filename->str, self->options->follow_freq,
+                                                  self->options->multi_line_timeout, self);
+
+#if SYSLOG_NG_HAVE_INOTIFY
+  if (self->options->inotify && fd >= 0)
+    poll_file_changes_watch_with_inotify((PollFileChanges *) poll_events, self->options->inotify);
+#endif
+
+  return poll_events;
+}
+
 static PollEvents *
 _construct_poll_events(FileReader *self, gint fd)
 {
   if (self->options->follow_freq > 0)
-    {
-      LogProtoFileReaderOptions *proto_opts = file_reader_options_get_log_proto_options(self->options);
-
-      if (proto_opts->super.mode == MLM_NONE)
-        return poll_file_changes_new(fd, self->filename->str, self->options->follow_freq, &self->super);
-      else
-        return poll_multiline_file_changes_new(fd, self->filename->str, self->options->follow_freq,
-                                               self->options->multi_line_timeout, self);
-    }
+    return _construct_poll_file_changes(self, fd);
   else if (fd >= 0 && _is_fd_pollable(fd))
     return poll_fd_events_new(fd);
   else
@@ -394,6 +406,7 @@ file_reader_options_defaults(FileReaderOptions *options)
   log_proto_file_reader_options_defaults(file_reader_options_get_log_proto_options(options));
   options->reader_options.parse_options.flags |= LP_LOCAL;
   options->restore_state = FALSE;
+  options->follow_with_inotify = TRUE;
 }
 
 static gboolean
@@ -411,6 +424,51 @@ file_reader_options_validate(FileReaderOptions *options)
   return TRUE;
 }
 
+#if SYSLOG_NG_HAVE_INOTIFY
+
+static void
+_init_inotify(FileReaderOptions *options)
+{
+  if (options->inotify || !options->follow_with_inotify || options->follow_freq <= 0)
+    return;
+
+  options->inotify = g_new0(struct iv_inotify, 1);
+  IV_INOTIFY_INIT(options->inotify);
+  if (iv_inotify_register(options->inotify) != 0)
+    {
+      msg_debug("file-reader: could not create inotify object, polling files with follow-freq()",
+                evt_tag_error("error"));
+      g_free(options->inotify);
+      options->inotify = NULL;
+    }
+}
+
+/* the readers using the inotify object must be deinitialized already */
+void
+file_reader_options_deinit_inotify(FileReaderOptions *options)
+{
+  if (!options->inotify)
+    return;
+
+  iv_inotify_unregister(options->inotify);
+  g_free(options->inotify);
+  options->inotify = NULL;
+}
+
+#else
+
+static void
+_init_inotify(FileReaderOptions *options)
+{
+}
+
+void
+file_reader_options_deinit_inotify(FileReaderOptions *options)
+{
+}
+
+#endif
+
 gboolean
 file_reader_options_init(FileReaderOptions *options, GlobalConfig *cfg, const gchar *group)
 {
@@ -419,12 +477,15 @@ file_reader_options_init(FileReaderOptions *options, GlobalConfig *cfg, const gc
   if (!file_reader_options_validate(options))
     return FALSE;
 
+  _init_inotify(options);
+
   return log_proto_file_reader_options_init(file_reader_options_get_log_proto_options(options));
 }
 
 void
 file_reader_options_deinit(FileReaderOptions *options)
 {
+  file_reader_options_deinit_inotify(options);
   log_reader_options_destroy(&options->reader_options);
   log_proto_file_reader_options_destroy(file_reader_options_get_log_proto_options(options));
 }
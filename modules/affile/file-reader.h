@@ -26,6 +26,10 @@
 #include "logreader.h"
 #include "file-opener.h"
 
+#if SYSLOG_NG_HAVE_INOTIFY
+#include <iv_inotify.h>
+#endif
+
 typedef struct _FileReaderOptions
 {
   gint follow_freq;
@@ -33,6 +37,11 @@ typedef struct _FileReaderOptions
   gboolean restore_state;
   LogReaderOptions reader_options;
   gboolean exit_on_eof;
+  gboolean follow_with_inotify;
+#if SYSLOG_NG_HAVE_INOTIFY
+  /* shared by all readers of the source */
+  struct iv_inotify *inotify;
+#endif
 } FileReaderOptions;
 
 typedef struct _FileReader
@@ -73,6 +82,7 @@ void file_reader_options_set_multi_line_timeout(FileReaderOptions *options, gint
 
 void file_reader_options_defaults(FileReaderOptions *options);
 gboolean file_reader_options_init(FileReaderOptions *options, GlobalConfig *cfg, const gchar *group);
+void file_reader_options_deinit_inotify(FileReaderOptions *options);
 void file_reader_options_deinit(FileReaderOptions *options);
 
 
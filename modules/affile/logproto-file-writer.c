@@ -23,11 +23,14 @@
 
 #include "logproto-file-writer.h"
 #include "messages.h"
+#include "apphook.h"
 
 #include <string.h>
 #include <errno.h>
 #include <sys/uio.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>
 
 typedef struct _LogProtoFileWriter
 {
@@ -40,9 +43,157 @@ typedef struct _LogProtoFileWriter
   gint fd;
   gint sum_len;
   gboolean fsync;
+  gint sync_interval;
+  gint64 preallocate;
+  /* our idea of the end of file, the file is opened with O_APPEND */
+  gint64 offset;
+  gint64 preallocated_end;
+  gint64 last_sync;
+  gboolean unsynced;
+  LogProtoFileWriterStats *stats;
   struct iovec buffer[0];
 } LogProtoFileWriter;
 
+/*
+ * Reserve disk space ahead of the write position in preallocate() sized
+ * chunks, so that the filesystem does not need to allocate blocks on every
+ * append.  FALLOC_FL_KEEP_SIZE leaves the file size alone, readers never see
+ * the reserved area.
+ */
+static void
+_preallocate(LogProtoFileWriter *self, gsize len)
+{
+#if defined(SYSLOG_NG_HAVE_FALLOCATE) && defined(FALLOC_FL_KEEP_SIZE)
+  if (self->preallocate <= 0 || self->offset + len <= self->preallocated_end)
+    return;
+
+  gint64 start = MAX(self->offset, self->preallocated_end);
+  gint64 end = ((self->offset + len) / self->preallocate + 1) * self->preallocate;
+
+  if (fallocate(self->fd, FALLOC_FL_KEEP_SIZE, start, end - start) < 0)
+    {
+      msg_debug("Error preallocating space for destination file, preallocation disabled for this file",
+                evt_tag_int("fd", self->fd),
+                evt_tag_error(EVT_TAG_OSERROR));
+      self->preallocate = 0;
+      return;
+    }
+  self->preallocated_end = end;
+#endif
+}
+
+static void
+_datasync(LogProtoFileWriter *self)
+{
+#ifdef SYSLOG_NG_HAVE_FDATASYNC
+  fdatasync(self->fd);
+#else
+  fsync(self->fd);
+#endif
+  self->last_sync = g_get_monotonic_time();
+  self->unsynced = FALSE;
+}
+
+static gboolean
+_is_sync_due(LogProtoFileWriter *self)
+{
+  return self->unsynced &&
+         g_get_monotonic_time() - self->last_sync >= self->sync_interval * G_USEC_PER_SEC;
+}
+
+/*
+ * Closing the file is not waited for: the last fdatasync() of a file is
+ * done by a separate thread on a duplicate of its fd, as the writer is
+ * freed from the main thread, e.g. during reload.
+ */
+static GThreadPool *close_sync_pool;
+
+static void
+_close_sync(gpointer data, gpointer user_data)
+{
+  gint fd = GPOINTER_TO_INT(data) - 1;
+
+#ifdef SYSLOG_NG_HAVE_FDATASYNC
+  fdatasync(fd);
+#else
+  fsync(fd);
+#endif
+  close(fd);
+}
+
+static void
+_stop_close_sync(gint type, gpointer user_data)
+{
+  /* files closed before shutdown are still synced */
+  g_thread_pool_free(close_sync_pool, FALSE, TRUE);
+  close_sync_pool = NULL;
+}
+
+static void
+_datasync_in_background(LogProtoFileWriter *self)
+{
+  gint fd = dup(self->fd);
+
+  if (fd < 0)
+    {
+      _datasync(self);
+      return;
+    }
+
+  if (!close_sync_pool)
+    {
+      close_sync_pool = g_thread_pool_new(_close_sync, NULL, 1, FALSE, NULL);
+      register_application_hook(AH_SHUTDOWN, _stop_close_sync, NULL, AHM_RUN_ONCE);
+    }
+  g_thread_pool_push(close_sync_pool, GINT_TO_POINTER(fd + 1), NULL);
+  self->unsynced = FALSE;
+}
+
+static void
+_sync_written_data(LogProtoFileWriter *self, gint64 start, gssize len)
+{
+  if (self->fsync)
+    {
+      fsync(self->fd);
+      return;
+    }
+
+  if (self->sync_interval <= 0)
+    return;
+
+#if defined(SYSLOG_NG_HAVE_SYNC_FILE_RANGE) && defined(SYNC_FILE_RANGE_WRITE)
+  /* start writeback right away, the periodic fdatasync() has less to wait for */
+  sync_file_range(self->fd, start, len, SYNC_FILE_RANGE_WRITE);
+#endif
+
+  self->unsynced = TRUE;
+  if (_is_sync_due(self))
+    _datasync(self);
+}
+
+static gint64
+_prepare_write(LogProtoFileWriter *self, gsize len)
+{
+  _preallocate(self, len);
+  return g_get_monotonic_time();
+}
+
+static void
+_finish_write(LogProtoFileWriter *self, gssize rc, gint64 write_start)
+{
+  if (rc > 0)
+    {
+      _sync_written_data(self, self->offset, rc);
+      self->offset += rc;
+    }
+
+  if (self->stats)
+    {
+      stats_counter_inc(self->stats->writes);
+      stats_counter_add(self->stats->write_latency, g_get_monotonic_time() - write_start);
+    }
+}
+
 /*
  * log_proto_file_writer_flush:
  *
@@ -56,15 +207,16 @@ log_proto_file_writer_flush(LogProtoClient *s)
 {
   LogProtoFileWriter *self = (LogProtoFileWriter *)s;
   gint rc, i, i0, sum, ofs, pos;
+  gint64 write_start;
 
   if (self->partial)
     {
       /* there is still some data from the previous file writing process */
       gint len = self->partial_len - self->partial_pos;
 
+      write_start = _prepare_write(self, len);
       rc = log_transport_write(self->super.transport, self->partial + self->partial_pos, len);
-      if (rc > 0 && self->fsync)
-        fsync(self->fd);
+      _finish_write(self, rc, write_start);
       if (rc < 0)
         {
           goto write_error;
@@ -82,13 +234,18 @@ log_proto_file_writer_flush(LogProtoClient *s)
         }
     }
 
-  /* we might be called from log_writer_deinit() without having a buffer at all */
+  /* we might be called from log_writer_deinit() without having a buffer at
+   * all, or by an idle LogWriter when our sync-interval() has elapsed */
   if (self->buf_count == 0)
-    return LPS_SUCCESS;
+    {
+      if (_is_sync_due(self))
+        _datasync(self);
+      return LPS_SUCCESS;
+    }
 
+  write_start = _prepare_write(self, self->sum_len);
   rc = log_transport_writev(self->super.transport, self->buffer, self->buf_count);
-  if (rc > 0 && self->fsync)
-    fsync(self->fd);
+  _finish_write(self, rc, write_start);
 
   if (rc < 0)
     {
@@ -214,7 +371,62 @@ log_proto_file_writer_prepare(LogProtoClient *s, gint *fd, GIOCondition *cond, g
   if (!pending_write && s->options->timeout > 0)
     *timeout = s->options->timeout;
 
-  return pending_write;
+  /* a due sync is done by flush() */
+  return pending_write || _is_sync_due(self);
+}
+
+static gint
+log_proto_file_writer_get_idle_flush_timeout(LogProtoClient *s)
+{
+  LogProtoFileWriter *self = (LogProtoFileWriter *) s;
+
+  if (!self->unsynced)
+    return -1;
+
+  gint64 remaining_usec = self->last_sync + self->sync_interval * G_USEC_PER_SEC - g_get_monotonic_time();
+  return MAX(remaining_usec / 1000, 0);
+}
+
+static void
+log_proto_file_writer_free(LogProtoClient *s)
+{
+  LogProtoFileWriter *self = (LogProtoFileWriter *) s;
+
+  if (self->unsynced)
+    _datasync_in_background(self);
+  log_proto_client_free_method(s);
+}
+
+void
+log_proto_file_writer_set_sync_interval(LogProtoClient *s, gint sync_interval)
+{
+  LogProtoFileWriter *self = (LogProtoFileWriter *) s;
+
+  self->sync_interval = sync_interval;
+}
+
+void
+log_proto_file_writer_set_preallocate(LogProtoClient *s, gint64 preallocate)
+{
+  LogProtoFileWriter *self = (LogProtoFileWriter *) s;
+
+  self->preallocate = preallocate;
+}
+
+void
+log_proto_file_writer_set_stats(LogProtoClient *s, LogProtoFileWriterStats *stats)
+{
+  LogProtoFileWriter *self = (LogProtoFileWriter *) s;
+
+  self->stats = stats;
+}
+
+void
+log_proto_file_writer_options_defaults(LogProtoFileWriterOptions *options)
+{
+  options->fsync = FALSE;
+  options->sync_interval = 0;
+  options->preallocate = 0;
 }
 
 LogProtoClient *
@@ -237,8 +449,16 @@ log_proto_file_writer_new(LogTransport *transport, const LogProtoClientOptions *
   self->fd = transport->fd;
   self->buf_size = flush_lines;
   self->fsync = fsync_;
+  self->last_sync = g_get_monotonic_time();
+
+  struct stat st;
+  if (fstat(self->fd, &st) == 0)
+    self->offset = st.st_size;
+
   self->super.prepare = log_proto_file_writer_prepare;
   self->super.post = log_proto_file_writer_post;
   self->super.flush = log_proto_file_writer_flush;
+  self->super.get_idle_flush_timeout = log_proto_file_writer_get_idle_flush_timeout;
+  self->super.free_fn = log_proto_file_writer_free;
   return &self->super;
 }
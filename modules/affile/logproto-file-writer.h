@@ -25,8 +25,30 @@
 #define LOG_PROTO_FILE_WRITER_H_INCLUDED
 
 #include "logproto/logproto-client.h"
+#include "stats/stats-counter.h"
+
+typedef struct _LogProtoFileWriterOptions
+{
+  gboolean fsync;
+  /* seconds between fdatasync() calls, 0 means we leave it to the kernel */
+  gint sync_interval;
+  /* size of the chunks reserved ahead of the write position with fallocate() */
+  gint64 preallocate;
+} LogProtoFileWriterOptions;
+
+/* per-file counters owned by the destination, any of them may be NULL */
+typedef struct _LogProtoFileWriterStats
+{
+  StatsCounterItem *writes;
+  StatsCounterItem *write_latency;
+} LogProtoFileWriterStats;
 
 LogProtoClient *log_proto_file_writer_new(LogTransport *transport, const LogProtoClientOptions *options,
                                           gint flush_lines, gboolean fsync);
+void log_proto_file_writer_set_sync_interval(LogProtoClient *s, gint sync_interval);
+void log_proto_file_writer_set_preallocate(LogProtoClient *s, gint64 preallocate);
+void log_proto_file_writer_set_stats(LogProtoClient *s, LogProtoFileWriterStats *stats);
+
+void log_proto_file_writer_options_defaults(LogProtoFileWriterOptions *options);
 
 #endif
@@ -36,6 +36,12 @@
 #include <stdlib.h>
 #include <iv.h>
 #include <iv_work.h>
+#if SYSLOG_NG_HAVE_INOTIFY
+#include <sys/vfs.h>
+#endif
+
+/* with a working inotify watch the follow timer is only a safety net */
+#define POLL_FILE_CHANGES_INOTIFY_RECHECK_FREQ 10000
 
 
 static inline void
@@ -64,8 +70,38 @@ poll_file_changes_on_eof(PollFileChanges *self)
   return result;
 }
 
+#if SYSLOG_NG_HAVE_INOTIFY
+
+static gboolean
+_is_inotify_watch_active(PollFileChanges *self)
+{
+  return self->inotify_watch_registered;
+}
+
+/* the follow timer found new content that inotify did not tell us about:
+ * this filesystem does not deliver events, stick to polling */
+static void
+_check_inotify_delivery(PollFileChanges *self)
+{
+  if (!self->inotify_watch_registered || !self->inotify_trusted || self->inotify_woken)
+    return;
+
+  msg_debug("poll-file-changes: inotify did not report changes, falling back to polling",
+            evt_tag_str("follow_filename", self->follow_filename));
+  self->inotify_trusted = FALSE;
+}
+
+#else
+
+static void
+_check_inotify_delivery(PollFileChanges *self)
+{
+}
+
+#endif
+
 /* follow timer callback. Check if the file has new content, or deleted or
- * moved.  Ran every follow_freq seconds.  */
+ * moved.  Ran every follow_freq seconds, or when inotify reports a change.  */
 static void
 poll_file_changes_check_file(gpointer s)
 {
@@ -110,6 +146,8 @@ poll_file_changes_check_file(gpointer s)
 
       if (pos < st.st_size || !S_ISREG(st.st_mode))
         {
+          if (pos < st.st_size)
+            _check_inotify_delivery(self);
           msg_trace("poll-file-changes: file has new content: initiate reading");
           poll_file_changes_on_read(self);
           return;
@@ -153,8 +191,244 @@ reschedule:
   poll_events_update_watches(s, G_IO_IN);
 }
 
+#if SYSLOG_NG_HAVE_INOTIFY
+
+static gboolean
+_is_unlinked(PollFileChanges *self)
+{
+  struct stat st;
+
+  return fstat(self->fd, &st) == 0 && st.st_nlink == 0;
+}
+
+/*
+ * inotify returns the same wd for every watch on the same inode, and
+ * ivykis keys its watches by wd.  Two readers of the same iv_inotify may
+ * follow the same inode (e.g. a wildcard pattern matching the rotated name
+ * of a file still being read), so we keep track of the wds in use: only
+ * the first reader gets the watch, unregistering it would drop the watch
+ * of the other one as well.  Only used from the main thread.
+ */
+typedef struct _InotifyWatchKey
+{
+  struct iv_inotify *inotify;
+  gint wd;
+} InotifyWatchKey;
+
+static GHashTable *inotify_watches;
+
+static guint
+_inotify_watch_key_hash(gconstpointer k)
+{
+  const InotifyWatchKey *key = (const InotifyWatchKey *) k;
+
+  return g_direct_hash(key->inotify) ^ (guint) key->wd;
+}
+
+static gboolean
+_inotify_watch_key_equal(gconstpointer a, gconstpointer b)
+{
+  const InotifyWatchKey *key_a = (const InotifyWatchKey *) a;
+  const InotifyWatchKey *key_b = (const InotifyWatchKey *) b;
+
+  return key_a->inotify == key_b->inotify && key_a->wd == key_b->wd;
+}
+
+static gboolean
+_claim_inotify_wd(PollFileChanges *self)
+{
+  InotifyWatchKey key = { self->inotify, self->inotify_watch.wd };
+
+  if (!inotify_watches)
+    inotify_watches = g_hash_table_new_full(_inotify_watch_key_hash, _inotify_watch_key_equal, g_free, NULL);
+
+  if (g_hash_table_lookup(inotify_watches, &key))
+    return FALSE;
+
+  InotifyWatchKey *new_key = g_new(InotifyWatchKey, 1);
+  *new_key = key;
+  g_hash_table_insert(inotify_watches, new_key, self);
+  return TRUE;
+}
+
+static void
+_release_inotify_wd(PollFileChanges *self)
+{
+  InotifyWatchKey key = { self->inotify, self->inotify_watch.wd };
+
+  g_hash_table_remove(inotify_watches, &key);
+  if (g_hash_table_size(inotify_watches) == 0)
+    {
+      g_hash_table_destroy(inotify_watches);
+      inotify_watches = NULL;
+    }
+}
+
+/* the reader keeps reading the file it has open, while a watch added by
+ * name would follow whatever file has that name now: once the file is
+ * moved or removed, the reader only polls */
+static void
+_fall_back_to_polling(PollFileChanges *self)
+{
+  if (self->inotify_watch_registered)
+    {
+      _release_inotify_wd(self);
+      iv_inotify_watch_unregister(&self->inotify_watch);
+      self->inotify_watch_registered = FALSE;
+    }
+  self->inotify = NULL;
+  self->inotify_trusted = FALSE;
+}
+
+static void
+_on_inotify_event(gpointer s, struct inotify_event *event)
+{
+  PollFileChanges *self = (PollFileChanges *) s;
+
+  if (event->mask & IN_IGNORED)
+    {
+      /* the kernel removed the watch, ivykis has already forgotten about it */
+      _release_inotify_wd(self);
+      self->inotify_watch_registered = FALSE;
+      self->inotify = NULL;
+      self->inotify_trusted = FALSE;
+      return;
+    }
+
+  if ((event->mask & (IN_MOVE_SELF | IN_DELETE_SELF)) ||
+      ((event->mask & IN_ATTRIB) && _is_unlinked(self)))
+    {
+      /* the followed name may be recreated without any event on this
+       * inode, look for it at follow_freq */
+      _fall_back_to_polling(self);
+    }
+
+  /* while the reader is busy, update_watches() checks for new data anyway */
+  if (!iv_timer_registered(&self->follow_timer))
+    return;
+
+  iv_timer_unregister(&self->follow_timer);
+  self->inotify_woken = TRUE;
+  poll_file_changes_check_file(self);
+}
+
+static gboolean
+_filesystem_delivers_inotify_events(gint fd)
+{
+  struct statfs sfs;
+
+  if (fstatfs(fd, &sfs) < 0)
+    return FALSE;
+
+  /* changes made by other hosts are never reported on network filesystems */
+  switch ((guint32) sfs.f_type)
+    {
+    case 0x6969:      /* NFS_SUPER_MAGIC */
+    case 0x517B:      /* SMB_SUPER_MAGIC */
+    case 0xFE534D42:  /* SMB2_MAGIC_NUMBER */
+    case 0xFF534D42:  /* CIFS_MAGIC_NUMBER */
+    case 0x5346414F:  /* AFS_SUPER_MAGIC */
+    case 0x00C36400:  /* CEPH_SUPER_MAGIC */
+    case 0x47504653:  /* GPFS_SUPER_MAGIC */
+    case 0x0BD00BD0:  /* LUSTRE_SUPER_MAGIC */
+      return FALSE;
+    default:
+      return TRUE;
+    }
+}
+
+static void
+_start_inotify_watch(PollFileChanges *self)
+{
+  if (!self->inotify || self->inotify_watch_registered)
+    return;
+
+  IV_INOTIFY_WATCH_INIT(&self->inotify_watch);
+  self->inotify_watch.inotify = self->inotify;
+  self->inotify_watch.pathname = self->follow_filename;
+  self->inotify_watch.mask = IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF;
+  self->inotify_watch.cookie = self;
+  self->inotify_watch.handler = _on_inotify_event;
+
+  if (iv_inotify_watch_register(&self->inotify_watch) != 0)
+    {
+      msg_debug("poll-file-changes: unable to add inotify watch, polling the file",
+                evt_tag_str("follow_filename", self->follow_filename),
+                evt_tag_error("error"));
+      self->inotify = NULL;
+      return;
+    }
+
+  if (!_claim_inotify_wd(self))
+    {
+      /* ivykis did not take our watch, the kernel watch is not ours to remove */
+      msg_debug("poll-file-changes: file is already watched by another reader, polling the file",
+                evt_tag_str("follow_filename", self->follow_filename));
+      self->inotify = NULL;
+      return;
+    }
+  self->inotify_watch_registered = TRUE;
+}
+
+static void
+_stop_inotify_watch(PollFileChanges *self)
+{
+  if (!self->inotify_watch_registered)
+    return;
+
+  _release_inotify_wd(self);
+  iv_inotify_watch_unregister(&self->inotify_watch);
+  self->inotify_watch_registered = FALSE;
+}
+
+static gint
+_get_follow_timer_freq(PollFileChanges *self)
+{
+  /* a pending multi-line timeout is evaluated on the follow timer, keep its frequency */
+  if (self->inotify_watch_registered && self->inotify_trusted && !self->on_eof)
+    return MAX(self->follow_freq, POLL_FILE_CHANGES_INOTIFY_RECHECK_FREQ);
+  return self->follow_freq;
+}
+
+/* NOTE: fd must be the open file behind follow_filename */
 void
-poll_file_changes_stop_watches(PollEvents *s)
+poll_file_changes_watch_with_inotify(PollFileChanges *self, struct iv_inotify *inotify)
+{
+  g_assert(self->fd >= 0);
+
+  if (!_filesystem_delivers_inotify_events(self->fd))
+    {
+      msg_debug("poll-file-changes: filesystem does not deliver inotify events, polling the file",
+                evt_tag_str("follow_filename", self->follow_filename));
+      return;
+    }
+
+  self->inotify = inotify;
+  self->inotify_trusted = TRUE;
+}
+
+#else
+
+static void
+_start_inotify_watch(PollFileChanges *self)
+{
+}
+
+static void
+_stop_inotify_watch(PollFileChanges *self)
+{
+}
+
+static gint
+_get_follow_timer_freq(PollFileChanges *self)
+{
+  return self->follow_freq;
+}
+
+#endif
+
+void
+poll_file_changes_suspend_watches(PollEvents *s)
 {
   PollFileChanges *self = (PollFileChanges *) s;
 
@@ -162,12 +436,21 @@ poll_file_changes_stop_watches(PollEvents *s)
     iv_timer_unregister(&self->follow_timer);
 }
 
+void
+poll_file_changes_stop_watches(PollEvents *s)
+{
+  PollFileChanges *self = (PollFileChanges *) s;
+
+  poll_file_changes_suspend_watches(s);
+  _stop_inotify_watch(self);
+}
+
 static void
-poll_file_changes_rearm_timer(PollFileChanges *self)
+poll_file_changes_rearm_timer(PollFileChanges *self, gint msec)
 {
   iv_validate_now();
   self->follow_timer.expires = iv_now;
-  timespec_add_msec(&self->follow_timer.expires, self->follow_freq);
+  timespec_add_msec(&self->follow_timer.expires, msec);
   iv_timer_register(&self->follow_timer);
 }
 
@@ -197,21 +480,40 @@ poll_file_changes_update_watches(PollEvents *s, GIOCondition cond)
 {
   PollFileChanges *self = (PollFileChanges *) s;
   gboolean check_again = TRUE;
+  gboolean end_of_file;
 
   /* we can only provide input events */
   g_assert((cond & ~G_IO_IN) == 0);
 
-  poll_file_changes_stop_watches(s);
+  poll_file_changes_suspend_watches(s);
+
+  /* the watch goes first, so that a write racing with the EOF check below
+   * either shows up there or as an event */
+  _start_inotify_watch(self);
 
-  if (poll_file_changes_check_eof(self))
+  end_of_file = poll_file_changes_check_eof(self);
+  if (end_of_file)
     {
       msg_trace("End of file, following file",
                 evt_tag_str("follow_filename", self->follow_filename));
       check_again = poll_file_changes_on_eof(self);
     }
 
-  if (check_again)
-    poll_file_changes_rearm_timer(self);
+  if (!check_again)
+    return;
+
+#if SYSLOG_NG_HAVE_INOTIFY
+  if (!end_of_file && _is_inotify_watch_active(self))
+    {
+      /* written while the reader was busy and events were ignored, check now */
+      self->inotify_woken = TRUE;
+      poll_file_changes_rearm_timer(self, 0);
+      return;
+    }
+  self->inotify_woken = FALSE;
+#endif
+
+  poll_file_changes_rearm_timer(self, _get_follow_timer_freq(self));
 }
 
 void
@@ -219,6 +521,7 @@ poll_file_changes_free(PollEvents *s)
 {
   PollFileChanges *self = (PollFileChanges *) s;
 
+  _stop_inotify_watch(self);
   log_pipe_unref(self->control);
   g_free(self->follow_filename);
 }
@@ -228,6 +531,7 @@ poll_file_changes_init_instance(PollFileChanges *self, gint fd, const gchar *fol
                                 LogPipe *control)
 {
   self->super.stop_watches = poll_file_changes_stop_watches;
+  self->super.suspend_watches = poll_file_changes_suspend_watches;
   self->super.update_watches = poll_file_changes_update_watches;
   self->super.free_fn = poll_file_changes_free;
 
@@ -27,6 +27,9 @@
 #include "logpipe.h"
 
 #include <iv.h>
+#if SYSLOG_NG_HAVE_INOTIFY
+#include <iv_inotify.h>
+#endif
 
 typedef struct _PollFileChanges PollFileChanges;
 
@@ -42,6 +45,16 @@ struct _PollFileChanges
   void (*on_read)(PollFileChanges *);
   gboolean (*on_eof)(PollFileChanges *);
   void (*on_file_moved)(PollFileChanges *);
+
+#if SYSLOG_NG_HAVE_INOTIFY
+  /* optional fast path: the file is rechecked as soon as inotify reports a
+   * change, and follow_timer only runs as a rare safety net */
+  struct iv_inotify *inotify;
+  struct iv_inotify_watch inotify_watch;
+  gboolean inotify_watch_registered;
+  gboolean inotify_trusted;
+  gboolean inotify_woken;
+#endif
 };
 
 PollEvents *poll_file_changes_new(gint fd, const gchar *follow_filename, gint follow_freq, LogPipe *control);
@@ -50,6 +63,11 @@ void poll_file_changes_init_instance(PollFileChanges *self, gint fd, const gchar
                                      LogPipe *control);
 void poll_file_changes_update_watches(PollEvents *s, GIOCondition cond);
 void poll_file_changes_stop_watches(PollEvents *s);
+void poll_file_changes_suspend_watches(PollEvents *s);
 void poll_file_changes_free(PollEvents *s);
 
+#if SYSLOG_NG_HAVE_INOTIFY
+void poll_file_changes_watch_with_inotify(PollFileChanges *self, struct iv_inotify *inotify);
+#endif
+
 #endif
@@ -139,6 +139,15 @@ poll_multiline_file_changes_stop_watches(PollEvents *s)
   poll_file_changes_stop_watches(s);
 }
 
+static void
+poll_multiline_file_changes_suspend_watches(PollEvents *s)
+{
+  PollMultilineFileChanges *self = (PollMultilineFileChanges *) s;
+
+  poll_multiline_file_changes_stop_timer(self);
+  poll_file_changes_suspend_watches(s);
+}
+
 PollEvents *
 poll_multiline_file_changes_new(gint fd, const gchar *follow_filename, gint follow_freq,
                                 gint multi_line_timeout, FileReader *reader)
@@ -158,6 +167,7 @@ poll_multiline_file_changes_new(gint fd, const gchar *follow_filename, gint foll
 
   self->super.super.update_watches = poll_file_changes_update_watches;
   self->super.super.stop_watches = poll_multiline_file_changes_stop_watches;
+  self->super.super.suspend_watches = poll_multiline_file_changes_suspend_watches;
 
   return &self->super.super;
 }
@@ -81,17 +81,23 @@ typedef struct _FileOpenerRegularDestFiles
 {
   FileOpener super;
   const LogWriterOptions *writer_options;
-  gboolean *use_fsync;
+  const LogProtoFileWriterOptions *file_writer_options;
 } FileOpenerRegularDestFiles;
 
 static LogProtoClient *
-_construct_dst_proto(FileOpener *s, LogTransport *transport, LogProtoClientOptions *proto_options)
+_construct_dst_proto(FileOpener *s, LogTransport *transport, LogProtoClientOptions *proto_options,
+                     LogProtoFileWriterStats *stats)
 {
   FileOpenerRegularDestFiles *self = (FileOpenerRegularDestFiles *) s;
+  LogProtoClient *proto;
 
-  return log_proto_file_writer_new(transport, proto_options,
-                                   self->writer_options->flush_lines,
-                                   *self->use_fsync);
+  proto = log_proto_file_writer_new(transport, proto_options,
+                                    self->writer_options->flush_lines,
+                                    self->file_writer_options->fsync);
+  log_proto_file_writer_set_sync_interval(proto, self->file_writer_options->sync_interval);
+  log_proto_file_writer_set_preallocate(proto, self->file_writer_options->preallocate);
+  log_proto_file_writer_set_stats(proto, stats);
+  return proto;
 }
 
 static LogTransport *
@@ -101,7 +107,8 @@ _construct_transport(FileOpener *s, gint fd)
 }
 
 FileOpener *
-file_opener_for_regular_dest_files_new(const LogWriterOptions *writer_options, gboolean *use_fsync)
+file_opener_for_regular_dest_files_new(const LogWriterOptions *writer_options,
+                                       const LogProtoFileWriterOptions *file_writer_options)
 {
   FileOpenerRegularDestFiles *self = g_new0(FileOpenerRegularDestFiles, 1);
 
@@ -109,6 +116,6 @@ file_opener_for_regular_dest_files_new(const LogWriterOptions *writer_options, g
   self->super.construct_transport = _construct_transport;
   self->super.construct_dst_proto = _construct_dst_proto;
   self->writer_options = writer_options;
-  self->use_fsync = use_fsync;
+  self->file_writer_options = file_writer_options;
   return &self->super;
 }
@@ -20,6 +20,7 @@
  *
  */
 #include "logproto-file-writer.h"
+#include "transport/transport-file.h"
 #include "logmsg/logmsg.h"
 #include "apphook.h"
 
@@ -27,6 +28,10 @@
 #include "cr_template.h"
 #include "mock-transport.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 static void _ack_callback(gint num_acked, gpointer user_data);
 
 /* helper variables used by all testcases below */
@@ -161,6 +166,117 @@ Test(file_writer, batches_of_messages_are_flushed_even_if_the_underlying_transpo
   log_proto_client_free(fw);
 }
 
+Test(file_writer, write_stats_are_updated_on_each_write)
+{
+  StatsCounterItem writes = {0};
+  StatsCounterItem write_latency = {0};
+  LogProtoFileWriterStats stats = { .writes = &writes, .write_latency = &write_latency };
+  LogProtoClient *fw = log_proto_file_writer_new(transport, &options, 100, FALSE);
+
+  log_proto_file_writer_set_stats(fw, &stats);
+  log_proto_client_set_client_flow_control(fw, &flow_control_funcs);
+
+  for (gint i = 0; i < 3; i++)
+    {
+      status = log_proto_client_post(fw, msg, (guchar *) g_strdup(payload), strlen(payload) + 1, &consumed);
+      cr_assert(status == LPS_SUCCESS);
+      status = log_proto_client_flush(fw);
+      cr_assert(status == LPS_SUCCESS);
+    }
+
+  cr_assert_eq(stats_counter_get(&writes), 3);
+  cr_assert_geq(stats_counter_get(&write_latency), 0);
+  cr_assert_eq(messages_acked, 3);
+
+  log_proto_client_free(fw);
+}
+
+Test(file_writer, preallocation_and_periodic_sync_keep_the_file_contents_intact)
+{
+  const gint MESSAGE_COUNT = 10;
+  gchar *filename = NULL;
+
+  /* this testcase writes to a real file instead of the mock transport */
+  log_transport_free(transport);
+
+  gint tmp_fd = g_file_open_tmp("test_file_writer_XXXXXX", &filename, NULL);
+  cr_assert(tmp_fd >= 0);
+  close(tmp_fd);
+
+  gint fd = open(filename, O_WRONLY | O_APPEND);
+  cr_assert(fd >= 0);
+
+  LogProtoClient *fw = log_proto_file_writer_new(log_transport_file_new(fd), &options, 4, FALSE);
+  log_proto_file_writer_set_preallocate(fw, 1024 * 1024);
+  log_proto_file_writer_set_sync_interval(fw, 1);
+  log_proto_client_set_client_flow_control(fw, &flow_control_funcs);
+
+  for (gint i = 0; i < MESSAGE_COUNT; i++)
+    {
+      status = log_proto_client_post(fw, msg, (guchar *) g_strdup(payload), strlen(payload) + 1, &consumed);
+      cr_assert(status == LPS_SUCCESS);
+      cr_assert(consumed == TRUE);
+    }
+  status = log_proto_client_flush(fw);
+  cr_assert(status == LPS_SUCCESS);
+  log_proto_client_free(fw);
+
+  /* the preallocated space is beyond the end of the file */
+  struct stat st;
+  cr_assert(stat(filename, &st) == 0);
+  cr_assert_eq(st.st_size, MESSAGE_COUNT * (strlen(payload) + 1));
+
+  gchar *contents = NULL;
+  gsize length = 0;
+  cr_assert(g_file_get_contents(filename, &contents, &length, NULL));
+  for (gint i = 0; i < MESSAGE_COUNT; i++)
+    cr_assert_str_eq(contents + i * (strlen(payload) + 1), "PAYLOAD");
+  cr_assert_eq(messages_acked, MESSAGE_COUNT);
+
+  g_free(contents);
+  unlink(filename);
+  g_free(filename);
+}
+
+Test(file_writer, idle_writer_asks_for_a_flush_when_the_sync_interval_elapses)
+{
+  gchar *filename = NULL;
+  gint fd, timeout = -1;
+  GIOCondition cond;
+
+  /* this testcase writes to a real file instead of the mock transport */
+  log_transport_free(transport);
+
+  gint tmp_fd = g_file_open_tmp("test_file_writer_XXXXXX", &filename, NULL);
+  cr_assert(tmp_fd >= 0);
+  close(tmp_fd);
+
+  fd = open(filename, O_WRONLY | O_APPEND);
+  cr_assert(fd >= 0);
+
+  LogProtoClient *fw = log_proto_file_writer_new(log_transport_file_new(fd), &options, 1, FALSE);
+  log_proto_file_writer_set_sync_interval(fw, 1);
+  log_proto_client_set_client_flow_control(fw, &flow_control_funcs);
+  cr_assert_eq(log_proto_client_get_idle_flush_timeout(fw), -1, "Nothing to sync before the first write");
+
+  status = log_proto_client_post(fw, msg, (guchar *) g_strdup(payload), strlen(payload), &consumed);
+  cr_assert(status == LPS_SUCCESS);
+
+  gint idle_flush_msec = log_proto_client_get_idle_flush_timeout(fw);
+  cr_assert(idle_flush_msec >= 0 && idle_flush_msec <= 1000, "The unsynced write is due within the sync-interval()");
+  cr_assert_not(log_proto_client_prepare(fw, &fd, &cond, &timeout));
+
+  g_usleep((idle_flush_msec + 10) * 1000);
+  cr_assert(log_proto_client_prepare(fw, &fd, &cond, &timeout), "A due sync asks for a flush");
+  cr_assert(log_proto_client_flush(fw) == LPS_SUCCESS);
+  cr_assert_eq(log_proto_client_get_idle_flush_timeout(fw), -1, "The flush synced the file");
+  cr_assert_not(log_proto_client_prepare(fw, &fd, &cond, &timeout));
+
+  log_proto_client_free(fw);
+  unlink(filename);
+  g_free(filename);
+}
+
 static void
 startup(void)
 {
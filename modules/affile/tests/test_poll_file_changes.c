@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include "poll-file-changes.h"
+#include "apphook.h"
+#include "cfg.h"
+#include "timeutils/misc.h"
+
+#include <criterion/criterion.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+#if SYSLOG_NG_HAVE_INOTIFY
+
+#define TEST_FILENAME "test_poll_file_changes.log"
+
+/* long enough that only inotify can trigger the callback within the guard */
+#define FOLLOW_FREQ_MSEC 60000
+#define GUARD_MSEC 5000
+
+typedef struct _PollFileChangesTest
+{
+  GlobalConfig *cfg;
+  LogPipe *control;
+  struct iv_inotify inotify;
+  struct iv_timer guard;
+  PollEvents *poll_events;
+  gint fd;
+  gboolean callback_called;
+  gboolean timed_out;
+} PollFileChangesTest;
+
+static PollFileChangesTest test;
+
+static void
+_on_read(gpointer user_data)
+{
+  test.callback_called = TRUE;
+  iv_quit();
+}
+
+static void
+_on_file_moved(PollFileChanges *self)
+{
+  test.callback_called = TRUE;
+  iv_quit();
+}
+
+static void
+_on_guard_expired(gpointer user_data)
+{
+  test.timed_out = TRUE;
+  iv_quit();
+}
+
+static void
+_append(const gchar *line)
+{
+  gint fd = open(TEST_FILENAME, O_WRONLY | O_APPEND);
+
+  cr_assert(fd >= 0);
+  cr_assert_eq(write(fd, line, strlen(line)), strlen(line));
+  close(fd);
+}
+
+static void
+_run_until_callback(gint guard_msec)
+{
+  iv_validate_now();
+  test.guard.expires = iv_now;
+  timespec_add_msec(&test.guard.expires, guard_msec);
+  iv_timer_register(&test.guard);
+
+  iv_main();
+
+  if (iv_timer_registered(&test.guard))
+    iv_timer_unregister(&test.guard);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+
+  memset(&test, 0, sizeof(test));
+  test.cfg = cfg_new_snippet();
+  test.control = log_pipe_new(test.cfg);
+
+  IV_INOTIFY_INIT(&test.inotify);
+  cr_assert(iv_inotify_register(&test.inotify) == 0);
+
+  IV_TIMER_INIT(&test.guard);
+  test.guard.handler = _on_guard_expired;
+
+  cr_assert(g_file_set_contents(TEST_FILENAME, "first\n", -1, NULL));
+  test.fd = open(TEST_FILENAME, O_RDONLY);
+  cr_assert(test.fd >= 0);
+  lseek(test.fd, 0, SEEK_END);
+
+  test.poll_events = poll_file_changes_new(test.fd, TEST_FILENAME, FOLLOW_FREQ_MSEC, test.control);
+  poll_file_changes_watch_with_inotify((PollFileChanges *) test.poll_events, &test.inotify);
+  poll_events_set_callback(test.poll_events, _on_read, NULL);
+}
+
+static void
+teardown(void)
+{
+  poll_events_stop_watches(test.poll_events);
+  poll_events_free(test.poll_events);
+  iv_inotify_unregister(&test.inotify);
+  close(test.fd);
+  unlink(TEST_FILENAME);
+
+  log_pipe_unref(test.control);
+  cfg_free(test.cfg);
+  app_shutdown();
+}
+
+TestSuite(poll_file_changes, .init = setup, .fini = teardown);
+
+Test(poll_file_changes, append_triggers_callback_without_waiting_for_follow_freq)
+{
+  poll_events_update_watches(test.poll_events, G_IO_IN);
+  _append("second\n");
+
+  _run_until_callback(GUARD_MSEC);
+  cr_assert(test.callback_called);
+  cr_assert_not(test.timed_out);
+}
+
+Test(poll_file_changes, append_while_suspended_is_noticed_on_update)
+{
+  poll_events_update_watches(test.poll_events, G_IO_IN);
+  poll_events_suspend_watches(test.poll_events);
+
+  /* the event arrives while the reader is busy, it is up to update_watches() to notice */
+  _append("second\n");
+  _run_until_callback(200);
+  cr_assert_not(test.callback_called);
+
+  test.timed_out = FALSE;
+  poll_events_update_watches(test.poll_events, G_IO_IN);
+  _run_until_callback(GUARD_MSEC);
+  cr_assert(test.callback_called);
+  cr_assert_not(test.timed_out);
+}
+
+Test(poll_file_changes, second_reader_of_the_same_file_does_not_take_over_the_watch)
+{
+  gint fd = open(TEST_FILENAME, O_RDONLY);
+  cr_assert(fd >= 0);
+  lseek(fd, 0, SEEK_END);
+
+  /* same inode, same iv_inotify: inotify returns the same wd */
+  PollEvents *other = poll_file_changes_new(fd, TEST_FILENAME, FOLLOW_FREQ_MSEC, test.control);
+  poll_file_changes_watch_with_inotify((PollFileChanges *) other, &test.inotify);
+
+  poll_events_update_watches(test.poll_events, G_IO_IN);
+  poll_events_update_watches(other, G_IO_IN);
+  cr_assert(((PollFileChanges *) test.poll_events)->inotify_watch_registered);
+  cr_assert_not(((PollFileChanges *) other)->inotify_watch_registered,
+                "The second reader of the same file polls");
+
+  poll_events_stop_watches(other);
+  poll_events_free(other);
+  close(fd);
+
+  _append("second\n");
+  _run_until_callback(GUARD_MSEC);
+  cr_assert(test.callback_called, "Stopping the second reader kept the watch of the first one");
+  cr_assert_not(test.timed_out);
+}
+
+Test(poll_file_changes, moved_file_is_not_watched_again_by_name)
+{
+  PollFileChanges *self = (PollFileChanges *) test.poll_events;
+
+  self->on_file_moved = _on_file_moved;
+  poll_events_update_watches(test.poll_events, G_IO_IN);
+  cr_assert(self->inotify_watch_registered);
+
+  cr_assert_eq(rename(TEST_FILENAME, TEST_FILENAME ".1"), 0);
+  cr_assert(g_file_set_contents(TEST_FILENAME, "new file\n", -1, NULL));
+  _run_until_callback(GUARD_MSEC);
+  cr_assert(test.callback_called, "The move is noticed through inotify");
+
+  cr_assert_not(self->inotify_watch_registered, "The moved file is polled");
+  poll_events_update_watches(test.poll_events, G_IO_IN);
+  cr_assert_not(self->inotify_watch_registered, "The new file with the same name is not watched for this reader");
+
+  unlink(TEST_FILENAME ".1");
+}
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include "affile-dest-writer-cache.h"
+#include "mainloop-worker.h"
+#include "apphook.h"
+#include "cfg.h"
+
+#include <criterion/criterion.h>
+#include "libtest/cr_template.h"
+
+#define JAN_1_2021 1609459200
+
+static LogTemplateOptions template_options;
+static gint writer_a, writer_b;
+
+static LogMessage *
+_create_message(const gchar *host, time_t stamp, glong gmtoff)
+{
+  LogMessage *msg = create_empty_message();
+
+  log_msg_set_value(msg, LM_V_HOST, host, -1);
+  msg->timestamps[LM_TS_STAMP].ut_sec = stamp;
+  msg->timestamps[LM_TS_STAMP].ut_usec = 0;
+  msg->timestamps[LM_TS_STAMP].ut_gmtoff = gmtoff;
+  return msg;
+}
+
+static AFFileDestWriterCache *
+_create_cache(const gchar *template)
+{
+  LogTemplate *filename_template = compile_template(template, FALSE);
+  AFFileDestWriterCache *cache = affile_dw_cache_new(filename_template, &template_options);
+
+  log_template_unref(filename_template);
+  return cache;
+}
+
+static gpointer
+_lookup(AFFileDestWriterCache *cache, LogMessage *msg, guint *generation)
+{
+  gpointer writer = NULL;
+
+  if (!affile_dw_cache_lookup(cache, msg, &writer, generation))
+    return NULL;
+  return writer;
+}
+
+Test(writer_cache, templates_with_inputs_we_cannot_key_on_are_not_cached)
+{
+  cr_assert_null(_create_cache("/var/log/${HOST}@2.log"));
+  cr_assert_null(_create_cache("/var/log/$ISODATE.log"));
+  cr_assert_null(_create_cache("/var/log/$HOST-$MSEC.log"));
+  cr_assert_null(_create_cache("/var/log/$HOST-$C_DAY.log"));
+}
+
+Test(writer_cache, same_inputs_resolve_to_the_stored_writer)
+{
+  AFFileDestWriterCache *cache = _create_cache("/var/log/$HOST/$YEAR$MONTH$DAY.log");
+  guint generation;
+  cr_assert_not_null(cache);
+
+  LogMessage *msg = _create_message("host-a", JAN_1_2021 + 10 * 3600, 0);
+  cr_assert_null(_lookup(cache, msg, &generation));
+  affile_dw_cache_store(cache, &writer_a, 0);
+  log_msg_unref(msg);
+
+  /* same host, same day */
+  msg = _create_message("host-a", JAN_1_2021 + 23 * 3600 + 59 * 60, 0);
+  cr_assert_eq(_lookup(cache, msg, &generation), &writer_a);
+  cr_assert_eq(generation, 0);
+  log_msg_unref(msg);
+
+  /* same host, next day */
+  msg = _create_message("host-a", JAN_1_2021 + 24 * 3600 + 60, 0);
+  cr_assert_null(_lookup(cache, msg, &generation));
+  log_msg_unref(msg);
+
+  /* same UTC time, but it is the next day in the message's own zone */
+  msg = _create_message("host-a", JAN_1_2021 + 23 * 3600 + 30 * 60, 3600);
+  cr_assert_null(_lookup(cache, msg, &generation));
+  log_msg_unref(msg);
+
+  /* different host */
+  msg = _create_message("host-b", JAN_1_2021 + 10 * 3600, 0);
+  cr_assert_null(_lookup(cache, msg, &generation));
+  affile_dw_cache_store(cache, &writer_b, 0);
+  cr_assert_eq(_lookup(cache, msg, &generation), &writer_b);
+  log_msg_unref(msg);
+
+  affile_dw_cache_free(cache);
+}
+
+Test(writer_cache, storing_with_a_new_generation_drops_older_entries)
+{
+  AFFileDestWriterCache *cache = _create_cache("/var/log/$HOST.log");
+  LogMessage *msg_a = _create_message("host-a", JAN_1_2021, 0);
+  LogMessage *msg_b = _create_message("host-b", JAN_1_2021, 0);
+  guint generation;
+
+  _lookup(cache, msg_a, &generation);
+  affile_dw_cache_store(cache, &writer_a, 0);
+
+  _lookup(cache, msg_b, &generation);
+  affile_dw_cache_store(cache, &writer_b, 1);
+
+  cr_assert_null(_lookup(cache, msg_a, &generation));
+  cr_assert_eq(_lookup(cache, msg_b, &generation), &writer_b);
+  cr_assert_eq(generation, 1);
+
+  log_msg_unref(msg_a);
+  log_msg_unref(msg_b);
+  affile_dw_cache_free(cache);
+}
+
+Test(writer_cache, threads_without_a_worker_id_bypass_the_cache)
+{
+  AFFileDestWriterCache *cache = _create_cache("/var/log/$HOST.log");
+  LogMessage *msg = _create_message("host-a", JAN_1_2021, 0);
+  guint generation;
+
+  main_loop_worker_set_thread_id(-1);
+  cr_assert_null(_lookup(cache, msg, &generation));
+  affile_dw_cache_store(cache, &writer_a, 0);
+  cr_assert_null(_lookup(cache, msg, &generation));
+
+  log_msg_unref(msg);
+  affile_dw_cache_free(cache);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  init_template_tests();
+  log_template_options_defaults(&template_options);
+  log_template_options_init(&template_options, configuration);
+  main_loop_worker_set_thread_id(0);
+}
+
+static void
+teardown(void)
+{
+  log_template_options_destroy(&template_options);
+  deinit_template_tests();
+  app_shutdown();
+}
+
+TestSuite(writer_cache, .init = setup, .fini = teardown);
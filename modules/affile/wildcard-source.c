@@ -266,6 +266,8 @@ _init_reader_options(WildcardSourceDriver *self, GlobalConfig *cfg)
       self->window_size_initialized = TRUE;
     }
 
+  /* monitor-method(poll) asks for polling the files too */
+  self->file_reader_options.follow_with_inotify = self->monitor_method != MM_POLL;
   return file_reader_options_init(&self->file_reader_options, cfg, self->super.super.group);
 }
 
@@ -359,6 +361,7 @@ _deinit(LogPipe *s)
 
   g_pattern_spec_free(self->compiled_pattern);
   g_hash_table_foreach(self->file_readers, _deinit_reader, NULL);
+  file_reader_options_deinit_inotify(&self->file_reader_options);
   return TRUE;
 }
 
@@ -44,6 +44,9 @@ static const char *s_freetds = "freetds";
 static dbi_inst dbi_instance;
 static const gint DEFAULT_SQL_TX_SIZE = 100;
 
+/* MSSQL refuses row value lists longer than 1000 elements, stay below that */
+static const gint MAX_BULK_INSERT_ROWS = 1000;
+
 #define MAX_FAILED_ATTEMPTS 3
 
 void
@@ -737,15 +740,6 @@ afsql_dd_connect(LogThreadedDestDriver *s)
   return TRUE;
 }
 
-static void
-afsql_dd_disconnect(LogThreadedDestDriver *s)
-{
-  AFSqlDestDriver *self = (AFSqlDestDriver *) s;
-
-  dbi_conn_close(self->dbi_ctx);
-  self->dbi_ctx = NULL;
-}
-
 static GString *
 afsql_dd_ensure_accessible_database_table(AFSqlDestDriver *self, LogMessage *msg)
 {
@@ -766,14 +760,12 @@ afsql_dd_ensure_accessible_database_table(AFSqlDestDriver *self, LogMessage *msg
   return table;
 }
 
-static GString *
-afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+static void
+afsql_dd_append_insert_columns(AFSqlDestDriver *self, GString *insert_command)
 {
-  GString *insert_command = g_string_sized_new(256);
-  GString *value = g_string_sized_new(512);
   gint i, j;
 
-  g_string_printf(insert_command, "INSERT INTO %s (", table->str);
+  g_string_append(insert_command, "(");
 
   for (i = 0; i < self->fields_len; i++)
     {
@@ -790,7 +782,16 @@ afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *t
         }
     }
 
-  g_string_append(insert_command, ") VALUES (");
+  g_string_append(insert_command, ")");
+}
+
+static void
+afsql_dd_append_insert_values(AFSqlDestDriver *self, LogMessage *msg, GString *insert_command)
+{
+  GString *value = g_string_sized_new(512);
+  gint i, j;
+
+  g_string_append(insert_command, "(");
 
   for (i = 0; i < self->fields_len; i++)
     {
@@ -829,16 +830,126 @@ afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *t
   g_string_append(insert_command, ")");
 
   g_string_free(value, TRUE);
+}
+
+static GString *
+afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+{
+  GString *insert_command = g_string_sized_new(256);
+
+  g_string_printf(insert_command, "INSERT INTO %s ", table->str);
+  afsql_dd_append_insert_columns(self, insert_command);
+  g_string_append(insert_command, " VALUES ");
+  afsql_dd_append_insert_values(self, msg, insert_command);
 
   return insert_command;
 }
 
+/**
+ * Bulk inserts
+ *
+ * In bulk-insert mode, rows of a batch are collected into a single
+ * multi-row INSERT statement, which is sent to the server at flush time,
+ * replacing one round trip per message with one round trip per batch.
+ * Oracle has no multi-row VALUES clause, the equivalent INSERT ALL form
+ * is used there.
+ *
+ * NOTE: these functions can only be called from the database thread.
+ **/
+static void
+afsql_dd_bulk_reset(AFSqlDestDriver *self)
+{
+  g_string_truncate(self->bulk_insert_command, 0);
+  g_string_truncate(self->bulk_table, 0);
+  self->bulk_rows = 0;
+}
+
+static void
+afsql_dd_bulk_append_row(AFSqlDestDriver *self, GString *table, LogMessage *msg)
+{
+  gboolean insert_all = strcmp(self->type, s_oracle) == 0;
+
+  if (self->bulk_rows == 0)
+    {
+      g_string_assign(self->bulk_table, table->str);
+      if (insert_all)
+        {
+          g_string_assign(self->bulk_insert_command, "INSERT ALL");
+        }
+      else
+        {
+          g_string_printf(self->bulk_insert_command, "INSERT INTO %s ", table->str);
+          afsql_dd_append_insert_columns(self, self->bulk_insert_command);
+          g_string_append(self->bulk_insert_command, " VALUES ");
+        }
+    }
+  else if (!insert_all)
+    {
+      g_string_append(self->bulk_insert_command, ", ");
+    }
+
+  if (insert_all)
+    {
+      g_string_append_printf(self->bulk_insert_command, " INTO %s ", table->str);
+      afsql_dd_append_insert_columns(self, self->bulk_insert_command);
+      g_string_append(self->bulk_insert_command, " VALUES ");
+    }
+
+  afsql_dd_append_insert_values(self, msg, self->bulk_insert_command);
+  self->bulk_rows++;
+}
+
+static gboolean
+afsql_dd_bulk_should_flush_before_row(AFSqlDestDriver *self, GString *table)
+{
+  if (self->bulk_rows == 0)
+    return FALSE;
+
+  return self->bulk_rows >= MAX_BULK_INSERT_ROWS || strcmp(self->bulk_table->str, table->str) != 0;
+}
+
+static gboolean
+afsql_dd_bulk_flush_rows(AFSqlDestDriver *self)
+{
+  gboolean success;
+
+  if (self->bulk_rows == 0)
+    return TRUE;
+
+  if (strcmp(self->type, s_oracle) == 0)
+    g_string_append(self->bulk_insert_command, " SELECT 1 FROM DUAL");
+
+  msg_trace("Sending bulk SQL insert",
+            evt_tag_str("table", self->bulk_table->str),
+            evt_tag_int("rows", self->bulk_rows));
+
+  success = afsql_dd_run_query(self, self->bulk_insert_command->str, FALSE, NULL);
+  afsql_dd_bulk_reset(self);
+  return success;
+}
+
+static void
+afsql_dd_disconnect(LogThreadedDestDriver *s)
+{
+  AFSqlDestDriver *self = (AFSqlDestDriver *) s;
+
+  dbi_conn_close(self->dbi_ctx);
+  self->dbi_ctx = NULL;
+  afsql_dd_bulk_reset(self);
+}
+
 static inline gboolean
 afsql_dd_is_transaction_handling_enabled(const AFSqlDestDriver *self)
 {
   return !!(self->flags & AFSQL_DDF_EXPLICIT_COMMITS);
 }
 
+static inline gboolean
+afsql_dd_is_bulk_insert_enabled(const AFSqlDestDriver *self)
+{
+  return !!(self->flags & AFSQL_DDF_BULK_INSERT);
+}
+
 static inline gboolean
 afsql_dd_should_begin_new_transaction(const AFSqlDestDriver *self)
 {
@@ -891,6 +1002,14 @@ afsql_dd_flush(LogThreadedDestDriver *s)
 {
   AFSqlDestDriver *self = (AFSqlDestDriver *) s;
 
+  if (afsql_dd_is_bulk_insert_enabled(self) && !afsql_dd_bulk_flush_rows(self))
+    {
+      LogThreadedResult retval = afsql_dd_handle_insert_row_error_depending_on_connection_availability(self);
+
+      afsql_dd_rollback_transaction(self);
+      return retval;
+    }
+
   if (!afsql_dd_is_transaction_handling_enabled(self))
     return LTR_SUCCESS;
 
@@ -914,6 +1033,30 @@ afsql_dd_run_insert_query(AFSqlDestDriver *self, GString *table, LogMessage *msg
   return success;
 }
 
+/* Adds the message as a new row to the pending bulk INSERT statement.  If
+ * the pending statement cannot be extended with this row (it targets a
+ * different table or it is already full), it is sent first.  Without
+ * explicit commits, the rows sent this way are acknowledged right away, as
+ * they are committed by the server independently of the rest of the batch.
+ */
+static LogThreadedResult
+afsql_dd_queue_bulk_row(AFSqlDestDriver *self, GString *table, LogMessage *msg)
+{
+  if (afsql_dd_bulk_should_flush_before_row(self, table))
+    {
+      gint flushed_rows = self->bulk_rows;
+
+      if (!afsql_dd_bulk_flush_rows(self))
+        return afsql_dd_handle_insert_row_error_depending_on_connection_availability(self);
+
+      if (!afsql_dd_is_transaction_handling_enabled(self))
+        log_threaded_dest_worker_ack_messages(&self->super.worker.instance, flushed_rows);
+    }
+
+  afsql_dd_bulk_append_row(self, table, msg);
+  return LTR_QUEUED;
+}
+
 /**
  * afsql_dd_insert_db:
  *
@@ -936,18 +1079,29 @@ afsql_dd_insert(LogThreadedDestDriver *s, LogMessage *msg)
   if (afsql_dd_should_begin_new_transaction(self) && !afsql_dd_begin_transaction(self))
     goto error;
 
-  if (!afsql_dd_run_insert_query(self, table, msg))
+  if (afsql_dd_is_bulk_insert_enabled(self))
+    {
+      retval = afsql_dd_queue_bulk_row(self, table, msg);
+    }
+  else if (!afsql_dd_run_insert_query(self, table, msg))
     {
       retval = afsql_dd_handle_insert_row_error_depending_on_connection_availability(self);
       goto error;
     }
-
-  retval = afsql_dd_is_transaction_handling_enabled(self)
-           ? LTR_QUEUED
-           : LTR_SUCCESS;
+  else
+    {
+      retval = afsql_dd_is_transaction_handling_enabled(self)
+               ? LTR_QUEUED
+               : LTR_SUCCESS;
+    }
 
 error:
 
+  /* the whole batch is going to be rewound or dropped, including the rows
+   * accumulated so far */
+  if (retval != LTR_QUEUED && afsql_dd_is_bulk_insert_enabled(self))
+    afsql_dd_bulk_reset(self);
+
   if (table != NULL)
     g_string_free(table, TRUE);
 
@@ -1141,7 +1295,7 @@ afsql_dd_init(LogPipe *s)
 
   log_template_options_init(&self->template_options, cfg);
 
-  if (afsql_dd_is_transaction_handling_enabled(self))
+  if (afsql_dd_is_transaction_handling_enabled(self) || afsql_dd_is_bulk_insert_enabled(self))
     log_threaded_dest_driver_set_batch_lines((LogDriver *)self, _batch_lines(self));
 
   return TRUE;
@@ -1176,6 +1330,8 @@ afsql_dd_free(LogPipe *s)
   string_list_free(self->indexes);
   string_list_free(self->values);
   log_template_unref(self->table);
+  g_string_free(self->bulk_insert_command, TRUE);
+  g_string_free(self->bulk_table, TRUE);
   g_hash_table_destroy(self->syslogng_conform_tables);
   g_hash_table_destroy(self->dbd_options);
   g_hash_table_destroy(self->dbd_options_numeric);
@@ -1216,6 +1372,9 @@ afsql_dd_new(GlobalConfig *cfg)
 
   self->session_statements = NULL;
 
+  self->bulk_insert_command = g_string_sized_new(1024);
+  self->bulk_table = g_string_sized_new(32);
+
   self->syslogng_conform_tables = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
   self->dbd_options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
   self->dbd_options_numeric = g_hash_table_new_full(g_str_hash, g_int_equal, g_free, NULL);
@@ -1233,6 +1392,8 @@ afsql_dd_lookup_flag(const gchar *flag)
     return AFSQL_DDF_EXPLICIT_COMMITS;
   else if (strcmp(flag, "dont-create-tables") == 0)
     return AFSQL_DDF_DONT_CREATE_TABLES;
+  else if (strcmp(flag, "bulk-insert") == 0)
+    return AFSQL_DDF_BULK_INSERT;
   else
     msg_warning("Unknown SQL flag",
                 evt_tag_str("flag", flag));
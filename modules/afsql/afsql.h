@@ -46,6 +46,7 @@ enum
 {
   AFSQL_DDF_EXPLICIT_COMMITS = 0x0001,
   AFSQL_DDF_DONT_CREATE_TABLES = 0x0002,
+  AFSQL_DDF_BULK_INSERT = 0x0004,
 };
 
 typedef struct _AFSqlField
@@ -100,6 +101,11 @@ typedef struct _AFSqlDestDriver
   GHashTable *syslogng_conform_tables;
   guint32 failed_message_counter;
   gboolean transaction_active;
+
+  /* multi-row INSERT statement being accumulated in bulk-insert mode */
+  GString *bulk_insert_command;
+  GString *bulk_table;
+  gint bulk_rows;
 } AFSqlDestDriver;
 
 
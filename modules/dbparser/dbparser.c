@@ -117,13 +117,34 @@ log_db_parser_format_persist_name(LogDBParser *self)
   return persist_name;
 }
 
+/* compiling the ruleset is the expensive part of init, do it in parallel
+ * with the other pipes at startup, see cfg_tree_start() */
+static gboolean
+log_db_parser_preload(LogPipe *s)
+{
+  LogDBParser *self = (LogDBParser *) s;
+  GlobalConfig *cfg = log_pipe_get_config(s);
+
+  /* on reload, our database (along with its correlation state) is
+   * carried over in the persist config, which is fetched by init() */
+  if (cfg->persist || self->db)
+    return TRUE;
+
+  self->db = pattern_db_new();
+  log_db_parser_reload_database(self);
+  return TRUE;
+}
+
 static gboolean
 log_db_parser_init(LogPipe *s)
 {
   LogDBParser *self = (LogDBParser *) s;
   GlobalConfig *cfg = log_pipe_get_config(s);
 
-  self->db = cfg_persist_config_fetch(cfg, log_db_parser_format_persist_name(self));
+  /* the database is already loaded if we were preloaded, in that case
+   * the check below only confirms that the file hasn't changed since */
+  if (!self->db)
+    self->db = cfg_persist_config_fetch(cfg, log_db_parser_format_persist_name(self));
   if (self->db)
     {
       struct stat st;
@@ -292,6 +313,7 @@ log_db_parser_new(GlobalConfig *cfg)
 
   stateful_parser_init_instance(&self->super, cfg);
   self->super.super.super.free_fn = log_db_parser_free;
+  self->super.super.super.preload = log_db_parser_preload;
   self->super.super.super.init = log_db_parser_init;
   self->super.super.super.deinit = log_db_parser_deinit;
   self->super.super.super.clone = log_db_parser_clone;
@@ -224,6 +224,7 @@ _ack_backlog (LogQueueDisk *s, guint num_msg_to_ack)
         return;
       msg = g_queue_pop_head (self->qbacklog);
       POINTER_TO_LOG_PATH_OPTIONS (g_queue_pop_head (self->qbacklog), &path_options);
+      log_queue_record_ack_latency(&self->super.super, msg);
       log_msg_unref (msg);
       log_msg_ack (msg, &path_options, AT_PROCESSED);
     }
@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include "geoip-lookup-cache.h"
+#include "mainloop-worker.h"
+#include "apphook.h"
+#include "messages.h"
+
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/stat.h>
+
+typedef struct _GeoIPLookupCacheValue
+{
+  NVHandle handle;
+  gsize value_len;
+  gchar *value;
+} GeoIPLookupCacheValue;
+
+struct _GeoIPLookupCacheEntry
+{
+  GeoIPLookupCacheKey key;
+  GList lru_link;
+  GArray *values;
+};
+
+struct _GeoIPLookupCache
+{
+  GHashTable *entries;
+  /* most recently used entry at the head */
+  GQueue lru;
+  gint capacity;
+};
+
+/* identifies the database file a set was filled from */
+typedef struct _GeoIPDatabaseStamp
+{
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  time_t mtime;
+  guint64 build_epoch;
+} GeoIPDatabaseStamp;
+
+struct _GeoIPLookupCacheSet
+{
+  gchar *name;
+  gint ref_cnt;
+  gint capacity;
+  GeoIPDatabaseStamp stamp;
+  /* indexed by the worker thread id, each slot is owned by its thread */
+  GeoIPLookupCache *caches[MAIN_LOOP_MAX_WORKER_THREADS];
+};
+
+gboolean
+geoip_lookup_cache_key_parse(GeoIPLookupCacheKey *key, const gchar *ip)
+{
+  memset(key, 0, sizeof(*key));
+
+  if (inet_pton(AF_INET, ip, key->addr) == 1)
+    {
+      key->family = AF_INET;
+      return TRUE;
+    }
+  if (inet_pton(AF_INET6, ip, key->addr) == 1)
+    {
+      key->family = AF_INET6;
+      return TRUE;
+    }
+  return FALSE;
+}
+
+socklen_t
+geoip_lookup_cache_key_to_sockaddr(const GeoIPLookupCacheKey *key, struct sockaddr_storage *sa)
+{
+  memset(sa, 0, sizeof(*sa));
+
+  if (key->family == AF_INET)
+    {
+      struct sockaddr_in *sin = (struct sockaddr_in *) sa;
+
+      sin->sin_family = AF_INET;
+      memcpy(&sin->sin_addr, key->addr, sizeof(sin->sin_addr));
+      return sizeof(*sin);
+    }
+
+  struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) sa;
+
+  g_assert(key->family == AF_INET6);
+  sin6->sin6_family = AF_INET6;
+  memcpy(&sin6->sin6_addr, key->addr, sizeof(sin6->sin6_addr));
+  return sizeof(*sin6);
+}
+
+static guint
+_key_hash(gconstpointer k)
+{
+  const GeoIPLookupCacheKey *key = (const GeoIPLookupCacheKey *) k;
+  gint len = key->family == AF_INET ? 4 : 16;
+  guint hash = key->family;
+
+  for (gint i = 0; i < len; i++)
+    hash = hash * 31 + key->addr[i];
+  return hash;
+}
+
+static gboolean
+_key_equal(gconstpointer a, gconstpointer b)
+{
+  return memcmp(a, b, sizeof(GeoIPLookupCacheKey)) == 0;
+}
+
+void
+geoip_lookup_cache_entry_add_value(GeoIPLookupCacheEntry *self, NVHandle handle,
+                                   const gchar *value, gsize value_len)
+{
+  GeoIPLookupCacheValue v =
+  {
+    .handle = handle,
+    .value_len = value_len,
+    .value = g_strndup(value, value_len),
+  };
+
+  g_array_append_val(self->values, v);
+}
+
+void
+geoip_lookup_cache_entry_apply(GeoIPLookupCacheEntry *self, LogMessage *msg)
+{
+  for (guint i = 0; i < self->values->len; i++)
+    {
+      GeoIPLookupCacheValue *v = &g_array_index(self->values, GeoIPLookupCacheValue, i);
+
+      log_msg_set_value(msg, v->handle, v->value, v->value_len);
+    }
+}
+
+static void
+_entry_free(GeoIPLookupCacheEntry *self)
+{
+  for (guint i = 0; i < self->values->len; i++)
+    g_free(g_array_index(self->values, GeoIPLookupCacheValue, i).value);
+  g_array_free(self->values, TRUE);
+  g_free(self);
+}
+
+GeoIPLookupCacheEntry *
+geoip_lookup_cache_lookup(GeoIPLookupCache *self, const GeoIPLookupCacheKey *key)
+{
+  GeoIPLookupCacheEntry *entry = g_hash_table_lookup(self->entries, key);
+
+  if (!entry)
+    return NULL;
+
+  g_queue_unlink(&self->lru, &entry->lru_link);
+  g_queue_push_head_link(&self->lru, &entry->lru_link);
+  return entry;
+}
+
+static void
+_evict_least_recently_used(GeoIPLookupCache *self)
+{
+  GList *link = g_queue_pop_tail_link(&self->lru);
+  GeoIPLookupCacheEntry *entry = (GeoIPLookupCacheEntry *) link->data;
+
+  g_hash_table_remove(self->entries, &entry->key);
+}
+
+/* returns a new, empty entry for key, to be filled in by the caller */
+GeoIPLookupCacheEntry *
+geoip_lookup_cache_store(GeoIPLookupCache *self, const GeoIPLookupCacheKey *key)
+{
+  GeoIPLookupCacheEntry *entry = g_hash_table_lookup(self->entries, key);
+
+  if (entry)
+    {
+      g_queue_unlink(&self->lru, &entry->lru_link);
+      g_hash_table_remove(self->entries, key);
+    }
+
+  while (self->lru.length > 0 && self->lru.length >= (guint) self->capacity)
+    _evict_least_recently_used(self);
+
+  entry = g_new0(GeoIPLookupCacheEntry, 1);
+  entry->key = *key;
+  entry->lru_link.data = entry;
+  entry->values = g_array_new(FALSE, FALSE, sizeof(GeoIPLookupCacheValue));
+
+  g_hash_table_insert(self->entries, &entry->key, entry);
+  g_queue_push_head_link(&self->lru, &entry->lru_link);
+  return entry;
+}
+
+guint
+geoip_lookup_cache_get_length(GeoIPLookupCache *self)
+{
+  return self->lru.length;
+}
+
+void
+geoip_lookup_cache_clear(GeoIPLookupCache *self)
+{
+  g_queue_init(&self->lru);
+  g_hash_table_remove_all(self->entries);
+}
+
+GeoIPLookupCache *
+geoip_lookup_cache_new(gint capacity)
+{
+  GeoIPLookupCache *self = g_new0(GeoIPLookupCache, 1);
+
+  self->entries = g_hash_table_new_full(_key_hash, _key_equal, NULL, (GDestroyNotify) _entry_free);
+  g_queue_init(&self->lru);
+  self->capacity = capacity;
+  return self;
+}
+
+void
+geoip_lookup_cache_free(GeoIPLookupCache *self)
+{
+  g_hash_table_destroy(self->entries);
+  g_free(self);
+}
+
+/*
+ * GeoIPLookupCacheSet: the per-thread caches of the parsers that use the
+ * same database and prefix.  Sets are kept in a registry, so that a
+ * reload can pick up the warm caches of the previous configuration.
+ * Acquire/release happen in the main thread while the workers are idle.
+ */
+
+G_LOCK_DEFINE_STATIC(geoip_lookup_cache_sets);
+static GHashTable *geoip_lookup_cache_sets;
+
+static gboolean
+_stamp_database(GeoIPDatabaseStamp *stamp, const gchar *database_path, const MMDB_s *database)
+{
+  struct stat st;
+
+  memset(stamp, 0, sizeof(*stamp));
+  if (stat(database_path, &st) < 0)
+    return FALSE;
+
+  stamp->dev = st.st_dev;
+  stamp->ino = st.st_ino;
+  stamp->size = st.st_size;
+  stamp->mtime = st.st_mtime;
+  stamp->build_epoch = database->metadata.build_epoch;
+  return TRUE;
+}
+
+static gboolean
+_stamp_equal(const GeoIPDatabaseStamp *a, const GeoIPDatabaseStamp *b)
+{
+  return a->dev == b->dev && a->ino == b->ino && a->size == b->size &&
+         a->mtime == b->mtime && a->build_epoch == b->build_epoch;
+}
+
+static void
+_set_drop_caches(GeoIPLookupCacheSet *self)
+{
+  for (gint i = 0; i < MAIN_LOOP_MAX_WORKER_THREADS; i++)
+    {
+      if (self->caches[i])
+        geoip_lookup_cache_free(self->caches[i]);
+      self->caches[i] = NULL;
+    }
+}
+
+static void
+_set_free(GeoIPLookupCacheSet *self)
+{
+  _set_drop_caches(self);
+  g_free(self->name);
+  g_free(self);
+}
+
+GeoIPLookupCache *
+geoip_lookup_cache_set_get_thread_cache(GeoIPLookupCacheSet *self)
+{
+  gint thread_id = main_loop_worker_get_thread_id();
+
+  /* threads without a worker id (main thread, external input threads)
+   * have no slot, they go to the database directly */
+  if (thread_id < 0 || thread_id >= MAIN_LOOP_MAX_WORKER_THREADS)
+    return NULL;
+
+  if (!self->caches[thread_id])
+    self->caches[thread_id] = geoip_lookup_cache_new(self->capacity);
+  return self->caches[thread_id];
+}
+
+static gboolean
+_is_unused_set(gpointer key, gpointer value, gpointer user_data)
+{
+  GeoIPLookupCacheSet *set = (GeoIPLookupCacheSet *) value;
+
+  return set->ref_cnt == 0;
+}
+
+static void
+_free_unused_sets(gint type, gpointer user_data)
+{
+  G_LOCK(geoip_lookup_cache_sets);
+  if (geoip_lookup_cache_sets)
+    {
+      g_hash_table_foreach_remove(geoip_lookup_cache_sets, _is_unused_set, NULL);
+      if (type == AH_SHUTDOWN && g_hash_table_size(geoip_lookup_cache_sets) == 0)
+        {
+          g_hash_table_destroy(geoip_lookup_cache_sets);
+          geoip_lookup_cache_sets = NULL;
+        }
+    }
+  G_UNLOCK(geoip_lookup_cache_sets);
+}
+
+static void
+_init_registry(void)
+{
+  geoip_lookup_cache_sets = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify) _set_free);
+
+  /* sets no longer referenced once the new configuration is up are gone
+   * for good; the hook list itself is dropped at shutdown */
+  register_application_hook(AH_CONFIG_CHANGED, _free_unused_sets, NULL, AHM_RUN_REPEAT);
+  register_application_hook(AH_SHUTDOWN, _free_unused_sets, NULL, AHM_RUN_ONCE);
+}
+
+GeoIPLookupCacheSet *
+geoip_lookup_cache_set_acquire(const gchar *database_path, const gchar *prefix,
+                               const MMDB_s *database, gint capacity)
+{
+  GeoIPDatabaseStamp stamp;
+  GeoIPLookupCacheSet *self;
+  gchar *name = g_strdup_printf("%s,%s,%d", database_path, prefix, capacity);
+
+  _stamp_database(&stamp, database_path, database);
+
+  G_LOCK(geoip_lookup_cache_sets);
+  if (!geoip_lookup_cache_sets)
+    _init_registry();
+
+  self = g_hash_table_lookup(geoip_lookup_cache_sets, name);
+  if (!self)
+    {
+      self = g_new0(GeoIPLookupCacheSet, 1);
+      self->name = name;
+      self->capacity = capacity;
+      self->stamp = stamp;
+      g_hash_table_insert(geoip_lookup_cache_sets, self->name, self);
+    }
+  else
+    {
+      g_free(name);
+      if (!_stamp_equal(&self->stamp, &stamp))
+        {
+          msg_debug("geoip2(): database changed, flushing lookup cache",
+                    evt_tag_str("database", database_path));
+          _set_drop_caches(self);
+          self->stamp = stamp;
+        }
+    }
+  self->ref_cnt++;
+  G_UNLOCK(geoip_lookup_cache_sets);
+
+  return self;
+}
+
+void
+geoip_lookup_cache_set_release(GeoIPLookupCacheSet *self)
+{
+  G_LOCK(geoip_lookup_cache_sets);
+  g_assert(self->ref_cnt > 0);
+  self->ref_cnt--;
+  G_UNLOCK(geoip_lookup_cache_sets);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#ifndef GEOIP_LOOKUP_CACHE_H_INCLUDED
+#define GEOIP_LOOKUP_CACHE_H_INCLUDED
+
+#include "syslog-ng.h"
+#include "logmsg/logmsg.h"
+
+#include <maxminddb.h>
+#include <sys/socket.h>
+
+/*
+ * A bounded LRU cache of the name-value pairs geoip2() extracted for an IP
+ * address.
+ *
+ * GeoIPLookupCache instances are not locked: each is only ever accessed
+ * by the worker thread that owns its slot in a GeoIPLookupCacheSet.  The
+ * set is shared between the clones of a parser and survives configuration
+ * reloads, but it is flushed if the database file behind it changed.
+ */
+
+typedef struct _GeoIPLookupCacheKey
+{
+  guint8 family;
+  guint8 addr[16];
+} GeoIPLookupCacheKey;
+
+typedef struct _GeoIPLookupCacheEntry GeoIPLookupCacheEntry;
+typedef struct _GeoIPLookupCache GeoIPLookupCache;
+typedef struct _GeoIPLookupCacheSet GeoIPLookupCacheSet;
+
+gboolean geoip_lookup_cache_key_parse(GeoIPLookupCacheKey *key, const gchar *ip);
+socklen_t geoip_lookup_cache_key_to_sockaddr(const GeoIPLookupCacheKey *key, struct sockaddr_storage *sa);
+
+void geoip_lookup_cache_entry_add_value(GeoIPLookupCacheEntry *self, NVHandle handle,
+                                        const gchar *value, gsize value_len);
+void geoip_lookup_cache_entry_apply(GeoIPLookupCacheEntry *self, LogMessage *msg);
+
+GeoIPLookupCacheEntry *geoip_lookup_cache_lookup(GeoIPLookupCache *self, const GeoIPLookupCacheKey *key);
+GeoIPLookupCacheEntry *geoip_lookup_cache_store(GeoIPLookupCache *self, const GeoIPLookupCacheKey *key);
+guint geoip_lookup_cache_get_length(GeoIPLookupCache *self);
+void geoip_lookup_cache_clear(GeoIPLookupCache *self);
+GeoIPLookupCache *geoip_lookup_cache_new(gint capacity);
+void geoip_lookup_cache_free(GeoIPLookupCache *self);
+
+GeoIPLookupCache *geoip_lookup_cache_set_get_thread_cache(GeoIPLookupCacheSet *self);
+GeoIPLookupCacheSet *geoip_lookup_cache_set_acquire(const gchar *database_path, const gchar *prefix,
+                                                    const MMDB_s *database, gint capacity);
+void geoip_lookup_cache_set_release(GeoIPLookupCacheSet *self);
+
+#endif
@@ -22,6 +22,8 @@
 
 #include "geoip-parser.h"
 #include "maxminddb-helper.h"
+#include "geoip-lookup-cache.h"
+#include "stats/stats-cluster-single.h"
 
 typedef struct _GeoIPParser GeoIPParser;
 
@@ -32,6 +34,13 @@ struct _GeoIPParser
 
   gchar *database_path;
   gchar *prefix;
+  /* 0 disables the cache, which is the default */
+  gint cache_size;
+
+  GeoIPLookupCacheSet *cache;
+  /* process-wide, shared by every geoip2() parser that has a cache */
+  StatsCounterItem *cache_hits;
+  StatsCounterItem *cache_misses;
 };
 
 void
@@ -52,6 +61,27 @@ geoip_parser_set_database_path(LogParser *s, const gchar *database_path)
   self->database_path = g_strdup(database_path);
 }
 
+void
+geoip_parser_set_cache_size(LogParser *s, gint cache_size)
+{
+  GeoIPParser *self = (GeoIPParser *) s;
+
+  self->cache_size = cache_size;
+}
+
+static gboolean
+_mmdb_get_entry_data_list(MMDB_lookup_result_s *result, MMDB_entry_data_list_s **entry_data_list)
+{
+  int mmdb_error = MMDB_get_entry_data_list(&result->entry, entry_data_list);
+  if (MMDB_SUCCESS != mmdb_error)
+    {
+      msg_debug("GeoIP2: MMDB_get_entry_data_list",
+                evt_tag_str("error", MMDB_strerror(mmdb_error)));
+      return FALSE;
+    }
+  return TRUE;
+}
+
 static gboolean
 _mmdb_load_entry_data_list(GeoIPParser *self, const gchar *input, MMDB_entry_data_list_s **entry_data_list)
 {
@@ -76,16 +106,92 @@ _mmdb_load_entry_data_list(GeoIPParser *self, const gchar *input, MMDB_entry_dat
       return FALSE;
     }
 
-  mmdb_error = MMDB_get_entry_data_list(&result.entry, entry_data_list);
-  if (MMDB_SUCCESS != mmdb_error)
+  return _mmdb_get_entry_data_list(&result, entry_data_list);
+}
+
+static void
+_dump_entry_data_list(GeoIPParser *self, const GeoIPValueSink *sink, MMDB_entry_data_list_s *entry_data_list)
+{
+  GArray *path = g_array_new(TRUE, FALSE, sizeof(gchar *));
+  g_array_append_val(path, self->prefix);
+
+  gint status;
+  dump_geodata(sink, entry_data_list, path, &status);
+
+  MMDB_free_entry_data_list(entry_data_list);
+  g_array_free(path, TRUE);
+}
+
+static void
+_msg_add_value(const gchar *name, const gchar *value, gsize value_len, gpointer user_data)
+{
+  LogMessage *msg = (LogMessage *) user_data;
+
+  log_msg_set_value_by_name(msg, name, value, value_len);
+}
+
+static void
+_cache_entry_add_value(const gchar *name, const gchar *value, gsize value_len, gpointer user_data)
+{
+  GeoIPLookupCacheEntry *entry = (GeoIPLookupCacheEntry *) user_data;
+
+  geoip_lookup_cache_entry_add_value(entry, log_msg_get_value_handle(name), value, value_len);
+}
+
+/* returns FALSE on error, addresses that are not in the database are
+ * cached as an empty entry */
+static gboolean
+_mmdb_lookup_into_cache(GeoIPParser *self, GeoIPLookupCache *cache, const GeoIPLookupCacheKey *key,
+                        const gchar *input, GeoIPLookupCacheEntry **entry)
+{
+  struct sockaddr_storage sa;
+  int mmdb_error;
+
+  geoip_lookup_cache_key_to_sockaddr(key, &sa);
+  MMDB_lookup_result_s result = MMDB_lookup_sockaddr(self->database, (struct sockaddr *) &sa, &mmdb_error);
+
+  if (mmdb_error != MMDB_SUCCESS)
     {
-      msg_debug("GeoIP2: MMDB_get_entry_data_list",
-                evt_tag_str("error", MMDB_strerror(mmdb_error)));
+      msg_error("geoip2(): maxminddb error",
+                evt_tag_str("error", MMDB_strerror(mmdb_error)),
+                evt_tag_str("ip", input),
+                log_pipe_location_tag(&self->super.super));
       return FALSE;
     }
+
+  MMDB_entry_data_list_s *entry_data_list = NULL;
+  if (result.found_entry && !_mmdb_get_entry_data_list(&result, &entry_data_list))
+    return FALSE;
+
+  *entry = geoip_lookup_cache_store(cache, key);
+  if (entry_data_list)
+    {
+      GeoIPValueSink sink = { .add_value = _cache_entry_add_value, .user_data = *entry };
+      _dump_entry_data_list(self, &sink, entry_data_list);
+    }
   return TRUE;
 }
 
+static void
+_process_cached(GeoIPParser *self, GeoIPLookupCache *cache, const GeoIPLookupCacheKey *key,
+                const gchar *input, LogMessage *msg)
+{
+  GeoIPLookupCacheEntry *entry = geoip_lookup_cache_lookup(cache, key);
+
+  if (entry)
+    {
+      stats_counter_inc(self->cache_hits);
+    }
+  else
+    {
+      stats_counter_inc(self->cache_misses);
+      if (!_mmdb_lookup_into_cache(self, cache, key, input, &entry))
+        return;
+    }
+
+  geoip_lookup_cache_entry_apply(entry, msg);
+}
+
 static gboolean
 maxminddb_parser_process(LogParser *s, LogMessage **pmsg,
                          const LogPathOptions *path_options,
@@ -98,18 +204,20 @@ maxminddb_parser_process(LogParser *s, LogMessage **pmsg,
             evt_tag_str ("prefix", self->prefix),
             evt_tag_printf("msg", "%p", *pmsg));
 
+  GeoIPLookupCache *cache = self->cache ? geoip_lookup_cache_set_get_thread_cache(self->cache) : NULL;
+  GeoIPLookupCacheKey key;
+  if (cache && geoip_lookup_cache_key_parse(&key, input))
+    {
+      _process_cached(self, cache, &key, input, msg);
+      return TRUE;
+    }
+
   MMDB_entry_data_list_s *entry_data_list;
   if (!_mmdb_load_entry_data_list(self, input, &entry_data_list))
     return TRUE;
 
-  GArray *path = g_array_new(TRUE, FALSE, sizeof(gchar *));
-  g_array_append_val(path, self->prefix);
-
-  gint status;
-  dump_geodata_into_msg(msg, entry_data_list, path, &status);
-
-  MMDB_free_entry_data_list(entry_data_list);
-  g_array_free(path, TRUE);
+  GeoIPValueSink sink = { .add_value = _msg_add_value, .user_data = msg };
+  _dump_entry_data_list(self, &sink, entry_data_list);
 
   return TRUE;
 }
@@ -124,6 +232,7 @@ maxminddb_parser_clone(LogPipe *s)
 
   geoip_parser_set_database_path(&cloned->super, self->database_path);
   geoip_parser_set_prefix(&cloned->super, self->prefix);
+  geoip_parser_set_cache_size(&cloned->super, self->cache_size);
   log_parser_set_template(&cloned->super, log_template_ref(self->super.template));
 
   return &cloned->super.super;
@@ -180,9 +289,46 @@ maxminddb_parser_init(LogPipe *s)
 
   remove_trailing_dot(self->prefix);
 
+  if (self->cache_size > 0)
+    {
+      StatsClusterKey sc_key;
+
+      self->cache = geoip_lookup_cache_set_acquire(self->database_path, self->prefix, self->database,
+                                                   self->cache_size);
+      stats_lock();
+      stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "geoip2_cache_hits", NULL);
+      stats_register_contended_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &self->cache_hits);
+      stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "geoip2_cache_misses", NULL);
+      stats_register_contended_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &self->cache_misses);
+      stats_unlock();
+    }
+
   return log_parser_init_method(s);
 }
 
+static gboolean
+maxminddb_parser_deinit(LogPipe *s)
+{
+  GeoIPParser *self = (GeoIPParser *) s;
+
+  if (self->cache)
+    {
+      StatsClusterKey sc_key;
+
+      stats_lock();
+      stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "geoip2_cache_hits", NULL);
+      stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &self->cache_hits);
+      stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "geoip2_cache_misses", NULL);
+      stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &self->cache_misses);
+      stats_unlock();
+
+      geoip_lookup_cache_set_release(self->cache);
+      self->cache = NULL;
+    }
+
+  return log_parser_deinit_method(s);
+}
+
 LogParser *
 maxminddb_parser_new(GlobalConfig *cfg)
 {
@@ -190,6 +336,7 @@ maxminddb_parser_new(GlobalConfig *cfg)
 
   log_parser_init_instance(&self->super, cfg);
   self->super.super.init = maxminddb_parser_init;
+  self->super.super.deinit = maxminddb_parser_deinit;
   self->super.super.free_fn = maxminddb_parser_free;
   self->super.super.clone = maxminddb_parser_clone;
   self->super.process = maxminddb_parser_process;
@@ -25,12 +25,19 @@
 
 #include <syslog-ng.h>
 #include <maxminddb.h>
+
+typedef struct _GeoIPValueSink
+{
+  void (*add_value)(const gchar *name, const gchar *value, gsize value_len, gpointer user_data);
+  gpointer user_data;
+} GeoIPValueSink;
+
 void append_mmdb_entry_data_to_gstring(GString *target, MMDB_entry_data_s *entry_data);
 gchar *mmdb_default_database(void);
 gboolean mmdb_open_database(const gchar *path, MMDB_s *database);
-MMDB_entry_data_list_s *dump_geodata_into_msg(LogMessage *msg,
-                                              MMDB_entry_data_list_s *entry_data_list,
-                                              GArray *path, gint *status);
+MMDB_entry_data_list_s *dump_geodata(const GeoIPValueSink *sink,
+                                     MMDB_entry_data_list_s *entry_data_list,
+                                     GArray *path, gint *status);
 
 
 #endif
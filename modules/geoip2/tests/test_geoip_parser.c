@@ -20,11 +20,17 @@
  */
 
 #include "geoip-parser.h"
+#include "geoip-lookup-cache.h"
 #include "apphook.h"
 #include "msg_parse_lib.h"
 #include "scratch-buffers.h"
+#include "mainloop-worker.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-single.h"
 
 #include <criterion/criterion.h>
+#include <unistd.h>
+#include <utime.h>
 
 GlobalConfig *cfg;
 LogParser *geoip_parser;
@@ -134,4 +140,231 @@ Test(geoip2, test_basic)
   log_msg_unref(msg);
 }
 
+static LogParser *
+_init_cloned_parser(const gchar *database_path, gint cache_size)
+{
+  LogParser *cloned_parser = (LogParser *) log_pipe_clone(&geoip_parser->super);
+
+  LogTemplate *template = log_template_new(NULL, NULL);
+  cr_assert(log_template_compile(template, "$MSG", NULL));
+  log_parser_set_template(cloned_parser, template);
+  if (database_path)
+    geoip_parser_set_database_path(cloned_parser, database_path);
+  /* 0 keeps the default */
+  if (cache_size)
+    geoip_parser_set_cache_size(cloned_parser, cache_size);
+
+  cr_assert(log_pipe_init(&cloned_parser->super));
+  return cloned_parser;
+}
+
+static void
+_deinit_cloned_parser(LogParser *cloned_parser)
+{
+  log_pipe_deinit(&cloned_parser->super);
+  log_pipe_unref(&cloned_parser->super);
+}
+
+static LogMessage *
+_process_ip(LogParser *parser, const gchar *ip)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msg = log_msg_new_empty();
+
+  log_msg_set_value(msg, LM_V_MESSAGE, ip, -1);
+  cr_assert(log_parser_process_message(parser, &msg, &path_options));
+  return msg;
+}
+
+static StatsCounterItem *
+_lookup_cache_counter(const gchar *name)
+{
+  StatsClusterKey sc_key;
+  StatsCounterItem *counter;
+
+  stats_lock();
+  stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, name, NULL);
+  counter = stats_get_counter(&sc_key, SC_TYPE_SINGLE_VALUE);
+  stats_unlock();
+  return counter;
+}
+
+static gsize
+_get_cache_counter(const gchar *name)
+{
+  StatsCounterItem *counter = _lookup_cache_counter(name);
+
+  cr_assert_not_null(counter, "counter %s is not registered", name);
+  return stats_counter_get(counter);
+}
+
+static void
+_assert_lookup_counters(gsize hits, gsize misses)
+{
+  cr_assert_eq(_get_cache_counter("geoip2_cache_hits"), hits);
+  cr_assert_eq(_get_cache_counter("geoip2_cache_misses"), misses);
+}
+
+Test(geoip2, cache_is_disabled_by_default)
+{
+  LogParser *parser = _init_cloned_parser(NULL, 0);
+  LogMessage *msg;
+
+  main_loop_worker_set_thread_id(0);
+  msg = _process_ip(parser, "2.125.160.216");
+  assert_log_message_value(msg, log_msg_get_value_handle(".geoip2.country.iso_code"), "GB");
+  log_msg_unref(msg);
+  cr_assert_null(_lookup_cache_counter("geoip2_cache_hits"));
+
+  _deinit_cloned_parser(parser);
+}
+
+Test(geoip2, cached_lookup_is_the_same_as_uncached)
+{
+  LogParser *parser = _init_cloned_parser(NULL, 1024);
+  LogMessage *msg;
+
+  main_loop_worker_set_thread_id(0);
+  for (gint i = 0; i < 3; i++)
+    {
+      msg = _process_ip(parser, "2.125.160.216");
+      assert_log_message_value(msg, log_msg_get_value_handle(".geoip2.country.iso_code"), "GB");
+      assert_log_message_value(msg, log_msg_get_value_handle(".geoip2.location.latitude"), "51.750000");
+      assert_log_message_value(msg, log_msg_get_value_handle(".geoip2.location.longitude"), "-1.250000");
+      log_msg_unref(msg);
+    }
+  _assert_lookup_counters(2, 1);
+
+  /* not in the database: cached as an empty result */
+  for (gint i = 0; i < 2; i++)
+    {
+      msg = _process_ip(parser, "127.0.0.1");
+      assert_log_message_value(msg, log_msg_get_value_handle(".geoip2.country.iso_code"), NULL);
+      log_msg_unref(msg);
+    }
+  _assert_lookup_counters(3, 2);
+
+  _deinit_cloned_parser(parser);
+}
+
+Test(geoip2, threads_without_worker_id_bypass_the_cache)
+{
+  LogParser *parser = _init_cloned_parser(NULL, 1024);
+  LogMessage *msg;
+
+  main_loop_worker_set_thread_id(-1);
+  msg = _process_ip(parser, "2.125.160.216");
+  assert_log_message_value(msg, log_msg_get_value_handle(".geoip2.country.iso_code"), "GB");
+  log_msg_unref(msg);
+  _assert_lookup_counters(0, 0);
+
+  _deinit_cloned_parser(parser);
+}
+
+Test(geoip2, cache_survives_reload_unless_the_database_changes)
+{
+  const gchar *database_copy = "test_geoip_lookup_cache.mmdb";
+  gchar *contents;
+  gsize length;
+  LogParser *parser;
+  LogMessage *msg;
+
+  cr_assert(g_file_get_contents(TOP_SRCDIR "/modules/geoip2/tests/test.mmdb", &contents, &length, NULL));
+  cr_assert(g_file_set_contents(database_copy, contents, length, NULL));
+  g_free(contents);
+
+  main_loop_worker_set_thread_id(0);
+
+  parser = _init_cloned_parser(database_copy, 1024);
+  log_msg_unref(_process_ip(parser, "2.125.160.216"));
+  _assert_lookup_counters(0, 1);
+  _deinit_cloned_parser(parser);
+
+  parser = _init_cloned_parser(database_copy, 1024);
+  log_msg_unref(_process_ip(parser, "2.125.160.216"));
+  _assert_lookup_counters(1, 1);
+  _deinit_cloned_parser(parser);
+
+  struct utimbuf times = { .actime = 1, .modtime = 1 };
+  cr_assert(utime(database_copy, &times) == 0);
+
+  parser = _init_cloned_parser(database_copy, 1024);
+  msg = _process_ip(parser, "2.125.160.216");
+  assert_log_message_value(msg, log_msg_get_value_handle(".geoip2.country.iso_code"), "GB");
+  log_msg_unref(msg);
+  _assert_lookup_counters(1, 2);
+  _deinit_cloned_parser(parser);
+
+  unlink(database_copy);
+}
+
 TestSuite(geoip2, .init = setup, .fini = teardown);
+
+Test(geoip2_lookup_cache, key_parse)
+{
+  GeoIPLookupCacheKey key;
+
+  cr_assert(geoip_lookup_cache_key_parse(&key, "2.125.160.216"));
+  cr_assert_eq(key.family, AF_INET);
+  cr_assert(geoip_lookup_cache_key_parse(&key, "2001:218::1"));
+  cr_assert_eq(key.family, AF_INET6);
+  cr_assert_not(geoip_lookup_cache_key_parse(&key, "localhost"));
+  cr_assert_not(geoip_lookup_cache_key_parse(&key, ""));
+}
+
+static void
+_store(GeoIPLookupCache *cache, const gchar *ip)
+{
+  GeoIPLookupCacheKey key;
+
+  cr_assert(geoip_lookup_cache_key_parse(&key, ip));
+  geoip_lookup_cache_entry_add_value(geoip_lookup_cache_store(cache, &key),
+                                     log_msg_get_value_handle("ip"), ip, strlen(ip));
+}
+
+static gboolean
+_is_cached(GeoIPLookupCache *cache, const gchar *ip)
+{
+  GeoIPLookupCacheKey key;
+
+  cr_assert(geoip_lookup_cache_key_parse(&key, ip));
+  return geoip_lookup_cache_lookup(cache, &key) != NULL;
+}
+
+Test(geoip2_lookup_cache, least_recently_used_entry_is_evicted)
+{
+  GeoIPLookupCache *cache = geoip_lookup_cache_new(2);
+
+  _store(cache, "10.0.0.1");
+  _store(cache, "10.0.0.2");
+  cr_assert(_is_cached(cache, "10.0.0.1"));
+
+  _store(cache, "10.0.0.3");
+  cr_assert_eq(geoip_lookup_cache_get_length(cache), 2);
+  cr_assert(_is_cached(cache, "10.0.0.1"));
+  cr_assert_not(_is_cached(cache, "10.0.0.2"));
+  cr_assert(_is_cached(cache, "10.0.0.3"));
+
+  geoip_lookup_cache_clear(cache);
+  cr_assert_eq(geoip_lookup_cache_get_length(cache), 0);
+  cr_assert_not(_is_cached(cache, "10.0.0.1"));
+
+  geoip_lookup_cache_free(cache);
+}
+
+Test(geoip2_lookup_cache, cached_values_are_applied_to_the_message)
+{
+  GeoIPLookupCache *cache = geoip_lookup_cache_new(16);
+  GeoIPLookupCacheKey key;
+  LogMessage *msg = log_msg_new_empty();
+
+  _store(cache, "::1");
+  cr_assert(geoip_lookup_cache_key_parse(&key, "::1"));
+  geoip_lookup_cache_entry_apply(geoip_lookup_cache_lookup(cache, &key), msg);
+  assert_log_message_value(msg, log_msg_get_value_handle("ip"), "::1");
+
+  log_msg_unref(msg);
+  geoip_lookup_cache_free(cache);
+}
+
+TestSuite(geoip2_lookup_cache, .init = app_startup, .fini = app_shutdown);
@@ -45,6 +45,8 @@
 #define DEFAULT_PRIO (LOG_LOCAL0 | LOG_NOTICE)
 #define DEFAULT_FETCH_LIMIT 10
 
+#define MAX_FIELD_NAME_LENGTH 256
+
 static gboolean journal_reader_initialized = FALSE;
 
 typedef struct _JournalReaderState
@@ -53,6 +55,24 @@ typedef struct _JournalReaderState
   gchar cursor[MAX_CURSOR_LENGTH];
 } JournalReaderState;
 
+typedef enum
+{
+  JF_OTHER,
+  JF_MESSAGE,
+  JF_HOSTNAME,
+  JF_PID,
+  JF_SYSLOG_FACILITY,
+  JF_PRIORITY,
+} JournalFieldType;
+
+/* what we know about a journal field name, cached so that the per-entry
+ * processing needs neither string compares nor name-value registry lookups */
+typedef struct _JournalField
+{
+  JournalFieldType type;
+  NVHandle handle;
+} JournalField;
+
 typedef struct _JournalBookmarkData
 {
   PersistEntryHandle persist_handle;
@@ -72,6 +92,11 @@ struct _JournalReader
   gboolean watches_running:1, suspended:1;
   gint notify_code;
   gboolean immediate_check;
+  gboolean entry_prefetched;
+
+  GHashTable *fields;
+  NVHandle syslog_identifier_handle;
+  NVHandle comm_handle;
 
   PersistState *persist_state;
   PersistEntryHandle persist_handle;
@@ -154,30 +179,58 @@ _reader_wakeup(LogSource *s)
     iv_event_post(&self->schedule_wakeup);
 }
 
-static void
-_map_key_value_pairs_to_syslog_macros(LogMessage *msg, gchar *key, gchar *value, gssize value_len)
+static JournalFieldType
+_get_field_type(const gchar *key)
 {
   if (strcmp(key, "MESSAGE") == 0)
+    return JF_MESSAGE;
+  else if (strcmp(key, "_HOSTNAME") == 0)
+    return JF_HOSTNAME;
+  else if (strcmp(key, "_PID") == 0)
+    return JF_PID;
+  else if (strcmp(key, "SYSLOG_FACILITY") == 0)
+    return JF_SYSLOG_FACILITY;
+  else if (strcmp(key, "PRIORITY") == 0)
+    return JF_PRIORITY;
+  return JF_OTHER;
+}
+
+static gint
+_value_to_int(const gchar *value, gssize value_len)
+{
+  gchar buf[16];
+  gsize len = MIN((gsize) value_len, sizeof(buf) - 1);
+
+  /* value points into the journal data and is not NUL terminated */
+  memcpy(buf, value, len);
+  buf[len] = 0;
+  return atoi(buf);
+}
+
+static void
+_map_key_value_pairs_to_syslog_macros(LogMessage *msg, JournalFieldType type, const gchar *value, gssize value_len)
+{
+  switch (type)
     {
+    case JF_MESSAGE:
       log_msg_set_value(msg, LM_V_MESSAGE, value, value_len);
       msg_debug("Incoming log entry from journal",
                 evt_tag_printf("message", "%.*s", (int)value_len, value));
-    }
-  else if (strcmp(key, "_HOSTNAME") == 0)
-    {
+      break;
+    case JF_HOSTNAME:
       log_msg_set_value(msg, LM_V_HOST, value, value_len);
-    }
-  else if (strcmp(key, "_PID") == 0)
-    {
+      break;
+    case JF_PID:
       log_msg_set_value(msg, LM_V_PID, value, value_len);
-    }
-  else if (strcmp(key, "SYSLOG_FACILITY") == 0)
-    {
-      msg->pri = (msg->pri & 7) | atoi(value) << 3;
-    }
-  else if (strcmp(key, "PRIORITY") == 0)
-    {
-      msg->pri = (msg->pri & ~7) | atoi(value);
+      break;
+    case JF_SYSLOG_FACILITY:
+      msg->pri = (msg->pri & 7) | _value_to_int(value, value_len) << 3;
+      break;
+    case JF_PRIORITY:
+      msg->pri = (msg->pri & ~7) | _value_to_int(value, value_len);
+      break;
+    default:
+      break;
     }
 }
 
@@ -191,50 +244,66 @@ _format_value_name_with_prefix(gchar *buf, gsize buf_len, JournalReaderOptions *
   g_strlcpy(buf + cont, key, buf_len - cont);
 }
 
-static void
-_set_value_in_message(JournalReaderOptions *options, LogMessage *msg, gchar *key, gchar *value, gssize value_len)
+static NVHandle
+_get_value_handle_with_prefix(JournalReaderOptions *options, const gchar *key)
 {
-  gchar name_with_prefix[256];
+  gchar name_with_prefix[MAX_FIELD_NAME_LENGTH];
 
   _format_value_name_with_prefix(name_with_prefix, sizeof(name_with_prefix), options, key);
-  log_msg_set_value_by_name(msg, name_with_prefix, value, value_len);
+  return log_msg_get_value_handle(name_with_prefix);
 }
 
-static const gchar *
-_get_value_from_message(JournalReaderOptions *options, LogMessage *msg,  const gchar *key, gssize *value_length)
+static JournalField *
+_lookup_field(JournalReader *self, const gchar *key)
 {
-  gchar name_with_prefix[256];
+  JournalField *field = g_hash_table_lookup(self->fields, key);
 
-  _format_value_name_with_prefix(name_with_prefix, sizeof(name_with_prefix), options, key);
-  return log_msg_get_value_by_name(msg, name_with_prefix, value_length);
+  if (!field)
+    {
+      field = g_new0(JournalField, 1);
+      field->type = _get_field_type(key);
+      field->handle = _get_value_handle_with_prefix(self->options, key);
+      g_hash_table_insert(self->fields, g_strdup(key), field);
+    }
+  return field;
 }
 
 static void
-_handle_data(gchar *key, gchar *value, gpointer user_data)
+_handle_field(const gchar *key, gsize key_len, const gchar *value, gsize value_len, gpointer user_data)
 {
   gpointer *args = user_data;
 
-  LogMessage *msg = args[0];
-  JournalReaderOptions *options = args[1];
-  gssize value_len = MIN(strlen(value), options->max_field_size);
+  JournalReader *self = args[0];
+  LogMessage *msg = args[1];
+  gchar key_buf[MAX_FIELD_NAME_LENGTH];
+  gchar *key_str = key_len < sizeof(key_buf) ? key_buf : g_malloc(key_len + 1);
+
+  memcpy(key_str, key, key_len);
+  key_str[key_len] = 0;
+
+  JournalField *field = _lookup_field(self, key_str);
+  value_len = MIN(value_len, self->options->max_field_size);
+
+  _map_key_value_pairs_to_syslog_macros(msg, field->type, value, value_len);
+  log_msg_set_value(msg, field->handle, value, value_len);
 
-  _map_key_value_pairs_to_syslog_macros(msg, key, value, value_len);
-  _set_value_in_message(options, msg, key, value, value_len);
+  if (key_str != key_buf)
+    g_free(key_str);
 }
 
 static void
-_set_program(JournalReaderOptions *options, LogMessage *msg)
+_set_program(JournalReader *self, LogMessage *msg)
 {
   gssize value_length = 0;
-  const gchar *value_ref = _get_value_from_message(options, msg, "SYSLOG_IDENTIFIER", &value_length);
+  const gchar *value_ref = log_msg_get_value(msg, self->syslog_identifier_handle, &value_length);
 
   if (value_length <= 0)
     {
-      value_ref = _get_value_from_message(options, msg, "_COMM", &value_length);
+      value_ref = log_msg_get_value(msg, self->comm_handle, &value_length);
     }
 
   /* we need to strdup the value_ref: referred value can change during log_msg_set_value if nvtable realloc needed */
-  gchar *value = g_strdup(value_ref);
+  gchar *value = g_strndup(value_ref, value_length);
   log_msg_set_value(msg, LM_V_PROGRAM, value, value_length);
   g_free(value);
 }
@@ -255,21 +324,20 @@ _set_message_timestamp(JournalReader *self, LogMessage *msg)
     }
 }
 
-static gboolean
-_handle_message(JournalReader *self)
+static LogMessage *
+_create_message(JournalReader *self)
 {
   LogMessage *msg = log_msg_new_empty();
 
   msg->pri = self->options->default_pri;
 
-  gpointer args[] = {msg, self->options};
+  gpointer args[] = {self, msg};
 
-  journald_foreach_data(self->journal, _handle_data, args);
+  journald_foreach_field(self->journal, _handle_field, args);
   _set_message_timestamp(self, msg);
-  _set_program(self->options, msg);
+  _set_program(self, msg);
 
-  log_source_post(&self->super, msg);
-  return log_source_free_to_send(&self->super);
+  return msg;
 }
 
 static gboolean
@@ -437,7 +505,7 @@ _set_starting_position(JournalReader *self)
 static gchar *
 _get_cursor(JournalReader *self)
 {
-  gchar *cursor;
+  gchar *cursor = NULL;
   journald_get_cursor(self->journal, &cursor);
   return cursor;
 }
@@ -446,6 +514,11 @@ static void
 _reader_save_state(Bookmark *bookmark)
 {
   JournalBookmarkData *bookmark_data = (JournalBookmarkData *)(&bookmark->container);
+
+  /* only the last entry of a batch carries a cursor */
+  if (!bookmark_data->cursor)
+    return;
+
   JournalReaderState *state = persist_state_map_entry(bookmark->persist_state, bookmark_data->persist_handle);
   strcpy(state->cursor, bookmark_data->cursor);
   persist_state_unmap_entry(bookmark->persist_state, bookmark_data->persist_handle);
@@ -459,15 +532,41 @@ _destroy_bookmark(Bookmark *bookmark)
 }
 
 static void
-_fill_bookmark(JournalReader *self, Bookmark *bookmark)
+_fill_bookmark(JournalReader *self, Bookmark *bookmark, gboolean with_cursor)
 {
   JournalBookmarkData *bookmark_data = (JournalBookmarkData *)(&bookmark->container);
-  bookmark_data->cursor = _get_cursor(self);
+  bookmark_data->cursor = with_cursor ? _get_cursor(self) : NULL;
   bookmark_data->persist_handle = self->persist_handle;
   bookmark->save = _reader_save_state;
   bookmark->destroy = _destroy_bookmark;
 }
 
+static gint
+_step_to_next_entry(JournalReader *self)
+{
+  if (self->entry_prefetched)
+    {
+      self->entry_prefetched = FALSE;
+      return 1;
+    }
+  return journald_next(self->journal);
+}
+
+static gboolean
+_is_last_in_batch(JournalReader *self, gint msg_count)
+{
+  return msg_count >= self->options->fetch_limit ||
+         window_size_counter_get(&self->super.window_size, NULL) <= 1 ||
+         main_loop_worker_job_quit();
+}
+
+/*
+ * Fetching a cursor from the journal is expensive, so only the last entry
+ * of a batch gets one: we read ahead one entry to find out whether the
+ * current one is the last.  If the read-ahead hits EOF, sd_journal stays on
+ * the current entry and the cursor can still be fetched.  A crash in the
+ * middle of a batch means the whole batch is re-read on startup.
+ */
 static gint
 _fetch_log(JournalReader *self)
 {
@@ -476,16 +575,36 @@ _fetch_log(JournalReader *self)
   self->immediate_check = TRUE;
   while (msg_count < self->options->fetch_limit && !main_loop_worker_job_quit())
     {
-      gint rc = journald_next(self->journal);
+      gint rc = _step_to_next_entry(self);
       if (rc > 0)
         {
+          LogMessage *msg = _create_message(self);
+          gboolean last_in_batch = _is_last_in_batch(self, ++msg_count);
+
+          if (!last_in_batch)
+            {
+              rc = journald_next(self->journal);
+              self->entry_prefetched = (rc > 0);
+              last_in_batch = !self->entry_prefetched;
+            }
+
           Bookmark *bookmark = ack_tracker_request_bookmark(self->super.ack_tracker);
-          _fill_bookmark(self, bookmark);
-          msg_count++;
-          if (!_handle_message(self))
+          _fill_bookmark(self, bookmark, last_in_batch && rc >= 0);
+          log_source_post(&self->super, msg);
+
+          if (rc <= 0)
             {
+              self->immediate_check = FALSE;
+              if (rc < 0)
+                {
+                  msg_error("Error occurred while getting next message from journal",
+                            evt_tag_errno("error", -rc));
+                  result = NC_READ_ERROR;
+                }
               break;
             }
+          if (!log_source_free_to_send(&self->super))
+            break;
         }
       else
         {
@@ -671,12 +790,17 @@ _init(LogPipe *s)
       journald_close(self->journal);
       return FALSE;
     }
+  self->entry_prefetched = FALSE;
 
   if (!_add_poll_events(self))
     {
       return FALSE;
     }
 
+  self->fields = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+  self->syslog_identifier_handle = _get_value_handle_with_prefix(self->options, "SYSLOG_IDENTIFIER");
+  self->comm_handle = _get_value_handle_with_prefix(self->options, "_COMM");
+
   self->immediate_check = TRUE;
   journal_reader_initialized = TRUE;
   _update_watches(self);
@@ -691,6 +815,8 @@ _deinit(LogPipe *s)
   _stop_watches(self);
   journald_close(self->journal);
   poll_events_free(self->poll_events);
+  g_hash_table_destroy(self->fields);
+  self->fields = NULL;
   journal_reader_initialized = FALSE;
   return TRUE;
 }
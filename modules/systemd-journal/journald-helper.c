@@ -64,3 +64,26 @@ void journald_foreach_data(Journald *self, FOREACH_DATA_CALLBACK func, gpointer
       }
   }
 }
+
+void journald_foreach_field(Journald *self, FOREACH_FIELD_CALLBACK func, gpointer user_data)
+{
+  const void *data;
+  size_t l = 0;
+
+  JOURNALD_FOREACH_DATA(self, data, l)
+  {
+    const gchar *field = (const gchar *) data;
+    const gchar *pos = memchr(field, '=', l);
+
+    if (!pos)
+      continue;
+
+    const gchar *value = pos + 1;
+    gsize value_len = l - (value - field);
+    const gchar *value_end = memchr(value, '\0', value_len);
+
+    if (value_end)
+      value_len = value_end - value;
+    func(field, pos - field, value, value_len, user_data);
+  }
+}
@@ -47,6 +47,13 @@ typedef void (*FOREACH_DATA_CALLBACK)(gchar *key, gchar *value, gpointer user_da
 
 void journald_foreach_data(Journald *self, FOREACH_DATA_CALLBACK func, gpointer user_data);
 
+/* key and value point into the journal's own buffer, they are neither
+ * NUL terminated nor valid after the callback returns */
+typedef void (*FOREACH_FIELD_CALLBACK)(const gchar *key, gsize key_len, const gchar *value, gsize value_len,
+                                       gpointer user_data);
+
+void journald_foreach_field(Journald *self, FOREACH_FIELD_CALLBACK func, gpointer user_data);
+
 
 gboolean load_journald_subsystem(void);
 Journald *journald_new(void);
@@ -97,13 +97,17 @@ int
 journald_next(Journald *self)
 {
   g_assert(self->opened);
-  self->current_pos = self->next_element;
-  if (self->current_pos)
-    {
-      self->next_element = self->current_pos->next;
-      return 1;
-    }
-  return 0;
+  GList *next = self->next_element;
+
+  /* like sd_journal_next(), stay on the last entry at EOF */
+  if (!next && self->current_pos)
+    next = self->current_pos->next;
+  if (!next)
+    return 0;
+
+  self->current_pos = next;
+  self->next_element = next->next;
+  return 1;
 }
 
 void
@@ -24,17 +24,21 @@
 #include "ctl-stats.h"
 
 static gboolean stats_options_reset_is_set = FALSE;
+static gboolean stats_options_prometheus_is_set = FALSE;
 
 GOptionEntry stats_options[] =
 {
   { "reset", 'r', 0, G_OPTION_ARG_NONE, &stats_options_reset_is_set, "reset counters", NULL },
+  { "prometheus", 'p', 0, G_OPTION_ARG_NONE, &stats_options_prometheus_is_set, "print counters in OpenMetrics format", NULL },
   { NULL,    0,   0, G_OPTION_ARG_NONE, NULL,                        NULL,             NULL }
 };
 
 static const gchar *
 _stats_command_builder(void)
 {
-  return stats_options_reset_is_set ? "RESET_STATS" : "STATS";
+  if (stats_options_reset_is_set)
+    return "RESET_STATS";
+  return stats_options_prometheus_is_set ? "STATS PROMETHEUS" : "STATS";
 }
 
 gint
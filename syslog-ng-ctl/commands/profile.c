@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "profile.h"
+
+static gboolean profile_options_start_is_set = FALSE;
+static gboolean profile_options_stop_is_set = FALSE;
+static gboolean profile_options_reset_is_set = FALSE;
+
+GOptionEntry profile_options[] =
+{
+  { "start", 0, 0, G_OPTION_ARG_NONE, &profile_options_start_is_set, "reset the profile and start profiling", NULL },
+  { "stop",  0, 0, G_OPTION_ARG_NONE, &profile_options_stop_is_set,  "stop profiling", NULL },
+  { "reset", 'r', 0, G_OPTION_ARG_NONE, &profile_options_reset_is_set, "reset the profile", NULL },
+  { NULL,    0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL }
+};
+
+static const gchar *
+_profile_command_builder(void)
+{
+  if (profile_options_start_is_set)
+    return "PROFILE START";
+  if (profile_options_stop_is_set)
+    return "PROFILE STOP";
+  if (profile_options_reset_is_set)
+    return "PROFILE RESET";
+  return "PROFILE SHOW";
+}
+
+gint
+slng_profile(int argc, char *argv[], const gchar *mode, GOptionContext *ctx)
+{
+  return dispatch_command(_profile_command_builder());
+}
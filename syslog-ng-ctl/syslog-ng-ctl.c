@@ -35,6 +35,7 @@
 #include "commands/ctl-stats.h"
 #include "commands/query.h"
 #include "commands/license.h"
+#include "commands/profile.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -122,6 +123,7 @@ static CommandDescriptor modes[] =
   { "config", config_options, "Print current config", slng_config, NULL },
   { "list-files", no_options, "Print files present in config", slng_listfiles, NULL },
   { "export-config-graph", no_options, "export configuration graph", slng_export_config_graph, NULL },
+  { "profile", profile_options, "Profile the processing pipeline. Possible options: --start, --stop, --reset", slng_profile, NULL },
   { NULL, NULL },
 };
 
@@ -0,0 +1,346 @@
+#!/usr/bin/env python3
+#############################################################################
+# Copyright (c) 2021 One Identity
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License version 2 as published
+# by the Free Software Foundation, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#
+# As an additional exemption you are allowed to compile & link against the
+# OpenSSL libraries as published by the OpenSSL project. See the file
+# COPYING for details.
+#
+#############################################################################
+
+"""
+End-to-end throughput benchmark of syslog-ng.
+
+Every scenario starts syslog-ng with a canned configuration from the
+configs/ directory, drives it with loggen over loopback and collects:
+
+  - msgs_per_sec: messages received by syslog-ng per second
+  - cpu_usec_per_msg: user+system CPU time of syslog-ng per message
+  - max_rss_kb: peak resident set size of syslog-ng
+  - p99_latency_usec: end-to-end latency, measured by loggen for the
+    scenarios delivering the messages back to it over the network
+
+The results are written as JSON, to be compared between releases.
+"""
+
+import argparse
+import json
+import os
+import re
+import shlex
+import shutil
+import signal
+import socket
+import subprocess
+import sys
+import time
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+CONFIG_DIR = os.path.join(BENCH_DIR, 'configs')
+DATA_DIR = os.path.join(BENCH_DIR, 'data')
+
+STARTUP_TIMEOUT_SEC = 15
+STOP_TIMEOUT_SEC = 10
+DRAIN_IDLE_SEC = 1.0
+DRAIN_TIMEOUT_SEC = 60
+
+
+class Scenario(object):
+    def __init__(self, name, transport='stream', input_file=None, latency=False):
+        self.name = name
+        self.config = os.path.join(CONFIG_DIR, name + '.conf')
+        self.transport = transport
+        self.input_file = input_file
+        self.latency = latency
+
+
+SCENARIOS = [
+    Scenario('tcp-to-file'),
+    Scenario('udp-to-null', transport='dgram'),
+    Scenario('tcp-diskbuffer-tcp', latency=True),
+    Scenario('json-parse-format', input_file=os.path.join(DATA_DIR, 'json-messages.log')),
+    Scenario('patterndb'),
+    Scenario('templated-fanout'),
+]
+
+
+def find_free_port():
+    # the port is bound for both TCP and UDP by the latency receiver of loggen
+    while True:
+        tcp = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        tcp.bind(('127.0.0.1', 0))
+        port = tcp.getsockname()[1]
+        udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        try:
+            udp.bind(('127.0.0.1', port))
+            return port
+        except OSError:
+            continue
+        finally:
+            udp.close()
+            tcp.close()
+
+
+def get_config_version(syslog_ng):
+    output = subprocess.check_output([syslog_ng, '--version'], universal_newlines=True)
+    return re.search(r'^Config version: *(\S+)', output, re.MULTILINE).group(1)
+
+
+def get_version_string(syslog_ng):
+    output = subprocess.check_output([syslog_ng, '--version'], universal_newlines=True)
+    return output.splitlines()[0]
+
+
+def query_stats(control_socket):
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    try:
+        sock.connect(control_socket)
+        sock.sendall(b'STATS\n')
+        response = b''
+        while not response.endswith(b'\n.\n') and response != b'.\n':
+            chunk = sock.recv(65536)
+            if not chunk:
+                break
+            response += chunk
+    finally:
+        sock.close()
+
+    counters = {}
+    for line in response.decode('utf-8', 'replace').splitlines()[1:]:
+        fields = line.split(';')
+        if len(fields) == 6:
+            counters[';'.join(fields[0:3] + fields[4:5])] = int(fields[5])
+    return counters
+
+
+def get_received(control_socket):
+    return query_stats(control_socket).get('center;;received;processed', 0)
+
+
+def get_cpu_seconds(pid):
+    with open('/proc/%d/stat' % pid) as f:
+        # the command name may contain spaces, the fields start after it
+        fields = f.read().rsplit(')', 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / float(os.sysconf('SC_CLK_TCK'))
+
+
+def get_max_rss_kb(pid):
+    with open('/proc/%d/status' % pid) as f:
+        for line in f:
+            if line.startswith('VmHWM:'):
+                return int(line.split()[1])
+    return None
+
+
+class SyslogNg(object):
+    def __init__(self, binary, module_path, workdir):
+        self.binary = binary
+        self.module_path = module_path
+        self.workdir = workdir
+        self.control_socket = os.path.join(workdir, 'syslog-ng.ctl')
+        self.process = None
+
+    def start(self, config, env):
+        command = [self.binary, '-F', '--no-caps', '--enable-core',
+                   '-f', config,
+                   '-p', os.path.join(self.workdir, 'syslog-ng.pid'),
+                   '-R', os.path.join(self.workdir, 'syslog-ng.persist'),
+                   '-c', self.control_socket]
+        if self.module_path:
+            command += ['--module-path', self.module_path]
+
+        with open(os.path.join(self.workdir, 'syslog-ng.out'), 'w') as output:
+            self.process = subprocess.Popen(command, env=env, stdout=output, stderr=subprocess.STDOUT)
+
+        deadline = time.time() + STARTUP_TIMEOUT_SEC
+        while time.time() < deadline:
+            if self.process.poll() is not None:
+                raise RuntimeError('syslog-ng exited with %d, see %s/syslog-ng.out' % (self.process.returncode, self.workdir))
+            try:
+                get_received(self.control_socket)
+                return
+            except (OSError, socket.error):
+                time.sleep(0.1)
+        raise RuntimeError('syslog-ng did not start up in %d seconds' % STARTUP_TIMEOUT_SEC)
+
+    def stop(self):
+        if not self.process or self.process.poll() is not None:
+            return
+        self.process.send_signal(signal.SIGTERM)
+        try:
+            self.process.wait(STOP_TIMEOUT_SEC)
+        except subprocess.TimeoutExpired:
+            self.process.kill()
+            self.process.wait()
+
+
+def run_loggen(args, scenario, port, latency_port):
+    command = [args.loggen, '--inet', '--' + scenario.transport,
+               '--rate', str(args.rate),
+               '--interval', str(args.duration),
+               '--size', str(args.size),
+               '--active-connections', str(args.connections)]
+    if scenario.input_file:
+        command += ['--read-file', scenario.input_file, '--loop-reading', '--dont-parse']
+    if scenario.latency:
+        command += ['--latency-port', str(latency_port)]
+    command += ['127.0.0.1', str(port)]
+
+    output = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                            universal_newlines=True).stdout
+
+    result = {'sent': None, 'p99_latency_usec': None}
+    match = re.search(r'average rate = [0-9.]+ msg/sec, count=([0-9]+)', output)
+    if match:
+        result['sent'] = int(match.group(1))
+    match = re.search(r'p99=([0-9]+) usec', output)
+    if match:
+        result['p99_latency_usec'] = int(match.group(1))
+    return result, output
+
+
+def wait_for_drain(control_socket, pid):
+    """Wait until syslog-ng stops receiving messages, returns the time,
+    the received counter and the CPU time at the last change"""
+    last = (time.time(), get_received(control_socket), get_cpu_seconds(pid))
+    deadline = last[0] + DRAIN_TIMEOUT_SEC
+
+    while time.time() < deadline and time.time() - last[0] < DRAIN_IDLE_SEC:
+        time.sleep(0.1)
+        received = get_received(control_socket)
+        if received != last[1]:
+            last = (time.time(), received, get_cpu_seconds(pid))
+    return last
+
+
+def run_scenario(args, scenario, config_version):
+    workdir = os.path.join(args.workdir, scenario.name)
+    shutil.rmtree(workdir, ignore_errors=True)
+    os.makedirs(workdir)
+
+    config = os.path.join(workdir, 'syslog-ng.conf')
+    with open(scenario.config) as template, open(config, 'w') as f:
+        f.write('@version: %s\n' % config_version)
+        f.write(template.read())
+
+    port = find_free_port()
+    latency_port = find_free_port()
+    env = dict(os.environ,
+               bench_port=str(port),
+               bench_latency_port=str(latency_port),
+               bench_workdir=workdir,
+               bench_confdir=CONFIG_DIR)
+
+    syslog_ng = SyslogNg(args.syslog_ng, args.module_path, workdir)
+    try:
+        syslog_ng.start(config, env)
+        pid = syslog_ng.process.pid
+
+        start = (time.time(), get_received(syslog_ng.control_socket), get_cpu_seconds(pid))
+        loggen_result, loggen_output = run_loggen(args, scenario, port, latency_port)
+        end = wait_for_drain(syslog_ng.control_socket, pid)
+
+        with open(os.path.join(workdir, 'loggen.out'), 'w') as f:
+            f.write(loggen_output)
+
+        received = end[1] - start[1]
+        elapsed = end[0] - start[0]
+        result = {
+            'scenario': scenario.name,
+            'sent': loggen_result['sent'],
+            'received': received,
+            'elapsed_sec': round(elapsed, 3),
+            'msgs_per_sec': round(received / elapsed, 1) if elapsed > 0 else None,
+            'cpu_usec_per_msg': round((end[2] - start[2]) * 1e6 / received, 3) if received else None,
+            'max_rss_kb': get_max_rss_kb(pid),
+            'p99_latency_usec': loggen_result['p99_latency_usec'],
+        }
+    except Exception as e:
+        result = {'scenario': scenario.name, 'error': str(e)}
+    finally:
+        syslog_ng.stop()
+    return result
+
+
+def format_value(value):
+    return '-' if value is None else str(value)
+
+
+def print_results(results):
+    columns = ['scenario', 'msgs_per_sec', 'cpu_usec_per_msg', 'max_rss_kb', 'p99_latency_usec', 'sent', 'received']
+    rows = [columns] + [[format_value(r.get(c)) if 'error' not in r or c == 'scenario' else 'error' for c in columns]
+                        for r in results]
+    widths = [max(len(row[i]) for row in rows) for i in range(len(columns))]
+    for row in rows:
+        print('  '.join(value.ljust(width) for value, width in zip(row, widths)).rstrip())
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Run the syslog-ng end-to-end throughput benchmarks')
+    parser.add_argument('--syslog-ng', default=os.getenv('SYSLOG_NG_BINARY', 'syslog-ng'),
+                        help='syslog-ng binary to benchmark')
+    parser.add_argument('--loggen', default=os.getenv('LOGGEN_BINARY', 'loggen'),
+                        help='loggen binary used to generate the load')
+    parser.add_argument('--module-path', default=None,
+                        help='module path of syslog-ng, defaults to the one compiled into the binary')
+    parser.add_argument('--workdir', default=os.path.abspath('bench-work'),
+                        help='directory for the configs, logs and output files of the runs')
+    parser.add_argument('--output', default='bench-results.json',
+                        help='file to write the results to, in JSON')
+    parser.add_argument('--scenario', action='append', choices=[s.name for s in SCENARIOS],
+                        help='scenario to run, can be repeated (default: all)')
+    parser.add_argument('--duration', type=int, default=10, help='length of a run in seconds')
+    parser.add_argument('--rate', type=int, default=100000, help='message rate per connection')
+    parser.add_argument('--connections', type=int, default=4, help='number of loggen connections')
+    parser.add_argument('--size', type=int, default=256, help='message size')
+    # BENCH_ARGS is how the make targets pass extra options
+    args = parser.parse_args(sys.argv[1:] + shlex.split(os.getenv('BENCH_ARGS', '')))
+    args.workdir = os.path.abspath(args.workdir)
+    return args
+
+
+def main():
+    args = parse_args()
+    scenarios = [s for s in SCENARIOS if not args.scenario or s.name in args.scenario]
+    config_version = get_config_version(args.syslog_ng)
+
+    results = []
+    for scenario in scenarios:
+        print('Running %s for %d seconds' % (scenario.name, args.duration), file=sys.stderr)
+        results.append(run_scenario(args, scenario, config_version))
+
+    report = {
+        'version': get_version_string(args.syslog_ng),
+        'hostname': socket.gethostname(),
+        'timestamp': time.strftime('%Y-%m-%dT%H:%M:%S%z'),
+        'parameters': {
+            'duration': args.duration,
+            'rate': args.rate,
+            'connections': args.connections,
+            'size': args.size,
+        },
+        'results': results,
+    }
+    with open(args.output, 'w') as f:
+        json.dump(report, f, indent=2)
+        f.write('\n')
+
+    print_results(results)
+    return 1 if any('error' in r for r in results) else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -44,7 +44,18 @@ destination d_sql {
         flush-lines(25) flush_timeout(100));
 };
 
-log { source(s_tcp); destination(d_sql); };
+destination d_sql_bulk {
+    sql(type(sqlite3) database("%(current_dir)s/test-sql-bulk.db") host(dummy) port(1234) username(dummy) password(dummy)
+        table("logs")
+        null("@NULL@")
+        columns("date datetime", "host", "program", "pid", "msg")
+        values("$DATE", "$HOST", "$PROGRAM", "${PID:-@NULL@}", "$MSG")
+        indexes("date", "host", "program")
+        flags(explicit-commits, bulk-insert)
+        flush-lines(25) flush_timeout(100));
+};
+
+log { source(s_tcp); destination(d_sql); destination(d_sql_bulk); };
 
 """ % locals()
 
@@ -96,4 +107,6 @@ def test_sql():
     time.sleep(10)
     stopped = stop_syslogng()
     time.sleep(5)
-    return stopped and check_sql_expected("%s/test-sql.db" % current_dir, "logs", expected, settle_time=5, syslog_prefix="Sep  7 10:43:21 bzorp prog 12345")
+    return stopped and \
+        check_sql_expected("%s/test-sql.db" % current_dir, "logs", expected, settle_time=5, syslog_prefix="Sep  7 10:43:21 bzorp prog 12345") and \
+        check_sql_expected("%s/test-sql-bulk.db" % current_dir, "logs", expected, settle_time=5, syslog_prefix="Sep  7 10:43:21 bzorp prog 12345")
@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "compat/glib.h"
+#include "latency_receiver.h"
+#include "logline_generator.h"
+#include "loggen_helper.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#define RECEIVE_BUFFER_SIZE 65536
+#define POLL_TIMEOUT_MSEC 100
+
+typedef struct _ReceiverConnection
+{
+  int fd;
+  GString *partial_line;
+} ReceiverConnection;
+
+static struct
+{
+  GThread *thread;
+  volatile gint running;
+  int udp_fd;
+  int listen_fd;
+  GPtrArray *connections;
+
+  /* protects the fields below, they are updated by the receiver thread and
+   * read by the main thread */
+  GMutex *lock;
+  LatencyHistogram histogram;
+  guint64 received;
+  guint64 unstamped;
+} receiver;
+
+static gint
+latency_histogram_bucket_index(guint64 value)
+{
+  if (value < LATENCY_HISTOGRAM_SUB_BUCKETS)
+    return value;
+
+  gint msb = 63 - __builtin_clzll(value);
+  return (msb - LATENCY_HISTOGRAM_SUB_BITS + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS +
+         ((value >> (msb - LATENCY_HISTOGRAM_SUB_BITS)) & (LATENCY_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/* the largest value that still falls into the bucket */
+static guint64
+latency_histogram_bucket_upper_bound(gint index)
+{
+  if (index < LATENCY_HISTOGRAM_SUB_BUCKETS)
+    return index;
+
+  gint msb = index / LATENCY_HISTOGRAM_SUB_BUCKETS + LATENCY_HISTOGRAM_SUB_BITS - 1;
+  guint64 sub_bucket = index % LATENCY_HISTOGRAM_SUB_BUCKETS;
+  guint64 width = G_GUINT64_CONSTANT(1) << (msb - LATENCY_HISTOGRAM_SUB_BITS);
+
+  return (LATENCY_HISTOGRAM_SUB_BUCKETS + sub_bucket) * width + width - 1;
+}
+
+void
+latency_histogram_record(LatencyHistogram *self, guint64 usec)
+{
+  if (self->count == 0 || usec < self->min)
+    self->min = usec;
+  if (usec > self->max)
+    self->max = usec;
+
+  self->buckets[latency_histogram_bucket_index(usec)]++;
+  self->count++;
+}
+
+guint64
+latency_histogram_get_percentile(const LatencyHistogram *self, gdouble percentile)
+{
+  if (self->count == 0)
+    return 0;
+
+  /* the rank is calculated in parts per million, to avoid rounding errors
+   * (e.g. p99.9 of 1000 values is the 999th and not the 1000th) */
+  guint64 ppm = (guint64) (CLAMP(percentile, 0, 100) * 10000 + 0.5);
+  guint64 rank = MAX((ppm * self->count + 999999) / 1000000, 1);
+  guint64 cumulative = 0;
+
+  for (gint i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+      cumulative += self->buckets[i];
+      if (cumulative >= rank)
+        return CLAMP(latency_histogram_bucket_upper_bound(i), self->min, self->max);
+    }
+  return self->max;
+}
+
+static guint64
+get_now_usec(void)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (guint64) now.tv_sec * USEC_PER_SEC + now.tv_usec;
+}
+
+static void
+record_line(const char *line, int line_length, guint64 now)
+{
+  gint64 sent = parse_send_timestamp(line, line_length);
+
+  receiver.received++;
+  if (sent < 0)
+    receiver.unstamped++;
+  else
+    latency_histogram_record(&receiver.histogram, now > sent ? now - sent : 0);
+}
+
+static void
+process_stream_chunk(ReceiverConnection *connection, const char *buffer, int length)
+{
+  guint64 now = get_now_usec();
+  const char *line = buffer;
+  const char *end = buffer + length;
+  const char *eol;
+
+  g_mutex_lock(receiver.lock);
+  while ((eol = memchr(line, '\n', end - line)))
+    {
+      if (connection->partial_line->len > 0)
+        {
+          g_string_append_len(connection->partial_line, line, eol - line);
+          record_line(connection->partial_line->str, connection->partial_line->len, now);
+          g_string_truncate(connection->partial_line, 0);
+        }
+      else
+        {
+          record_line(line, eol - line, now);
+        }
+      line = eol + 1;
+    }
+  g_mutex_unlock(receiver.lock);
+
+  g_string_append_len(connection->partial_line, line, end - line);
+}
+
+static void
+receive_datagrams(char *buffer)
+{
+  int rc;
+
+  while ((rc = recv(receiver.udp_fd, buffer, RECEIVE_BUFFER_SIZE, MSG_DONTWAIT)) > 0)
+    {
+      guint64 now = get_now_usec();
+
+      g_mutex_lock(receiver.lock);
+      record_line(buffer, rc, now);
+      g_mutex_unlock(receiver.lock);
+    }
+}
+
+static void
+accept_connection(void)
+{
+  int fd = accept(receiver.listen_fd, NULL, NULL);
+
+  if (fd < 0)
+    {
+      ERROR("error accepting latency connection (%s)\n", strerror(errno));
+      return;
+    }
+
+  ReceiverConnection *connection = g_new0(ReceiverConnection, 1);
+  connection->fd = fd;
+  connection->partial_line = g_string_sized_new(MAX_MESSAGE_LENGTH);
+  g_ptr_array_add(receiver.connections, connection);
+  DEBUG("latency connection accepted on socket %d\n", fd);
+}
+
+static void
+receiver_connection_free(ReceiverConnection *connection)
+{
+  close(connection->fd);
+  g_string_free(connection->partial_line, TRUE);
+  g_free(connection);
+}
+
+/* returns FALSE if the connection was closed */
+static gboolean
+receive_stream(ReceiverConnection *connection, char *buffer)
+{
+  int rc = recv(connection->fd, buffer, RECEIVE_BUFFER_SIZE, 0);
+
+  if (rc <= 0)
+    {
+      DEBUG("latency connection on socket %d closed\n", connection->fd);
+      return FALSE;
+    }
+
+  process_stream_chunk(connection, buffer, rc);
+  return TRUE;
+}
+
+static gpointer
+receiver_thread_func(gpointer user_data)
+{
+  char *buffer = g_malloc(RECEIVE_BUFFER_SIZE);
+  GArray *fds = g_array_new(FALSE, TRUE, sizeof(struct pollfd));
+
+  while (g_atomic_int_get(&receiver.running))
+    {
+      struct pollfd pfd = { .events = POLLIN };
+
+      g_array_set_size(fds, 0);
+      pfd.fd = receiver.udp_fd;
+      g_array_append_val(fds, pfd);
+      pfd.fd = receiver.listen_fd;
+      g_array_append_val(fds, pfd);
+      for (guint i = 0; i < receiver.connections->len; i++)
+        {
+          pfd.fd = ((ReceiverConnection *) g_ptr_array_index(receiver.connections, i))->fd;
+          g_array_append_val(fds, pfd);
+        }
+
+      if (poll((struct pollfd *) fds->data, fds->len, POLL_TIMEOUT_MSEC) <= 0)
+        continue;
+
+      if (g_array_index(fds, struct pollfd, 0).revents)
+        receive_datagrams(buffer);
+
+      /* connections are iterated backwards, as closed ones are removed */
+      for (gint i = receiver.connections->len - 1; i >= 0; i--)
+        {
+          ReceiverConnection *connection = g_ptr_array_index(receiver.connections, i);
+
+          if (g_array_index(fds, struct pollfd, i + 2).revents && !receive_stream(connection, buffer))
+            {
+              receiver_connection_free(connection);
+              g_ptr_array_remove_index(receiver.connections, i);
+            }
+        }
+
+      if (g_array_index(fds, struct pollfd, 1).revents)
+        accept_connection();
+    }
+
+  g_array_free(fds, TRUE);
+  g_free(buffer);
+  return NULL;
+}
+
+static int
+bind_socket(int sock_type, const char *port, int use_ipv6)
+{
+  struct sockaddr_storage addr = { 0 };
+  socklen_t addr_len;
+  int on = 1;
+
+  if (use_ipv6)
+    {
+      struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) &addr;
+
+      sin6->sin6_family = AF_INET6;
+      sin6->sin6_addr = in6addr_any;
+      sin6->sin6_port = htons(atoi(port));
+      addr_len = sizeof(*sin6);
+    }
+  else
+    {
+      struct sockaddr_in *sin = (struct sockaddr_in *) &addr;
+
+      sin->sin_family = AF_INET;
+      sin->sin_addr.s_addr = htonl(INADDR_ANY);
+      sin->sin_port = htons(atoi(port));
+      addr_len = sizeof(*sin);
+    }
+
+  int fd = socket(addr.ss_family, sock_type, 0);
+  if (fd < 0)
+    {
+      ERROR("error creating latency socket (%s)\n", strerror(errno));
+      return -1;
+    }
+
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  if (bind(fd, (struct sockaddr *) &addr, addr_len) < 0 ||
+      (sock_type == SOCK_STREAM && listen(fd, 255) < 0))
+    {
+      ERROR("error binding latency socket to port %s (%s)\n", port, strerror(errno));
+      close(fd);
+      return -1;
+    }
+  return fd;
+}
+
+gboolean
+latency_receiver_start(const char *port, int use_ipv6)
+{
+  receiver.udp_fd = bind_socket(SOCK_DGRAM, port, use_ipv6);
+  if (receiver.udp_fd < 0)
+    return FALSE;
+
+  receiver.listen_fd = bind_socket(SOCK_STREAM, port, use_ipv6);
+  if (receiver.listen_fd < 0)
+    {
+      close(receiver.udp_fd);
+      return FALSE;
+    }
+
+  receiver.connections = g_ptr_array_new();
+  receiver.lock = g_mutex_new();
+  receiver.running = TRUE;
+  receiver.thread = g_thread_new("latency-receiver", receiver_thread_func, NULL);
+
+  DEBUG("latency receiver listening on TCP & UDP port %s\n", port);
+  return TRUE;
+}
+
+/* wait until all the messages sent are received, or no more message
+ * arrives for timeout_sec */
+void
+latency_receiver_wait(guint64 expected_count, int timeout_sec)
+{
+  guint64 last_received = 0;
+  gint64 last_progress = g_get_monotonic_time();
+
+  while (g_get_monotonic_time() - last_progress < (gint64) timeout_sec * G_TIME_SPAN_SECOND)
+    {
+      g_mutex_lock(receiver.lock);
+      guint64 received = receiver.received;
+      g_mutex_unlock(receiver.lock);
+
+      if (received >= expected_count)
+        return;
+
+      if (received != last_received)
+        {
+          last_received = received;
+          last_progress = g_get_monotonic_time();
+        }
+      g_usleep(POLL_TIMEOUT_MSEC * 1000);
+    }
+
+  ERROR("timeout while waiting for messages to arrive back, received=%" G_GUINT64_FORMAT ", sent=%" G_GUINT64_FORMAT "\n",
+        last_received, expected_count);
+}
+
+void
+latency_receiver_stop(void)
+{
+  if (!receiver.thread)
+    return;
+
+  g_atomic_int_set(&receiver.running, FALSE);
+  g_thread_join(receiver.thread);
+  receiver.thread = NULL;
+
+  g_ptr_array_foreach(receiver.connections, (GFunc) receiver_connection_free, NULL);
+  g_ptr_array_free(receiver.connections, TRUE);
+  close(receiver.listen_fd);
+  close(receiver.udp_fd);
+  g_mutex_free(receiver.lock);
+}
+
+void
+latency_receiver_print_report(void)
+{
+  LatencyHistogram *histogram = &receiver.histogram;
+
+  g_mutex_lock(receiver.lock);
+  if (histogram->count == 0)
+    {
+      fprintf(stderr, "latency: no timestamped messages received, received=%" G_GUINT64_FORMAT "\n", receiver.received);
+    }
+  else
+    {
+      fprintf(stderr, "latency: received=%" G_GUINT64_FORMAT ", unstamped=%" G_GUINT64_FORMAT
+              ", min=%" G_GUINT64_FORMAT " usec, p50=%" G_GUINT64_FORMAT " usec, p99=%" G_GUINT64_FORMAT
+              " usec, p999=%" G_GUINT64_FORMAT " usec, max=%" G_GUINT64_FORMAT " usec\n",
+              receiver.received,
+              receiver.unstamped,
+              histogram->min,
+              latency_histogram_get_percentile(histogram, 50),
+              latency_histogram_get_percentile(histogram, 99),
+              latency_histogram_get_percentile(histogram, 99.9),
+              histogram->max);
+    }
+  g_mutex_unlock(receiver.lock);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef LATENCY_RECEIVER_H_INCLUDED
+#define LATENCY_RECEIVER_H_INCLUDED
+
+#include <glib.h>
+
+/* values below 2^LATENCY_HISTOGRAM_SUB_BITS are counted exactly, above
+ * that every power of two is split into 2^LATENCY_HISTOGRAM_SUB_BITS linear
+ * buckets, which keeps the error of a percentile below 6.25% */
+#define LATENCY_HISTOGRAM_SUB_BITS 4
+#define LATENCY_HISTOGRAM_SUB_BUCKETS (1 << LATENCY_HISTOGRAM_SUB_BITS)
+#define LATENCY_HISTOGRAM_BUCKETS ((64 - LATENCY_HISTOGRAM_SUB_BITS + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS)
+
+typedef struct _LatencyHistogram
+{
+  guint64 buckets[LATENCY_HISTOGRAM_BUCKETS];
+  guint64 count;
+  guint64 min;
+  guint64 max;
+} LatencyHistogram;
+
+void latency_histogram_record(LatencyHistogram *self, guint64 usec);
+guint64 latency_histogram_get_percentile(const LatencyHistogram *self, gdouble percentile);
+
+gboolean latency_receiver_start(const char *port, int use_ipv6);
+void latency_receiver_wait(guint64 expected_count, int timeout_sec);
+void latency_receiver_stop(void);
+void latency_receiver_print_report(void);
+
+#endif
@@ -27,6 +27,7 @@
 #include "loggen_helper.h"
 #include "file_reader.h"
 #include "logline_generator.h"
+#include "latency_receiver.h"
 #include "reloc.h"
 
 #include <stdio.h>
@@ -76,9 +77,13 @@ static char *proxy_src_ip = NULL;
 static char *proxy_dst_ip = NULL;
 static char *proxy_src_port = NULL;
 static char *proxy_dst_port = NULL;
+static char *latency_port = NULL;
 
 static GMutex *message_counter_lock = NULL;
 
+/* time to wait for the last messages to arrive back to the latency receiver */
+#define LATENCY_DRAIN_TIMEOUT_SEC 5
+
 static GOptionEntry loggen_options[] =
 {
   { "rate", 'r', 0, G_OPTION_ARG_INT, &global_plugin_option.rate, "Number of messages to generate per second", "<msg/sec/active connection>" },
@@ -101,6 +106,7 @@ static GOptionEntry loggen_options[] =
   { "quiet", 'Q', 0, G_OPTION_ARG_NONE, &quiet, "Don't print the msg/sec data", NULL },
   { "debug", 0, 0, G_OPTION_ARG_NONE, &debug, "Enable loggen debug messages", NULL },
   { "reconnect", 0, 0, G_OPTION_ARG_NONE, &global_plugin_option.reconnect, "Attempt to reconnect when destination connections are lost", NULL},
+  { "latency-port", 0, 0, G_OPTION_ARG_STRING, &latency_port, "Embed send timestamps into the messages, receive them back on this TCP and UDP port (e.g. from a syslog-ng destination) and report their end-to-end latency", "<port>" },
   { NULL }
 };
 
@@ -303,7 +309,8 @@ init_logline_generator(GPtrArray *plugin_array)
     syslog_proto,
     framing,
     global_plugin_option.message_length,
-    sdata_value);
+    sdata_value,
+    latency_port != NULL);
 }
 
 static void
@@ -566,6 +573,18 @@ main(int argc, char *argv[])
       return 1;
     }
 
+  if (latency_port)
+    {
+      if (read_from_file)
+        ERROR("warning: messages read from file carry no send timestamp, latency is not measured for them\n");
+
+      if (!latency_receiver_start(latency_port, global_plugin_option.use_ipv6))
+        {
+          close_file_reader(global_plugin_option.active_connections);
+          return 1;
+        }
+    }
+
   message_counter_lock = g_mutex_new();
 
   init_logline_generator(plugin_array);
@@ -575,8 +594,16 @@ main(int argc, char *argv[])
     {
       wait_all_plugin_to_finish(plugin_array);
       stop_plugins(plugin_array);
+
+      if (latency_port)
+        {
+          latency_receiver_wait(sent_messages_num, LATENCY_DRAIN_TIMEOUT_SEC);
+          latency_receiver_print_report();
+        }
     }
 
+  latency_receiver_stop();
+
   close_file_reader(global_plugin_option.active_connections);
 
   if (message_counter_lock)
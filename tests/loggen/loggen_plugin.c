@@ -55,37 +55,60 @@ thread_check_exit_criteria(ThreadData *thread_context)
   return FALSE;
 }
 
+static void
+time_val_add_usec(struct timeval *tv, guint64 usec)
+{
+  guint64 total_usec = tv->tv_usec + usec;
+
+  tv->tv_sec += total_usec / USEC_PER_SEC;
+  tv->tv_usec = total_usec % USEC_PER_SEC;
+}
+
+/*
+ * Token bucket rate control: tokens are credited for the time elapsed
+ * since the last refill, the fraction of a token left over is carried over
+ * to the next refill (so the rate does not drift downwards), and the bucket
+ * holds at most one second worth of tokens. If the bucket is empty, we
+ * sleep exactly until the next token is due.
+ */
 gboolean
 thread_check_time_bucket(ThreadData *thread_context)
 {
+  if (thread_context->buckets > 0)
+    return FALSE;
+
+  /* the rate may change at any time, see rate_change_handler() */
+  guint64 rate = MAX(thread_context->option->rate, 1);
   struct timeval now;
   gettimeofday(&now, NULL);
 
-  double diff_usec = time_val_diff_in_usec(&now, &thread_context->last_throttle_check);
-  if (thread_context->buckets == 0 || diff_usec > 1e5)
+  guint64 diff_usec = time_val_diff_in_usec(&now, &thread_context->last_throttle_check);
+  guint64 new_buckets = (rate * diff_usec) / USEC_PER_SEC;
+
+  if (new_buckets >= rate)
     {
-      /* check rate every 0.1sec */
-      long new_buckets = (long)((thread_context->option->rate * diff_usec) / USEC_PER_SEC);
-      if (new_buckets)
-        {
-          thread_context->buckets = (thread_context->option->rate < thread_context->buckets + new_buckets) ?
-                                    thread_context->option->rate : thread_context->buckets + new_buckets;
-          thread_context->last_throttle_check = now;
-        }
+      thread_context->buckets = rate;
+      thread_context->last_throttle_check = now;
+      return FALSE;
     }
 
-  if (thread_context->buckets == 0)
+  if (new_buckets > 0)
+    {
+      thread_context->buckets = new_buckets;
+      time_val_add_usec(&thread_context->last_throttle_check, (new_buckets * USEC_PER_SEC) / rate);
+      return FALSE;
+    }
+
+  guint64 token_usec = (USEC_PER_SEC + rate - 1) / rate;
+  if (token_usec > diff_usec)
     {
       struct timespec tspec;
-      long msec = (1000 / thread_context->option->rate) + 1;
+      guint64 wait_usec = token_usec - diff_usec;
 
-      tspec.tv_sec = msec / 1000;
-      tspec.tv_nsec = (msec % 1000) * 1000000;
+      tspec.tv_sec = wait_usec / USEC_PER_SEC;
+      tspec.tv_nsec = (wait_usec % USEC_PER_SEC) * 1000;
       while (nanosleep(&tspec, &tspec) < 0 && errno == EINTR)
         ;
-      return TRUE;
     }
-
-  return FALSE;
+  return TRUE;
 }
-
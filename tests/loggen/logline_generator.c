@@ -23,6 +23,7 @@
 
 #include "logline_generator.h"
 #include "loggen_helper.h"
+#include "tls-support.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -33,13 +34,33 @@
 #include <glib.h>
 
 static char line_buf_template[MAX_MESSAGE_LENGTH + 1];
+static int line_buf_template_length = 0;
 static int pos_timestamp1 = 0;
 static int pos_timestamp2 = 0;
 static int pos_seq = 0;
 static int pos_thread_id = 0;
+static int pos_send_stamp = 0;
+
+/* the formatted timestamps only change once per second, cache them per
+ * thread instead of calling localtime_r() & strftime() for every line */
+TLS_BLOCK_START
+{
+  time_t cached_sec;
+  char cached_stamp1[32];
+  char cached_stamp2[32];
+  int cached_stamp1_len;
+  int cached_stamp2_len;
+}
+TLS_BLOCK_END;
+
+#define cached_sec __tls_deref(cached_sec)
+#define cached_stamp1 __tls_deref(cached_stamp1)
+#define cached_stamp2 __tls_deref(cached_stamp2)
+#define cached_stamp1_len __tls_deref(cached_stamp1_len)
+#define cached_stamp2_len __tls_deref(cached_stamp2_len)
 
 int
-prepare_log_line_template(int syslog_proto, int framing, int message_length, char *sdata_value)
+prepare_log_line_template(int syslog_proto, int framing, int message_length, char *sdata_value, int send_timestamp)
 {
   int linelen = 0;
   char padding[] = "PADD";
@@ -79,6 +100,21 @@ prepare_log_line_template(int syslog_proto, int framing, int message_length, cha
       pos_timestamp2 = 107 + hdr_len;
     }
 
+  if (send_timestamp)
+    {
+      /* microseconds since the epoch, see parse_send_timestamp() */
+      int stamp_len = snprintf(line_buf_template + hdr_len + linelen, buffer_length - hdr_len - linelen,
+                               "%s%016d ", SEND_TIMESTAMP_PREFIX, 0);
+      pos_send_stamp = hdr_len + linelen + strlen(SEND_TIMESTAMP_PREFIX);
+      linelen += stamp_len;
+    }
+  else
+    {
+      pos_send_stamp = 0;
+    }
+
+  line_buf_template_length = strlen(line_buf_template);
+
   if (linelen > message_length)
     {
       ERROR("warning: message length is too small, the minimum is %d bytes\n", linelen);
@@ -92,6 +128,7 @@ prepare_log_line_template(int syslog_proto, int framing, int message_length, cha
 
   line_buf_template[hdr_len + message_length - 1] = '\n';
   line_buf_template[hdr_len + message_length] = 0;
+  line_buf_template_length = hdr_len + message_length;
 
   return linelen;
 }
@@ -105,22 +142,41 @@ generate_log_line(char *buffer, int buffer_length, int syslog_proto, int thread_
       return -1;
     }
 
-  /* make a copy of logline template */
-  memcpy(buffer, line_buf_template, buffer_length < MAX_MESSAGE_LENGTH ? buffer_length : MAX_MESSAGE_LENGTH);
+  /* make a copy of logline template, the callers reserve an extra byte
+   * after buffer_length for the terminating NUL */
+  int length = MIN(line_buf_template_length, buffer_length);
+  memcpy(buffer, line_buf_template, length);
+  buffer[length] = 0;
 
   /* create time stamps */
   struct timeval now;
   gettimeofday(&now, NULL);
-  struct tm tm;
-  char stamp[32];
-  localtime_r(&now.tv_sec, &tm);
-  int len = strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &tm);
-  memcpy(&buffer[pos_timestamp2], stamp, len);
 
-  if (syslog_proto)
-    format_timezone_offset_with_colon(stamp, sizeof(stamp), &tm);
+  if (cached_sec != now.tv_sec || cached_stamp1_len == 0)
+    {
+      struct tm tm;
+
+      localtime_r(&now.tv_sec, &tm);
+      cached_stamp2_len = strftime(cached_stamp2, sizeof(cached_stamp2), "%Y-%m-%dT%H:%M:%S", &tm);
+      memcpy(cached_stamp1, cached_stamp2, cached_stamp2_len + 1);
 
-  memcpy(&buffer[pos_timestamp1], stamp, strlen(stamp));
+      if (syslog_proto)
+        format_timezone_offset_with_colon(cached_stamp1, sizeof(cached_stamp1), &tm);
+      cached_stamp1_len = strlen(cached_stamp1);
+      cached_sec = now.tv_sec;
+    }
+
+  memcpy(&buffer[pos_timestamp2], cached_stamp2, cached_stamp2_len);
+  memcpy(&buffer[pos_timestamp1], cached_stamp1, cached_stamp1_len);
+
+  if (pos_send_stamp)
+    {
+      char stampbuf[32];
+      gint64 usec = (gint64) now.tv_sec * USEC_PER_SEC + now.tv_usec;
+
+      snprintf(stampbuf, sizeof(stampbuf), "%016" G_GINT64_FORMAT, usec);
+      memcpy(&buffer[pos_send_stamp], stampbuf, 16);
+    }
 
   /* print sequence number to logline */
   char intbuf[16];
@@ -132,6 +188,28 @@ generate_log_line(char *buffer, int buffer_length, int syslog_proto, int thread_
   snprintf(thread_id_buff, sizeof(thread_id_buff), "%04d", thread_id);
   memcpy(&buffer[pos_thread_id], thread_id_buff, 4);
 
-  return strlen(buffer);
+  return length;
+}
+
+gint64
+parse_send_timestamp(const char *line, int line_length)
+{
+  const char *stamp = g_strstr_len(line, line_length, SEND_TIMESTAMP_PREFIX);
+
+  if (!stamp)
+    return -1;
+
+  stamp += strlen(SEND_TIMESTAMP_PREFIX);
+  if (stamp + 16 > line + line_length)
+    return -1;
+
+  gint64 usec = 0;
+  for (int i = 0; i < 16; i++)
+    {
+      if (!g_ascii_isdigit(stamp[i]))
+        return -1;
+      usec = usec * 10 + (stamp[i] - '0');
+    }
+  return usec;
 }
 
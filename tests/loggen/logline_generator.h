@@ -24,7 +24,14 @@
 #ifndef LOGLINE_GENERATOR_H_INCLUDED
 #define LOGLINE_GENERATOR_H_INCLUDED
 
+#include <glib.h>
+
+/* prefix of the send timestamp embedded into the generated lines */
+#define SEND_TIMESTAMP_PREFIX "sent: "
+
 int generate_log_line(char *buffer, int buffer_length, int syslog_proto, int thread_id, unsigned long seq);
-int prepare_log_line_template(int syslog_proto, int framing, int message_length, char *sdata_value);
+int prepare_log_line_template(int syslog_proto, int framing, int message_length, char *sdata_value,
+                              int send_timestamp);
+gint64 parse_send_timestamp(const char *line, int line_length);
 
 #endif
@@ -53,6 +53,24 @@ static GOptionEntry  *get_options(void);
 static gboolean       is_plugin_activated(void);
 static GPtrArray      *thread_array = NULL;
 
+#ifdef SYSLOG_NG_HAVE_SENDMMSG
+#define DGRAM_BATCH_SIZE 64
+
+/* datagrams are sent in batches with sendmmsg(), using one syscall for up
+ * to DGRAM_BATCH_SIZE messages instead of one for each */
+typedef struct _DgramBatch
+{
+  struct mmsghdr headers[DGRAM_BATCH_SIZE];
+  struct iovec iov[DGRAM_BATCH_SIZE];
+  char *messages[DGRAM_BATCH_SIZE];
+} DgramBatch;
+
+static DgramBatch    *dgram_batch_new(void);
+static void           dgram_batch_free(DgramBatch *self);
+static int            send_dgram_batch(int fd, DgramBatch *batch, ThreadData *thread_context, unsigned long *count,
+                                       gboolean *connection_error);
+#endif
+
 static gboolean thread_run;
 static generate_message_func generate_message;
 static GMutex *thread_lock = NULL;
@@ -323,6 +341,9 @@ active_thread_func(gpointer user_data)
     sock_type = SOCK_STREAM;
 
   char *message = g_malloc0(MAX_MESSAGE_LENGTH+1);
+#ifdef SYSLOG_NG_HAVE_SENDMMSG
+  DgramBatch *dgram_batch = sock_type == SOCK_DGRAM ? dgram_batch_new() : NULL;
+#endif
 
   int fd;
   if (unix_socket_x)
@@ -380,20 +401,33 @@ active_thread_func(gpointer user_data)
           break;
         }
 
-      int str_len = generate_message(message, MAX_MESSAGE_LENGTH, thread_context, count++);
-
-      if (str_len < 0)
+#ifdef SYSLOG_NG_HAVE_SENDMMSG
+      if (dgram_batch)
         {
-          ERROR("can't generate more log lines. end of input file?\n");
-          break;
+          if (send_dgram_batch(fd, dgram_batch, thread_context, &count, &connection_error) < 0)
+            {
+              ERROR("can't generate more log lines. end of input file?\n");
+              break;
+            }
         }
+      else
+#endif
+        {
+          int str_len = generate_message(message, MAX_MESSAGE_LENGTH, thread_context, count++);
+
+          if (str_len < 0)
+            {
+              ERROR("can't generate more log lines. end of input file?\n");
+              break;
+            }
 
-      connection_error = send_msg(fd, message, str_len);
+          connection_error = send_msg(fd, message, str_len);
 
-      if(!connection_error)
-        {
-          thread_context->sent_messages++;
-          thread_context->buckets--;
+          if(!connection_error)
+            {
+              thread_context->sent_messages++;
+              thread_context->buckets--;
+            }
         }
 
       if(connection_error && option->reconnect && thread_run)
@@ -428,6 +462,9 @@ active_thread_func(gpointer user_data)
   DEBUG("thread (%s,%p) finished\n", socket_loggen_plugin_info.name, g_thread_self());
 
   g_free((gpointer)message);
+#ifdef SYSLOG_NG_HAVE_SENDMMSG
+  dgram_batch_free(dgram_batch);
+#endif
   g_mutex_lock(thread_lock);
   active_thread_count--;
   g_mutex_unlock(thread_lock);
@@ -490,3 +527,98 @@ send_plain(int fd, void *buf, size_t length)
     }
   return (cc);
 }
+
+#ifdef SYSLOG_NG_HAVE_SENDMMSG
+static DgramBatch *
+dgram_batch_new(void)
+{
+  DgramBatch *self = g_new0(DgramBatch, 1);
+
+  for (int i = 0; i < DGRAM_BATCH_SIZE; i++)
+    {
+      self->messages[i] = g_malloc0(MAX_MESSAGE_LENGTH+1);
+      self->iov[i].iov_base = self->messages[i];
+      self->headers[i].msg_hdr.msg_iov = &self->iov[i];
+      self->headers[i].msg_hdr.msg_iovlen = 1;
+    }
+  return self;
+}
+
+static void
+dgram_batch_free(DgramBatch *self)
+{
+  if (!self)
+    return;
+
+  for (int i = 0; i < DGRAM_BATCH_SIZE; i++)
+    g_free(self->messages[i]);
+  g_free(self);
+}
+
+static int
+get_dgram_batch_size(ThreadData *thread_context)
+{
+  int batch_size = MIN(DGRAM_BATCH_SIZE, thread_context->buckets);
+
+  if (thread_context->option->number_of_messages != 0)
+    batch_size = MIN(batch_size, thread_context->option->number_of_messages - thread_context->sent_messages);
+  return MAX(batch_size, 1);
+}
+
+/* returns the number of messages sent, or -1 if no message could be generated */
+static int
+send_dgram_batch(int fd, DgramBatch *batch, ThreadData *thread_context, unsigned long *count,
+                 gboolean *connection_error)
+{
+  int batch_size = get_dgram_batch_size(thread_context);
+  int generated = 0;
+
+  for (; generated < batch_size; generated++)
+    {
+      int str_len = generate_message(batch->messages[generated], MAX_MESSAGE_LENGTH, thread_context, (*count)++);
+
+      if (str_len < 0)
+        break;
+      batch->iov[generated].iov_len = str_len;
+    }
+
+  if (generated == 0)
+    return -1;
+
+  int sent = 0;
+  while (sent < generated)
+    {
+      int rc = sendmmsg(fd, &batch->headers[sent], generated - sent, 0);
+
+      if (rc > 0)
+        {
+          sent += rc;
+          continue;
+        }
+      if (rc < 0 && errno == ENOBUFS)
+        {
+          /* SendQ for the network interface is full, see send_plain() */
+          struct timespec tspec;
+
+          /* wait 1 msec */
+          tspec.tv_sec = 0;
+          tspec.tv_nsec = 1e6;
+          while (nanosleep(&tspec, &tspec) < 0 && errno == EINTR)
+            ;
+          continue;
+        }
+
+      ERROR("error sending batch on %d (rc=%d)\n", fd, rc);
+      errno = ECONNABORTED;
+      *connection_error = TRUE;
+      break;
+    }
+
+  thread_context->sent_messages += sent;
+  thread_context->buckets -= sent;
+
+  if (generated < batch_size && !*connection_error)
+    return -1;
+  return sent;
+}
+#endif
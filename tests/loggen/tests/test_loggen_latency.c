@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "tests/loggen/logline_generator.c"
+#include "tests/loggen/latency_receiver.c"
+
+#include <criterion/criterion.h>
+
+Test(loggen_latency, test_generated_lines_carry_the_send_timestamp)
+{
+  char buffer[MAX_MESSAGE_LENGTH + 1];
+
+  cr_assert(prepare_log_line_template(0, 0, 256, NULL, 1) > 0);
+
+  guint64 before = get_now_usec();
+  int length = generate_log_line(buffer, MAX_MESSAGE_LENGTH, 0, 1, 42);
+  guint64 after = get_now_usec();
+
+  cr_assert_eq(length, 256);
+  cr_assert_eq(buffer[length - 1], '\n');
+  cr_assert_not_null(strstr(buffer, "seq: 0000000042"));
+
+  gint64 sent = parse_send_timestamp(buffer, length);
+  cr_assert((guint64) sent >= before && (guint64) sent <= after, "sent=%" G_GINT64_FORMAT, sent);
+}
+
+Test(loggen_latency, test_lines_without_send_timestamp_are_not_parsed)
+{
+  char buffer[MAX_MESSAGE_LENGTH + 1];
+
+  cr_assert(prepare_log_line_template(0, 0, 256, NULL, 0) > 0);
+  int length = generate_log_line(buffer, MAX_MESSAGE_LENGTH, 0, 1, 42);
+
+  cr_assert_eq(length, 256);
+  cr_assert_eq(parse_send_timestamp(buffer, length), -1);
+  cr_assert_eq(parse_send_timestamp("sent: 12345", 11), -1);
+  cr_assert_eq(parse_send_timestamp("sent: 000000000000000x", 22), -1);
+}
+
+Test(loggen_latency, test_histogram_percentiles)
+{
+  static LatencyHistogram histogram;
+
+  for (guint64 i = 1; i <= 1000; i++)
+    latency_histogram_record(&histogram, i);
+
+  cr_assert_eq(histogram.count, 1000);
+  cr_assert_eq(histogram.min, 1);
+  cr_assert_eq(histogram.max, 1000);
+
+  /* exact below LATENCY_HISTOGRAM_SUB_BUCKETS, within 6.25% above */
+  cr_assert_eq(latency_histogram_get_percentile(&histogram, 0.5), 5);
+  cr_assert_geq(latency_histogram_get_percentile(&histogram, 50), 500);
+  cr_assert_leq(latency_histogram_get_percentile(&histogram, 50), 500 * 1.0625);
+  cr_assert_geq(latency_histogram_get_percentile(&histogram, 99), 990);
+  cr_assert_leq(latency_histogram_get_percentile(&histogram, 99), 1000);
+  cr_assert_eq(latency_histogram_get_percentile(&histogram, 100), 1000);
+}
+
+Test(loggen_latency, test_empty_histogram)
+{
+  static LatencyHistogram histogram;
+
+  cr_assert_eq(latency_histogram_get_percentile(&histogram, 99), 0);
+}